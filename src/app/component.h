@@ -35,6 +35,13 @@ namespace flexran {
 
   namespace app {
 
+    /// outcome of a batch operation for one BS, error is empty on success
+    struct bs_result {
+      uint64_t bs_id;
+      std::string error;
+    };
+    typedef std::vector<bs_result> batch_results;
+
     class component : public core::rt::rt_task {
     public:
 
@@ -55,7 +62,22 @@ namespace flexran {
       //  with the right scheduling policy has as set in the constructor.
       virtual void run_app() { LOG4CXX_ERROR(flog::app, "run_app() not implemented"); }
 
+      //! resolves the BSs of a batch operation, see Rib::select_bs()
+      bool select_bs(const std::string& selector, std::vector<uint64_t>& bs_ids,
+          std::string& error_reason) const
+      { return rib_.select_bs(selector, bs_ids, error_reason); }
+
     protected:
+      //! BS IDs for logging, e.g., "1234" or "{1234, 5678}"
+      static std::string format_bs_ids(const std::vector<uint64_t>& bs_ids)
+      {
+        if (bs_ids.size() == 1) return std::to_string(bs_ids[0]);
+        std::string s = "{";
+        for (uint64_t bs_id : bs_ids)
+          s += (s.size() > 1 ? ", " : "") + std::to_string(bs_id);
+        return s + "}";
+      }
+
       const rib::Rib& rib_;
       const core::requests_manager& req_manager_;
       event::subscription& event_sub_;
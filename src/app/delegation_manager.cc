@@ -99,7 +99,6 @@ void flexran::app::management::delegation_manager::reconfigure_agent(
   protocol::flex_header *config_header(new protocol::flex_header);
   config_header->set_type(protocol::FLPT_RECONFIGURE_AGENT);
   config_header->set_version(0);
-  config_header->set_xid(0);
   
   protocol::flex_agent_reconfiguration *agent_reconfiguration_msg(new protocol::flex_agent_reconfiguration);
   agent_reconfiguration_msg->set_allocated_header(config_header);
@@ -108,7 +107,7 @@ void flexran::app::management::delegation_manager::reconfigure_agent(
 
   config_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   config_message.set_allocated_agent_reconfiguration_msg(agent_reconfiguration_msg);
-  req_manager_.send_message(bs_id, config_message);
+  req_manager_.send_request(bs_id, config_message);
 }
 
 void flexran::app::management::delegation_manager::push_code(
@@ -119,7 +118,6 @@ void flexran::app::management::delegation_manager::push_code(
   protocol::flex_header *delegation_header(new protocol::flex_header);
   delegation_header->set_type(protocol::FLPT_DELEGATE_CONTROL);
   delegation_header->set_version(0);
-  delegation_header->set_xid(0);
   
   protocol::flex_control_delegation *control_delegation_msg(new protocol::flex_control_delegation);
   control_delegation_msg->set_allocated_header(delegation_header);
@@ -138,5 +136,5 @@ void flexran::app::management::delegation_manager::push_code(
   // Create and send the flexran message
   d_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   d_message.set_allocated_control_delegation_msg(control_delegation_msg);
-  req_manager_.send_message(bs_id, d_message);
+  req_manager_.send_request(bs_id, d_message);
 }
@@ -15,7 +15,7 @@
  * For more information about Mosaic5G:  contact@mosaic-5g.io
  */
 
-/*! \file    elastic_search.h
+/*! \file    elastic_search.cc
  *  \brief   Elastic Search client for database feeding
  *  \authors Robert Schmidt, Berkay Köksal
  *  \company Eurecom
@@ -24,64 +24,89 @@
 
 #include "elastic_search.h"
 #include "enb_rib_info.h"
+#include "rib.h"
 #include "flexran_log.h"
 #include "rt_controller_common.h"
+#include "rt_wrapper.h"
 
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <algorithm>
 #include <chrono>
 #include <string>
 #include <thread>
 #include <curl/curl.h>
 #include <regex>
 
+constexpr const uint64_t flexran::app::log::elastic_search::max_transfers_per_endpoint;
+
 flexran::app::log::elastic_search::elastic_search(const rib::Rib& rib,
-    const core::requests_manager& rm, event::subscription& sub)
+    const core::requests_manager& rm, event::subscription& sub,
+    size_t queue_size)
   : component(rib, rm, sub),
     active_since_(std::chrono::system_clock::now()),
     sent_packets_(0),
     freq_stats_ (100),
     freq_config_(5000),
     batch_stats_max_no_(100),
-    batch_config_max_no_(5)
+    batch_config_max_no_(5),
+    queue_(queue_size)
 {
-  elastic_search_ep_.push_back("localhost:9200"),
+  elastic_search_ep_.push_back("localhost:9200");
+  endpoints_ = std::make_shared<const std::vector<std::string>>(elastic_search_ep_);
   curl_global_init(CURL_GLOBAL_DEFAULT);
   curl_multi_ = curl_multi_init();
+  /* Elastic Search speaks HTTP/1.1, so a connection carries one transfer at
+   * a time; with HTTP/2, transfers to one endpoint are multiplexed */
+  curl_multi_setopt(curl_multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  curl_multi_setopt(curl_multi_, CURLMOPT_MAX_HOST_CONNECTIONS,
+      static_cast<long>(max_transfers_per_endpoint));
+  //Headers for bulk request
+  curl_headers_ = curl_slist_append(NULL, "Expect:");
+  curl_headers_ = curl_slist_append(curl_headers_, "Content-Type: application/x-ndjson");
+  sender_ = std::thread(&elastic_search::run, this);
 }
 
 flexran::app::log::elastic_search::~elastic_search()
 {
-  disable_logging();
+  /* no flush sample: the queue might be full, so the sender ships its
+   * batches itself when stopping */
+  disconnect_ticks();
+  stop_ = true;
+  sender_.join();
   curl_multi_cleanup(curl_multi_);
+  curl_slist_free_all(curl_headers_);
   curl_global_cleanup();
 }
 
+bool flexran::app::log::elastic_search::push(sample::kind k, bool snapshot)
+{
+  /* only the tick thread pushes, so a free slot stays free; check it before
+   * taking a snapshot that would be thrown away */
+  if (queue_.write_available() == 0) {
+    /* logging every drop would slow down the tick thread further */
+    if (dropped_samples_++ == 0)
+      LOG4CXX_WARN(flog::app, "elastic_search: sender is behind, dropping samples");
+    return false;
+  }
+  /* prepare_snapshot() only copies which BSs and UEs exist, the sender
+   * copies the contents */
+  sample *s = new sample{k, std::chrono::system_clock::now(),
+      snapshot ? rib_.prepare_snapshot(std::atomic_load(&last_snapshot_)) : nullptr,
+      endpoints_,
+      k == sample::kind::config ? batch_config_max_no_ : batch_stats_max_no_};
+  queue_.push(s);
+  backlog_++;
+  return true;
+}
 
 void flexran::app::log::elastic_search::process_stats(uint64_t tick)
 {
   _unused(tick);
-
-  //Collect all UE stats from all BS and fill the bulk batch
-  int ue_count = 0;
-  for (uint64_t bs_id : rib_.get_available_base_stations()) {
-    std::shared_ptr<rib::enb_rib_info> bs_config = rib_.get_bs(bs_id);
-    const auto& lueu = bs_config->get_ue_configs();
-    ue_count += lueu.ue_config().size();
-    for(auto& flex_ue_config : lueu.ue_config()) {
-      const flexran::rib::rnti_t rnti = flex_ue_config.rnti();
-      std::shared_ptr<rib::ue_mac_rib_info> ue_mac_info = bs_config->get_ue_mac_info(rnti);
-      const std::string json = rib_.format_statistics_to_json(
-          std::chrono::system_clock::now(),
-          "",
-          ue_mac_info->dump_stats_to_json_string());
-      batch_stats_data_ += bulk_create_index("mac_stats", json);
-    }
-  }
-  batch_stats_current_no_ += ue_count;
-
-  if (batch_stats_current_no_ >= batch_stats_max_no_) {
-    trigger_send(batch_stats_data_);
-    initialise_batch_stats();
-  }
+  push(sample::kind::stats, true);
 }
 
 void flexran::app::log::elastic_search::ue_disconnect(uint64_t bs_id, flexran::rib::rnti_t rnti)
@@ -95,35 +120,148 @@ void flexran::app::log::elastic_search::ue_disconnect(uint64_t bs_id, flexran::r
     ue_count += bs_config->get_ue_configs().ue_config().size();
   }
   /* if it is the last UE (new ue_count 0), send the batch off */
-  if (ue_count == 0) {
-    trigger_send(batch_stats_data_);
-    initialise_batch_stats();
-  }
+  if (ue_count == 0)
+    push(sample::kind::flush_stats, false);
 }
 
 void flexran::app::log::elastic_search::process_config(uint64_t tick)
 {
   _unused(tick);
+  push(sample::kind::config, true);
+}
 
-  const std::string s = rib_.format_statistics_to_json(
-      std::chrono::system_clock::now(),
-      rib_.dump_all_enb_configurations_to_json_string(),
-      "");
-  batch_config_data_ += bulk_create_index("enb_config", s);
-  batch_config_current_no_++;
+void flexran::app::log::elastic_search::run()
+{
+  /* signals are handled by the main thread only */
+  sigset_t sigmask;
+  sigfillset(&sigmask);
+  pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+
+  core::rt::become_background_thread();
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);
+  pthread_setname_np(pthread_self(), "es_sender");
+
+  while (true) {
+    /* on shutdown, samples queued before are still sent */
+    const bool stop = stop_;
+    sample *s;
+    while (queue_.pop(s)) {
+      backlog_--;
+      handle(*s);
+      delete s;
+    }
+    if (stop)
+      break;
+    process_curl();
+    if (pending_transfers_ > 0) {
+      int numfds;
+      curl_multi_wait(curl_multi_, NULL, 0, 1, &numfds);
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  /* ship what has been collected since the last batch */
+  if (last_endpoints_) {
+    send(batch_config_data_, last_endpoints_);
+    send(batch_stats_data_, last_endpoints_);
+  }
+  wait_curl_end();
+  curl_cleanup_handles();
+}
+
+void flexran::app::log::elastic_search::handle(sample& s)
+{
+  last_endpoints_ = s.endpoints;
+  if (s.snapshot) {
+    s.snapshot->complete_snapshot();
+    std::atomic_store(&last_snapshot_, std::shared_ptr<const rib::Rib>(s.snapshot));
+  }
 
-  if (batch_config_current_no_ >= batch_config_max_no_) {
-    trigger_send(batch_config_data_);
-    initialise_batch_config();
+  switch (s.k) {
+    case sample::kind::stats:
+      /* one document per UE */
+      for (uint64_t bs_id : s.snapshot->get_available_base_stations()) {
+        std::shared_ptr<rib::enb_rib_info> bs_config = s.snapshot->get_bs(bs_id);
+        for (const auto& flex_ue_config : bs_config->get_ue_configs().ue_config()) {
+          std::shared_ptr<rib::ue_mac_rib_info> ue_mac_info =
+              bs_config->get_ue_mac_info(flex_ue_config.rnti());
+          if (!ue_mac_info) continue;
+          const std::string json = rib::Rib::format_statistics_to_json(s.time, "",
+              ue_mac_info->dump_stats_to_json_string());
+          batch_stats_data_ += bulk_create_index("mac_stats", json);
+          batch_stats_current_no_++;
+        }
+      }
+      if (batch_stats_current_no_ >= s.batch_max) {
+        send(batch_stats_data_, s.endpoints);
+        batch_stats_current_no_ = 0;
+      }
+      break;
+    case sample::kind::config:
+      batch_config_data_ += bulk_create_index("enb_config",
+          rib::Rib::format_statistics_to_json(s.time,
+              s.snapshot->dump_all_enb_configurations_to_json_string(), ""));
+      batch_config_current_no_++;
+      if (batch_config_current_no_ >= s.batch_max) {
+        send(batch_config_data_, s.endpoints);
+        batch_config_current_no_ = 0;
+      }
+      break;
+    case sample::kind::flush:
+      send(batch_config_data_, s.endpoints);
+      batch_config_current_no_ = 0;
+      /* fall through */
+    case sample::kind::flush_stats:
+      send(batch_stats_data_, s.endpoints);
+      batch_stats_current_no_ = 0;
+      break;
   }
 }
 
-void flexran::app::log::elastic_search::trigger_send(const std::string& s)
+void flexran::app::log::elastic_search::send(std::string& data,
+    const std::shared_ptr<const std::vector<std::string>>& endpoints)
 {
-  /* place a new transfer handle in curl's transfer queue */
-  for (const std::string& addr : elastic_search_ep_) {
-    CURL *temp = curl_create_transfer(addr + "/_bulk", s);
-    curl_multi_add_handle(curl_multi_, temp);
+  if (data.empty())
+    return;
+  /* curl does not copy the data, all transfers of this batch share it */
+  auto payload = std::make_shared<const std::string>(std::move(data));
+  data.clear();
+  data.reserve(payload->size());
+
+  /* place a transfer handle of the endpoint in curl's transfer queue */
+  for (const std::string& addr : *endpoints) {
+    endpoint_pool& pool = pools_[addr];
+    if (pool.in_flight >= max_transfers_per_endpoint) {
+      dropped_batches_++;
+      LOG4CXX_WARN(flog::app, "elastic_search: " << pool.in_flight
+          << " transfers pending, dropping batch for " << addr);
+      continue;
+    }
+    CURL *e = curl_get_handle(addr);
+    if (!e) {
+      failed_packets_++;
+      continue;
+    }
+    curl_easy_setopt(e, CURLOPT_POSTFIELDS, payload->data());
+    curl_easy_setopt(e, CURLOPT_POSTFIELDSIZE_LARGE,
+        static_cast<curl_off_t>(payload->size()));
+    transfers_[e] = transfer{addr, payload};
+    curl_multi_add_handle(curl_multi_, e);
+    pool.in_flight++;
+    pending_transfers_++;
+  }
+
+  /* close the connections of removed endpoints */
+  for (auto it = pools_.begin(); it != pools_.end(); ) {
+    const bool used = std::find(endpoints->begin(), endpoints->end(), it->first)
+        != endpoints->end();
+    if (used || it->second.in_flight > 0) {
+      ++it;
+      continue;
+    }
+    for (CURL *e : it->second.idle)
+      curl_easy_cleanup(e);
+    it = pools_.erase(it);
   }
   /* actual transfer happens in process_curl() */
 }
@@ -147,25 +285,30 @@ std::string flexran::app::log::elastic_search::bulk_create_index(
   return s;
 }
 
-CURL *flexran::app::log::elastic_search::curl_create_transfer(
-    const std::string& addr, const std::string& data)
+CURL *flexran::app::log::elastic_search::curl_get_handle(const std::string& addr)
 {
-  CURL *curl1;
-  curl1 = curl_easy_init();
+  endpoint_pool& pool = pools_[addr];
+  if (!pool.idle.empty()) {
+    CURL *e = pool.idle.back();
+    pool.idle.pop_back();
+    return e;
+  }
 
-  //Headers for bulk request
-  struct curl_slist *headers = NULL;
-  headers = curl_slist_append(headers, "Expect:");
-  headers = curl_slist_append(headers, "Content-Type: application/x-ndjson");
-  curl_easy_setopt(curl1, CURLOPT_HTTPHEADER, headers);
+  CURL *curl1 = curl_easy_init();
+  if (!curl1) {
+    LOG4CXX_ERROR(flog::app, "elastic_search: cannot create CURL handle for " << addr);
+    return nullptr;
+  }
+  curl_easy_setopt(curl1, CURLOPT_HTTPHEADER, curl_headers_);
 
   //Request options
-  curl_easy_setopt(curl1, CURLOPT_URL, addr.c_str());
-  curl_easy_setopt(curl1, CURLOPT_POSTFIELDSIZE, data.length());
-  /* tell curl to copy string so we can override it afterwards */
-  curl_easy_setopt(curl1, CURLOPT_COPYPOSTFIELDS, data.c_str());
+  const std::string url = addr + "/_bulk";
+  curl_easy_setopt(curl1, CURLOPT_URL, url.c_str());
   curl_easy_setopt(curl1, CURLOPT_POST, 1L);
   curl_easy_setopt(curl1, CURLOPT_VERBOSE, 0L);
+  curl_easy_setopt(curl1, CURLOPT_TCP_KEEPALIVE, 1L);
+  /* an unreachable cluster must not keep transfers pending forever */
+  curl_easy_setopt(curl1, CURLOPT_TIMEOUT, 10L);
   /* provide lambda that swallows all output. operator+ converts to function
    * pointer which is necessary since we call a C library */
   curl_easy_setopt(curl1, CURLOPT_WRITEFUNCTION,
@@ -176,7 +319,8 @@ CURL *flexran::app::log::elastic_search::curl_create_transfer(
 
 void flexran::app::log::elastic_search::curl_release_handles()
 {
-  /* check finished transfers and remove/free the handles */
+  /* check finished transfers, remove the handles and give them back to their
+   * endpoint, which keeps the connection open */
   CURLMsg *m;
   int n;
   do {
@@ -185,27 +329,46 @@ void flexran::app::log::elastic_search::curl_release_handles()
      CURL *e = m->easy_handle;
      long code = 0;
      curl_easy_getinfo(e, CURLINFO_RESPONSE_CODE, &code);
-     if (code == 200) /* if ok */
+     if (m->data.result == CURLE_OK && code == 200) /* if ok */
        sent_packets_ += 1;
+     else
+       failed_packets_ += 1;
      curl_multi_remove_handle(curl_multi_, e);
-     curl_easy_cleanup(e);
+     pending_transfers_--;
+
+     auto t = transfers_.find(e);
+     endpoint_pool& pool = pools_[t->second.addr];
+     pool.in_flight--;
+     pool.idle.push_back(e);
+     /* the last transfer of a batch frees its payload */
+     transfers_.erase(t);
    }
   } while (m);
 }
 
-void flexran::app::log::elastic_search::process_curl(uint64_t tick)
+void flexran::app::log::elastic_search::curl_cleanup_handles()
 {
-  _unused(tick);
+  for (auto& t : transfers_) {
+    curl_multi_remove_handle(curl_multi_, t.first);
+    curl_easy_cleanup(t.first);
+  }
+  transfers_.clear();
+  for (auto& p : pools_)
+    for (CURL *e : p.second.idle)
+      curl_easy_cleanup(e);
+  pools_.clear();
+  pending_transfers_ = 0;
+}
 
+void flexran::app::log::elastic_search::process_curl()
+{
   int n;
   /* from documentation for curl_multi_perform(): "This function does not
    * require that there actually is any data available for reading or that data
    * can be written, it can be called just in case." */
   CURLMcode mc = curl_multi_perform(curl_multi_, &n);
-  if (mc != CURLM_OK) {
-    LOG4CXX_ERROR(flog::app, "CURL encountered a problem (" << mc << "), disabling logging");
-    disable_logging();
-  }
+  if (mc != CURLM_OK)
+    LOG4CXX_ERROR(flog::app, "elastic_search: CURL encountered a problem (" << mc << ")");
 
   curl_release_handles();
 }
@@ -242,6 +405,8 @@ bool flexran::app::log::elastic_search::add_endpoint(const std::string& ep)
   if (it != elastic_search_ep_.end()) return false;
 
   elastic_search_ep_.push_back(ep);
+  /* the sender keeps using the list of queued samples */
+  endpoints_ = std::make_shared<const std::vector<std::string>>(elastic_search_ep_);
   return true;
 }
 
@@ -250,6 +415,7 @@ bool flexran::app::log::elastic_search::remove_endpoint(const std::string& ep)
   auto it = std::find(elastic_search_ep_.begin(), elastic_search_ep_.end(), ep);
   if (it == elastic_search_ep_.end()) return false;
   elastic_search_ep_.erase(it);
+  endpoints_ = std::make_shared<const std::vector<std::string>>(elastic_search_ep_);
   if (elastic_search_ep_.size() == 0 && is_active())
     disable_logging();
   return true;
@@ -265,7 +431,7 @@ bool flexran::app::log::elastic_search::set_freq_stats(int freq)
       tick_stats_.disconnect();
     if (freq_stats_ > 0)
       tick_stats_ = event_sub_.subscribe_task_tick(
-          boost::bind(&flexran::app::log::elastic_search::process_config, this, _1),
+          boost::bind(&flexran::app::log::elastic_search::process_stats, this, _1),
           freq_stats_, event_sub_.last_tick());
   }
   return true;
@@ -301,34 +467,6 @@ bool flexran::app::log::elastic_search::set_batch_config_max_size(int size)
   return true;
 }
 
-void flexran::app::log::elastic_search::initialise_batch_stats()
-{
-  int ue_count = 0;
-  for (uint64_t bs_id : rib_.get_available_base_stations()) {
-    std::shared_ptr<rib::enb_rib_info> bs_config = rib_.get_bs(bs_id);
-    ue_count += bs_config->get_ue_configs().ue_config().size();
-  }
-
-  batch_stats_current_no_ = 0;
-  batch_stats_data_.clear();
-  /* estimate size of stats:
-   * (size of 1 UE's stats + 10%) * no of currently connected UEs * batch size
-   * = (1250 * 1.1) * ue_count */
-  batch_stats_data_.reserve(1400 * ue_count * batch_stats_max_no_);
-}
-
-void flexran::app::log::elastic_search::initialise_batch_config()
-{
-  const int bs_count = rib_.get_available_base_stations().size();
-
-  batch_config_current_no_ = 0;
-  batch_config_data_.clear();
-  /* estimate size of config:
-   * (size of 1 BS's stats + 10%) * no of currently connected BSs * batch size
-   * = (2150 * 1.1) * ue_count */
-  batch_config_data_.reserve(2400 * bs_count * batch_config_max_no_);
-}
-
 bool flexran::app::log::elastic_search::enable_logging()
 {
   if (is_active())
@@ -340,8 +478,9 @@ bool flexran::app::log::elastic_search::enable_logging()
 
   active_since_ = std::chrono::system_clock::now();
   sent_packets_ = 0;
-  initialise_batch_stats();
-  initialise_batch_config();
+  failed_packets_ = 0;
+  dropped_samples_ = 0;
+  dropped_batches_ = 0;
 
   if (freq_config_ > 0) {
     tick_config_ = event_sub_.subscribe_task_tick(
@@ -356,19 +495,24 @@ bool flexran::app::log::elastic_search::enable_logging()
     ue_disconnect_ = event_sub_.subscribe_ue_disconnect(
         boost::bind(&flexran::app::log::elastic_search::ue_disconnect, this, _1, _2));
   }
-  tick_curl_ = event_sub_.subscribe_task_tick(
-      boost::bind(&flexran::app::log::elastic_search::process_curl, this, _1),
-        20, 0);
 
   return true;
 }
 
 bool flexran::app::log::elastic_search::disable_logging()
+{
+  const bool active = is_active();
+  disconnect_ticks();
+  /* the sender ships what it has collected. If the queue is full, the
+   * batches are shipped with the next flush or when stopping */
+  if (active)
+    push(sample::kind::flush, false);
+  return true;
+}
+
+void flexran::app::log::elastic_search::disconnect_ticks()
 {
   if (tick_config_.connected()) tick_config_.disconnect();
   if (tick_stats_.connected()) tick_stats_.disconnect();
   if (ue_disconnect_.connected()) ue_disconnect_.disconnect();
-  if (tick_curl_.connected()) tick_curl_.disconnect();
-  wait_curl_end();
-  return true;
 }
@@ -29,19 +29,31 @@
 #include "rib_common.h"
 
 #include <curl/curl.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <chrono>
 
+#include <boost/lockfree/spsc_queue.hpp>
+
 namespace flexran {
   namespace app {
     namespace log {
 
+      /* Feeds RIB samples into Elastic Search. The tick thread only takes
+       * samples (see rib::Rib::prepare_snapshot()) and pushes them into a
+       * bounded queue; a sender thread completes them, formats the JSON,
+       * collects batches and ships them. If the sender falls behind, samples
+       * are dropped, so the tick thread never blocks on the network. All
+       * public methods must be called from the tick thread. */
       class elastic_search : public component {
 
       public:
 
         elastic_search(const rib::Rib& rib, const core::requests_manager& rm,
-            event::subscription& sub);
+            event::subscription& sub, size_t queue_size = 64);
         ~elastic_search();
 
         bool add_endpoint(const std::string& ep);
@@ -60,46 +72,104 @@ namespace flexran {
         bool set_batch_config_max_size(int size);
         int get_batch_config_max_size() const { return batch_config_max_no_; }
 
+        /// samples dropped since the sender's queue was full
+        uint64_t get_dropped_samples() const { return dropped_samples_; }
+        /// samples waiting for the sender
+        uint64_t get_backlog() const { return backlog_; }
+        /// batches not sent since too many transfers to an endpoint were pending
+        uint64_t get_dropped_batches() const { return dropped_batches_; }
+        /// transfers that did not end with HTTP code 200
+        uint64_t get_failed_packets() const { return failed_packets_; }
+        /// transfers in progress
+        uint64_t get_pending_transfers() const { return pending_transfers_; }
+
         bool enable_logging();
         bool disable_logging();
         bool is_active() const { return tick_config_.connected() || tick_stats_.connected(); }
 
       private:
+        struct sample {
+          enum class kind { stats, config, flush_stats, flush } k;
+          std::chrono::system_clock::time_point time;
+          /* prepared in the tick thread, completed by the sender */
+          std::shared_ptr<rib::Rib> snapshot;
+          std::shared_ptr<const std::vector<std::string>> endpoints;
+          int batch_max;
+        };
+
         std::vector<std::string> elastic_search_ep_;
+        std::shared_ptr<const std::vector<std::string>> endpoints_;
 
         std::chrono::system_clock::time_point active_since_;
-        int sent_packets_;
+        std::atomic<int> sent_packets_;
 
         int freq_stats_;
         int freq_config_;
 
         int batch_stats_max_no_;
-        int batch_stats_current_no_;
-        std::string batch_stats_data_;
-        void initialise_batch_config();
         void process_stats(uint64_t tick);
         void ue_disconnect(uint64_t bs_id, flexran::rib::rnti_t rnti);
 
-        std::string bulk_create_index(const std::string& index , const std::string& data);
+        static std::string bulk_create_index(const std::string& index, const std::string& data);
 
         int batch_config_max_no_;
-        int batch_config_current_no_;
-        std::string batch_config_data_;
-        void initialise_batch_stats();
         void process_config(uint64_t tick);
 
+        bool push(sample::kind k, bool snapshot);
+        void disconnect_ticks();
+
+        /* bounded queue between the tick and the sender thread */
+        boost::lockfree::spsc_queue<sample *> queue_;
+        std::atomic<uint64_t> backlog_{0};
+        std::atomic<uint64_t> dropped_samples_{0};
+        std::atomic<bool> stop_{false};
+        std::thread sender_;
+
+        /* state of the sender thread */
+        void run();
+        void handle(sample& s);
+        void send(std::string& data,
+            const std::shared_ptr<const std::vector<std::string>>& endpoints);
+
+        /* the last complete sample, shares unchanged BSs with the next */
+        std::shared_ptr<const rib::Rib> last_snapshot_;
+        /* endpoints of the last sample, for the batches left when stopping */
+        std::shared_ptr<const std::vector<std::string>> last_endpoints_;
+        std::string batch_stats_data_;
+        int batch_stats_current_no_ = 0;
+        std::string batch_config_data_;
+        int batch_config_current_no_ = 0;
+
+        /* Every endpoint has a pool of easy handles which are reused, so that
+         * their connections are kept alive. A batch is sent to all endpoints
+         * from one buffer, which is kept until all transfers are done */
+        static constexpr const uint64_t max_transfers_per_endpoint = 2;
+        struct endpoint_pool {
+          std::vector<CURL *> idle;
+          uint64_t in_flight = 0;
+        };
+        struct transfer {
+          std::string addr;
+          std::shared_ptr<const std::string> payload;
+        };
+        std::map<std::string, endpoint_pool> pools_;
+        std::map<CURL *, transfer> transfers_;
+        std::atomic<uint64_t> pending_transfers_{0};
+        std::atomic<uint64_t> dropped_batches_{0};
+        std::atomic<uint64_t> failed_packets_{0};
+
         CURLM* curl_multi_;
-        CURL* curl_create_transfer(const std::string& addr, const std::string& s);
+        struct curl_slist *curl_headers_;
+        CURL* curl_get_handle(const std::string& addr);
         void curl_release_handles();
+        void curl_cleanup_handles();
 
-        void trigger_send(const std::string &s);
-        void process_curl(uint64_t tick);
+        void process_curl();
         void wait_curl_end();
 
         bs2::connection tick_stats_;
         bs2::connection ue_disconnect_;
         bs2::connection tick_config_;
-        bs2::connection tick_curl_;
       };
     }
   }
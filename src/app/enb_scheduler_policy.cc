@@ -95,7 +95,6 @@ void flexran::app::scheduler::enb_scheduler_policy::reconfigure_agent(
   protocol::flex_header *config_header(new protocol::flex_header);
   config_header->set_type(protocol::FLPT_RECONFIGURE_AGENT);
   config_header->set_version(0);
-  config_header->set_xid(0);
   
   protocol::flex_agent_reconfiguration *agent_reconfiguration_msg(new protocol::flex_agent_reconfiguration);
   agent_reconfiguration_msg->set_allocated_header(config_header);
@@ -104,7 +103,7 @@ void flexran::app::scheduler::enb_scheduler_policy::reconfigure_agent(
 
   config_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   config_message.set_allocated_agent_reconfiguration_msg(agent_reconfiguration_msg);
-  req_manager_.send_message(bs_id, config_message);
+  req_manager_.send_request(bs_id, config_message);
 }
 
 void flexran::app::scheduler::enb_scheduler_policy::push_code(
@@ -115,7 +114,6 @@ void flexran::app::scheduler::enb_scheduler_policy::push_code(
   protocol::flex_header *delegation_header(new protocol::flex_header);
   delegation_header->set_type(protocol::FLPT_DELEGATE_CONTROL);
   delegation_header->set_version(0);
-  delegation_header->set_xid(0);
   
   protocol::flex_control_delegation *control_delegation_msg(new protocol::flex_control_delegation);
   control_delegation_msg->set_allocated_header(delegation_header);
@@ -134,7 +132,7 @@ void flexran::app::scheduler::enb_scheduler_policy::push_code(
   // Create and send the progran message
   d_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   d_message.set_allocated_control_delegation_msg(control_delegation_msg);
-  req_manager_.send_message(bs_id, d_message);
+  req_manager_.send_request(bs_id, d_message);
 }
 
 // this fucntion will be called by the rest API as this is already registered as a valide URI 
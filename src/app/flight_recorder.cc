@@ -0,0 +1,212 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    flight_recorder.cc
+ *  \brief   continuous recording of the last seconds, dumped on triggers
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <fstream>
+
+#include "flight_recorder.h"
+#include "recording_file.h"
+#include "flexran_log.h"
+
+flexran::app::log::flight_recorder::flight_recorder(const rib::Rib& rib,
+    const core::requests_manager& rm, event::subscription& sub,
+    core::background_executor& executor, uint64_t pre_ms, uint64_t post_ms,
+    int compression_level, size_t max_bytes)
+  : component(rib, rm, sub),
+    executor_(executor),
+    pre_ms_(pre_ms),
+    post_ms_(post_ms),
+    compression_level_(compression_level),
+    max_bytes_(max_bytes)
+{
+  event_sub_.subscribe_task_tick(
+      boost::bind(&flexran::app::log::flight_recorder::tick, this, _1), 1);
+}
+
+bool flexran::app::log::flight_recorder::trigger(const std::string& reason,
+    std::string& id)
+{
+  if (dump_at_ > 0) {
+    id = dumps_.back().id;
+    LOG4CXX_INFO(flog::app, "flight recorder: dump " << id
+        << " pending, ignoring trigger (" << reason << ")");
+    return false;
+  }
+  id = std::to_string(last_tick_);
+  dump_at_ = last_tick_ + post_ms_;
+  dumps_.push_back(dump_info{id, reason, last_tick_, "/tmp/flight." + id + ".delta", false});
+  LOG4CXX_WARN(flog::app, "flight recorder: triggered (" << reason << "), writing "
+      << pre_ms_ << "ms before and " << post_ms_ << "ms after to "
+      << dumps_.back().filename);
+  return true;
+}
+
+bool flexran::app::log::flight_recorder::get_dump(const std::string& id,
+    dump_info& info) const
+{
+  for (const dump_info& d : dumps_) {
+    if (d.id != id) continue;
+    info = d;
+    return true;
+  }
+  return false;
+}
+
+uint64_t flexran::app::log::flight_recorder::ring_ms() const
+{
+  return ring_.empty() ? 0 : ring_.back().tick - ring_.front().tick + 1;
+}
+
+void flexran::app::log::flight_recorder::tick(uint64_t ms)
+{
+  last_tick_ = ms;
+  delta_chunk d = capture_.capture(rib_);
+  const size_t bytes = estimate_bytes(d);
+  ring_.push_back(entry{ms, std::move(d), bytes});
+  bytes_ += bytes;
+
+  /* the oldest deltas leave the ring */
+  while (ring_.size() > 1) {
+    const bool expired = ring_.front().tick + pre_ms_ + post_ms_ < ms;
+    if (!expired && bytes_ <= max_bytes_)
+      break;
+    if (!expired)
+      truncated_ = true;
+    apply(base_, ring_.front().delta);
+    bytes_ -= ring_.front().bytes;
+    ring_.pop_front();
+  }
+
+  if (dump_at_ > 0 && ms >= dump_at_)
+    dump();
+}
+
+size_t flexran::app::log::flight_recorder::estimate_bytes(const delta_chunk& d)
+{
+  size_t n = 0;
+  for (const auto& p : d) {
+    const bs_delta& b = p.second;
+    n += sizeof(p) + b.ues.size() * sizeof(bs_delta::ue)
+        + b.removed.size() * sizeof(rib::rnti_t);
+    if (b.enb_config) n += b.enb_config->ByteSizeLong();
+    if (b.ue_config) n += b.ue_config->ByteSizeLong();
+    if (b.lc_config) n += b.lc_config->ByteSizeLong();
+    for (const bs_delta::ue& u : b.ues)
+      if (u.stats) n += u.stats->ByteSizeLong();
+  }
+  return n;
+}
+
+void flexran::app::log::flight_recorder::apply(delta_chunk& base, const delta_chunk& d)
+{
+  /* BSs that are not in d disconnected */
+  for (auto it = base.begin(); it != base.end(); ) {
+    if (d.count(it->first) > 0) ++it;
+    else it = base.erase(it);
+  }
+
+  /* the UEs of base are sorted by RNTI */
+  auto by_rnti = [] (const bs_delta::ue& u, rib::rnti_t rnti) { return u.rnti < rnti; };
+  for (const auto& p : d) {
+    const bs_delta& delta = p.second;
+    bs_delta& b = base[p.first];
+    if (delta.enb_config) b.enb_config = delta.enb_config;
+    if (delta.ue_config) b.ue_config = delta.ue_config;
+    if (delta.lc_config) b.lc_config = delta.lc_config;
+
+    for (rib::rnti_t rnti : delta.removed) {
+      auto it = std::lower_bound(b.ues.begin(), b.ues.end(), rnti, by_rnti);
+      if (it != b.ues.end() && it->rnti == rnti)
+        b.ues.erase(it);
+    }
+    for (const bs_delta::ue& u : delta.ues) {
+      auto it = std::lower_bound(b.ues.begin(), b.ues.end(), u.rnti, by_rnti);
+      if (it == b.ues.end() || it->rnti != u.rnti) {
+        b.ues.insert(it, u);
+        continue;
+      }
+      it->harq = u.harq;
+      if (u.stats) it->stats = u.stats;
+    }
+  }
+}
+
+void flexran::app::log::flight_recorder::dump()
+{
+  dump_at_ = 0;
+  const dump_info info = dumps_.back();
+
+  if (truncated_)
+    LOG4CXX_WARN(flog::app, "flight recorder: dump " << info.id << " covers only "
+        << ring_ms() << "ms, the ring is limited to " << max_bytes_ << " bytes");
+  truncated_ = false;
+
+  /* hand the ring over to the background; recording restarts with a
+   * complete chunk */
+  auto r = std::make_shared<ring>(std::move(ring_));
+  ring_.clear();
+  bytes_ = 0;
+  auto base = std::make_shared<delta_chunk>();
+  base->swap(base_);
+  capture_.reset();
+
+  const int level = compression_level_;
+  auto written = std::make_shared<bool>(false);
+  const bool queued = executor_.submit(
+      [r, base, info, level, written] () {
+        std::ofstream file(info.filename, std::ios::binary);
+        if (!file.is_open()) {
+          LOG4CXX_ERROR(flog::app, "flight recorder: cannot open file " << info.filename);
+          return;
+        }
+        recording_file_writer w(file, 1000, level);
+        w.write_header();
+        for (size_t i = 0; i < r->size(); ++i) {
+          const entry& e = (*r)[i];
+          if (i == 0) {
+            /* the first chunk needs to be complete */
+            apply(*base, e.delta);
+            w.write(e.tick, *base);
+          } else {
+            w.write(e.tick, e.delta);
+          }
+        }
+        w.finish();
+        *written = true;
+        LOG4CXX_INFO(flog::app, "flight recorder: wrote " << w.num_chunks()
+            << " chunks to file " << info.filename);
+      },
+      [this, info, written] () {
+        auto it = std::find_if(dumps_.begin(), dumps_.end(),
+            [&info] (const dump_info& d) { return d.id == info.id; });
+        if (it == dumps_.end()) return;
+        if (*written) it->done = true;
+        else dumps_.erase(it);
+      });
+  if (!queued) {
+    LOG4CXX_ERROR(flog::app, "flight recorder: cannot write dump " << info.id
+        << ", background executor is busy");
+    dumps_.pop_back();
+  }
+}
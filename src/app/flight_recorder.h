@@ -0,0 +1,123 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    flight_recorder.h
+ *  \brief   continuous recording of the last seconds, dumped on triggers
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef _FLIGHT_RECORDER_H_
+#define _FLIGHT_RECORDER_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "component.h"
+#include "background_executor.h"
+#include "recording_delta.h"
+
+namespace flexran {
+
+  namespace app {
+
+    namespace log {
+
+      /* Keeps the RIB deltas (see delta_capture) of the last pre_ms + post_ms
+       * milliseconds in a ring, but at most about max_bytes of them. On a
+       * trigger, recording continues for post_ms, then the ring is written
+       * as a recording file (see recording_file_writer) in the background,
+       * so that it covers the time before and after the trigger. Deltas that
+       * leave the ring are folded into a base state, which becomes the first
+       * chunk of a dump. All methods must be called from the tick thread. */
+      class flight_recorder : public component {
+      public:
+        struct dump_info {
+          std::string id;
+          std::string reason;
+          uint64_t trigger_tick;
+          std::string filename;
+          /// the file is complete
+          bool done;
+        };
+
+        flight_recorder(const rib::Rib& rib, const core::requests_manager& rm,
+            event::subscription& sub, core::background_executor& executor,
+            uint64_t pre_ms = 10000, uint64_t post_ms = 2000,
+            int compression_level = 0, size_t max_bytes = 16 << 20);
+
+        /*! dumps the ring post_ms after now; the id names the dump. Returns
+         * false if a dump is pending already (id is the pending one) */
+        bool trigger(const std::string& reason, std::string& id);
+
+        /// pending and finished dumps, oldest first
+        const std::vector<dump_info>& dumps() const { return dumps_; }
+        bool get_dump(const std::string& id, dump_info& info) const;
+
+        uint64_t pre_ms() const { return pre_ms_; }
+        uint64_t post_ms() const { return post_ms_; }
+        /// estimated memory used by the deltas in the ring
+        size_t ring_bytes() const { return bytes_; }
+        /// time covered by the ring
+        uint64_t ring_ms() const;
+
+        void tick(uint64_t ms);
+
+        /// applies the delta d to the complete state base, in place
+        static void apply(delta_chunk& base, const delta_chunk& d);
+
+      private:
+        struct entry {
+          uint64_t tick;
+          delta_chunk delta;
+          size_t bytes;
+        };
+        typedef std::deque<entry> ring;
+
+        /* estimated memory of the delta d, from the serialized sizes */
+        static size_t estimate_bytes(const delta_chunk& d);
+        void dump();
+
+        core::background_executor& executor_;
+        const uint64_t pre_ms_;
+        const uint64_t post_ms_;
+        const int compression_level_;
+        const size_t max_bytes_;
+
+        delta_capture capture_;
+        /* state before the oldest delta in the ring */
+        delta_chunk base_;
+        ring ring_;
+        size_t bytes_ = 0;
+        /* deltas left the ring early because of max_bytes_ */
+        bool truncated_ = false;
+
+        /* the dump in progress ends at this tick, 0 if none */
+        uint64_t dump_at_ = 0;
+        uint64_t last_tick_ = 0;
+        std::vector<dump_info> dumps_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* _FLIGHT_RECORDER_H_ */
@@ -38,108 +38,103 @@ flexran::app::management::plmn_management::plmn_management(rib::Rib& rib,
 
 void flexran::app::management::plmn_management::add_mme(const std::string& bs,
     const std::string& config)
+{
+  single(bs, config, &plmn_management::add_mme);
+}
+
+void flexran::app::management::plmn_management::remove_mme(const std::string& bs,
+    const std::string& config)
+{
+  single(bs, config, &plmn_management::remove_mme);
+}
+
+void flexran::app::management::plmn_management::change_plmn(const std::string& bs,
+    const std::string& config)
+{
+  single(bs, config, &plmn_management::change_plmn);
+}
+
+void flexran::app::management::plmn_management::single(const std::string& bs,
+    const std::string& config,
+    void (plmn_management::*batch)(const std::vector<uint64_t>&,
+      const std::string&, batch_results&))
 {
   uint64_t bs_id = rib_.parse_bs_id(bs);
   if (bs_id == 0)
     throw std::invalid_argument("cannot find BS " + bs);
+  batch_results results;
+  (this->*batch)({bs_id}, config, results);
+  if (!results[0].error.empty())
+    throw std::invalid_argument(results[0].error);
+}
 
-  protocol::flex_s1ap_config s1ap;
-  auto ret = proto_util::JsonStringToMessage(config, &s1ap, proto_util::JsonParseOptions());
-  if (ret != proto_util::Status::OK) {
-    LOG4CXX_ERROR(flog::app, "error while parsing ProtoBuf message:" << ret.ToString());
-    throw std::invalid_argument("Protobuf parser error");
-  }
-
-  s1ap.clear_pending();
-  s1ap.clear_connected();
-  s1ap.clear_enb_s1_ip();
-  s1ap.clear_enb_name();
-  if (s1ap.mme_size() == 0)
-    throw std::invalid_argument("no MME present");
-  if (s1ap.mme_size() > 1)
-    throw std::invalid_argument("only one MME allowed");
-
-  for (protocol::flex_s1ap_mme& mme : *s1ap.mutable_mme()) {
-    if (!mme.has_s1_ip())
-      throw std::invalid_argument("no S1Ip for MME");
-    const std::string& ip = mme.s1_ip();
-    const auto bs = rib_.get_bs(bs_id);
-    const auto s1ap = bs->get_enb_config().s1ap();
-    bool ip_present = std::any_of(s1ap.mme().begin(), s1ap.mme().end(),
-        [ip](const protocol::flex_s1ap_mme& mme) { return mme.s1_ip() == ip; });
-    if (ip_present)
-      throw std::invalid_argument("MME at IP " + ip + " already present");
-    mme.clear_state();
-    mme.clear_served_gummeis();
-    if (mme.requested_plmns_size() > 0)
-      throw std::invalid_argument("requested PLMNs not supported yet");
-    mme.clear_rel_capacity();
+void flexran::app::management::plmn_management::add_mme(
+    const std::vector<uint64_t>& bs_ids, const std::string& config,
+    batch_results& results)
+{
+  protocol::flex_s1ap_config s1ap = parse_mme_config(config);
+  protocol::flex_s1ap_mme& mme = *s1ap.mutable_mme(0);
+  mme.clear_state();
+  mme.clear_served_gummeis();
+  if (mme.requested_plmns_size() > 0)
+    throw std::invalid_argument("requested PLMNs not supported yet");
+  mme.clear_rel_capacity();
+
+  std::vector<uint64_t> push;
+  for (uint64_t bs_id : bs_ids) {
+    results.push_back({bs_id, ""});
+    if (has_mme(bs_id, mme.s1_ip()))
+      results.back().error = "MME at IP " + mme.s1_ip() + " already present";
+    else
+      push.push_back(bs_id);
   }
+  if (push.empty())
+    return;
 
   std::string s;
   proto_util::JsonPrintOptions opt;
   opt.add_whitespace = true;
   proto_util::MessageToJsonString(s1ap, &s, opt);
-  LOG4CXX_INFO(flog::app, "sending MME list to BS " << bs_id << ":\n" << s);
+  LOG4CXX_INFO(flog::app, "sending MME list to BS " << format_bs_ids(push) << ":\n" << s);
 
-  push_mme_config(bs_id, s1ap);
+  push_mme_config(push, s1ap);
 }
 
-void flexran::app::management::plmn_management::remove_mme(const std::string& bs,
-    const std::string& config)
+void flexran::app::management::plmn_management::remove_mme(
+    const std::vector<uint64_t>& bs_ids, const std::string& config,
+    batch_results& results)
 {
-  uint64_t bs_id = rib_.parse_bs_id(bs);
-  if (bs_id == 0)
-    throw std::invalid_argument("cannot find BS " + bs);
-
-  protocol::flex_s1ap_config s1ap;
-  auto ret = proto_util::JsonStringToMessage(config, &s1ap, proto_util::JsonParseOptions());
-  if (ret != proto_util::Status::OK) {
-    LOG4CXX_ERROR(flog::app, "error while parsing ProtoBuf message:" << ret.ToString());
-    throw std::invalid_argument("Protobuf parser error");
-  }
-
-  s1ap.clear_pending();
-  s1ap.clear_connected();
-  s1ap.clear_enb_s1_ip();
-  s1ap.clear_enb_name();
-  if (s1ap.mme_size() == 0)
-    throw std::invalid_argument("no MME present");
-  if (s1ap.mme_size() > 1)
-    throw std::invalid_argument("only one MME allowed");
-
-  for (protocol::flex_s1ap_mme& mme : *s1ap.mutable_mme()) {
-    if (!mme.has_s1_ip())
-      throw std::invalid_argument("no S1Ip for MME");
-    const std::string& ip = mme.s1_ip();
-    const auto bs = rib_.get_bs(bs_id);
-    const auto s1ap = bs->get_enb_config().s1ap();
-    bool ip_present = std::any_of(s1ap.mme().begin(), s1ap.mme().end(),
-        [ip](const protocol::flex_s1ap_mme& mme) { return mme.s1_ip() == ip; });
-    if (!ip_present)
-      throw std::invalid_argument("no MME at IP " + ip + " present");
-    mme.set_state(protocol::FLMMES_DISCONNECTED);
-    mme.clear_served_gummeis();
-    mme.clear_requested_plmns();
-    mme.clear_rel_capacity();
+  protocol::flex_s1ap_config s1ap = parse_mme_config(config);
+  protocol::flex_s1ap_mme& mme = *s1ap.mutable_mme(0);
+  mme.set_state(protocol::FLMMES_DISCONNECTED);
+  mme.clear_served_gummeis();
+  mme.clear_requested_plmns();
+  mme.clear_rel_capacity();
+
+  std::vector<uint64_t> push;
+  for (uint64_t bs_id : bs_ids) {
+    results.push_back({bs_id, ""});
+    if (!has_mme(bs_id, mme.s1_ip()))
+      results.back().error = "no MME at IP " + mme.s1_ip() + " present";
+    else
+      push.push_back(bs_id);
   }
+  if (push.empty())
+    return;
 
   std::string s;
   proto_util::JsonPrintOptions opt;
   opt.add_whitespace = true;
   proto_util::MessageToJsonString(s1ap, &s, opt);
-  LOG4CXX_INFO(flog::app, "sending MME list to BS " << bs_id << ":\n" << s);
+  LOG4CXX_INFO(flog::app, "sending MME list to BS " << format_bs_ids(push) << ":\n" << s);
 
-  push_mme_config(bs_id, s1ap);
+  push_mme_config(push, s1ap);
 }
 
-void flexran::app::management::plmn_management::change_plmn(const std::string& bs,
-    const std::string& config)
+void flexran::app::management::plmn_management::change_plmn(
+    const std::vector<uint64_t>& bs_ids, const std::string& config,
+    batch_results& results)
 {
-  uint64_t bs_id = rib_.parse_bs_id(bs);
-  if (bs_id == 0)
-    throw std::invalid_argument("cannot find BS " + bs);
-
   protocol::flex_cell_config cc;
   auto ret = proto_util::JsonStringToMessage(config, &cc, proto_util::JsonParseOptions());
   if (ret != proto_util::Status::OK) {
@@ -165,22 +160,56 @@ void flexran::app::management::plmn_management::change_plmn(const std::string& b
     ncc.add_plmn_id()->CopyFrom(p);
   }
 
+  for (uint64_t bs_id : bs_ids)
+    results.push_back({bs_id, ""});
+
   std::string s;
   proto_util::JsonPrintOptions opt;
   opt.add_whitespace = true;
   proto_util::MessageToJsonString(ncc, &s, opt);
-  LOG4CXX_INFO(flog::app, "sending MME list to BS " << bs_id << ":\n" << s);
+  LOG4CXX_INFO(flog::app, "sending MME list to BS " << format_bs_ids(bs_ids) << ":\n" << s);
+
+  push_cell_config(bs_ids, ncc);
+}
 
-  push_cell_config(bs_id, ncc);
+protocol::flex_s1ap_config flexran::app::management::plmn_management::parse_mme_config(
+    const std::string& config)
+{
+  protocol::flex_s1ap_config s1ap;
+  auto ret = proto_util::JsonStringToMessage(config, &s1ap, proto_util::JsonParseOptions());
+  if (ret != proto_util::Status::OK) {
+    LOG4CXX_ERROR(flog::app, "error while parsing ProtoBuf message:" << ret.ToString());
+    throw std::invalid_argument("Protobuf parser error");
+  }
+
+  s1ap.clear_pending();
+  s1ap.clear_connected();
+  s1ap.clear_enb_s1_ip();
+  s1ap.clear_enb_name();
+  if (s1ap.mme_size() == 0)
+    throw std::invalid_argument("no MME present");
+  if (s1ap.mme_size() > 1)
+    throw std::invalid_argument("only one MME allowed");
+  if (!s1ap.mme(0).has_s1_ip())
+    throw std::invalid_argument("no S1Ip for MME");
+  return s1ap;
+}
+
+bool flexran::app::management::plmn_management::has_mme(uint64_t bs_id,
+    const std::string& ip) const
+{
+  const auto bs = rib_.get_bs(bs_id);
+  const auto& mmes = bs->get_enb_config().s1ap().mme();
+  return std::any_of(mmes.begin(), mmes.end(),
+      [&ip](const protocol::flex_s1ap_mme& mme) { return mme.s1_ip() == ip; });
 }
 
 void flexran::app::management::plmn_management::push_mme_config(
-    uint64_t bs_id, const protocol::flex_s1ap_config& s1ap)
+    const std::vector<uint64_t>& bs_ids, const protocol::flex_s1ap_config& s1ap)
 {
   protocol::flex_header *config_header(new protocol::flex_header);
   config_header->set_type(protocol::FLPT_RECONFIGURE_AGENT);
   config_header->set_version(0);
-  config_header->set_xid(0);
 
   protocol::flex_s1ap_config *s(new protocol::flex_s1ap_config);
   s->CopyFrom(s1ap);
@@ -191,16 +220,15 @@ void flexran::app::management::plmn_management::push_mme_config(
   protocol::flexran_message config_message;
   config_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   config_message.set_allocated_enb_config_reply_msg(enb_config_msg);
-  req_manager_.send_message(bs_id, config_message);
+  req_manager_.send_request(bs_ids, config_message);
 }
 
 void flexran::app::management::plmn_management::push_cell_config(
-    uint64_t bs_id, const protocol::flex_cell_config& cell_config)
+    const std::vector<uint64_t>& bs_ids, const protocol::flex_cell_config& cell_config)
 {
   protocol::flex_header *config_header(new protocol::flex_header);
   config_header->set_type(protocol::FLPT_RECONFIGURE_AGENT);
   config_header->set_version(0);
-  config_header->set_xid(0);
 
   protocol::flex_enb_config_reply *enb_config_msg(new protocol::flex_enb_config_reply);
   enb_config_msg->add_cell_config();
@@ -210,5 +238,5 @@ void flexran::app::management::plmn_management::push_cell_config(
   protocol::flexran_message config_message;
   config_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   config_message.set_allocated_enb_config_reply_msg(enb_config_msg);
-  req_manager_.send_message(bs_id, config_message);
+  req_manager_.send_request(bs_ids, config_message);
 }
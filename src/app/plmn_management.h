@@ -46,10 +46,29 @@ namespace flexran {
         void remove_mme(const std::string& bs, const std::string& config);
         void change_plmn(const std::string& bs, const std::string& config);
 
+        /* Batch versions of the above: config is parsed and validated once
+         * (throwing std::invalid_argument if it is invalid), BS-specific
+         * checks are reported per BS in results, and one message is sent to
+         * all remaining BSs */
+        void add_mme(const std::vector<uint64_t>& bs_ids, const std::string& config,
+            batch_results& results);
+        void remove_mme(const std::vector<uint64_t>& bs_ids, const std::string& config,
+            batch_results& results);
+        void change_plmn(const std::vector<uint64_t>& bs_ids, const std::string& config,
+            batch_results& results);
+
       private:
 
-        void push_mme_config(uint64_t bs_id, const protocol::flex_s1ap_config& s1ap);
-        void push_cell_config(uint64_t bs_id, const protocol::flex_cell_config& s1ap);
+        static protocol::flex_s1ap_config parse_mme_config(const std::string& config);
+        bool has_mme(uint64_t bs_id, const std::string& ip) const;
+        void single(const std::string& bs, const std::string& config,
+            void (plmn_management::*batch)(const std::vector<uint64_t>&,
+              const std::string&, batch_results&));
+
+        void push_mme_config(const std::vector<uint64_t>& bs_ids,
+            const protocol::flex_s1ap_config& s1ap);
+        void push_cell_config(const std::vector<uint64_t>& bs_ids,
+            const protocol::flex_cell_config& s1ap);
       };
     }
   }
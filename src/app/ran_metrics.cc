@@ -0,0 +1,185 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    ran_metrics.cc
+ *  \brief   agent counters and RAN KPIs of a RIB as OpenMetrics
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include "ran_metrics.h"
+#include "rib.h"
+
+namespace {
+  /* wideband CQI of a CSI report (of the first codeword), false if the
+   * report has none */
+  bool wb_cqi(const protocol::flex_dl_csi& csi, uint32_t& cqi)
+  {
+    switch (csi.report_case()) {
+      case protocol::flex_dl_csi::kP10Csi: cqi = csi.p10csi().wb_cqi(); return true;
+      case protocol::flex_dl_csi::kP20Csi: cqi = csi.p20csi().wb_cqi(); return true;
+      case protocol::flex_dl_csi::kA20Csi: cqi = csi.a20csi().wb_cqi(); return true;
+      case protocol::flex_dl_csi::kA30Csi: cqi = csi.a30csi().wb_cqi(); return true;
+      case protocol::flex_dl_csi::kP11Csi:
+        if (csi.p11csi().wb_cqi_size() == 0) return false;
+        cqi = csi.p11csi().wb_cqi(0);
+        return true;
+      case protocol::flex_dl_csi::kP21Csi:
+        if (csi.p21csi().wb_cqi_size() == 0) return false;
+        cqi = csi.p21csi().wb_cqi(0);
+        return true;
+      case protocol::flex_dl_csi::kA12Csi:
+        if (csi.a12csi().wb_cqi_size() == 0) return false;
+        cqi = csi.a12csi().wb_cqi(0);
+        return true;
+      case protocol::flex_dl_csi::kA22Csi:
+        if (csi.a22csi().wb_cqi_size() == 0) return false;
+        cqi = csi.a22csi().wb_cqi(0);
+        return true;
+      case protocol::flex_dl_csi::kA31Csi:
+        if (csi.a31csi().wb_cqi_size() == 0) return false;
+        cqi = csi.a31csi().wb_cqi(0);
+        return true;
+      case protocol::flex_dl_csi::REPORT_NOT_SET:
+        break;
+    }
+    return false;
+  }
+}
+
+void flexran::app::stats::ran_metrics::write(const rib::Rib& rib,
+    core::metrics::writer& w)
+{
+  using core::metrics::writer;
+  generation_++;
+
+  const std::map<int, std::shared_ptr<rib::agent_info>> agents = rib.get_agents();
+  w.family("flexran_agent_rx_messages", "counter", "Messages received from the agent");
+  for (const auto& a : agents)
+    w.counter("flexran_agent_rx_messages", agent_labels(a.first, a.second->bs_id),
+        a.second->rx_packets.load());
+  w.family("flexran_agent_rx_bytes", "counter", "Bytes received from the agent", "bytes");
+  for (const auto& a : agents)
+    w.counter("flexran_agent_rx_bytes", agent_labels(a.first, a.second->bs_id),
+        a.second->rx_bytes.load());
+  w.family("flexran_agent_tx_messages", "counter", "Messages sent to the agent");
+  for (const auto& a : agents)
+    w.counter("flexran_agent_tx_messages", agent_labels(a.first, a.second->bs_id),
+        a.second->tx_packets.load());
+  w.family("flexran_agent_tx_bytes", "counter", "Bytes sent to the agent", "bytes");
+  for (const auto& a : agents)
+    w.counter("flexran_agent_tx_bytes", agent_labels(a.first, a.second->bs_id),
+        a.second->tx_bytes.load());
+
+  /* UE counts are small, the per-UE samples go into one buffer per family */
+  std::map<std::pair<uint64_t, uint32_t>, uint64_t> cell_ues;
+  std::map<std::pair<uint64_t, uint32_t>, uint64_t> slice_ues;
+  ue_cqi_.clear();
+  ue_mcs_.clear();
+  ue_dl_bytes_.clear();
+  ue_ul_bytes_.clear();
+  for (uint64_t bs_id : rib.get_available_base_stations()) {
+    std::shared_ptr<const rib::enb_rib_info> bs = rib.get_bs(bs_id);
+    if (!bs) continue;
+    for (const auto& c : bs->get_ue_configs().ue_config()) {
+      const uint32_t cell_id = c.pcell_carrier_index();
+      const uint32_t slice_id = c.dl_slice_id();
+      cell_ues[std::make_pair(bs_id, cell_id)]++;
+      slice_ues[std::make_pair(bs_id, slice_id)]++;
+
+      std::shared_ptr<const rib::ue_mac_rib_info> ue = bs->get_ue_mac_info(c.rnti());
+      if (!ue) continue;
+      const protocol::flex_ue_stats_report& r = ue->get_mac_stats_report();
+      const std::string& labels = ue_labels(bs_id, c.rnti(), c.imsi(), cell_id, slice_id);
+      uint32_t cqi;
+      if (r.dl_cqi_report().csi_report_size() > 0
+          && wb_cqi(r.dl_cqi_report().csi_report(0), cqi))
+        writer::format_sample(ue_cqi_, "flexran_ue_dl_cqi", "", labels,
+            static_cast<uint64_t>(cqi));
+      if (!r.has_mac_stats()) continue;
+      const protocol::flex_mac_stats& m = r.mac_stats();
+      writer::format_sample(ue_mcs_, "flexran_ue_dl_mcs", "", labels,
+          static_cast<uint64_t>(m.mcs1_dl()));
+      writer::format_sample(ue_dl_bytes_, "flexran_ue_dl_bytes", "_total", labels,
+          static_cast<uint64_t>(m.total_bytes_sdus_dl()));
+      writer::format_sample(ue_ul_bytes_, "flexran_ue_ul_bytes", "_total", labels,
+          static_cast<uint64_t>(m.total_bytes_sdus_ul()));
+    }
+  }
+
+  w.family("flexran_cell_ues", "gauge", "UEs with this cell as primary cell");
+  for (const auto& c : cell_ues)
+    w.gauge("flexran_cell_ues", writer::labels({{"bs_id", std::to_string(c.first.first)},
+        {"cell_id", std::to_string(c.first.second)}}), c.second);
+  w.family("flexran_slice_ues", "gauge", "UEs in this DL slice");
+  for (const auto& s : slice_ues)
+    w.gauge("flexran_slice_ues", writer::labels({{"bs_id", std::to_string(s.first.first)},
+        {"slice_id", std::to_string(s.first.second)}}), s.second);
+
+  /* per cell or slice, aggregate over the cell_id and slice_id labels */
+  w.family("flexran_ue_dl_cqi", "gauge", "Last reported DL wideband CQI");
+  w.append(ue_cqi_);
+  w.family("flexran_ue_dl_mcs", "gauge", "Last DL MCS (first codeword)");
+  w.append(ue_mcs_);
+  w.family("flexran_ue_dl_bytes", "counter",
+      "DL MAC SDU bytes reported by the agent", "bytes");
+  w.append(ue_dl_bytes_);
+  w.family("flexran_ue_ul_bytes", "counter",
+      "UL MAC SDU bytes reported by the agent", "bytes");
+  w.append(ue_ul_bytes_);
+
+  evict();
+}
+
+const std::string& flexran::app::stats::ran_metrics::agent_labels(int agent_id,
+    uint64_t bs_id)
+{
+  agent_entry& e = agents_[agent_id];
+  if (e.labels.empty() || e.bs_id != bs_id) {
+    e.bs_id = bs_id;
+    e.labels = core::metrics::writer::labels({{"agent_id", std::to_string(agent_id)},
+        {"bs_id", std::to_string(bs_id)}});
+  }
+  e.generation = generation_;
+  return e.labels;
+}
+
+const std::string& flexran::app::stats::ran_metrics::ue_labels(uint64_t bs_id,
+    rib::rnti_t rnti, uint64_t imsi, uint32_t cell_id, uint32_t slice_id)
+{
+  ue_entry& e = ues_[std::make_pair(bs_id, rnti)];
+  if (e.labels.empty() || e.imsi != imsi || e.cell_id != cell_id
+      || e.slice_id != slice_id) {
+    e.imsi = imsi;
+    e.cell_id = cell_id;
+    e.slice_id = slice_id;
+    e.labels = core::metrics::writer::labels({{"bs_id", std::to_string(bs_id)},
+        {"cell_id", std::to_string(cell_id)}, {"slice_id", std::to_string(slice_id)},
+        {"rnti", std::to_string(rnti)}, {"imsi", std::to_string(imsi)}});
+  }
+  e.generation = generation_;
+  return e.labels;
+}
+
+void flexran::app::stats::ran_metrics::evict()
+{
+  for (auto it = agents_.begin(); it != agents_.end(); )
+    it = it->second.generation != generation_ ? agents_.erase(it) : std::next(it);
+  for (auto it = ues_.begin(); it != ues_.end(); )
+    it = it->second.generation != generation_ ? ues_.erase(it) : std::next(it);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    ran_metrics.h
+ *  \brief   agent counters and RAN KPIs of a RIB as OpenMetrics
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef RAN_METRICS_H_
+#define RAN_METRICS_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "metrics.h"
+#include "rib_common.h"
+
+namespace flexran {
+
+  namespace rib {
+    class Rib;
+  }
+
+  namespace app {
+
+    namespace stats {
+
+      /* Writes the per-agent message counters and the RAN KPIs (UEs per
+       * cell and slice, per-UE CQI and traffic) of a RIB, usually a
+       * snapshot. The label sets of agents and UEs are kept between calls
+       * and only formatted anew when a UE appears or changes its cell or
+       * slice, so that a scrape of many UEs mostly copies strings. Not
+       * thread-safe: callers serialize write() */
+      class ran_metrics {
+      public:
+        void write(const rib::Rib& rib, core::metrics::writer& w);
+
+        /// number of UEs whose labels are kept
+        size_t num_cached_ues() const { return ues_.size(); }
+
+      private:
+        struct agent_entry {
+          uint64_t bs_id;
+          std::string labels;
+          uint64_t generation;
+        };
+        struct ue_entry {
+          uint64_t imsi;
+          uint32_t cell_id;
+          uint32_t slice_id;
+          std::string labels;
+          uint64_t generation;
+        };
+
+        const std::string& agent_labels(int agent_id, uint64_t bs_id);
+        const std::string& ue_labels(uint64_t bs_id, rib::rnti_t rnti,
+            uint64_t imsi, uint32_t cell_id, uint32_t slice_id);
+        /// drops the entries of agents and UEs that were not written
+        void evict();
+
+        uint64_t generation_ = 0;
+        std::map<int, agent_entry> agents_;
+        std::map<std::pair<uint64_t, rib::rnti_t>, ue_entry> ues_;
+
+        /* one buffer per family, since the samples of a family must be
+         * contiguous; kept to reuse their memory */
+        std::string ue_cqi_;
+        std::string ue_mcs_;
+        std::string ue_dl_bytes_;
+        std::string ue_ul_bytes_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* RAN_METRICS_H_ */
@@ -22,13 +22,19 @@
  *  \email   robert.schmidt@eurecom.fr
  */
 
+#include <deque>
 #include <fstream>
+#include <future>
+#include <sstream>
 #include <thread>
 #include <iomanip>
 
 #include <google/protobuf/util/json_util.h>
 
 #include "recorder.h"
+#include "recording_writer.h"
+#include "recording_delta.h"
+#include "recording_file.h"
 #include "enb_rib_info.h"
 #include "flexran_log.h"
 
@@ -45,7 +51,7 @@ bool flexran::app::log::bs_dump::operator==(const bs_dump& other) const
     // compare that serialized flex_ue_stats_report messages are the same
     std::string ss1, ss2;
     if (!it->first.SerializeToString(&ss1)) return false;
-    if (!it->first.SerializeToString(&ss2)) return false;
+    if (!oit->first.SerializeToString(&ss2)) return false;
     if (ss1 != ss2) return false;
   }
   // compare that serialized flex_*_config_reply messages are the same
@@ -59,6 +65,19 @@ bool flexran::app::log::bs_dump::operator==(const bs_dump& other) const
   return sec1 == sec2 && suc1 == suc2 && slc1 == slc2;
 }
 
+flexran::app::log::recorder::recorder(const rib::Rib& rib,
+    const core::requests_manager& rm, event::subscription& sub,
+    core::background_executor& executor, int compression_level)
+  : component(rib, rm, sub),
+    executor_(executor),
+    compression_level_(compression_level)
+{
+}
+
+flexran::app::log::recorder::~recorder()
+{
+}
+
 bool flexran::app::log::recorder::start_meas(uint64_t duration,
     const std::string& type, std::string& id)
 {
@@ -71,6 +90,7 @@ bool flexran::app::log::recorder::start_meas(uint64_t duration,
   else if (type == "enb")   jt = job_type::enb;
   else if (type == "stats") jt = job_type::stats;
   else if (type == "bin")   jt = job_type::bin;
+  else if (type == "delta") jt = job_type::delta;
   else {
     LOG4CXX_ERROR(flog::app, "recorder: illegal job type " << type);
     return false;
@@ -89,11 +109,13 @@ bool flexran::app::log::recorder::start_meas(uint64_t duration,
 
   /* ID corresponds to record start date, but first check if we can have the
    * corresponding file */
-  const uint64_t start = current_job_ ? current_job_->ms_end : event_sub_.last_tick() + 2;
+  const uint64_t start = current_job_ ? current_job_->info.ms_end : event_sub_.last_tick() + 2;
   id = std::to_string(start);
   std::string filename = "/tmp/record." + id + ".json";
   if (jt == job_type::bin)
     filename += ".bin";
+  else if (jt == job_type::delta)
+    filename = "/tmp/record." + id + ".delta";
 
   /* test whether we can write (later) */
   std::ofstream file;
@@ -105,9 +127,25 @@ bool flexran::app::log::recorder::start_meas(uint64_t duration,
   file.close();
 
 
-  dump_.reset(new std::vector<std::map<uint64_t, bs_dump>>);
-  dump_->reserve(duration);
-  current_job_.reset(new job_info{start, start + duration, filename, jt});
+  if (!writer_) {
+    /* the job becomes visible in the tick thread once it has been written */
+    writer_.reset(new recording_writer([this] (const job_info& info, uint64_t n) {
+        executor_.post([this, info, n] () {
+            std::chrono::duration<float, std::ratio<60l>> min = std::chrono::milliseconds(n);
+            LOG4CXX_INFO(flog::app, "recorder: " << n
+                << " objects persisted, corresponding to " << min.count() << " min");
+            finished_jobs_.push_back(info);
+            for (auto& j : jobs_)
+              if (j->info.ms_start == info.ms_start) j->finished = true;
+          });
+      }, 1024, compression_level_, &executor_));
+  }
+  current_job_ = std::make_shared<active_job>(
+      active_job{job_info{start, start + duration, filename, jt}, false, 0, nullptr,
+                 0, false, false, std::make_shared<std::atomic<uint64_t>>(0)});
+  if (jt == job_type::delta)
+    current_job_->capture.reset(new delta_capture);
+  jobs_.push_back(current_job_);
 
   std::chrono::duration<float, std::ratio<60l>> min = std::chrono::milliseconds(duration);
   auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
@@ -117,7 +155,7 @@ bool flexran::app::log::recorder::start_meas(uint64_t duration,
       << ", file " << filename << ", type " << type << ")");
 
   event_sub_.subscribe_task_tick_extended(
-      boost::bind(&flexran::app::log::recorder::tick, this, _1, _2), 1, start);
+      boost::bind(&flexran::app::log::recorder::tick, this, current_job_, _1, _2), 1, start);
 
   return true;
 }
@@ -133,30 +171,86 @@ bool flexran::app::log::recorder::get_job_info(const std::string& id, job_info&
   return true;
 }
 
-void flexran::app::log::recorder::tick(const bs2::connection& conn, uint64_t ms)
+bool flexran::app::log::recorder::get_job_progress(const std::string& id,
+    job_progress& progress) const
 {
-  if (!current_job_) {
-    LOG4CXX_ERROR(flog::app, "no current job available");
-    conn.disconnect();
-    return;
+  auto it = std::find_if(jobs_.begin(), jobs_.end(),
+      [&id] (const std::shared_ptr<active_job>& j) { return id == std::to_string(j->info.ms_start); }
+  );
+  if (it == jobs_.end()) return false;
+
+  const active_job& j = **it;
+  if (j.finished)        progress.s = job_progress::state::finished;
+  else if (j.ended)      progress.s = job_progress::state::writing;
+  else if (j.started)    progress.s = job_progress::state::recording;
+  else                   progress.s = job_progress::state::scheduled;
+  progress.recorded = j.recorded;
+  progress.written = *j.written;
+  progress.dropped = j.dropped;
+  progress.total = j.info.ms_end - j.info.ms_start;
+  return true;
+}
+
+std::string flexran::app::log::recorder::to_string(job_progress::state s)
+{
+  switch (s) {
+    case job_progress::state::scheduled: return "scheduled";
+    case job_progress::state::recording: return "recording";
+    case job_progress::state::writing:   return "writing";
+    case job_progress::state::finished:  return "finished";
+  }
+  return "unknown";
+}
+
+void flexran::app::log::recorder::tick(std::shared_ptr<active_job> job,
+    const bs2::connection& conn, uint64_t ms)
+{
+  if (!job->started) {
+    if (!writer_->begin(job->info, job->written)) {
+      LOG4CXX_ERROR(flog::app, "recorder: cannot start job " << job->info.ms_start
+          << ", writer is busy");
+      conn.disconnect();
+      jobs_.erase(std::find(jobs_.begin(), jobs_.end(), job));
+      if (current_job_ == job) current_job_.reset();
+      return;
+    }
+    job->started = true;
   }
 
   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-  std::map<uint64_t, flexran::app::log::bs_dump> m;
-  for (uint64_t bs_id: rib_.get_available_base_stations()) {
-    m.insert(std::make_pair(bs_id, record_chunk(bs_id)));
+  if (job->capture) {
+    /* only what changed since the last chunk is copied. If a chunk is
+     * dropped, the next one has to be complete */
+    if (writer_->push(ms, job->capture->capture(rib_))) {
+      job->recorded++;
+    } else {
+      job->dropped++;
+      job->capture->reset();
+    }
+  } else {
+    std::map<uint64_t, flexran::app::log::bs_dump> m;
+    for (uint64_t bs_id: rib_.get_available_base_stations()) {
+      m.insert(std::make_pair(bs_id, record_chunk(bs_id)));
+    }
+    /* the writer thread writes the chunk, if it falls behind it is dropped */
+    if (writer_->push(std::move(m)))
+      job->recorded++;
+    else
+      job->dropped++;
   }
-  dump_->push_back(m);
   std::chrono::duration<float, std::micro> dur = std::chrono::steady_clock::now() - start;
   LOG4CXX_TRACE(flog::app, "write_json_chunk() at " << ms
       << "ms, duration " << dur.count() << "us");
 
-  if (ms == current_job_->ms_end - 1) {
-    std::thread writer(&flexran::app::log::recorder::writer_method, this,
-        std::move(current_job_), std::move(dump_));
-    writer.detach();
+  if (ms >= job->info.ms_end - 1) {
+    writer_->end();
+    job->ended = true;
+    job->capture.reset();
+    if (job->dropped > 0)
+      LOG4CXX_WARN(flog::app, "recorder: job " << job->info.ms_start << " dropped "
+          << job->dropped << " chunks, the writer was too slow");
     conn.disconnect();
-    current_job_.reset();
+    if (current_job_ == job) current_job_.reset();
   }
 }
 
@@ -183,25 +277,9 @@ flexran::app::log::bs_dump flexran::app::log::recorder::record_chunk(uint64_t bs
   };
 }
 
-void flexran::app::log::recorder::writer_method(std::unique_ptr<job_info> info,
-    std::unique_ptr<std::vector<std::map<uint64_t, bs_dump>>> dump)
-{
-  uint64_t n;
-  if (info->type == job_type::bin)
-    n = write_binary(*info, *dump);
-  else
-    n = write_json(*info, *dump);
-
-  std::chrono::duration<float, std::ratio<60l>> min = std::chrono::milliseconds(n);
-  LOG4CXX_INFO(flog::app, "recorder: " << n
-      << " objects persisted, corresponding to " << min.count() << " min");
-  finished_jobs_.push_back(*info);
-  info.release();
-  dump.release();
-}
-
 uint64_t flexran::app::log::recorder::write_json(job_info info,
-    const std::vector<std::map<uint64_t, bs_dump>>& dump)
+    const std::vector<std::map<uint64_t, bs_dump>>& dump,
+    core::background_executor *executor)
 {
   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
   std::ofstream file;
@@ -211,10 +289,7 @@ uint64_t flexran::app::log::recorder::write_json(job_info info,
     return 0;
   }
   file << "[";
-  for (auto it = dump.begin(); it != dump.end(); it++) {
-    if (it != dump.begin()) file << ",";
-    write_json_chunk(file, info.type, *it);
-  }
+  write_json_chunks(file, info.type, dump, executor);
   file << "]";
   file.close();
   std::chrono::duration<float, std::milli> dur = std::chrono::steady_clock::now() - start;
@@ -223,9 +298,62 @@ uint64_t flexran::app::log::recorder::write_json(job_info info,
   return std::distance(dump.begin(), dump.end());
 }
 
+void flexran::app::log::recorder::write_json_chunks(std::ostream& s,
+    job_type type, const std::vector<std::map<uint64_t, bs_dump>>& chunks,
+    core::background_executor *executor, std::atomic<uint64_t> *progress)
+{
+  const size_t range = 256;
+  const size_t max_in_flight = 8;
+  auto render = [&chunks, type] (size_t b, size_t e) {
+    std::ostringstream ss;
+    for (size_t i = b; i < e; ++i) {
+      if (i > 0) ss << ",";
+      write_json_chunk(ss, type, chunks[i]);
+    }
+    return ss.str();
+  };
+
+  struct pending {
+    size_t b, e;
+    std::future<std::string> out;
+  };
+  std::deque<pending> in_flight;
+  size_t next = 0;
+  while (next < chunks.size() || !in_flight.empty()) {
+    while (executor && next < chunks.size() && in_flight.size() < max_in_flight) {
+      const size_t b = next;
+      const size_t e = std::min(b + range, chunks.size());
+      in_flight.push_back(pending{b, e,
+          executor->submit_future([render, b, e] () { return render(b, e); })});
+      next = e;
+    }
+    size_t b, e;
+    std::string out;
+    if (in_flight.empty()) {
+      b = next;
+      e = std::min(b + range, chunks.size());
+      out = render(b, e);
+      next = e;
+    } else {
+      pending& p = in_flight.front();
+      b = p.b;
+      e = p.e;
+      try {
+        out = p.out.get();
+      } catch (const std::runtime_error&) {
+        /* the executor is busy or shutting down */
+        out = render(b, e);
+      }
+      in_flight.pop_front();
+    }
+    s << out;
+    if (progress) *progress += e - b;
+  }
+}
+
 void flexran::app::log::recorder::write_json_chunk(std::ostream& s,
     job_type type,
-    const std::map<uint64_t, bs_dump>& dump_chunk)
+    const std::map<uint64_t, bs_dump>& dump_chunk, bool keyed)
 {
   /* TODO use flexran::rib::Rib::format_statistics_to_json() when time stamps
    * for single chunks are collected */
@@ -249,6 +377,7 @@ void flexran::app::log::recorder::write_json_chunk(std::ostream& s,
               p.first, "\"null\"", enb_config, ue_config, lc_config);
         }
     );
+    if (keyed) s << "\"eNB_config\":";
     s << flexran::rib::Rib::format_enb_configurations_to_json(enb_configurations);
   }
 
@@ -267,6 +396,7 @@ void flexran::app::log::recorder::write_json_chunk(std::ostream& s,
           return flexran::rib::enb_rib_info::format_mac_stats_to_json(bs_id, ue_stats);
         }
     );
+    if (keyed) s << "\"mac_stats\":";
     s << flexran::rib::Rib::format_mac_stats_to_json(ue_stats);
   }
   s << "}";
@@ -367,6 +497,15 @@ flexran::app::log::recorder::read_binary(std::string filename)
 {
   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
   std::vector<std::map<uint64_t, flexran::app::log::bs_dump>> dump;
+  if (recording_file_reader::is_recording_file(filename)) {
+    recording_file_reader reader;
+    std::map<uint64_t, std::map<uint64_t, bs_dump>> chunks;
+    if (reader.open(filename))
+      reader.read(0, UINT64_MAX, chunks);
+    for (auto& c : chunks)
+      dump.push_back(std::move(c.second));
+    return dump;
+  }
   std::ifstream file;
   file.open(filename, std::ios::binary);
   if (!file.is_open()) {
@@ -374,11 +513,21 @@ flexran::app::log::recorder::read_binary(std::string filename)
     return dump;
   }
 
-  uint64_t n;
-  file.read(reinterpret_cast<char *>(&n), sizeof(uint64_t));
-
-  for (uint64_t i = 0; i < n; i++) {
-    dump.push_back(read_binary_chunk(file));
+  delta_decoder dd;
+  if (dd.read_header(file)) {
+    uint64_t tick;
+    std::map<uint64_t, bs_dump> chunk;
+    while (dd.next(file, tick, chunk))
+      dump.push_back(std::move(chunk));
+  } else {
+    file.clear();
+    file.seekg(0);
+    uint64_t n;
+    file.read(reinterpret_cast<char *>(&n), sizeof(uint64_t));
+
+    for (uint64_t i = 0; i < n; i++) {
+      dump.push_back(read_binary_chunk(file));
+    }
   }
   file.close();
   std::chrono::duration<float, std::milli> dur = std::chrono::steady_clock::now() - start;
@@ -25,12 +25,15 @@
 #ifndef _RECORDER_H_
 #define _RECORDER_H_
 
+#include <atomic>
 #include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
 
 #include "component.h"
+#include "background_executor.h"
 #include "rib_common.h"
 #include "ue_mac_rib_info.h"
 
@@ -63,7 +66,7 @@ namespace flexran {
         bool operator==(const bs_dump& other) const;
       };
 
-      enum job_type { all, enb, stats, bin };
+      enum job_type { all, enb, stats, bin, delta };
 
       class job_info {
       public:
@@ -80,25 +83,43 @@ namespace flexran {
         job_type type;
       };
 
+      class recording_writer;
+      class delta_capture;
+
       class recorder : public component {
 
       public:
 
+        /// compression_level (0-9) applies to delta jobs
         recorder(const rib::Rib& rib, const core::requests_manager& rm,
-            event::subscription& sub)
-          : component(rib, rm, sub),
-            current_job_(nullptr)
-        {}
+            event::subscription& sub, core::background_executor& executor,
+            int compression_level = 0);
+        ~recorder();
+
+        struct job_progress {
+          enum class state { scheduled, recording, writing, finished };
+          state s;
+          /// chunks recorded, written to the file, and dropped so far
+          uint64_t recorded;
+          uint64_t written;
+          uint64_t dropped;
+          /// chunks of the complete job (its duration)
+          uint64_t total;
+        };
 
-        void tick(const bs2::connection& conn, uint64_t ms);
         bool start_meas(uint64_t duration, const std::string& type, std::string& id);
         bool get_job_info(const std::string& id, job_info& info);
+        /// progress of any job ever scheduled
+        bool get_job_progress(const std::string& id, job_progress& progress) const;
+        static std::string to_string(job_progress::state s);
 
         /**
-         * method for serializing to JSON
+         * method for serializing to JSON. With an executor, the chunks are
+         * rendered in parallel (see write_json_chunks())
          */
         static uint64_t write_json(job_info info,
-            const std::vector<std::map<uint64_t, bs_dump>>& dump);
+            const std::vector<std::map<uint64_t, bs_dump>>& dump,
+            core::background_executor *executor = nullptr);
 
         /**
          * method for serializing to binary (custom)
@@ -107,32 +128,68 @@ namespace flexran {
             const std::vector<std::map<uint64_t, bs_dump>>& dump);
 
         /**
-         * methods for deserializing from binary (custom)
+         * methods for deserializing from binary (custom), or from delta
+         * recordings (see recording_file_reader)
          */
         static std::vector<std::map<uint64_t, bs_dump>> read_binary(std::string filename);
 
+        /**
+         * methods for serializing single chunks, e.g., while recording. The
+         * JSON files of the recorder keep their layout, in which the
+         * configurations and statistics are not named. If keyed, they are
+         * named "eNB_config" and "mac_stats" like in the REST statistics,
+         * which makes every chunk a valid JSON object
+         */
+        static void write_json_chunk(std::ostream& s, job_type type,
+            const std::map<uint64_t, bs_dump>& dump_chunk, bool keyed = false);
+        static void write_binary_chunk(std::ostream& s, const std::map<uint64_t, bs_dump>& dump_chunk);
+        /*! writes chunks as JSON array elements separated by commas. Ranges
+         * of chunks are rendered into buffers on the workers of executor (in
+         * this thread without one, or if it is busy) and written in order,
+         * so the output is the same as write_json_chunk() one by one. Only a
+         * few ranges are in flight to bound the memory. progress, if given,
+         * counts the chunks written */
+        static void write_json_chunks(std::ostream& s, job_type type,
+            const std::vector<std::map<uint64_t, bs_dump>>& chunks,
+            core::background_executor *executor,
+            std::atomic<uint64_t> *progress = nullptr);
+
       private:
+        /* a job that has been scheduled, owned by its tick subscription */
+        struct active_job {
+          job_info info;
+          bool started;
+          uint64_t dropped;
+          /* only for delta jobs */
+          std::unique_ptr<delta_capture> capture;
+          uint64_t recorded;
+          bool ended;
+          bool finished;
+          /* chunks in the file, counted by the writer thread */
+          std::shared_ptr<std::atomic<uint64_t>> written;
+        };
+
+        void tick(std::shared_ptr<active_job> job, const bs2::connection& conn,
+            uint64_t ms);
+
+        core::background_executor& executor_;
+        const int compression_level_;
+
         /* list of finished jobs that can be accessed via the NB REST API */
         std::vector<job_info> finished_jobs_;
+        /* all jobs for their progress, in order */
+        std::vector<std::shared_ptr<active_job>> jobs_;
 
-        std::unique_ptr<std::vector<std::map<uint64_t, bs_dump>>> dump_;
-        std::unique_ptr<job_info> current_job_;
+        /* the last scheduled job, the next one starts after it */
+        std::shared_ptr<active_job> current_job_;
+        /* writes the chunks while recording, created with the first job */
+        std::unique_ptr<recording_writer> writer_;
 
         bs_dump record_chunk(uint64_t bs_id);
 
-        /**
-         * method for writer thread, passes to right (JSON/binary)
-         * serialization method and moves job to writing_jobs_ after work.
-         */
-        void writer_method(std::unique_ptr<job_info> info,
-            std::unique_ptr<std::vector<std::map<uint64_t, bs_dump>>> dump);
-
-        static void write_json_chunk(std::ostream& s, job_type type,
-            const std::map<uint64_t, bs_dump>& dump_chunk);
         static std::vector<std::string> get_ue_stats(
             const std::vector<mac_harq_info_t>& ue_mac_harq_infos);
 
-        static void write_binary_chunk(std::ostream& s, const std::map<uint64_t, bs_dump>& dump_chunk);
         static void write_binary_ue_configs(std::ostream& s,
             const std::vector<mac_harq_info_t>& ue_mac_harq_infos);
 
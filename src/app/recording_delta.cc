@@ -0,0 +1,378 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    recording_delta.cc
+ *  \brief   delta encoding of recorder chunks with periodic keyframes
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <cstring>
+
+#include "recording_delta.h"
+#include "enb_rib_info.h"
+#include "flexran_log.h"
+
+namespace {
+  const char magic[4] = {'F', 'X', 'R', 'D'};
+  const uint32_t format_version = 2;
+
+  enum section : uint8_t { enb_section = 1, ue_section = 2, lc_section = 4 };
+
+  template <typename T>
+  void write_raw(std::ostream& s, const T& v)
+  {
+    s.write(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
+
+  template <typename T>
+  bool read_raw(std::istream& s, T& v)
+  {
+    return static_cast<bool>(s.read(reinterpret_cast<char *>(&v), sizeof(T)));
+  }
+
+  /* same layout as recorder::write_flexran_message() */
+  void write_bytes(std::ostream& s, const std::string& b)
+  {
+    write_raw(s, static_cast<size_t>(b.size()));
+    s.write(b.data(), b.size());
+  }
+
+  bool read_message(std::istream& s, google::protobuf::Message& m)
+  {
+    size_t n;
+    if (!read_raw(s, n)) return false;
+    std::string bytes(n, 0);
+    if (!s.read(&bytes[0], n)) return false;
+    return m.ParseFromString(bytes);
+  }
+
+  /* replaces prev with the serialized section m, if given and different.
+   * Sets changed if the section needs to be written */
+  template <typename T>
+  void update_section(const std::shared_ptr<const T>& m, std::string& prev,
+      bool& changed)
+  {
+    changed = false;
+    if (!m) return;
+    std::string b;
+    m->SerializeToString(&b);
+    changed = b != prev;
+    if (changed) prev.swap(b);
+  }
+
+  uint8_t pack_harq(const std::array<bool, 8>& harq)
+  {
+    uint8_t h = 0;
+    for (int i = 0; i < 8; i++)
+      h |= harq[i] << i;
+    return h;
+  }
+}
+
+flexran::app::log::delta_chunk flexran::app::log::delta_capture::capture(
+    const rib::Rib& rib)
+{
+  delta_chunk chunk;
+  const uint64_t now = ++captures_;
+  for (uint64_t bs_id : rib.get_available_base_stations()) {
+    const std::shared_ptr<rib::enb_rib_info> bs = rib.get_bs(bs_id);
+    if (!bs) continue;
+    auto l = last_.emplace(bs_id, versions{0, 0, {}});
+    versions& v = l.first->second;
+    v.seen = now;
+    bs_delta& d = chunk[bs_id];
+
+    const uint64_t config = bs->get_config_version();
+    const bool config_changed = l.second || v.config != config;
+    if (config_changed) {
+      v.config = config;
+      d.enb_config = std::make_shared<protocol::flex_enb_config_reply>(bs->get_enb_config());
+      d.ue_config = std::make_shared<protocol::flex_ue_config_reply>(bs->get_ue_configs());
+      d.lc_config = std::make_shared<protocol::flex_lc_config_reply>(bs->get_lc_configs());
+    }
+
+    const protocol::flex_ue_config_reply& ue_configs = bs->get_ue_configs();
+    for (int i = 0; i < ue_configs.ue_config_size(); i++) {
+      const rib::rnti_t rnti = ue_configs.ue_config(i).rnti();
+      std::shared_ptr<rib::ue_mac_rib_info> ue = bs->get_ue_mac_info(rnti);
+      if (!ue) continue;
+      auto lu = v.ues.emplace(rnti, ue_versions{0, 0, 0});
+      ue_versions& uv = lu.first->second;
+      uv.seen = now;
+
+      const auto& harq_array = ue->get_all_harq_stats();
+      std::array<bool, 8> harq;
+      for (int h = 0; h < 8; h++)
+        harq[h] = harq_array[0][h][0] == protocol::FLHS_ACK;
+      const uint8_t packed = pack_harq(harq);
+      const uint64_t stats = ue->get_stats_version();
+      const bool stats_changed = lu.second || uv.stats != stats;
+      if (!stats_changed && uv.harq == packed)
+        continue;
+      uv.stats = stats;
+      uv.harq = packed;
+
+      bs_delta::ue u;
+      u.rnti = rnti;
+      u.harq = harq;
+      if (stats_changed)
+        u.stats = std::make_shared<protocol::flex_ue_stats_report>(ue->get_mac_stats_report());
+      d.ues.push_back(std::move(u));
+    }
+
+    /* UEs only leave with a configuration change */
+    if (!config_changed) continue;
+    for (auto it = v.ues.begin(); it != v.ues.end(); ) {
+      if (it->second.seen == now) {
+        ++it;
+        continue;
+      }
+      d.removed.push_back(it->first);
+      it = v.ues.erase(it);
+    }
+  }
+
+  for (auto it = last_.begin(); it != last_.end(); ) {
+    if (it->second.seen == now) ++it;
+    else it = last_.erase(it);
+  }
+  return chunk;
+}
+
+flexran::app::log::delta_encoder::delta_encoder(uint32_t keyframe_interval)
+  : keyframe_interval_(keyframe_interval > 0 ? keyframe_interval : 1)
+{
+}
+
+void flexran::app::log::delta_encoder::write_header(std::ostream& s)
+{
+  s.write(magic, sizeof(magic));
+  write_raw(s, format_version);
+}
+
+bool flexran::app::log::delta_encoder::write(std::ostream& s, uint64_t tick,
+    const delta_chunk& chunk)
+{
+  const uint8_t keyframe = chunks_ % keyframe_interval_ == 0;
+
+  /* nothing is written (and the state is kept) for a chunk that refers to
+   * unknown sections */
+  for (const auto& p : chunk) {
+    const bs_delta& d = p.second;
+    auto prev = state_.find(p.first);
+    if (prev == state_.end() && !(d.enb_config && d.ue_config && d.lc_config)) {
+      LOG4CXX_ERROR(flog::app, "recorder: BS " << p.first
+          << " has no configuration, chunk at " << tick << " not written");
+      return false;
+    }
+    for (const bs_delta::ue& ue : d.ues) {
+      if (ue.stats) continue;
+      if (prev == state_.end() || prev->second.ues.count(ue.rnti) == 0) {
+        LOG4CXX_ERROR(flog::app, "recorder: UE " << ue.rnti << " of BS " << p.first
+            << " has no statistics, chunk at " << tick << " not written");
+        return false;
+      }
+    }
+  }
+
+  /* BSs that are not in the chunk disconnected */
+  for (auto it = state_.begin(); it != state_.end(); ) {
+    if (chunk.count(it->first) > 0) ++it;
+    else it = state_.erase(it);
+  }
+
+  std::map<uint64_t, uint8_t> masks;
+  std::map<uint64_t, std::vector<bool>> ue_changed;
+  for (const auto& p : chunk) {
+    const bs_delta& d = p.second;
+    bs_state& st = state_[p.first];
+    bool e, u, l;
+    update_section(d.enb_config, st.enb_config, e);
+    update_section(d.ue_config, st.ue_config, u);
+    update_section(d.lc_config, st.lc_config, l);
+    masks[p.first] = keyframe ? enb_section | ue_section | lc_section
+        : (e ? enb_section : 0) | (u ? ue_section : 0) | (l ? lc_section : 0);
+
+    for (rib::rnti_t rnti : d.removed)
+      st.ues.erase(rnti);
+    std::vector<bool>& uc = ue_changed[p.first];
+    for (const bs_delta::ue& ue : d.ues) {
+      ue_state& us = st.ues[ue.rnti];
+      us.harq = pack_harq(ue.harq);
+      bool c;
+      update_section(ue.stats, us.stats, c);
+      uc.push_back(c);
+    }
+  }
+
+  write_raw(s, tick);
+  write_raw(s, keyframe);
+  write_raw(s, static_cast<uint16_t>(chunk.size()));
+  for (const auto& p : chunk) {
+    const bs_state& st = state_.at(p.first);
+    const uint8_t mask = masks[p.first];
+    write_raw(s, p.first);
+    write_raw(s, mask);
+    if (mask & enb_section) write_bytes(s, st.enb_config);
+    if (mask & ue_section)  write_bytes(s, st.ue_config);
+    if (mask & lc_section)  write_bytes(s, st.lc_config);
+
+    const uint8_t present = 1;
+    if (keyframe) {
+      /* all UEs, none removed */
+      write_raw(s, static_cast<uint16_t>(st.ues.size()));
+      for (const auto& ue : st.ues) {
+        write_raw(s, static_cast<uint16_t>(ue.first));
+        write_raw(s, ue.second.harq);
+        write_raw(s, present);
+        write_bytes(s, ue.second.stats);
+      }
+      write_raw(s, static_cast<uint16_t>(0));
+      continue;
+    }
+
+    const std::vector<bool>& uc = ue_changed[p.first];
+    write_raw(s, static_cast<uint16_t>(p.second.ues.size()));
+    for (size_t i = 0; i < p.second.ues.size(); ++i) {
+      const bs_delta::ue& ue = p.second.ues[i];
+      const ue_state& us = st.ues.at(ue.rnti);
+      write_raw(s, static_cast<uint16_t>(ue.rnti));
+      write_raw(s, us.harq);
+      const uint8_t changed = uc[i];
+      write_raw(s, changed);
+      if (changed)
+        write_bytes(s, us.stats);
+    }
+    write_raw(s, static_cast<uint16_t>(p.second.removed.size()));
+    for (rib::rnti_t rnti : p.second.removed)
+      write_raw(s, static_cast<uint16_t>(rnti));
+  }
+  chunks_++;
+  return true;
+}
+
+bool flexran::app::log::delta_decoder::read_header(std::istream& s)
+{
+  char m[sizeof(magic)];
+  uint32_t v;
+  if (!s.read(m, sizeof(m)) || std::memcmp(m, magic, sizeof(magic)) != 0)
+    return false;
+  if (!read_raw(s, v) || v != format_version) {
+    LOG4CXX_ERROR(flog::app, "recorder: unsupported delta recording version " << v);
+    return false;
+  }
+  return true;
+}
+
+bool flexran::app::log::delta_decoder::next(std::istream& s, uint64_t& tick,
+    std::map<uint64_t, bs_dump>& chunk)
+{
+  uint8_t keyframe;
+  uint16_t n_bs;
+  if (!read_raw(s, tick))
+    return false; // end of recording
+  if (!read_raw(s, keyframe) || !read_raw(s, n_bs)) {
+    LOG4CXX_ERROR(flog::app, "recorder: truncated chunk at " << tick);
+    return false;
+  }
+
+  chunk.clear();
+  std::map<uint64_t, bs_state> next;
+  for (uint16_t i = 0; i < n_bs; ++i) {
+    uint64_t bs_id;
+    uint8_t mask;
+    if (!read_raw(s, bs_id) || !read_raw(s, mask)) {
+      LOG4CXX_ERROR(flog::app, "recorder: truncated chunk at " << tick);
+      return false;
+    }
+    auto prev = state_.find(bs_id);
+    const bool known = prev != state_.end();
+    const uint8_t all = enb_section | ue_section | lc_section;
+    if (!known && (mask & all) != all) {
+      LOG4CXX_ERROR(flog::app, "recorder: BS " << bs_id << " at " << tick
+          << " refers to an unknown configuration");
+      return false;
+    }
+    bs_state& st = next[bs_id];
+    if (known)
+      st = std::move(prev->second);
+    if (((mask & enb_section) && !read_message(s, st.enb_config))
+        || ((mask & ue_section) && !read_message(s, st.ue_config))
+        || ((mask & lc_section) && !read_message(s, st.lc_config))) {
+      LOG4CXX_ERROR(flog::app, "recorder: cannot read configuration of BS "
+          << bs_id << " at " << tick);
+      return false;
+    }
+
+    uint16_t n_ue;
+    if (!read_raw(s, n_ue)) {
+      LOG4CXX_ERROR(flog::app, "recorder: truncated chunk at " << tick);
+      return false;
+    }
+    /* keyframes list all UEs */
+    if (keyframe)
+      st.ues.clear();
+    for (uint16_t j = 0; j < n_ue; ++j) {
+      uint16_t rnti;
+      uint8_t harq, present;
+      if (!read_raw(s, rnti) || !read_raw(s, harq) || !read_raw(s, present)) {
+        LOG4CXX_ERROR(flog::app, "recorder: truncated chunk at " << tick);
+        return false;
+      }
+      auto ue = st.ues.find(rnti);
+      if (present) {
+        if (ue == st.ues.end())
+          ue = st.ues.emplace(rnti, mac_harq_info_t()).first;
+        if (!read_message(s, ue->second.first)) {
+          LOG4CXX_ERROR(flog::app, "recorder: cannot read statistics of UE "
+              << rnti << " of BS " << bs_id << " at " << tick);
+          return false;
+        }
+      } else if (ue == st.ues.end()) {
+        LOG4CXX_ERROR(flog::app, "recorder: UE " << rnti << " of BS " << bs_id
+            << " at " << tick << " refers to unknown statistics");
+        return false;
+      }
+      for (int k = 0; k < 8; k++)
+        ue->second.second[k] = (harq >> k) & 1;
+    }
+
+    uint16_t n_removed;
+    if (!read_raw(s, n_removed)) {
+      LOG4CXX_ERROR(flog::app, "recorder: truncated chunk at " << tick);
+      return false;
+    }
+    for (uint16_t j = 0; j < n_removed; ++j) {
+      uint16_t rnti;
+      if (!read_raw(s, rnti)) {
+        LOG4CXX_ERROR(flog::app, "recorder: truncated chunk at " << tick);
+        return false;
+      }
+      st.ues.erase(rnti);
+    }
+
+    std::vector<mac_harq_info_t> ues;
+    ues.reserve(st.ues.size());
+    for (const auto& ue : st.ues)
+      ues.push_back(ue.second);
+    chunk.emplace(bs_id, bs_dump{st.enb_config, st.ue_config, st.lc_config, ues});
+  }
+  state_.swap(next);
+  return true;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    recording_delta.h
+ *  \brief   delta encoding of recorder chunks with periodic keyframes
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef _RECORDING_DELTA_H_
+#define _RECORDING_DELTA_H_
+
+#include <array>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "recorder.h"
+#include "rib.h"
+
+namespace flexran {
+
+  namespace app {
+
+    namespace log {
+
+      /* The sections of a BS that changed since the previous chunk of a
+       * recording. A nullptr section is unchanged. */
+      struct bs_delta {
+        struct ue {
+          rib::rnti_t rnti;
+          std::array<bool, 8> harq;
+          std::shared_ptr<const protocol::flex_ue_stats_report> stats;
+        };
+        std::shared_ptr<const protocol::flex_enb_config_reply> enb_config;
+        std::shared_ptr<const protocol::flex_ue_config_reply>  ue_config;
+        std::shared_ptr<const protocol::flex_lc_config_reply>  lc_config;
+        /// UEs that are new or whose HARQ information or statistics changed
+        std::vector<ue> ues;
+        /// UEs that left since the previous chunk
+        std::vector<rib::rnti_t> removed;
+      };
+      typedef std::map<uint64_t, bs_delta> delta_chunk;
+
+      /* Takes delta chunks from the RIB in the tick thread. Configurations
+       * are only copied when the BS's configuration version moved. A UE is
+       * only part of a chunk if it is new, if its HARQ information changed,
+       * or if its statistics version moved (then with the statistics). */
+      class delta_capture {
+      public:
+        delta_chunk capture(const rib::Rib& rib);
+        /// the next chunk has all sections, e.g., after a chunk was lost
+        void reset() { last_.clear(); }
+
+      private:
+        /* what the last chunk had; seen is the capture that last found the
+         * BS/UE, to detect the ones that left */
+        struct ue_versions {
+          uint64_t stats;
+          uint8_t harq;
+          uint64_t seen;
+        };
+        struct versions {
+          uint64_t config;
+          uint64_t seen;
+          std::map<rib::rnti_t, ue_versions> ues;
+        };
+        std::map<uint64_t, versions> last_;
+        uint64_t captures_ = 0;
+      };
+
+      /* Delta recording format:
+       *   header: magic "FXRD", uint32 version
+       *   per chunk: uint64 tick, uint8 keyframe, uint16 number of BSs
+       *     per BS: uint64 bs_id, uint8 mask of the config sections that
+       *       follow (enb, ue, lc), each as size_t-prefixed protobuf;
+       *       uint16 number of UEs
+       *       per UE: uint16 rnti, uint8 harq, uint8 stats present,
+       *         [size_t-prefixed flex_ue_stats_report]
+       *       uint16 number of removed UEs, per UE: uint16 rnti
+       * A missing section is the same as in the previous chunk of that BS,
+       * and so are UEs that are not listed. Keyframes have all sections and
+       * list all UEs, so reading can start at any of them. */
+      class delta_encoder {
+      public:
+        /// every keyframe_interval-th chunk is a keyframe, the first always
+        explicit delta_encoder(uint32_t keyframe_interval = 1000);
+
+        void write_header(std::ostream& s);
+        /*! writes chunk, dropping sections that did not change. Returns
+         * false if it refers to a section that has not been seen before,
+         * e.g., because the chunk with it was lost */
+        bool write(std::ostream& s, uint64_t tick, const delta_chunk& chunk);
+
+        uint64_t num_chunks() const { return chunks_; }
+
+      private:
+        /* the serialized sections of the last chunk, per BS */
+        struct ue_state {
+          uint8_t harq;
+          std::string stats;
+        };
+        struct bs_state {
+          std::string enb_config;
+          std::string ue_config;
+          std::string lc_config;
+          std::map<rib::rnti_t, ue_state> ues;
+        };
+
+        const uint32_t keyframe_interval_;
+        uint64_t chunks_ = 0;
+        std::map<uint64_t, bs_state> state_;
+      };
+
+      /* Reads delta recordings, reconstructing full chunks */
+      class delta_decoder {
+      public:
+        /// true if s is at the start of a delta recording (the header is consumed)
+        bool read_header(std::istream& s);
+        /*! reads the next chunk into tick and chunk, false at the end of s or
+         * if the recording is corrupt */
+        bool next(std::istream& s, uint64_t& tick, std::map<uint64_t, bs_dump>& chunk);
+
+      private:
+        struct bs_state {
+          protocol::flex_enb_config_reply enb_config;
+          protocol::flex_ue_config_reply  ue_config;
+          protocol::flex_lc_config_reply  lc_config;
+          std::map<rib::rnti_t, mac_harq_info_t> ues;
+        };
+
+        std::map<uint64_t, bs_state> state_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* _RECORDING_DELTA_H_ */
@@ -0,0 +1,360 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    recording_file.cc
+ *  \brief   indexed recording container with a random-access reader
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <istream>
+
+#include "recording_file.h"
+#include "flexran_log.h"
+
+namespace {
+  const char file_magic[4] = {'F', 'X', 'R', 'C'};
+  const char index_magic[4] = {'F', 'X', 'R', 'X'};
+  const uint32_t file_version = 1;
+
+  const size_t header_size = sizeof(file_magic) + 2 * sizeof(uint32_t);
+  const size_t entry_size = 5 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+  const size_t trailer_size = sizeof(uint64_t) + sizeof(uint32_t) + sizeof(index_magic);
+
+  template <typename T>
+  void write_raw(std::ostream& s, const T& v)
+  {
+    s.write(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
+
+  template <typename T>
+  const char *read_raw(const char *p, T& v)
+  {
+    std::memcpy(&v, p, sizeof(T));
+    return p + sizeof(T);
+  }
+
+  /* read-only stream buffer over mapped memory, to decode blocks in place */
+  class memory_buf : public std::streambuf {
+  public:
+    memory_buf(const char *data, size_t size)
+    {
+      char *p = const_cast<char *>(data);
+      setg(p, p, p + size);
+    }
+  };
+}
+
+constexpr const uint32_t flexran::app::log::index_entry::deflate;
+
+flexran::app::log::recording_file_writer::recording_file_writer(std::ostream& s,
+    uint32_t block_chunks, int compression_level)
+  : s_(s),
+    block_chunks_(block_chunks > 0 ? block_chunks : 1),
+    compression_level_(compression_level)
+{
+}
+
+void flexran::app::log::recording_file_writer::write_header()
+{
+  s_.write(file_magic, sizeof(file_magic));
+  write_raw(s_, file_version);
+  write_raw(s_, block_chunks_);
+}
+
+bool flexran::app::log::recording_file_writer::write(uint64_t tick,
+    const delta_chunk& chunk)
+{
+  bool ok = true;
+  for (const auto& p : chunk) {
+    auto it = blocks_.find(p.first);
+    if (it == blocks_.end())
+      it = blocks_.emplace(std::piecewise_construct, std::forward_as_tuple(p.first),
+          std::forward_as_tuple(block_chunks_)).first;
+    open_block& b = it->second;
+    if (!b.encoder.write(b.data, tick, delta_chunk{{p.first, p.second}})) {
+      ok = false;
+      continue;
+    }
+    if (b.entry.chunks == 0)
+      b.entry.first_tick = tick;
+    b.entry.last_tick = tick;
+    /* the encoder writes a keyframe every block_chunks_, i.e., the next
+     * block starts with one */
+    if (++b.entry.chunks == block_chunks_)
+      flush(p.first, b);
+  }
+  chunks_++;
+  return ok;
+}
+
+void flexran::app::log::recording_file_writer::finish()
+{
+  for (auto& p : blocks_)
+    if (p.second.entry.chunks > 0)
+      flush(p.first, p.second);
+  blocks_.clear();
+
+  std::sort(index_.begin(), index_.end(),
+      [] (const index_entry& a, const index_entry& b) {
+        return a.bs_id < b.bs_id || (a.bs_id == b.bs_id && a.first_tick < b.first_tick);
+      });
+  const uint64_t offset = s_.tellp();
+  for (const index_entry& e : index_) {
+    write_raw(s_, e.bs_id);
+    write_raw(s_, e.first_tick);
+    write_raw(s_, e.last_tick);
+    write_raw(s_, e.offset);
+    write_raw(s_, e.size);
+    write_raw(s_, e.chunks);
+    write_raw(s_, e.flags);
+  }
+  write_raw(s_, offset);
+  write_raw(s_, static_cast<uint32_t>(index_.size()));
+  s_.write(index_magic, sizeof(index_magic));
+}
+
+void flexran::app::log::recording_file_writer::flush(uint64_t bs_id, open_block& b)
+{
+  const std::string data = b.data.str();
+  b.entry.bs_id = bs_id;
+  b.entry.offset = s_.tellp();
+  b.entry.flags = 0;
+  if (compression_level_ > 0) {
+    uLongf n = compressBound(data.size());
+    std::string z(sizeof(uint64_t) + n, 0);
+    const uint64_t raw = data.size();
+    std::memcpy(&z[0], &raw, sizeof(raw));
+    if (compress2(reinterpret_cast<Bytef *>(&z[sizeof(uint64_t)]), &n,
+          reinterpret_cast<const Bytef *>(data.data()), data.size(),
+          compression_level_) == Z_OK
+        && sizeof(uint64_t) + n < data.size()) {
+      z.resize(sizeof(uint64_t) + n);
+      b.entry.size = z.size();
+      b.entry.flags = index_entry::deflate;
+      s_.write(z.data(), z.size());
+    }
+  }
+  if (b.entry.flags == 0) {
+    b.entry.size = data.size();
+    s_.write(data.data(), data.size());
+  }
+  index_.push_back(b.entry);
+  b.data.str("");
+  b.entry.chunks = 0;
+}
+
+flexran::app::log::recording_file_reader::~recording_file_reader()
+{
+  close();
+}
+
+bool flexran::app::log::recording_file_reader::is_recording_file(
+    const std::string& filename)
+{
+  std::ifstream f(filename, std::ios::binary);
+  char m[sizeof(file_magic)];
+  return f.read(m, sizeof(m)) && std::memcmp(m, file_magic, sizeof(m)) == 0;
+}
+
+bool flexran::app::log::recording_file_reader::open(const std::string& filename)
+{
+  close();
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG4CXX_ERROR(flog::app, "recorder: cannot open file " << filename
+        << ": " << strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < header_size + trailer_size) {
+    LOG4CXX_ERROR(flog::app, "recorder: " << filename << " is not a recording file");
+    ::close(fd);
+    return false;
+  }
+  void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (m == MAP_FAILED) {
+    LOG4CXX_ERROR(flog::app, "recorder: cannot map file " << filename
+        << ": " << strerror(errno));
+    return false;
+  }
+  data_ = static_cast<const char *>(m);
+  size_ = st.st_size;
+
+  uint32_t version;
+  read_raw(data_ + sizeof(file_magic), version);
+  if (std::memcmp(data_, file_magic, sizeof(file_magic)) != 0 || version != file_version) {
+    LOG4CXX_ERROR(flog::app, "recorder: " << filename
+        << " is not a recording file of version " << file_version);
+    close();
+    return false;
+  }
+
+  const char *t = data_ + size_ - trailer_size;
+  uint64_t offset;
+  uint32_t n;
+  t = read_raw(t, offset);
+  t = read_raw(t, n);
+  if (std::memcmp(t, index_magic, sizeof(index_magic)) != 0
+      || offset < header_size || offset + n * entry_size != size_ - trailer_size) {
+    LOG4CXX_ERROR(flog::app, "recorder: " << filename
+        << " has no index, the recording did not finish");
+    close();
+    return false;
+  }
+  index_.resize(n);
+  const char *p = data_ + offset;
+  for (index_entry& e : index_) {
+    p = read_raw(p, e.bs_id);
+    p = read_raw(p, e.first_tick);
+    p = read_raw(p, e.last_tick);
+    p = read_raw(p, e.offset);
+    p = read_raw(p, e.size);
+    p = read_raw(p, e.chunks);
+    p = read_raw(p, e.flags);
+    if (e.offset < header_size || e.offset + e.size > offset) {
+      LOG4CXX_ERROR(flog::app, "recorder: " << filename << " has a corrupt index");
+      close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void flexran::app::log::recording_file_reader::close()
+{
+  if (data_)
+    munmap(const_cast<char *>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+  index_.clear();
+}
+
+std::set<uint64_t> flexran::app::log::recording_file_reader::base_stations() const
+{
+  std::set<uint64_t> bs;
+  for (const index_entry& e : index_)
+    bs.insert(e.bs_id);
+  return bs;
+}
+
+bool flexran::app::log::recording_file_reader::tick_range(uint64_t& first,
+    uint64_t& last) const
+{
+  if (index_.empty()) return false;
+  first = UINT64_MAX;
+  last = 0;
+  for (const index_entry& e : index_) {
+    first = std::min(first, e.first_tick);
+    last = std::max(last, e.last_tick);
+  }
+  return true;
+}
+
+bool flexran::app::log::recording_file_reader::read(uint64_t bs_id,
+    uint64_t t0, uint64_t t1, std::map<uint64_t, bs_dump>& out) const
+{
+  /* the blocks of a BS are sorted and do not overlap: skip to the first
+   * one that ends at or after t0 */
+  auto it = std::lower_bound(index_.begin(), index_.end(), std::make_pair(bs_id, t0),
+      [] (const index_entry& e, const std::pair<uint64_t, uint64_t>& k) {
+        return e.bs_id < k.first || (e.bs_id == k.first && e.last_tick < k.second);
+      });
+  std::map<uint64_t, std::map<uint64_t, bs_dump>> chunks;
+  for (; it != index_.end() && it->bs_id == bs_id && it->first_tick <= t1; ++it)
+    if (!decode(*it, t0, t1, chunks))
+      return false;
+  for (auto& c : chunks)
+    out.emplace(c.first, std::move(c.second.begin()->second));
+  return true;
+}
+
+bool flexran::app::log::recording_file_reader::read(uint64_t t0, uint64_t t1,
+    std::map<uint64_t, std::map<uint64_t, bs_dump>>& out) const
+{
+  for (const index_entry& e : index_) {
+    if (e.last_tick < t0 || e.first_tick > t1)
+      continue;
+    if (!decode(e, t0, t1, out))
+      return false;
+  }
+  return true;
+}
+
+bool flexran::app::log::recording_file_reader::decode(const index_entry& e,
+    uint64_t t0, uint64_t t1,
+    std::map<uint64_t, std::map<uint64_t, bs_dump>>& out) const
+{
+  const char *block = data_ + e.offset;
+  size_t size = e.size;
+  std::string raw;
+  if (e.flags & index_entry::deflate) {
+    uint64_t n;
+    if (size < sizeof(n)) {
+      LOG4CXX_ERROR(flog::app, "recorder: corrupt block of BS " << e.bs_id
+          << " at " << e.first_tick);
+      return false;
+    }
+    read_raw(block, n);
+    raw.resize(n);
+    uLongf rn = n;
+    if (uncompress(reinterpret_cast<Bytef *>(&raw[0]), &rn,
+          reinterpret_cast<const Bytef *>(block + sizeof(n)), size - sizeof(n)) != Z_OK
+        || rn != n) {
+      LOG4CXX_ERROR(flog::app, "recorder: cannot decompress block of BS "
+          << e.bs_id << " at " << e.first_tick);
+      return false;
+    }
+    block = raw.data();
+    size = raw.size();
+  } else if (e.flags != 0) {
+    LOG4CXX_ERROR(flog::app, "recorder: block of BS " << e.bs_id << " at "
+        << e.first_tick << " has unknown flags " << e.flags);
+    return false;
+  }
+  memory_buf buf(block, size);
+  std::istream s(&buf);
+  /* every block starts with a keyframe */
+  delta_decoder dec;
+  uint64_t tick;
+  std::map<uint64_t, bs_dump> chunk;
+  for (uint32_t i = 0; i < e.chunks; ++i) {
+    if (!dec.next(s, tick, chunk)) {
+      LOG4CXX_ERROR(flog::app, "recorder: corrupt block of BS " << e.bs_id
+          << " at " << e.first_tick);
+      return false;
+    }
+    if (tick > t1)
+      break;
+    if (tick < t0)
+      continue;
+    for (auto& c : chunk)
+      out[tick].emplace(c.first, std::move(c.second));
+  }
+  return true;
+}
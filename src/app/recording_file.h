@@ -0,0 +1,147 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    recording_file.h
+ *  \brief   indexed recording container with a random-access reader
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef _RECORDING_FILE_H_
+#define _RECORDING_FILE_H_
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "recorder.h"
+#include "recording_delta.h"
+
+namespace flexran {
+
+  namespace app {
+
+    namespace log {
+
+      /* One block of a recording file: the delta chunks of one BS over a
+       * range of ticks, starting with a keyframe so that it can be decoded
+       * on its own */
+      struct index_entry {
+        /// flags: the block is deflate-compressed
+        static constexpr const uint32_t deflate = 1;
+
+        uint64_t bs_id;
+        uint64_t first_tick;
+        uint64_t last_tick;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t chunks;
+        uint32_t flags;
+      };
+
+      /* Recording file format (version 1):
+       *   header: magic "FXRC", uint32 version, uint32 chunks per block
+       *   blocks: delta chunks of a single BS each (see delta_encoder),
+       *     without the delta header. Compressed blocks (index_entry::deflate)
+       *     are a uint64 uncompressed size and the zlib stream
+       *   index: one index_entry per block (all fields in order), sorted by
+       *     BS and first tick
+       *   trailer: uint64 offset of the index, uint32 number of entries,
+       *     magic "FXRX"
+       * Blocks are buffered per BS and written when full, so the index is
+       * only complete after finish(). With a compression level (1-9), every
+       * block is compressed on its own, so random access still works. */
+      class recording_file_writer {
+      public:
+        recording_file_writer(std::ostream& s, uint32_t block_chunks = 1000,
+            int compression_level = 0);
+
+        void write_header();
+        /// appends the delta chunk at tick, false if it could not be encoded
+        bool write(uint64_t tick, const delta_chunk& chunk);
+        /// writes all open blocks and the index
+        void finish();
+
+        uint64_t num_chunks() const { return chunks_; }
+
+      private:
+        struct open_block {
+          explicit open_block(uint32_t block_chunks) : encoder(block_chunks), entry() {}
+          delta_encoder encoder;
+          std::ostringstream data;
+          index_entry entry;
+        };
+
+        void flush(uint64_t bs_id, open_block& b);
+
+        std::ostream& s_;
+        const uint32_t block_chunks_;
+        const int compression_level_;
+        uint64_t chunks_ = 0;
+        std::map<uint64_t, open_block> blocks_;
+        std::vector<index_entry> index_;
+      };
+
+      /* Reads recording files through a read-only memory mapping. Only the
+       * index is parsed on open(); time slices decode the blocks they need */
+      class recording_file_reader {
+      public:
+        recording_file_reader() = default;
+        ~recording_file_reader();
+        recording_file_reader(const recording_file_reader&) = delete;
+        recording_file_reader& operator=(const recording_file_reader&) = delete;
+
+        /// true if filename starts like a recording file
+        static bool is_recording_file(const std::string& filename);
+
+        /// maps filename and reads its index, false (and logs) on error
+        bool open(const std::string& filename);
+        void close();
+
+        const std::vector<index_entry>& index() const { return index_; }
+        std::set<uint64_t> base_stations() const;
+        /// first and last tick over all BSs, false if the file is empty
+        bool tick_range(uint64_t& first, uint64_t& last) const;
+
+        /*! the chunks of bs_id with ticks in [t0, t1], by tick. False if a
+         * block is corrupt */
+        bool read(uint64_t bs_id, uint64_t t0, uint64_t t1,
+            std::map<uint64_t, bs_dump>& out) const;
+        /*! the chunks of all BSs with ticks in [t0, t1], by tick */
+        bool read(uint64_t t0, uint64_t t1,
+            std::map<uint64_t, std::map<uint64_t, bs_dump>>& out) const;
+
+      private:
+        bool decode(const index_entry& e, uint64_t t0, uint64_t t1,
+            std::map<uint64_t, std::map<uint64_t, bs_dump>>& out) const;
+
+        const char *data_ = nullptr;
+        size_t size_ = 0;
+        std::vector<index_entry> index_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* _RECORDING_FILE_H_ */
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    recording_replay.cc
+ *  \brief   replays recordings of the recorder app into the RIB
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+
+#include "recording_replay.h"
+#include "flexran_log.h"
+
+namespace {
+  /* compares serialized messages, as bs_dump::operator== */
+  bool same(const google::protobuf::Message& a, const google::protobuf::Message& b)
+  {
+    return a.SerializeAsString() == b.SerializeAsString();
+  }
+}
+
+flexran::app::log::recording_replay::recording_replay(rib::Rib& rib,
+    event::subscription& sub, uint64_t window)
+  : rib_(rib),
+    event_sub_(sub),
+    window_(std::max<uint64_t>(window, 1))
+{
+}
+
+bool flexran::app::log::recording_replay::open(const std::string& filename,
+    std::string& error_reason)
+{
+  pending_.clear();
+  if (recording_file_reader::is_recording_file(filename)) {
+    if (!reader_.open(filename)) {
+      error_reason = "cannot open recording file " + filename;
+      return false;
+    }
+    if (!reader_.tick_range(first_tick_, last_tick_)) {
+      error_reason = "recording file " + filename + " is empty";
+      return false;
+    }
+    from_file_ = true;
+    next_read_ = first_tick_;
+    return true;
+  }
+
+  /* older recordings have no ticks: one chunk per tick */
+  std::vector<std::map<uint64_t, bs_dump>> chunks = recorder::read_binary(filename);
+  if (chunks.empty()) {
+    error_reason = "cannot read recording " + filename + " or it is empty";
+    return false;
+  }
+  for (size_t i = 0; i < chunks.size(); ++i)
+    pending_.emplace(i, std::move(chunks[i]));
+  from_file_ = false;
+  first_tick_ = 0;
+  last_tick_ = chunks.size() - 1;
+  return true;
+}
+
+bool flexran::app::log::recording_replay::load_window()
+{
+  if (!from_file_ || next_read_ > last_tick_)
+    return false;
+  const uint64_t t1 = std::min(last_tick_, next_read_ + window_ - 1);
+  if (!reader_.read(next_read_, t1, pending_)) {
+    LOG4CXX_ERROR(flog::app, "recording_replay: cannot read ticks "
+        << next_read_ << " to " << t1 << ", stopping replay");
+    next_read_ = last_tick_ + 1;
+    return false;
+  }
+  next_read_ = t1 + 1;
+  return true;
+}
+
+bool flexran::app::log::recording_replay::feed(uint64_t tick)
+{
+  const uint64_t until = first_tick_ + tick;
+  for (;;) {
+    if (pending_.empty()) {
+      if (!load_window())
+        return false;
+      continue;
+    }
+    auto it = pending_.begin();
+    if (it->first > until)
+      return true;
+    apply(it->second, it->first);
+    pending_.erase(it);
+  }
+}
+
+void flexran::app::log::recording_replay::apply(
+    std::map<uint64_t, bs_dump>& chunk, uint64_t tick)
+{
+  /* a BS that is not in a chunk was not connected anymore */
+  for (auto it = agents_.begin(); it != agents_.end(); ) {
+    const uint64_t bs_id = it->first;
+    ++it;
+    if (chunk.find(bs_id) == chunk.end())
+      remove_bs(bs_id);
+  }
+
+  for (const auto& p : chunk) {
+    const bool is_new = agents_.find(p.first) == agents_.end();
+    std::shared_ptr<rib::enb_rib_info> bs = is_new ? add_bs(p.first) : rib_.get_bs(p.first);
+    if (!bs)
+      continue;
+    auto prev = last_.find(p.first);
+    apply_bs(*bs, p.second, prev != last_.end() ? &prev->second : nullptr, tick);
+    /* the apps see the BS with its configuration */
+    if (is_new)
+      event_sub_.bs_add_(p.first);
+  }
+  last_.swap(chunk);
+  chunks_++;
+}
+
+std::shared_ptr<flexran::rib::enb_rib_info>
+flexran::app::log::recording_replay::add_bs(uint64_t bs_id)
+{
+  if (ignored_.find(bs_id) != ignored_.end())
+    return nullptr;
+  if (rib_.get_bs(bs_id)) {
+    LOG4CXX_WARN(flog::app, "recording_replay: BS " << bs_id
+        << " exists already, not replaying it");
+    ignored_.insert(bs_id);
+    return nullptr;
+  }
+
+  /* a single agent with all capabilities stands in for the BS */
+  google::protobuf::RepeatedField<int> caps;
+  for (int c = protocol::LOPHY; c <= protocol::RRC; ++c)
+    caps.Add(c);
+  const google::protobuf::RepeatedField<int> splits;
+  auto agent = std::make_shared<rib::agent_info>(next_agent_id_--, bs_id,
+      rib::agent_capabilities(caps), rib::agent_splits(splits), "replay");
+  if (!rib_.add_pending_agent(agent) || !rib_.new_eNB_config_entry(bs_id)) {
+    LOG4CXX_ERROR(flog::app, "recording_replay: cannot create BS " << bs_id);
+    rib_.remove_pending_agent(agent->agent_id);
+    ignored_.insert(bs_id);
+    return nullptr;
+  }
+  agents_.emplace(bs_id, agent->agent_id);
+  LOG4CXX_INFO(flog::app, "recording_replay: new BS " << bs_id);
+  return rib_.get_bs(bs_id);
+}
+
+void flexran::app::log::recording_replay::remove_bs(uint64_t bs_id)
+{
+  auto it = agents_.find(bs_id);
+  rib_.remove_eNB_config_entry(it->second);
+  agents_.erase(it);
+  last_.erase(bs_id);
+  LOG4CXX_INFO(flog::app, "recording_replay: BS " << bs_id << " is offline");
+  event_sub_.bs_remove_(bs_id);
+}
+
+void flexran::app::log::recording_replay::apply_bs(rib::enb_rib_info& bs,
+    const bs_dump& d, const bs_dump *prev, uint64_t tick)
+{
+  const uint64_t bs_id = bs.get_id();
+  if (!prev || !same(prev->enb_config, d.enb_config))
+    bs.update_eNB_config(d.enb_config);
+
+  /* UEs are added and removed through state changes, as by an agent */
+  std::set<rib::rnti_t> rntis, known;
+  for (const protocol::flex_ue_config& c : d.ue_config.ue_config())
+    rntis.insert(c.rnti());
+  if (prev)
+    for (const protocol::flex_ue_config& c : prev->ue_config.ue_config())
+      known.insert(c.rnti());
+  for (rib::rnti_t rnti : known) {
+    if (rntis.find(rnti) != rntis.end()) continue;
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_DEACTIVATED);
+    sc.mutable_config()->set_rnti(rnti);
+    bs.update_UE_config(sc);
+    event_sub_.ue_disconnect_(bs_id, rnti);
+  }
+  for (const protocol::flex_ue_config& c : d.ue_config.ue_config()) {
+    if (known.find(c.rnti()) != known.end()) continue;
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->CopyFrom(c);
+    bs.update_UE_config(sc);
+    event_sub_.ue_connect_(bs_id, c.rnti());
+  }
+  if (prev && !same(prev->ue_config, d.ue_config))
+    bs.update_UE_config(d.ue_config);
+
+  if (!prev || !same(prev->lc_config, d.lc_config))
+    bs.update_LC_config(d.lc_config);
+
+  /* statistics and HARQ states of UEs that changed */
+  std::map<rib::rnti_t, const mac_harq_info_t *> prev_ues;
+  if (prev)
+    for (const mac_harq_info_t& u : prev->ue_mac_harq_infos)
+      prev_ues.emplace(u.first.rnti(), &u);
+  protocol::flex_stats_reply stats;
+  protocol::flex_sf_trigger sf;
+  sf.set_sfn_sf(rib::get_sfn_sf((tick / 10) % 1024, tick % 10));
+  for (const mac_harq_info_t& u : d.ue_mac_harq_infos) {
+    const rib::rnti_t rnti = u.first.rnti();
+    auto pu = prev_ues.find(rnti);
+    if (pu == prev_ues.end() || !same(pu->second->first, u.first))
+      stats.add_ue_report()->CopyFrom(u.first);
+    if (pu != prev_ues.end() && pu->second->second == u.second)
+      continue;
+    for (int h = 0; h < 8; ++h) {
+      protocol::flex_dl_info *dl = sf.add_dl_info();
+      dl->set_rnti(rnti);
+      dl->set_harq_process_id(h);
+      dl->set_serv_cell_index(0);
+      dl->add_harq_status(u.second[h] ? protocol::FLHS_ACK : protocol::FLHS_NACK);
+    }
+  }
+  if (stats.ue_report_size() > 0)
+    bs.update_mac_stats(stats);
+  /* the subframe advances in every tick, which also keeps the BS alive */
+  bs.update_subframe(sf);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    recording_replay.h
+ *  \brief   replays recordings of the recorder app into the RIB
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef _RECORDING_REPLAY_H_
+#define _RECORDING_REPLAY_H_
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "replay_source.h"
+#include "rib.h"
+#include "subscription.h"
+#include "recorder.h"
+#include "recording_file.h"
+
+namespace flexran {
+
+  namespace app {
+
+    namespace log {
+
+      /* Replays a recording of the recorder app into the RIB, without any
+       * agent: the recorded BSs and UEs are created and removed together with
+       * their events, configurations are updated when they changed, and the
+       * UE statistics and HARQ states in every tick. Tick 0 is the first tick
+       * of the recording. Recording files (delta jobs) are read in windows of
+       * window ticks, other recordings completely on open(); the latter have
+       * no ticks and are replayed one chunk per tick. Runs in the task manager
+       * thread (see timing_mode::virtual_time). */
+      class recording_replay : public core::replay_source {
+      public:
+        recording_replay(rib::Rib& rib, event::subscription& sub,
+            uint64_t window = 1000);
+
+        bool open(const std::string& filename, std::string& error_reason);
+
+        /*! applies all chunks up to tick to the RIB. Returns false after the
+         * last one */
+        bool feed(uint64_t tick) override;
+
+        /// number of chunks applied so far
+        uint64_t num_chunks() const { return chunks_; }
+
+      private:
+        bool load_window();
+        void apply(std::map<uint64_t, bs_dump>& chunk, uint64_t tick);
+        std::shared_ptr<rib::enb_rib_info> add_bs(uint64_t bs_id);
+        void remove_bs(uint64_t bs_id);
+        void apply_bs(rib::enb_rib_info& bs, const bs_dump& d,
+            const bs_dump *prev, uint64_t tick);
+
+        rib::Rib& rib_;
+        event::subscription& event_sub_;
+        const uint64_t window_;
+
+        recording_file_reader reader_;
+        bool from_file_ = false;
+        uint64_t first_tick_ = 0;
+        uint64_t last_tick_ = 0;
+        /* first tick not read from reader_ yet */
+        uint64_t next_read_ = 0;
+        std::map<uint64_t, std::map<uint64_t, bs_dump>> pending_;
+
+        /* BSs created by the replay, with the agent that stands in for them */
+        std::map<uint64_t, int> agents_;
+        int next_agent_id_ = -1;
+        /* BSs that exist already in the RIB (e.g., connected agents) */
+        std::set<uint64_t> ignored_;
+        /* the last chunk applied, to detect changes */
+        std::map<uint64_t, bs_dump> last_;
+        uint64_t chunks_ = 0;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* _RECORDING_REPLAY_H_ */
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    recording_writer.cc
+ *  \brief   streams recorder chunks to disk on a dedicated thread
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "recording_writer.h"
+#include "rt_wrapper.h"
+#include "flexran_log.h"
+
+namespace {
+  /* a full batch is rendered on the executor, so the rendered strings of at
+   * most this many chunks are held in memory at once */
+  const size_t json_batch_size = 256;
+}
+
+flexran::app::log::recording_writer::recording_writer(done_cb done,
+    size_t capacity, int compression_level, core::background_executor *executor)
+  : done_(std::move(done)),
+    compression_level_(compression_level),
+    executor_(executor),
+    queue_(capacity)
+{
+  thread_ = std::thread(&recording_writer::run, this);
+}
+
+flexran::app::log::recording_writer::~recording_writer()
+{
+  stop_ = true;
+  thread_.join();
+}
+
+bool flexran::app::log::recording_writer::begin(const job_info& info,
+    std::shared_ptr<std::atomic<uint64_t>> written)
+{
+  if (queue_.write_available() < 2)
+    return false;
+  queue_.push(new item{item::kind::begin, {}, 0, {},
+      std::unique_ptr<job_info>(new job_info(info)), std::move(written)});
+  return true;
+}
+
+bool flexran::app::log::recording_writer::push(std::map<uint64_t, bs_dump>&& chunk)
+{
+  if (queue_.write_available() < 2) {
+    dropped_++;
+    return false;
+  }
+  queue_.push(new item{item::kind::chunk, std::move(chunk), 0, {}, nullptr, nullptr});
+  return true;
+}
+
+bool flexran::app::log::recording_writer::push(uint64_t tick, delta_chunk&& chunk)
+{
+  if (queue_.write_available() < 2) {
+    dropped_++;
+    return false;
+  }
+  queue_.push(new item{item::kind::chunk, {}, tick, std::move(chunk), nullptr, nullptr});
+  return true;
+}
+
+void flexran::app::log::recording_writer::end()
+{
+  queue_.push(new item{item::kind::end, {}, 0, {}, nullptr, nullptr});
+}
+
+void flexran::app::log::recording_writer::run()
+{
+  /* signals are handled by the main thread only */
+  sigset_t sigmask;
+  sigfillset(&sigmask);
+  pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+
+  core::rt::become_background_thread();
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);
+  pthread_setname_np(pthread_self(), "rec_writer");
+
+  while (true) {
+    item *it;
+    if (!queue_.pop(it)) {
+      /* the writer caught up */
+      flush_json();
+      /* on shutdown, queued chunks are still written */
+      if (stop_)
+        break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    handle(*it);
+    delete it;
+  }
+  if (file_.is_open())
+    LOG4CXX_WARN(flog::app, "recorder: file " << current_.filename
+        << " incomplete, job did not end");
+}
+
+void flexran::app::log::recording_writer::handle(item& it)
+{
+  const bool bin = current_.type == job_type::bin;
+  const bool delta = current_.type == job_type::delta;
+  switch (it.k) {
+    case item::kind::begin:
+      current_ = *it.info;
+      written_ = 0;
+      progress_ = it.written;
+      file_.open(current_.filename, current_.type == job_type::bin
+          || current_.type == job_type::delta
+          ? std::ios::out | std::ios::binary : std::ios::out);
+      file_.clear();
+      if (!file_.is_open()) {
+        LOG4CXX_ERROR(flog::app, "recorder: cannot open file " << current_.filename);
+        return;
+      }
+      if (current_.type == job_type::bin) {
+        /* the number of chunks is known at the end */
+        file_.write(reinterpret_cast<const char *>(&written_), sizeof(uint64_t));
+      } else if (current_.type == job_type::delta) {
+        /* blocks are compressed here, not in the tick thread */
+        rec_file_.reset(new recording_file_writer(file_, 1000, compression_level_));
+        rec_file_->write_header();
+      } else {
+        file_ << "[";
+      }
+      break;
+    case item::kind::chunk:
+      if (!file_.is_open())
+        return;
+      if (bin) {
+        recorder::write_binary_chunk(file_, it.chunk);
+      } else if (delta) {
+        if (!rec_file_->write(it.tick, it.delta))
+          return;
+      } else {
+        /* rendered in batches, see flush_json() */
+        batch_.push_back(std::move(it.chunk));
+        if (batch_.size() >= json_batch_size)
+          flush_json();
+        return;
+      }
+      written_++;
+      if (progress_) *progress_ = written_;
+      break;
+    case item::kind::end:
+      if (!file_.is_open())
+        return;
+      flush_json();
+      if (bin) {
+        file_.seekp(0);
+        file_.write(reinterpret_cast<const char *>(&written_), sizeof(uint64_t));
+      } else if (delta) {
+        rec_file_->finish();
+        rec_file_.reset();
+      } else {
+        file_ << "]";
+      }
+      file_.close();
+      LOG4CXX_INFO(flog::app, "recorder: wrote " << written_ << " chunks to file "
+          << current_.filename);
+      if (done_) done_(current_, written_);
+      break;
+  }
+}
+
+void flexran::app::log::recording_writer::flush_json()
+{
+  if (batch_.empty())
+    return;
+  if (written_ > 0) file_ << ",";
+  /* full batches, i.e., when the writer is behind, are worth the workers */
+  recorder::write_json_chunks(file_, current_.type, batch_,
+      batch_.size() >= json_batch_size ? executor_ : nullptr, progress_.get());
+  written_ += batch_.size();
+  batch_.clear();
+}
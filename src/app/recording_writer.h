@@ -0,0 +1,128 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    recording_writer.h
+ *  \brief   streams recorder chunks to disk on a dedicated thread
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef _RECORDING_WRITER_H_
+#define _RECORDING_WRITER_H_
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include "recorder.h"
+#include "recording_delta.h"
+#include "recording_file.h"
+
+namespace flexran {
+
+  namespace app {
+
+    namespace log {
+
+      /* Writes the chunks of recorder jobs while they are recorded. The tick
+       * thread pushes into a bounded single-producer/single-consumer queue,
+       * a writer thread serializes them to the job's file, so the memory
+       * is bounded by the queue capacity. The files are the same as written
+       * by recorder::write_json() and recorder::write_binary(), or indexed
+       * recording files (see recording_file_writer) for job_type::delta.
+       * When the writer falls behind on a JSON job, the queued chunks are
+       * rendered in parallel on the executor (see
+       * recorder::write_json_chunks()). begin(), push() and end() must be
+       * called from the same thread (the tick thread) and never block. */
+      class recording_writer {
+      public:
+        /// done is called in the writer thread when a job's file is complete,
+        /// with the number of chunks written
+        typedef std::function<void(const job_info& info, uint64_t n)> done_cb;
+
+        /// compression_level (0-9) applies to blocks of recording files
+        recording_writer(done_cb done, size_t capacity = 1024,
+            int compression_level = 0,
+            core::background_executor *executor = nullptr);
+        ~recording_writer();
+        recording_writer(const recording_writer&) = delete;
+        recording_writer& operator=(const recording_writer&) = delete;
+
+        /*! starts a job, false if the queue is full. written, if given, counts
+         * the chunks in the file */
+        bool begin(const job_info& info,
+            std::shared_ptr<std::atomic<uint64_t>> written = nullptr);
+        /// queues a chunk of the current job; false (the chunk is dropped) if
+        /// the queue is full
+        bool push(std::map<uint64_t, bs_dump>&& chunk);
+        /// queues the delta chunk at tick of the current delta job, see push()
+        bool push(uint64_t tick, delta_chunk&& chunk);
+        /// ends the current job; always succeeds after a successful begin()
+        void end();
+
+        /// chunks dropped since the queue was full
+        uint64_t num_dropped() const { return dropped_; }
+
+      private:
+        struct item {
+          enum class kind { begin, chunk, end } k;
+          std::map<uint64_t, bs_dump> chunk;
+          /// only for delta jobs
+          uint64_t tick;
+          delta_chunk delta;
+          /// only for begin
+          std::unique_ptr<job_info> info;
+          std::shared_ptr<std::atomic<uint64_t>> written;
+        };
+
+        void run();
+        void handle(item& it);
+        void flush_json();
+
+        done_cb done_;
+        const int compression_level_;
+        core::background_executor *executor_;
+        /* a slot is always left for end() */
+        boost::lockfree::spsc_queue<item *> queue_;
+        std::atomic<bool> stop_{false};
+        std::atomic<uint64_t> dropped_{0};
+        std::thread thread_;
+
+        /* state of the writer thread */
+        std::ofstream file_;
+        job_info current_{0, 0, "", job_type::all};
+        uint64_t written_ = 0;
+        std::shared_ptr<std::atomic<uint64_t>> progress_;
+        std::unique_ptr<recording_file_writer> rec_file_;
+        /* JSON chunks not rendered yet */
+        std::vector<std::map<uint64_t, bs_dump>> batch_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* _RECORDING_WRITER_H_ */
@@ -43,7 +43,6 @@ void delegate_control(uint64_t bs_id, const flexran::core::requests_manager& req
   protocol::flex_header *delegation_header(new protocol::flex_header);
   delegation_header->set_type(protocol::FLPT_DELEGATE_CONTROL);
   delegation_header->set_version(0);
-  delegation_header->set_xid(0);
   
   protocol::flex_control_delegation *control_delegation_msg(new protocol::flex_control_delegation);
   control_delegation_msg->set_allocated_header(delegation_header);
@@ -63,7 +62,7 @@ void delegate_control(uint64_t bs_id, const flexran::core::requests_manager& req
   // Create and send the flexran message
   d_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   d_message.set_allocated_control_delegation_msg(control_delegation_msg);
-  req_manager_.send_message(bs_id, d_message);
+  req_manager_.send_request(bs_id, d_message);
 }
 
 void flexran::app::scheduler::remote_scheduler_delegation::periodic_task() {
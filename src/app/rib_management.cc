@@ -38,7 +38,7 @@ flexran::app::management::rib_management::rib_management(const flexran::rib::Rib
 void flexran::app::management::rib_management::tick(uint64_t ms)
 {
   _unused(ms);
-  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point now = flexran::rib::clock_now();
   for (uint64_t bs_id: rib_.get_available_base_stations()) {
     send_enb_config_request(bs_id);
     send_ue_config_request(bs_id);
@@ -46,9 +46,11 @@ void flexran::app::management::rib_management::tick(uint64_t ms)
     std::chrono::duration<float> inactive = now - rib_.get_bs(bs_id)->last_active();
     /* inactive for longer than 1.5s */
     if (inactive.count() >= 1.5) {
-      inactive_bs_.insert(bs_id);
+      const bool lost = inactive_bs_.insert(bs_id).second;
       LOG4CXX_WARN(flog::app, "RibManagement: no connection to BS " << bs_id
           << " since " << inactive.count() << "s");
+      if (lost)
+        bs_inactive_(bs_id);
     } else {
       if (inactive_bs_.find(bs_id) != inactive_bs_.end()) {
         inactive_bs_.erase(bs_id);
@@ -65,7 +67,6 @@ void flexran::app::management::rib_management::send_enb_config_request(uint64_t
   protocol::flex_header *header1(new protocol::flex_header);
   header1->set_type(protocol::FLPT_GET_ENB_CONFIG_REQUEST);
   header1->set_version(0);
-  header1->set_xid(0);
 
   protocol::flex_enb_config_request *enb_config_request_msg(new protocol::flex_enb_config_request);
   enb_config_request_msg->set_allocated_header(header1);
@@ -73,7 +74,7 @@ void flexran::app::management::rib_management::send_enb_config_request(uint64_t
   protocol::flexran_message out_message1;
   out_message1.set_msg_dir(protocol::INITIATING_MESSAGE);
   out_message1.set_allocated_enb_config_request_msg(enb_config_request_msg);
-  req_manager_.send_message(bs_id, out_message1);
+  req_manager_.send_request(bs_id, out_message1);
 }
 
 void flexran::app::management::rib_management::send_ue_config_request(uint64_t bs_id)
@@ -82,7 +83,6 @@ void flexran::app::management::rib_management::send_ue_config_request(uint64_t b
   protocol::flex_header *header1(new protocol::flex_header);
   header1->set_type(protocol::FLPT_GET_UE_CONFIG_REQUEST);
   header1->set_version(0);
-  header1->set_xid(0);
 
   protocol::flex_ue_config_request *ue_config_request_msg(new protocol::flex_ue_config_request);
   ue_config_request_msg->set_allocated_header(header1);
@@ -90,7 +90,7 @@ void flexran::app::management::rib_management::send_ue_config_request(uint64_t b
   protocol::flexran_message out_message1;
   out_message1.set_msg_dir(protocol::INITIATING_MESSAGE);
   out_message1.set_allocated_ue_config_request_msg(ue_config_request_msg);
-  req_manager_.send_message(bs_id, out_message1);
+  req_manager_.send_request(bs_id, out_message1);
 }
 
 void flexran::app::management::rib_management::send_lc_config_request(uint64_t bs_id)
@@ -98,7 +98,6 @@ void flexran::app::management::rib_management::send_lc_config_request(uint64_t b
   protocol::flex_header *header1(new protocol::flex_header);
   header1->set_type(protocol::FLPT_GET_LC_CONFIG_REQUEST);
   header1->set_version(0);
-  header1->set_xid(0);
 
   protocol::flex_lc_config_request *lc_config_request_msg(new protocol::flex_lc_config_request);
   lc_config_request_msg->set_allocated_header(header1);
@@ -106,5 +105,5 @@ void flexran::app::management::rib_management::send_lc_config_request(uint64_t b
   protocol::flexran_message out_message1;
   out_message1.set_msg_dir(protocol::INITIATING_MESSAGE);
   out_message1.set_allocated_lc_config_request_msg(lc_config_request_msg);
-  req_manager_.send_message(bs_id, out_message1);
+  req_manager_.send_request(bs_id, out_message1);
 }
@@ -42,7 +42,13 @@ namespace flexran {
             event::subscription& sub);
         void tick(uint64_t ms);
 
+        typedef bs2::signal<void(uint64_t)> bs_inactive_signal;
+        /// cb is called with the BS when its connection is lost (in tick())
+        bs2::connection subscribe_bs_inactive(const bs_inactive_signal::slot_type& cb)
+        { return bs_inactive_.connect(cb); }
+
       private:
+        bs_inactive_signal bs_inactive_;
         std::set<uint64_t> inactive_bs_;
 
         void send_enb_config_request(uint64_t bs_id);
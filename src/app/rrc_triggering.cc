@@ -94,7 +94,14 @@ bool flexran::app::rrc::rrc_triggering::rrc_reconf(const std::string& bs,
     error_reason = "can not find BS";
     return false;
   }
+  batch_results results;
+  return rrc_reconf(std::vector<uint64_t>{bs_id}, config, results, error_reason);
+}
 
+bool flexran::app::rrc::rrc_triggering::rrc_reconf(
+    const std::vector<uint64_t>& bs_ids, const std::string& config,
+    batch_results& results, std::string& error_reason)
+{
   protocol::flex_measurement_info rrc_info;
   auto ret = proto_util::JsonStringToMessage(config, &rrc_info, proto_util::JsonParseOptions());
   if (ret != proto_util::Status::OK) {
@@ -110,13 +117,16 @@ bool flexran::app::rrc::rrc_triggering::rrc_reconf(const std::string& bs,
   //  return false;
   //}
 
+  for (uint64_t bs_id : bs_ids)
+    results.push_back({bs_id, ""});
+
   std::string s;
   proto_util::JsonPrintOptions opt;
   opt.add_whitespace = true;
   proto_util::MessageToJsonString(rrc_info, &s, opt);
   LOG4CXX_INFO(flog::app, "sent new RRC measurement info to BS "
-      << bs_id << ":\n" << s);
-  push_config(bs_id, rrc_info);
+      << format_bs_ids(bs_ids) << ":\n" << s);
+  push_config(bs_ids, rrc_info);
 
   return true;
 }
@@ -179,21 +189,31 @@ bool flexran::app::rrc::rrc_triggering::rrc_x2_ho_net_control(
     return false;
   }
 
-  push_x2_ho_net_control(bs_id, x2_ho_net_control);
-  LOG4CXX_INFO(flog::app, "Sent new X2 Handover policy: "
-      << (x2_ho_net_control ? "network-initiated" : "UE-initiated"));
+  batch_results results;
+  rrc_x2_ho_net_control(std::vector<uint64_t>{bs_id}, x2_ho_net_control, results);
   return true;
 }
 
+void flexran::app::rrc::rrc_triggering::rrc_x2_ho_net_control(
+    const std::vector<uint64_t>& bs_ids, bool x2_ho_net_control,
+    batch_results& results)
+{
+  for (uint64_t bs_id : bs_ids)
+    results.push_back({bs_id, ""});
+  push_x2_ho_net_control(bs_ids, x2_ho_net_control);
+  LOG4CXX_INFO(flog::app, "Sent new X2 Handover policy to BS "
+      << format_bs_ids(bs_ids) << ": "
+      << (x2_ho_net_control ? "network-initiated" : "UE-initiated"));
+}
+
 void flexran::app::rrc::rrc_triggering::push_config(
-    uint64_t bs_id, const protocol::flex_measurement_info& rrc_info)
+    const std::vector<uint64_t>& bs_ids, const protocol::flex_measurement_info& rrc_info)
 {
   protocol::flexran_message config_message;
   // Create control delegation message header
   protocol::flex_header *header(new protocol::flex_header);
   header->set_type(protocol::FLPT_RRC_TRIGGERING);
   header->set_version(0);
-  header->set_xid(0);
   
   protocol::flex_rrc_triggering *rrc_triggering(new protocol::flex_rrc_triggering);
   rrc_triggering->set_allocated_header(header);
@@ -201,7 +221,7 @@ void flexran::app::rrc::rrc_triggering::push_config(
 
   config_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   config_message.set_allocated_rrc_triggering(rrc_triggering);
-  req_manager_.send_message(bs_id, config_message);
+  req_manager_.send_request(bs_ids, config_message);
 }
 
 void flexran::app::rrc::rrc_triggering::push_ho(
@@ -212,7 +232,6 @@ void flexran::app::rrc::rrc_triggering::push_ho(
   protocol::flex_header *header(new protocol::flex_header);
   header->set_type(protocol::FLPT_HO_COMMAND);
   header->set_version(0);
-  header->set_xid(0);
 
   protocol::flex_ho_command *ho_command(new protocol::flex_ho_command);
   ho_command->set_allocated_header(header);
@@ -221,18 +240,17 @@ void flexran::app::rrc::rrc_triggering::push_ho(
 
   message.set_msg_dir(protocol::INITIATING_MESSAGE);
   message.set_allocated_ho_command(ho_command);
-  req_manager_.send_message(s_bs_id, message);
+  req_manager_.send_request(s_bs_id, message);
 }
 
 void flexran::app::rrc::rrc_triggering::push_x2_ho_net_control(
-    uint64_t bs_id, bool x2_ho_net_control)
+    const std::vector<uint64_t>& bs_ids, bool x2_ho_net_control)
 {
   protocol::flexran_message message;
   // Create control delegation message header
   protocol::flex_header *header(new protocol::flex_header);
   header->set_type(protocol::FLPT_GET_ENB_CONFIG_REPLY);
   header->set_version(0);
-  header->set_xid(0);
 
   protocol::flex_enb_config_reply *enb_config(new protocol::flex_enb_config_reply);
   enb_config->add_cell_config();
@@ -240,7 +258,7 @@ void flexran::app::rrc::rrc_triggering::push_x2_ho_net_control(
 
   message.set_msg_dir(protocol::INITIATING_MESSAGE);
   message.set_allocated_enb_config_reply_msg(enb_config);
-  req_manager_.send_message(bs_id, message);
+  req_manager_.send_request(bs_ids, message);
 }
 
 uint64_t flexran::app::rrc::rrc_triggering::parse_bs_agent_id(const std::string& s) const
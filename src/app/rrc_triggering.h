@@ -52,6 +52,13 @@ namespace flexran {
         bool rrc_x2_ho_net_control(const std::string& bs, bool x2_ho_net_control,
             std::string& error_reason);
 
+        /* batch versions: the policy is parsed once and sent with one
+         * message to all BSs. Return false if the policy is invalid */
+        bool rrc_reconf(const std::vector<uint64_t>& bs_ids, const std::string& policy,
+            batch_results& results, std::string& error_reason);
+        void rrc_x2_ho_net_control(const std::vector<uint64_t>& bs_ids,
+            bool x2_ho_net_control, batch_results& results);
+
         void bs_added(uint64_t bs_id);
         void bs_removed(uint64_t bs_id);
 
@@ -60,9 +67,11 @@ namespace flexran {
         uint64_t parse_bs_id(const std::string& s) const;
         uint64_t parse_physical_cell_id(const std::string& s) const;
 
-        void push_config(uint64_t bs_id, const protocol::flex_measurement_info& rrc_info);
+        void push_config(const std::vector<uint64_t>& bs_ids,
+            const protocol::flex_measurement_info& rrc_info);
         void push_ho(uint64_t bs_id, flexran::rib::rnti_t rnti, uint32_t target_phy_cell_id);
-        void push_x2_ho_net_control(uint64_t bs_id, bool x2_ho_net_control);
+        void push_x2_ho_net_control(const std::vector<uint64_t>& bs_ids,
+            bool x2_ho_net_control);
 
         std::unordered_set<uint64_t> set_check_phyCellId;
         std::map<uint64_t, int> map_phyCellId;
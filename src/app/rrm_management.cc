@@ -36,7 +36,8 @@
 
 flexran::app::management::rrm_management::rrm_management(rib::Rib& rib,
     const core::requests_manager& rm, event::subscription& sub)
-  : component(rib, rm, sub)
+  : component(rib, rm, sub),
+    mutable_rib_(rib)
 {
 }
 
@@ -91,7 +92,6 @@ void flexran::app::management::rrm_management::reconfigure_agent_string(
   protocol::flex_header *config_header(new protocol::flex_header);
   config_header->set_type(protocol::FLPT_RECONFIGURE_AGENT);
   config_header->set_version(0);
-  config_header->set_xid(0);
 
   protocol::flex_agent_reconfiguration *agent_reconfiguration_msg(new protocol::flex_agent_reconfiguration);
   agent_reconfiguration_msg->set_allocated_header(config_header);
@@ -100,7 +100,7 @@ void flexran::app::management::rrm_management::reconfigure_agent_string(
 
   config_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   config_message.set_allocated_agent_reconfiguration_msg(agent_reconfiguration_msg);
-  req_manager_.send_message(bs_id, config_message);
+  req_manager_.send_request(bs_id, config_message);
 }
 
 void flexran::app::management::rrm_management::apply_slice_config_policy(
@@ -110,6 +110,16 @@ void flexran::app::management::rrm_management::apply_slice_config_policy(
   if (bs_id == 0)
     throw std::invalid_argument("BS " + bs_ + " does not exist");
 
+  batch_results results;
+  apply_slice_config_policy({bs_id}, policy, results);
+  if (!results[0].error.empty())
+    throw std::invalid_argument(results[0].error);
+}
+
+void flexran::app::management::rrm_management::apply_slice_config_policy(
+    const std::vector<uint64_t>& bs_ids, const std::string& policy,
+    batch_results& results)
+{
   protocol::flex_slice_config slice_config;
   auto ret = google::protobuf::util::JsonStringToMessage(policy, &slice_config,
       google::protobuf::util::JsonParseOptions());
@@ -118,6 +128,49 @@ void flexran::app::management::rrm_management::apply_slice_config_policy(
     throw std::invalid_argument("Protobuf parser error");
   }
 
+  /* the completed configuration only differs in the algorithms taken over
+   * from a BS, so all BSs with the same algorithms get the same message */
+  std::map<std::pair<int, int>, std::vector<uint64_t>> same_algorithms;
+  std::vector<uint64_t> algo_changed;
+  for (uint64_t bs_id : bs_ids) {
+    results.push_back({bs_id, ""});
+    protocol::flex_slice_config completed(slice_config);
+    bool algo_change = false;
+    try {
+      if (!complete_slice_config(bs_id, completed, algo_change))
+        continue;
+    } catch (const std::invalid_argument& e) {
+      results.back().error = e.what();
+      continue;
+    }
+    same_algorithms[std::make_pair(completed.dl().algorithm(), completed.ul().algorithm())]
+        .push_back(bs_id);
+    if (algo_change)
+      algo_changed.push_back(bs_id);
+  }
+
+  google::protobuf::util::JsonPrintOptions opt;
+  opt.add_whitespace = true;
+  for (const auto& a : same_algorithms) {
+    protocol::flex_cell_config cell_config;
+    protocol::flex_slice_config *c = cell_config.mutable_slice_config();
+    c->CopyFrom(slice_config);
+    c->mutable_dl()->set_algorithm(static_cast<protocol::flex_slice_algorithm>(a.first.first));
+    c->mutable_ul()->set_algorithm(static_cast<protocol::flex_slice_algorithm>(a.first.second));
+    push_cell_config_reconfiguration(a.second, cell_config);
+    std::string pol_corrected;
+    google::protobuf::util::MessageToJsonString(*c, &pol_corrected, opt);
+    LOG4CXX_INFO(flog::app, "sent new configuration to BS " << format_bs_ids(a.second)
+        << ":\n" << pol_corrected);
+  }
+
+  for (uint64_t bs_id : algo_changed)
+    preserve_ue_slice_association(bs_id, slice_config);
+}
+
+bool flexran::app::management::rrm_management::complete_slice_config(
+    uint64_t bs_id, protocol::flex_slice_config& slice_config, bool& algo_change)
+{
   const auto bs = rib_.get_bs(bs_id);
   const auto& current = bs->get_enb_config().cell_config(0).slice_config();
 
@@ -145,38 +198,36 @@ void flexran::app::management::rrm_management::apply_slice_config_policy(
       && ul->algorithm() == current.ul().algorithm()
       && dl->slices_size() == 0 && ul->slices_size() == 0
       && !dl->has_scheduler() && !ul->has_scheduler())
-    return;
+    return false;
 
   if ((dl->algorithm() == protocol::flex_slice_algorithm::None && dl->slices_size() > 0)
       || (ul->algorithm() == protocol::flex_slice_algorithm::None && ul->slices_size() > 0))
     throw std::invalid_argument("no slice algorithm, but slices present");
 
-  bool algo_change = current.dl().algorithm() != dl->algorithm()
-                     || current.ul().algorithm() != ul->algorithm();
-
-  protocol::flex_cell_config cell_config;
-  cell_config.mutable_slice_config()->CopyFrom(slice_config);
-  push_cell_config_reconfiguration(bs_id, cell_config);
-  std::string pol_corrected;
-  google::protobuf::util::JsonPrintOptions opt;
-  opt.add_whitespace = true;
-  google::protobuf::util::MessageToJsonString(slice_config, &pol_corrected, opt);
-  LOG4CXX_INFO(flog::app, "sent new configuration to BS " << bs_id
-      << ":\n" << pol_corrected);
+  algo_change = current.dl().algorithm() != dl->algorithm()
+                || current.ul().algorithm() != ul->algorithm();
+  return true;
+}
 
-  if (!algo_change || bs->get_ue_configs().ue_config_size() == 0)
+void flexran::app::management::rrm_management::preserve_ue_slice_association(
+    uint64_t bs_id, const protocol::flex_slice_config& slice_config)
+{
+  const auto bs = rib_.get_bs(bs_id);
+  if (bs->get_ue_configs().ue_config_size() == 0)
     return;
   LOG4CXX_INFO(flog::app, "ue_config_size() " << bs->get_ue_configs().ue_config_size());
   /* if there is an algorithm change, try to preserve the UE-slice association:
    * Go through all UEs and check whether the slice exists, then associate */
+  const auto& dl_slices = slice_config.dl().slices();
+  const auto& ul_slices = slice_config.ul().slices();
   protocol::flex_ue_config_reply ue_config_reply;
   for (const auto& ue : bs->get_ue_configs().ue_config()) {
     uint32_t did = ue.has_dl_slice_id() ? ue.dl_slice_id() : 0;
     uint32_t uid = ue.has_ul_slice_id() ? ue.ul_slice_id() : 0;
-    if (!std::any_of(dl->slices().begin(), dl->slices().end(),
+    if (!std::any_of(dl_slices.begin(), dl_slices.end(),
           [did] (const protocol::flex_slice& s) { return s.id() == did; }))
       did = 0;
-    if (!std::any_of(ul->slices().begin(), ul->slices().end(),
+    if (!std::any_of(ul_slices.begin(), ul_slices.end(),
           [uid] (const protocol::flex_slice& s) { return s.id() == uid; }))
       uid = 0;
     if (did != 0 || uid != 0) { // only send if it makes sense
@@ -188,6 +239,8 @@ void flexran::app::management::rrm_management::apply_slice_config_policy(
   }
   push_ue_config_reconfiguration(bs_id, ue_config_reply);
   std::string ue_policy;
+  google::protobuf::util::JsonPrintOptions opt;
+  opt.add_whitespace = true;
   google::protobuf::util::MessageToJsonString(ue_config_reply, &ue_policy, opt);
   LOG4CXX_INFO(flog::app, "sent new UE configuration to BS "
       << bs_id << ":\n" << ue_policy);
@@ -200,6 +253,14 @@ void flexran::app::management::rrm_management::remove_slice(
   if (bs_id == 0)
     throw std::invalid_argument("BS " + bs + " does not exist");
 
+  batch_results results;
+  remove_slice({bs_id}, policy, results);
+}
+
+void flexran::app::management::rrm_management::remove_slice(
+    const std::vector<uint64_t>& bs_ids, const std::string& policy,
+    batch_results& results)
+{
   protocol::flex_slice_config slice_config;
   google::protobuf::util::Status ret;
   ret = google::protobuf::util::JsonStringToMessage(policy, &slice_config,
@@ -220,15 +281,18 @@ void flexran::app::management::rrm_management::remove_slice(
   for (auto& s: *slice_config.mutable_ul()->mutable_slices())
     s.clear_static_();
 
+  for (uint64_t bs_id : bs_ids)
+    results.push_back({bs_id, ""});
+
   protocol::flex_cell_config cell_config;
   cell_config.mutable_slice_config()->CopyFrom(slice_config);
-  push_cell_config_reconfiguration(bs_id, cell_config);
+  push_cell_config_reconfiguration(bs_ids, cell_config);
 
   std::string pol_corrected;
   google::protobuf::util::JsonPrintOptions opt;
   opt.add_whitespace = true;
   google::protobuf::util::MessageToJsonString(slice_config, &pol_corrected, opt);
-  LOG4CXX_INFO(flog::app, "sent remove slice command to BS " << bs_id
+  LOG4CXX_INFO(flog::app, "sent remove slice command to BS " << format_bs_ids(bs_ids)
       << ":\n" << pol_corrected << "\n");
 }
 
@@ -300,6 +364,14 @@ bool flexran::app::management::rrm_management::apply_cell_config_policy(
     return false;
   }
 
+  batch_results results;
+  return apply_cell_config_policy({bs_id}, policy, results, error_reason);
+}
+
+bool flexran::app::management::rrm_management::apply_cell_config_policy(
+    const std::vector<uint64_t>& bs_ids, const std::string& policy,
+    batch_results& results, std::string& error_reason)
+{
   protocol::flex_cell_config cell_config;
   google::protobuf::util::Status ret;
   ret = google::protobuf::util::JsonStringToMessage(policy, &cell_config,
@@ -316,20 +388,45 @@ bool flexran::app::management::rrm_management::apply_cell_config_policy(
     return false;
   }
 
-  push_cell_config_reconfiguration(bs_id, cell_config);
-  LOG4CXX_INFO(flog::app, "sent new cell configuration to BS " << bs_id
+  for (uint64_t bs_id : bs_ids)
+    results.push_back({bs_id, ""});
+
+  push_cell_config_reconfiguration(bs_ids, cell_config);
+  LOG4CXX_INFO(flog::app, "sent new cell configuration to BS " << format_bs_ids(bs_ids)
       << ":\n" << policy << "\n");
 
   return true;
 }
 
+bool flexran::app::management::rrm_management::label_bs(const std::string& bs,
+    const std::string& label, bool add, std::string& error_reason)
+{
+  const uint64_t bs_id = rib_.parse_enb_agent_id(bs);
+  if (bs_id == 0) {
+    error_reason = "BS " + bs + " does not exist";
+    return false;
+  }
+  if (label.empty() || label.find_first_of(",=") != std::string::npos) {
+    error_reason = "invalid label " + label;
+    return false;
+  }
+  if (add) {
+    mutable_rib_.add_bs_label(bs_id, label);
+  } else if (!mutable_rib_.remove_bs_label(bs_id, label)) {
+    error_reason = "BS " + std::to_string(bs_id) + " has no label " + label;
+    return false;
+  }
+  LOG4CXX_INFO(flog::app, (add ? "added" : "removed") << " label " << label
+      << " of BS " << bs_id);
+  return true;
+}
+
 void flexran::app::management::rrm_management::push_cell_config_reconfiguration(
-    uint64_t bs_id, const protocol::flex_cell_config& cell_config)
+    const std::vector<uint64_t>& bs_ids, const protocol::flex_cell_config& cell_config)
 {
   protocol::flex_header *config_header(new protocol::flex_header);
   config_header->set_type(protocol::FLPT_RECONFIGURE_AGENT);
   config_header->set_version(0);
-  config_header->set_xid(0);
 
   protocol::flex_enb_config_reply *enb_config_msg(new protocol::flex_enb_config_reply);
   enb_config_msg->add_cell_config();
@@ -339,7 +436,7 @@ void flexran::app::management::rrm_management::push_cell_config_reconfiguration(
   protocol::flexran_message config_message;
   config_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   config_message.set_allocated_enb_config_reply_msg(enb_config_msg);
-  req_manager_.send_message(bs_id, config_message);
+  req_manager_.send_request(bs_ids, config_message);
 }
 
 void flexran::app::management::rrm_management::push_ue_config_reconfiguration(
@@ -348,7 +445,6 @@ void flexran::app::management::rrm_management::push_ue_config_reconfiguration(
   protocol::flex_header *config_header(new protocol::flex_header);
   config_header->set_type(protocol::FLPT_RECONFIGURE_AGENT);
   config_header->set_version(0);
-  config_header->set_xid(0);
 
   protocol::flex_ue_config_reply *ue_config_msg(new protocol::flex_ue_config_reply);
   ue_config_msg->CopyFrom(ue_config);
@@ -357,7 +453,7 @@ void flexran::app::management::rrm_management::push_ue_config_reconfiguration(
   protocol::flexran_message config_message;
   config_message.set_msg_dir(protocol::INITIATING_MESSAGE);
   config_message.set_allocated_ue_config_reply_msg(ue_config_msg);
-  req_manager_.send_message(bs_id, config_message);
+  req_manager_.send_request(bs_id, config_message);
 }
 
 bool flexran::app::management::rrm_management::verify_ue_slice_assoc_msg(
@@ -49,6 +49,21 @@ namespace flexran {
         bool apply_cell_config_policy(uint64_t bs_id, const std::string& policy,
             std::string& error_reason);
 
+        /* Batch versions of the above: the policy is parsed and validated
+         * once, BS-specific checks are reported per BS in results, and BSs
+         * receiving the same configuration get the same message */
+        void apply_slice_config_policy(const std::vector<uint64_t>& bs_ids,
+            const std::string& policy, batch_results& results);
+        void remove_slice(const std::vector<uint64_t>& bs_ids,
+            const std::string& policy, batch_results& results);
+        bool apply_cell_config_policy(const std::vector<uint64_t>& bs_ids,
+            const std::string& policy, batch_results& results,
+            std::string& error_reason);
+
+        /// adds (add) or removes a label of a BS for batch operations
+        bool label_bs(const std::string& bs, const std::string& label, bool add,
+            std::string& error_reason);
+
         uint64_t parse_enb_agent_id(const std::string& enb_agent_id_s) const;
         uint64_t get_last_bs() const;
         bool parse_rnti_imsi(uint64_t bs_id, const std::string& rnti_imsi_s,
@@ -61,10 +76,17 @@ namespace flexran {
 
       private:
 
-        void push_cell_config_reconfiguration(uint64_t bs_id,
+        void push_cell_config_reconfiguration(const std::vector<uint64_t>& bs_ids,
             const protocol::flex_cell_config& cell_config);
         void push_ue_config_reconfiguration(uint64_t bs_id,
             const protocol::flex_ue_config_reply& ue_config);
+        /* fills in the slice algorithms of BS bs_id not given in
+         * slice_config and verifies it. Returns false if there is nothing to
+         * change, throws std::invalid_argument if it is invalid */
+        bool complete_slice_config(uint64_t bs_id,
+            protocol::flex_slice_config& slice_config, bool& algo_change);
+        void preserve_ue_slice_association(uint64_t bs_id,
+            const protocol::flex_slice_config& slice_config);
         static bool verify_ue_slice_assoc_msg(const protocol::flex_ue_config& c,
             std::string& error_message);
         bool verify_rnti_imsi(uint64_t bs_id, protocol::flex_ue_config *c,
@@ -82,6 +104,8 @@ namespace flexran {
 
         /// association IMSI -> slice_id
         std::map<uint64_t, uint32_t> ue_slice_;
+        /// the RIB for BS labels, component only has read access
+        rib::Rib& mutable_rib_;
       };
     }
   }
@@ -24,6 +24,7 @@
  */
 
 #include <iostream>
+#include <cstdio>
 
 #include "stats_manager.h"
 #include "flexran.pb.h"
@@ -68,23 +69,24 @@ protocol::flex_complete_stats_request_repeated flexran::app::stats::stats_manage
 
 void flexran::app::stats::stats_manager::bs_add(uint64_t bs_id)
 {
-  const uint32_t xid = 0;
   protocol::flex_complete_stats_request_repeated reqs = default_stats_request();
-  for (const auto& r : reqs.reports())
-    push_complete_stats_request(bs_id, xid, r);
-  LOG4CXX_INFO(flog::app, "Sent periodical stats request to BS " << bs_id
-      << " (xid " << xid << ")");
+  std::vector<uint32_t>& xids = bs_xids_[bs_id];
+  xids.clear();
+  for (const auto& r : reqs.reports()) {
+    xids.push_back(push_complete_stats_request(bs_id, r));
+    LOG4CXX_INFO(flog::app, "Sent periodical stats request to BS " << bs_id
+        << " (xid " << xids.back() << ")");
+  }
   bs_list_.insert({bs_id, reqs});
 }
 
-void flexran::app::stats::stats_manager::push_complete_stats_request(
-    uint64_t bs_id, uint32_t xid, const protocol::flex_complete_stats_request& req)
+uint32_t flexran::app::stats::stats_manager::push_complete_stats_request(
+    uint64_t bs_id, const protocol::flex_complete_stats_request& req)
 {
+  /* the xid is set when sending: it identifies the request at the agent */
   protocol::flex_header *header(new protocol::flex_header);
   header->set_type(protocol::FLPT_STATS_REQUEST);
   header->set_version(0);
-  // We need to store the xid for keeping context info
-  header->set_xid(xid);
 
   protocol::flex_complete_stats_request *complete_stats_request(new protocol::flex_complete_stats_request);
   complete_stats_request->set_report_frequency(req.report_frequency());
@@ -105,7 +107,7 @@ void flexran::app::stats::stats_manager::push_complete_stats_request(
   protocol::flexran_message msg;
   msg.set_msg_dir(protocol::INITIATING_MESSAGE);
   msg.set_allocated_stats_request_msg(stats_request_msg);
-  req_manager_.send_message(bs_id, msg);
+  return req_manager_.send_request(bs_id, msg);
 }
 
 void flexran::app::stats::stats_manager::remove_complete_stats_request(
@@ -137,6 +139,53 @@ void flexran::app::stats::stats_manager::bs_remove(uint64_t bs_id)
   if (it == bs_list_.end()) return; /* not found */
 
   bs_list_.erase(it);
+  bs_xids_.erase(bs_id);
+}
+
+std::shared_ptr<flexran::rib::Rib> flexran::app::stats::stats_manager::prepare_snapshot() const
+{
+  return rib_.prepare_snapshot(std::atomic_load(&snapshot_));
+}
+
+void flexran::app::stats::stats_manager::publish_snapshot(std::shared_ptr<rib::Rib> snapshot)
+{
+  const auto t = std::chrono::steady_clock::now();
+  snapshot->complete_snapshot();
+  std::atomic_store(&snapshot_, std::shared_ptr<const rib::Rib>(std::move(snapshot)));
+  snapshot_time_ = t.time_since_epoch().count();
+}
+
+bool flexran::app::stats::stats_manager::snapshot_outdated(std::chrono::milliseconds max_age) const
+{
+  const std::chrono::steady_clock::time_point t(
+      std::chrono::steady_clock::duration(snapshot_time_.load()));
+  return !std::atomic_load(&snapshot_) || std::chrono::steady_clock::now() - t > max_age;
+}
+
+void flexran::app::stats::stats_manager::refresh_snapshot(
+    std::chrono::milliseconds max_age,
+    const std::function<std::shared_ptr<rib::Rib>()>& prepare)
+{
+  if (!snapshot_outdated(max_age))
+    return;
+  std::lock_guard<std::mutex> lg(refresh_mutex_);
+  /* another thread might have refreshed it in the meantime */
+  if (!snapshot_outdated(max_age))
+    return;
+  publish_snapshot(prepare());
+}
+
+std::shared_ptr<const flexran::rib::Rib> flexran::app::stats::stats_manager::current_snapshot() const
+{
+  return std::atomic_load(&snapshot_);
+}
+
+std::shared_ptr<const flexran::rib::Rib> flexran::app::stats::stats_manager::view() const
+{
+  std::shared_ptr<const rib::Rib> s = std::atomic_load(&snapshot_);
+  if (s) return s;
+  /* no snapshot yet: non-owning pointer to the live RIB */
+  return std::shared_ptr<const rib::Rib>(std::shared_ptr<const rib::Rib>(), &rib_);
 }
 
 std::string flexran::app::stats::stats_manager::all_stats_to_string() const
@@ -144,104 +193,234 @@ std::string flexran::app::stats::stats_manager::all_stats_to_string() const
   return all_enb_configs_to_string() + "\n\n\n" + all_mac_configs_to_string() + "\n";
 }
 
-std::string flexran::app::stats::stats_manager::all_stats_to_json_string() const
+bool flexran::app::stats::stats_manager::write_json_stats(const std::string& type,
+    uint64_t bs_id, const rib::json_writer& out, const rib::stats_filter& filter) const
 {
-  return flexran::rib::Rib::format_statistics_to_json(
-      std::chrono::system_clock::now(),
-      rib_.dump_all_enb_configurations_to_json_string(),
-      rib_.dump_all_mac_stats_to_json_string()
-  );
+  const auto rib = view();
+  if (bs_id != 0 && !rib->get_bs(bs_id))
+    return false;
+  const bool config = type != "mac_stats";
+  const bool stats = type != "enb_config";
+
+  /* same output as Rib::format_statistics_to_json() */
+  out("{\"date_time\":\"" + flexran::rib::Rib::format_date_time(
+        std::chrono::system_clock::now()) + "\",");
+  if (config) {
+    out("\"eNB_config\":");
+    rib->dump_enb_configurations_to_json(out, filter, bs_id);
+  }
+  if (config && stats)
+    out(",");
+  if (stats) {
+    out("\"mac_stats\":");
+    rib->dump_mac_stats_to_json(out, filter, bs_id);
+  }
+  if (filter.paged()) {
+    const std::string cursor = rib->next_cursor(filter, bs_id);
+    if (!cursor.empty())
+      out(",\"next_cursor\":\"" + cursor + "\"");
+  }
+  out("}");
+  return true;
 }
 
-bool flexran::app::stats::stats_manager::stats_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const
+bool flexran::app::stats::stats_manager::write_protobuf_stats(const std::string& type,
+    uint64_t bs_id, const rib::json_writer& out, const rib::stats_filter& filter,
+    std::string& next_cursor) const
 {
-  std::string json1, json2;
-  out = "{}";
-  bool found = rib_.dump_enb_configurations_by_bs_id_to_json_string(bs_id, json1);
-  if (!found) return false;
-  found = rib_.dump_mac_stats_by_bs_id_to_json_string(bs_id, json2);
-  if (!found) return false;
-  out = flexran::rib::Rib::format_statistics_to_json(
-      std::chrono::system_clock::now(), json1, json2
-  );
+  const auto rib = view();
+  if (bs_id != 0 && !rib->get_bs(bs_id))
+    return false;
+  rib->dump_to_protobuf(out, type != "mac_stats", type != "enb_config", filter, bs_id);
+  next_cursor = filter.paged() ? rib->next_cursor(filter, bs_id) : "";
+  return true;
+}
+
+bool flexran::app::stats::stats_manager::ue_stats_by_rnti_by_bs_id_to_protobuf(
+    flexran::rib::rnti_t rnti, std::string& out, uint64_t bs_id,
+    const rib::stats_filter& filter) const
+{
+  const auto bs = view()->get_bs(bs_id);
+  const auto ue = bs ? bs->get_ue_mac_info(rnti) : nullptr;
+  if (!ue)
+    return false;
+  out = ue->dump_stats_to_protobuf(filter);
   return true;
 }
 
+bool flexran::app::stats::stats_manager::json_stats_to_string(const std::string& type,
+    uint64_t bs_id, std::string& out, const rib::stats_filter& filter) const
+{
+  out.clear();
+  if (write_json_stats(type, bs_id, [&out] (const std::string& s) { out += s; }, filter))
+    return true;
+  out = "{}";
+  return false;
+}
+
+std::string flexran::app::stats::stats_manager::all_stats_to_json_string(
+    const rib::stats_filter& filter) const
+{
+  std::string out;
+  json_stats_to_string("all", 0, out, filter);
+  return out;
+}
+
+bool flexran::app::stats::stats_manager::stats_by_bs_id_to_json_string(uint64_t bs_id,
+    std::string& out, const rib::stats_filter& filter) const
+{
+  return json_stats_to_string("all", bs_id, out, filter);
+}
+
 std::string flexran::app::stats::stats_manager::all_enb_configs_to_string() const
 {
+  const auto rib = view();
   std::string str;
   str += "**************************\n";
   str += "* BS/Cell Configurations *\n";
   str += "**************************\n";
-  str += rib_.dump_all_enb_configurations_to_string();
+  str += rib->dump_all_enb_configurations_to_string();
 
   return str;
 }
 
-std::string flexran::app::stats::stats_manager::all_enb_configs_to_json_string() const
+std::string flexran::app::stats::stats_manager::all_enb_configs_to_json_string(
+    const rib::stats_filter& filter) const
 {
-  return flexran::rib::Rib::format_statistics_to_json(
-      std::chrono::system_clock::now(),
-      rib_.dump_all_enb_configurations_to_json_string(), ""
-  );
+  std::string out;
+  json_stats_to_string("enb_config", 0, out, filter);
+  return out;
 }
 
-bool flexran::app::stats::stats_manager::enb_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const
+bool flexran::app::stats::stats_manager::enb_configs_by_bs_id_to_json_string(uint64_t bs_id,
+    std::string& out, const rib::stats_filter& filter) const
 {
-  std::string json;
-  bool found = rib_.dump_enb_configurations_by_bs_id_to_json_string(bs_id, json);
-  out = flexran::rib::Rib::format_statistics_to_json(
-      std::chrono::system_clock::now(), json, "");
-  return found;
+  return json_stats_to_string("enb_config", bs_id, out, filter);
 }
 
 std::string flexran::app::stats::stats_manager::all_mac_configs_to_string() const
 {
+  const auto rib = view();
   std::string str;
   str += "***************\n";
   str += "UE statistics\n";
   str += "****************\n";
-  str += rib_.dump_all_mac_stats_to_string();
+  str += rib->dump_all_mac_stats_to_string();
 
   return str;
 }
 
-std::string flexran::app::stats::stats_manager::all_mac_configs_to_json_string() const
+std::string flexran::app::stats::stats_manager::all_mac_configs_to_json_string(
+    const rib::stats_filter& filter) const
+{
+  std::string out;
+  json_stats_to_string("mac_stats", 0, out, filter);
+  return out;
+}
+
+bool flexran::app::stats::stats_manager::mac_configs_by_bs_id_to_json_string(uint64_t bs_id,
+    std::string& out, const rib::stats_filter& filter) const
 {
-  return flexran::rib::Rib::format_statistics_to_json(std::chrono::system_clock::now(),
-      "", rib_.dump_all_mac_stats_to_json_string()
-  );
+  return json_stats_to_string("mac_stats", bs_id, out, filter);
 }
 
-bool flexran::app::stats::stats_manager::mac_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const
+size_t flexran::app::stats::stats_manager::num_ues(uint64_t bs_id) const
 {
-  std::string json;
-  bool found = rib_.dump_mac_stats_by_bs_id_to_json_string(bs_id, json);
-  out = flexran::rib::Rib::format_statistics_to_json(std::chrono::system_clock::now(), "", json);
-  return found;
+  const auto rib = view();
+  size_t n = 0;
+  for (uint64_t id : rib->get_available_base_stations())
+    if (bs_id == 0 || id == bs_id)
+      n += rib->get_bs(id)->get_rntis().size();
+  return n;
 }
 
-bool flexran::app::stats::stats_manager::ue_stats_by_rnti_by_bs_id_to_json_string(flexran::rib::rnti_t rnti, std::string& out, uint64_t bs_id) const
+bool flexran::app::stats::stats_manager::ue_stats_by_rnti_by_bs_id_to_json_string(flexran::rib::rnti_t rnti, std::string& out, uint64_t bs_id,
+    const rib::stats_filter& filter) const
 {
-  return rib_.dump_ue_by_rnti_by_bs_id_to_json_string(rnti, out, bs_id);
+  return view()->dump_ue_by_rnti_by_bs_id_to_json_string(rnti, out, bs_id, filter);
+}
+
+namespace {
+  /* FNV-1a over 64bit words */
+  uint64_t etag_hash(uint64_t h, uint64_t v)
+  {
+    for (int i = 0; i < 8; ++i) {
+      h ^= (v >> (i * 8)) & 0xff;
+      h *= 0x100000001b3;
+    }
+    return h;
+  }
+
+  std::string format_etag(uint64_t h)
+  {
+    char buf[20];
+    snprintf(buf, sizeof(buf), "\"%016lx\"", static_cast<unsigned long>(h));
+    return buf;
+  }
+}
+
+std::string flexran::app::stats::stats_manager::stats_etag(
+    const std::string& type, uint64_t bs_id) const
+{
+  const auto rib = view();
+  const bool config = type != "mac_stats";
+  const bool stats = type != "enb_config";
+  uint64_t h = 0xcbf29ce484222325;
+  h = etag_hash(h, (config ? 1 : 0) | (stats ? 2 : 0));
+  const std::set<uint64_t> bss = bs_id == 0 ? rib->get_available_base_stations()
+                                            : std::set<uint64_t>{bs_id};
+  for (uint64_t id : bss) {
+    const auto bs = rib->get_bs(id);
+    if (!bs) continue;
+    h = etag_hash(h, id);
+    /* the UEs in the MAC stats depend on the UE configuration */
+    h = etag_hash(h, bs->get_config_version());
+    if (!stats)
+      continue;
+    h = etag_hash(h, bs->get_stats_version());
+    /* the HARQ states of the UEs are updated by subframe information */
+    for (flexran::rib::rnti_t rnti : bs->get_rntis()) {
+      const auto ue = bs->get_ue_mac_info(rnti);
+      if (ue)
+        h = etag_hash(h, ue->get_sf_version());
+    }
+  }
+  return format_etag(h);
+}
+
+std::string flexran::app::stats::stats_manager::ue_stats_etag(
+    flexran::rib::rnti_t rnti, uint64_t bs_id) const
+{
+  const auto rib = view();
+  uint64_t h = 0xcbf29ce484222325;
+  h = etag_hash(h, bs_id);
+  h = etag_hash(h, rnti);
+  const auto bs = rib->get_bs(bs_id);
+  const auto ue = bs ? bs->get_ue_mac_info(rnti) : nullptr;
+  if (ue) {
+    h = etag_hash(h, ue->get_stats_version());
+    h = etag_hash(h, ue->get_sf_version());
+  }
+  return format_etag(h);
 }
 
 uint64_t flexran::app::stats::stats_manager::parse_bs_agent_id(const std::string& bs_agent_id_s) const
 {
-  return rib_.parse_enb_agent_id(bs_agent_id_s);
+  return view()->parse_enb_agent_id(bs_agent_id_s);
 }
 
 bool flexran::app::stats::stats_manager::parse_rnti_imsi(uint64_t bs_id, const std::string& rnti_imsi_s,
     flexran::rib::rnti_t& rnti) const
 {
-  return rib_.get_bs(bs_id)->parse_rnti_imsi(rnti_imsi_s, rnti);
+  return view()->get_bs(bs_id)->parse_rnti_imsi(rnti_imsi_s, rnti);
 }
 
 bool flexran::app::stats::stats_manager::parse_rnti_imsi_find_bs(const std::string& rnti_imsi_s,
     flexran::rib::rnti_t& rnti, uint64_t& bs_id) const
 {
-  for (uint64_t xbs_id: rib_.get_available_base_stations()) {
-    if (rib_.get_bs(xbs_id)->parse_rnti_imsi(rnti_imsi_s, rnti)) {
+  const auto rib = view();
+  for (uint64_t xbs_id: rib->get_available_base_stations()) {
+    if (rib->get_bs(xbs_id)->parse_rnti_imsi(rnti_imsi_s, rnti)) {
       bs_id = xbs_id;
       return true;
     }
@@ -287,7 +466,7 @@ bool flexran::app::stats::stats_manager::set_stats_requests(
   /* remove all old requests */
   auto it = bs_list_.find(bs_id);
   if (it != bs_list_.end()) {
-    for (int xid = 0; xid < it->second.reports().size(); ++xid) {
+    for (uint32_t xid : bs_xids_[bs_id]) {
       remove_complete_stats_request(bs_id, xid);
       LOG4CXX_INFO(flog::app, "Remove stats request (xid " << xid << ") of BS " << bs_id);
     }
@@ -297,13 +476,13 @@ bool flexran::app::stats::stats_manager::set_stats_requests(
   }
 
   /* send new requests and store */
-  uint32_t xid = 0;
+  std::vector<uint32_t>& xids = bs_xids_[bs_id];
+  xids.clear();
   for (const auto& r : proto.reports()) {
-    push_complete_stats_request(bs_id, xid, r);
+    xids.push_back(push_complete_stats_request(bs_id, r));
     LOG4CXX_INFO(flog::app, "Sent periodical stats request to BS " << bs_id
-        << " (xid " << xid << ")");
+        << " (xid " << xids.back() << ")");
     it->second.mutable_reports()->Add()->CopyFrom(r);
-    xid++;
   }
   return true;
 }
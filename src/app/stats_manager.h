@@ -26,10 +26,16 @@
 #ifndef STATS_MANAGER_H_
 #define STATS_MANAGER_H_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <set>
 
 #include "component.h"
 #include "rib_common.h"
+#include "stats_filter.h"
 #include "subscription.h"
 
 namespace protocol {
@@ -52,20 +58,69 @@ namespace flexran {
       void bs_add(uint64_t bs_id);
       void bs_remove(uint64_t bs_id);
 
+      /// All of the following read from a snapshot of the RIB, so they can
+      /// be called from any thread. To refresh it, call prepare_snapshot()
+      /// in the task manager thread and hand the result to
+      /// publish_snapshot() in any other thread, which does the copying
+      std::shared_ptr<rib::Rib> prepare_snapshot() const;
+      void publish_snapshot(std::shared_ptr<rib::Rib> snapshot);
+      /// true if there is no snapshot or it is older than max_age
+      bool snapshot_outdated(std::chrono::milliseconds max_age) const;
+      /// publishes the snapshot returned by prepare (which has to call
+      /// prepare_snapshot() in the task manager thread) if the current one
+      /// is older than max_age. Concurrent callers wait for a single refresh
+      void refresh_snapshot(std::chrono::milliseconds max_age,
+          const std::function<std::shared_ptr<rib::Rib>()>& prepare);
+      /// the current snapshot, nullptr if there is none yet
+      std::shared_ptr<const rib::Rib> current_snapshot() const;
+
       std::string all_stats_to_string() const;
-      std::string all_stats_to_json_string() const;
-      bool stats_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const;
+      /// the JSON dumps only contain what is selected by filter
+      std::string all_stats_to_json_string(
+          const rib::stats_filter& filter = rib::stats_filter::all()) const;
+      bool stats_by_bs_id_to_json_string(uint64_t bs_id, std::string& out,
+          const rib::stats_filter& filter = rib::stats_filter::all()) const;
 
       std::string all_enb_configs_to_string() const;
-      std::string all_enb_configs_to_json_string() const;
-      bool enb_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const;
+      std::string all_enb_configs_to_json_string(
+          const rib::stats_filter& filter = rib::stats_filter::all()) const;
+      bool enb_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out,
+          const rib::stats_filter& filter = rib::stats_filter::all()) const;
 
       std::string all_mac_configs_to_string() const;
-      std::string all_mac_configs_to_json_string() const;
-      bool mac_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const;
+      std::string all_mac_configs_to_json_string(
+          const rib::stats_filter& filter = rib::stats_filter::all()) const;
+      bool mac_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out,
+          const rib::stats_filter& filter = rib::stats_filter::all()) const;
 
       bool ue_stats_by_rnti_by_bs_id_to_json_string(flexran::rib::rnti_t rnti, std::string& out,
-          uint64_t bs_id) const;
+          uint64_t bs_id, const rib::stats_filter& filter = rib::stats_filter::all()) const;
+
+      /// writes the JSON statistics of the given type (all, enb_config,
+      /// mac_stats) of BS bs_id, or all BSs if zero, in pieces to out, e.g.,
+      /// for chunked transfer. If filter is paged, the next page's cursor is
+      /// added. Returns false if the BS does not exist
+      bool write_json_stats(const std::string& type, uint64_t bs_id,
+          const rib::json_writer& out, const rib::stats_filter& filter) const;
+      /// like write_json_stats(), but writes length-delimited protobuf
+      /// flex_nb_bs messages. The cursor of the next page, if any, is
+      /// stored in next_cursor
+      bool write_protobuf_stats(const std::string& type, uint64_t bs_id,
+          const rib::json_writer& out, const rib::stats_filter& filter,
+          std::string& next_cursor) const;
+      /// the statistics of a single UE as protobuf flex_ue_stats_report
+      bool ue_stats_by_rnti_by_bs_id_to_protobuf(flexran::rib::rnti_t rnti,
+          std::string& out, uint64_t bs_id, const rib::stats_filter& filter) const;
+      /// number of UEs of BS bs_id, or of all BSs if zero
+      size_t num_ues(uint64_t bs_id = 0) const;
+
+      /// returns an entity tag for the JSON statistics of the given type
+      /// (all, enb_config, mac_stats) of BS bs_id, or of all BSs if bs_id is
+      /// zero. It is derived from the RIB versions, i.e., it changes iff the
+      /// statistics change, and does not need any serialization
+      std::string stats_etag(const std::string& type, uint64_t bs_id = 0) const;
+      /// returns an entity tag for the statistics of a single UE
+      std::string ue_stats_etag(flexran::rib::rnti_t rnti, uint64_t bs_id) const;
 
       // returns the bs_id of matching agent/enb ID string or zero if not
       // found
@@ -78,17 +133,31 @@ namespace flexran {
       bool parse_rnti_imsi_find_bs(const std::string& rnti_imsi_s, flexran::rib::rnti_t& rnti,
           uint64_t& bs_id) const;
 
+      /// the stats requests are app state: call from the task manager thread
       bool get_stats_requests(const std::string& bs, std::string& resp) const;
       bool set_stats_requests(const std::string& bs, const std::string& policy,
           std::string& error_reason);
 
       private:
-        void push_complete_stats_request(uint64_t bs_id, uint32_t xid,
+        /// returns the xid identifying the request at the agent
+        uint32_t push_complete_stats_request(uint64_t bs_id,
             const protocol::flex_complete_stats_request& req);
         void remove_complete_stats_request(uint64_t bs_id, uint32_t xid);
         protocol::flex_complete_stats_request_repeated default_stats_request();
+        bool json_stats_to_string(const std::string& type, uint64_t bs_id,
+            std::string& out, const rib::stats_filter& filter) const;
+        /* the current snapshot, or the live RIB if there is none yet (only
+         * safe in the task manager thread) */
+        std::shared_ptr<const rib::Rib> view() const;
+
+        /* accessed with std::atomic_load/store */
+        std::shared_ptr<const rib::Rib> snapshot_;
+        std::atomic<std::chrono::steady_clock::rep> snapshot_time_{0};
+        std::mutex refresh_mutex_;
 
         std::map<uint64_t, protocol::flex_complete_stats_request_repeated> bs_list_;
+        /* the xids of the requests in bs_list_, to switch them off */
+        std::map<uint64_t, std::vector<uint32_t>> bs_xids_;
 
       };
 
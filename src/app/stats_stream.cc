@@ -0,0 +1,414 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    stats_stream.cc
+ *  \brief   app generating snapshots and deltas of RIB statistics for push
+ *           streaming to northbound clients
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "stats_stream.h"
+#include "enb_rib_info.h"
+#include "flexran_log.h"
+#include "async_log.h"
+#include "rt_wrapper.h"
+
+flexran::app::stats::stats_stream::stats_stream(const flexran::rib::Rib& rib,
+    const flexran::core::requests_manager& rm, flexran::event::subscription& sub,
+    size_t max_queue, size_t max_clients)
+  : component(rib, rm, sub),
+    max_queue_(max_queue),
+    max_clients_(max_clients)
+{
+  render_thread_ = std::thread(&flexran::app::stats::stats_stream::run, this);
+  event_sub_.subscribe_task_tick(
+      boost::bind(&flexran::app::stats::stats_stream::tick, this, _1), 1);
+}
+
+flexran::app::stats::stats_stream::~stats_stream()
+{
+  stop_ = true;
+  if (render_thread_.joinable())
+    render_thread_.join();
+  render_job *j;
+  while (jobs_.pop(j))
+    delete j;
+}
+
+bool flexran::app::stats::stats_stream::add_client(const std::string& bs,
+    const std::string& ue, const std::string& kpi, uint64_t period,
+    uint64_t& id, std::string& error_reason)
+{
+  auto c = std::make_shared<client>();
+
+  std::istringstream bss(bs);
+  std::string s;
+  while (std::getline(bss, s, ',')) {
+    if (s.empty()) continue;
+    const uint64_t bs_id = rib_.parse_enb_agent_id(s);
+    if (bs_id == 0) {
+      error_reason = "can not find BS " + s;
+      return false;
+    }
+    c->bs.insert(bs_id);
+  }
+
+  std::istringstream uess(ue);
+  while (std::getline(uess, s, ','))
+    if (!s.empty()) c->ue.push_back(s);
+
+  if (kpi.empty() || kpi == "all") {
+    c->enb_config = true;
+    c->mac_stats = true;
+  } else if (kpi == "enb_config" || kpi == "mac_stats") {
+    c->enb_config = kpi == "enb_config";
+    c->mac_stats = kpi == "mac_stats";
+  } else {
+    error_reason = "invalid statistics type " + kpi;
+    return false;
+  }
+
+  if (period < 1) {
+    error_reason = "period must be larger than 0";
+    return false;
+  }
+  c->period = period;
+
+  std::lock_guard<std::mutex> lg(clients_mutex_);
+  if (clients_.size() >= max_clients_) {
+    error_reason = "too many stream clients (maximum "
+        + std::to_string(max_clients_) + ")";
+    return false;
+  }
+  id = next_client_id_++;
+  clients_.emplace(id, c);
+  LOG4CXX_INFO(flog::app, "stats_stream: added client " << id << " (BS '"
+      << bs << "', UE '" << ue << "', kpi '" << kpi << "', period "
+      << period << "ms)");
+  return true;
+}
+
+void flexran::app::stats::stats_stream::remove_client(uint64_t id)
+{
+  std::lock_guard<std::mutex> lg(clients_mutex_);
+  if (clients_.erase(id) > 0)
+    LOG4CXX_INFO(flog::app, "stats_stream: removed client " << id);
+}
+
+bool flexran::app::stats::stats_stream::pop_events(uint64_t id,
+    std::vector<stream_event>& events)
+{
+  std::shared_ptr<client> c;
+  {
+    std::lock_guard<std::mutex> lg(clients_mutex_);
+    auto it = clients_.find(id);
+    if (it == clients_.end()) return false;
+    c = it->second;
+  }
+  std::lock_guard<std::mutex> lg(c->mutex);
+  events.reserve(events.size() + c->queue.size());
+  std::move(c->queue.begin(), c->queue.end(), std::back_inserter(events));
+  c->queue.clear();
+  return true;
+}
+
+bool flexran::app::stats::stats_stream::wait_events(uint64_t& seen,
+    std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lk(event_mutex_);
+  const bool ret = event_cv_.wait_for(lk, timeout,
+      [this, seen] { return event_count_ != seen; });
+  seen = event_count_;
+  return ret;
+}
+
+size_t flexran::app::stats::stats_stream::num_clients() const
+{
+  std::lock_guard<std::mutex> lg(clients_mutex_);
+  return clients_.size();
+}
+
+void flexran::app::stats::stats_stream::tick(uint64_t ms)
+{
+  std::vector<std::shared_ptr<client>> due;
+  {
+    std::lock_guard<std::mutex> lg(clients_mutex_);
+    for (const auto& c : clients_)
+      if (ms >= c.second->next_tick)
+        due.push_back(c.second);
+  }
+  if (due.empty()) return;
+
+  /* the render thread lags behind: try again in the next tick */
+  if (!jobs_.write_available()) {
+    skipped_++;
+    return;
+  }
+
+  if (rib_changed())
+    rib_generation_++;
+  /* clients that saw the current RIB state would only get empty deltas */
+  auto it = std::remove_if(due.begin(), due.end(),
+      [this, ms] (const std::shared_ptr<client>& c) {
+        c->next_tick = ms + c->period;
+        if (!c->need_snapshot && c->rib_generation == rib_generation_)
+          return true;
+        c->rib_generation = rib_generation_;
+        return false;
+      });
+  due.erase(it, due.end());
+  if (due.empty()) return;
+
+  /* prepare_snapshot() only copies which BSs and UEs exist, the render
+   * thread copies the contents */
+  jobs_.push(new render_job{
+      rib_.prepare_snapshot(std::atomic_load(&last_snapshot_)), std::move(due)});
+}
+
+bool flexran::app::stats::stats_stream::rib_changed()
+{
+  const std::set<uint64_t> bss = rib_.get_available_base_stations();
+  bool changed = bss.size() != seen_versions_.size();
+  seen_versions_.resize(bss.size());
+  size_t i = 0;
+  for (uint64_t bs_id : bss) {
+    const auto bs = rib_.get_bs(bs_id);
+    const std::array<uint64_t, 3> v{{bs_id, bs->get_config_version(),
+        bs->get_stats_version()}};
+    if (seen_versions_[i] != v) {
+      seen_versions_[i] = v;
+      changed = true;
+    }
+    ++i;
+  }
+  return changed;
+}
+
+void flexran::app::stats::stats_stream::run()
+{
+  /* signals are handled by the main thread only */
+  sigset_t sigmask;
+  sigfillset(&sigmask);
+  pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+
+  core::rt::become_background_thread();
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);
+  pthread_setname_np(pthread_self(), "stats_render");
+
+  while (!stop_) {
+    render_job *j;
+    if (!jobs_.pop(j)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    render(*j);
+    delete j;
+  }
+}
+
+void flexran::app::stats::stats_stream::render(render_job& job)
+{
+  job.snapshot->complete_snapshot();
+  std::atomic_store(&last_snapshot_, std::shared_ptr<const rib::Rib>(job.snapshot));
+
+  tick_cache cache;
+  for (auto& c : job.due) {
+    std::vector<stream_event> events = c->need_snapshot
+        ? make_snapshot(*c, *job.snapshot, cache)
+        : make_deltas(*c, *job.snapshot, cache);
+    enqueue(*c, events);
+  }
+
+  {
+    std::lock_guard<std::mutex> lg(event_mutex_);
+    event_count_++;
+  }
+  event_cv_.notify_all();
+}
+
+std::vector<flexran::app::stats::stream_event>
+flexran::app::stats::stats_stream::make_snapshot(client& c,
+    const flexran::rib::Rib& rib, tick_cache& cache)
+{
+  c.seen_config.clear();
+  c.seen_ue.clear();
+
+  std::vector<std::string> configs;
+  std::vector<std::string> mac_stats;
+  for (uint64_t bs_id : selected_bs(c, rib)) {
+    const auto bs = rib.get_bs(bs_id);
+    c.seen_config[bs_id] = bs->get_config_version();
+    if (c.enb_config)
+      configs.push_back(config_json(rib, bs_id, cache));
+    if (!c.mac_stats) continue;
+    std::vector<std::string> ues;
+    for (rib::rnti_t rnti : selected_rntis(c, *bs)) {
+      c.seen_ue[std::make_pair(bs_id, rnti)] = bs->get_ue_mac_info(rnti)->get_stats_version();
+      ues.push_back(ue_json(rib, bs_id, rnti, cache));
+    }
+    mac_stats.push_back(rib::enb_rib_info::format_mac_stats_to_json(bs_id, ues));
+  }
+  c.need_snapshot = false;
+
+  /* always send both parts, even if empty, so clients can reset their state */
+  std::string data = rib::Rib::format_statistics_to_json(
+      std::chrono::system_clock::now(),
+      c.enb_config ? rib::Rib::format_enb_configurations_to_json(configs) : "",
+      c.mac_stats ? rib::Rib::format_mac_stats_to_json(mac_stats) : "");
+  return std::vector<stream_event>{{0, "snapshot", std::move(data)}};
+}
+
+std::vector<flexran::app::stats::stream_event>
+flexran::app::stats::stats_stream::make_deltas(client& c,
+    const flexran::rib::Rib& rib, tick_cache& cache)
+{
+  std::vector<stream_event> events;
+  const std::set<uint64_t> bss = selected_bs(c, rib);
+
+  for (auto it = c.seen_config.begin(); it != c.seen_config.end(); ) {
+    if (bss.find(it->first) != bss.end()) {
+      ++it;
+      continue;
+    }
+    const uint64_t bs_id = it->first;
+    events.push_back({0, "bs_remove", "{\"bs_id\":" + std::to_string(bs_id) + "}"});
+    c.seen_ue.erase(c.seen_ue.lower_bound(std::make_pair(bs_id, rib::rnti_t(0))),
+        c.seen_ue.upper_bound(std::make_pair(bs_id, std::numeric_limits<rib::rnti_t>::max())));
+    it = c.seen_config.erase(it);
+  }
+
+  for (uint64_t bs_id : bss) {
+    const auto bs = rib.get_bs(bs_id);
+    const uint64_t cv = bs->get_config_version();
+    auto sit = c.seen_config.find(bs_id);
+    if (sit == c.seen_config.end() || sit->second != cv) {
+      c.seen_config[bs_id] = cv;
+      if (c.enb_config)
+        events.push_back({0, "enb_config", "{" + config_json(rib, bs_id, cache) + "}"});
+    }
+
+    if (!c.mac_stats) continue;
+    const std::set<rib::rnti_t> rntis = selected_rntis(c, *bs);
+    std::vector<std::string> changed;
+    for (rib::rnti_t rnti : rntis) {
+      const uint64_t sv = bs->get_ue_mac_info(rnti)->get_stats_version();
+      auto uit = c.seen_ue.find(std::make_pair(bs_id, rnti));
+      if (uit != c.seen_ue.end() && uit->second == sv) continue;
+      c.seen_ue[std::make_pair(bs_id, rnti)] = sv;
+      changed.push_back(ue_json(rib, bs_id, rnti, cache));
+    }
+    if (!changed.empty())
+      events.push_back({0, "mac_stats",
+          "{" + rib::enb_rib_info::format_mac_stats_to_json(bs_id, changed) + "}"});
+
+    auto uit = c.seen_ue.lower_bound(std::make_pair(bs_id, rib::rnti_t(0)));
+    while (uit != c.seen_ue.end() && uit->first.first == bs_id) {
+      if (rntis.find(uit->first.second) != rntis.end()) {
+        ++uit;
+        continue;
+      }
+      events.push_back({0, "ue_remove", "{\"bs_id\":" + std::to_string(bs_id)
+          + ",\"rnti\":" + std::to_string(uit->first.second) + "}"});
+      uit = c.seen_ue.erase(uit);
+    }
+  }
+  return events;
+}
+
+std::set<flexran::rib::rnti_t> flexran::app::stats::stats_stream::selected_rntis(
+    const client& c, const rib::enb_rib_info& bs)
+{
+  std::set<rib::rnti_t> all = bs.get_rntis();
+  if (c.ue.empty()) return all;
+
+  /* RNTIs of a UE change over time, so IMSIs are resolved on every tick */
+  std::set<rib::rnti_t> rntis;
+  for (const std::string& u : c.ue) {
+    rib::rnti_t rnti;
+    if (bs.parse_rnti_imsi(u, rnti) && all.find(rnti) != all.end())
+      rntis.insert(rnti);
+  }
+  return rntis;
+}
+
+std::set<uint64_t> flexran::app::stats::stats_stream::selected_bs(
+    const client& c, const flexran::rib::Rib& rib)
+{
+  std::set<uint64_t> available = rib.get_available_base_stations();
+  if (c.bs.empty()) return available;
+
+  std::set<uint64_t> bss;
+  for (uint64_t bs_id : c.bs)
+    if (available.find(bs_id) != available.end())
+      bss.insert(bs_id);
+  return bss;
+}
+
+const std::string& flexran::app::stats::stats_stream::config_json(
+    const flexran::rib::Rib& rib, uint64_t bs_id, tick_cache& cache)
+{
+  auto it = cache.config.find(bs_id);
+  if (it == cache.config.end())
+    it = cache.config.emplace(bs_id, rib.get_bs(bs_id)->dump_configs_to_json_string()).first;
+  return it->second;
+}
+
+const std::string& flexran::app::stats::stats_stream::ue_json(
+    const flexran::rib::Rib& rib, uint64_t bs_id, rib::rnti_t rnti,
+    tick_cache& cache)
+{
+  const auto key = std::make_pair(bs_id, rnti);
+  auto it = cache.ue.find(key);
+  if (it == cache.ue.end())
+    it = cache.ue.emplace(key,
+        rib.get_bs(bs_id)->get_ue_mac_info(rnti)->dump_stats_to_json_string()).first;
+  return it->second;
+}
+
+void flexran::app::stats::stats_stream::enqueue(client& c,
+    std::vector<stream_event>& events)
+{
+  if (events.empty()) return;
+
+  std::lock_guard<std::mutex> lg(c.mutex);
+  if (c.queue.size() + events.size() > max_queue_) {
+    /* the client does not keep up: drop everything and send a fresh
+     * snapshot next time instead of letting the queue grow */
+    const uint64_t n = c.queue.size() + events.size();
+    dropped_ += n;
+    c.queue.clear();
+    c.need_snapshot = true;
+    FLOG_WARN(flog::app, "stats_stream: client too slow, dropped {} events, "
+        "resynchronizing", n);
+    return;
+  }
+  for (auto& e : events) {
+    e.id = c.next_id++;
+    c.queue.push_back(std::move(e));
+  }
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    stats_stream.h
+ *  \brief   app generating snapshots and deltas of RIB statistics for push
+ *           streaming to northbound clients
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef STATS_STREAM_H_
+#define STATS_STREAM_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include "component.h"
+#include "rib_common.h"
+
+namespace flexran {
+
+  namespace app {
+
+    namespace stats {
+
+      /*! a single event of a stream. The type is one of "snapshot",
+       * "enb_config", "mac_stats", "ue_remove", "bs_remove", data is JSON */
+      struct stream_event {
+        uint64_t id;
+        std::string type;
+        std::string data;
+      };
+
+      /*! The task tick only checks the RIB versions and, if a client is due
+       * and something changed, hands a prepared RIB snapshot (see
+       * rib::Rib::prepare_snapshot()) to a render thread, which completes it
+       * and serializes the events of the clients */
+      class stats_stream : public component {
+
+      public:
+
+        stats_stream(const rib::Rib& rib, const core::requests_manager& rm,
+            event::subscription& sub, size_t max_queue = 256,
+            size_t max_clients = 16);
+        ~stats_stream();
+
+        /*! Registers a new client. bs and ue are comma-separated lists of
+         * BS/agent IDs and RNTIs/IMSIs (empty: all), kpi is one of
+         * enb_config, mac_stats, all. The client first receives a snapshot
+         * of its selection and then deltas every period ms. Fails if there
+         * are max_clients clients already */
+        bool add_client(const std::string& bs, const std::string& ue,
+            const std::string& kpi, uint64_t period, uint64_t& id,
+            std::string& error_reason);
+        void remove_client(uint64_t id);
+
+        /*! moves all queued events of a client into events. Returns false if
+         * there is no such client */
+        bool pop_events(uint64_t id, std::vector<stream_event>& events);
+
+        /*! blocks until events have been queued since the last call (seen
+         * holds the event counter of the caller) or the timeout expired.
+         * Returns true if there are new events */
+        bool wait_events(uint64_t& seen, std::chrono::milliseconds timeout);
+
+        size_t num_clients() const;
+        uint64_t num_dropped() const { return dropped_; }
+        //! ticks in which due clients were skipped as the render thread lagged
+        uint64_t num_skipped() const { return skipped_; }
+
+        void tick(uint64_t ms);
+
+      private:
+        struct client {
+          std::set<uint64_t> bs;
+          std::vector<std::string> ue;
+          bool enb_config;
+          bool mac_stats;
+          uint64_t period;
+
+          /* only accessed by tick() */
+          uint64_t next_tick = 0;
+          uint64_t rib_generation = 0;
+          /* set by the render thread, read by tick() */
+          std::atomic<bool> need_snapshot{true};
+          /* only accessed by the render thread */
+          std::map<uint64_t, uint64_t> seen_config;
+          std::map<std::pair<uint64_t, rib::rnti_t>, uint64_t> seen_ue;
+
+          /* bounded queue towards the northbound, protected by mutex */
+          std::mutex mutex;
+          std::deque<stream_event> queue;
+          uint64_t next_id = 1;
+        };
+
+        /* per-tick cache of serialized configurations/UE stats, so that
+         * multiple clients with overlapping selections serialize only once */
+        struct tick_cache {
+          std::map<uint64_t, std::string> config;
+          std::map<std::pair<uint64_t, rib::rnti_t>, std::string> ue;
+        };
+
+        /* clients due in one tick and the RIB state they get rendered from */
+        struct render_job {
+          std::shared_ptr<rib::Rib> snapshot;
+          std::vector<std::shared_ptr<client>> due;
+        };
+
+        bool rib_changed();
+        void run();
+        void render(render_job& job);
+
+        static std::vector<stream_event> make_snapshot(client& c,
+            const rib::Rib& rib, tick_cache& cache);
+        static std::vector<stream_event> make_deltas(client& c,
+            const rib::Rib& rib, tick_cache& cache);
+        static std::set<rib::rnti_t> selected_rntis(const client& c,
+            const rib::enb_rib_info& bs);
+        static std::set<uint64_t> selected_bs(const client& c, const rib::Rib& rib);
+        static const std::string& config_json(const rib::Rib& rib,
+            uint64_t bs_id, tick_cache& cache);
+        static const std::string& ue_json(const rib::Rib& rib, uint64_t bs_id,
+            rib::rnti_t rnti, tick_cache& cache);
+        void enqueue(client& c, std::vector<stream_event>& events);
+
+        const size_t max_queue_;
+        const size_t max_clients_;
+
+        mutable std::mutex clients_mutex_;
+        std::map<uint64_t, std::shared_ptr<client>> clients_;
+        uint64_t next_client_id_ = 1;
+        std::atomic<uint64_t> dropped_{0};
+
+        std::mutex event_mutex_;
+        std::condition_variable event_cv_;
+        uint64_t event_count_ = 0;
+
+        /* versions (BS ID, config, stats) of the RIB when last checked,
+         * and how often they changed, only accessed by tick() */
+        std::vector<std::array<uint64_t, 3>> seen_versions_;
+        uint64_t rib_generation_ = 0;
+        std::atomic<uint64_t> skipped_{0};
+
+        boost::lockfree::spsc_queue<render_job *> jobs_{8};
+        std::shared_ptr<const rib::Rib> last_snapshot_;
+        std::atomic<bool> stop_{false};
+        std::thread render_thread_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* STATS_STREAM_H_ */
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    admission.cc
+ *  \brief   admission control and rate limiting of northbound requests
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+
+#include "admission.h"
+
+namespace {
+  /* above this number of buckets, idle ones are dropped */
+  const size_t max_buckets = 1024;
+
+  /* the first path component, e.g., "/stats" for "/stats/enb/-1" */
+  std::string first_component(const std::string& path)
+  {
+    const size_t end = path.find_first_of("/?", 1);
+    return path.substr(0, end);
+  }
+}
+
+const char *flexran::core::admission::class_name(request_class c)
+{
+  switch (c) {
+    case request_class::control: return "control";
+    case request_class::read:    return "read";
+    case request_class::heavy:   return "heavy";
+  }
+  return "read";
+}
+
+const char *flexran::core::admission::verdict_name(verdict v)
+{
+  switch (v) {
+    case verdict::admitted:       return "admitted";
+    case verdict::client_limit:   return "client";
+    case verdict::endpoint_limit: return "endpoint";
+    case verdict::heavy_limit:    return "heavy";
+  }
+  return "admitted";
+}
+
+flexran::core::admission::counters& flexran::core::admission::get_counters()
+{
+  static counters c;
+  return c;
+}
+
+void flexran::core::admission::token_bucket::refill(clock::time_point now)
+{
+  if (now <= last_) return;
+  const double dt = std::chrono::duration<double>(now - last_).count();
+  tokens_ = std::min(burst_, tokens_ + dt * rate_);
+  last_ = now;
+}
+
+bool flexran::core::admission::token_bucket::take(clock::time_point now)
+{
+  refill(now);
+  if (tokens_ < 1)
+    return false;
+  tokens_ -= 1;
+  return true;
+}
+
+bool flexran::core::admission::token_bucket::idle(clock::time_point now) const
+{
+  const double dt = std::chrono::duration<double>(now - last_).count();
+  return tokens_ + dt * rate_ >= burst_;
+}
+
+flexran::core::admission::request_class flexran::core::admission::controller::classify(
+    const std::string& method, const std::string& path)
+{
+  if (method != "GET")
+    return request_class::control;
+  /* statistics of all UEs of one or all BSs, but not of a single UE or the
+   * statistics configuration */
+  const std::string c = first_component(path);
+  if (c == "/stats_manager")
+    return request_class::heavy;
+  if (c == "/stats") {
+    const std::string rest = path.substr(c.size());
+    if (rest.compare(0, 4, "/ue/") == 0 || rest.compare(0, 5, "/conf") == 0)
+      return request_class::read;
+    if (rest.compare(0, 5, "/enb/") == 0 && rest.find("/ue/") != std::string::npos)
+      return request_class::read;
+    return request_class::heavy;
+  }
+  return request_class::read;
+}
+
+std::string flexran::core::admission::controller::endpoint(
+    const std::string& method, const std::string& path)
+{
+  return method + " " + first_component(path);
+}
+
+flexran::core::admission::verdict flexran::core::admission::controller::admit(
+    const std::string& client, const std::string& method,
+    const std::string& path, request_class& c, clock::time_point now)
+{
+  counters& cnt = get_counters();
+  c = classify(method, path);
+  const int i = static_cast<int>(c);
+
+  {
+    std::lock_guard<std::mutex> lg(mutex_);
+    /* control requests have their own budget, so that reads of a client
+     * can not starve its control requests */
+    const std::string ckey = client + (c == request_class::control ? " c" : " r");
+    if (opts_.client_rate > 0
+        && !take(client_buckets_, ckey, opts_.client_rate, opts_.client_burst, now)) {
+      cnt.client_limited[i]++;
+      return verdict::client_limit;
+    }
+    if (opts_.endpoint_rate > 0
+        && !take(endpoint_buckets_, endpoint(method, path), opts_.endpoint_rate,
+                 opts_.endpoint_burst, now)) {
+      cnt.endpoint_limited[i]++;
+      return verdict::endpoint_limit;
+    }
+  }
+
+  if (c == request_class::heavy && opts_.max_heavy > 0) {
+    if (heavy_.fetch_add(1) >= opts_.max_heavy) {
+      heavy_--;
+      cnt.heavy_limited++;
+      return verdict::heavy_limit;
+    }
+  }
+  cnt.admitted[i]++;
+  return verdict::admitted;
+}
+
+void flexran::core::admission::controller::finish(request_class c)
+{
+  if (c == request_class::heavy && opts_.max_heavy > 0)
+    heavy_--;
+}
+
+flexran::core::admission::ticket flexran::core::admission::controller::make_ticket(
+    const std::shared_ptr<controller>& ac, request_class c)
+{
+  if (c != request_class::heavy)
+    return nullptr;
+  return ticket(new request_class(c),
+      [ac] (const request_class *rc) { ac->finish(*rc); delete rc; });
+}
+
+flexran::core::admission::ticket& flexran::core::admission::current_ticket()
+{
+  static thread_local ticket t;
+  return t;
+}
+
+size_t flexran::core::admission::controller::num_buckets() const
+{
+  std::lock_guard<std::mutex> lg(mutex_);
+  return client_buckets_.size() + endpoint_buckets_.size();
+}
+
+bool flexran::core::admission::controller::take(
+    std::map<std::string, token_bucket>& buckets, const std::string& key,
+    double rate, double burst, clock::time_point now)
+{
+  auto it = buckets.find(key);
+  if (it == buckets.end()) {
+    if (buckets.size() >= max_buckets) {
+      for (auto b = buckets.begin(); b != buckets.end(); )
+        b = b->second.idle(now) ? buckets.erase(b) : std::next(b);
+    }
+    it = buckets.emplace(key, token_bucket(rate, burst, now)).first;
+  }
+  return it->second.take(now);
+}
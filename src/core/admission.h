@@ -0,0 +1,152 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    admission.h
+ *  \brief   admission control and rate limiting of northbound requests
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef ADMISSION_H_
+#define ADMISSION_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace flexran {
+
+  namespace core {
+
+    namespace admission {
+
+      typedef std::chrono::steady_clock clock;
+
+      /*! class of a northbound request. Control requests (anything but GET)
+       * change the RAN and are served first, heavy requests dump statistics
+       * of many UEs, reads are all other GET requests */
+      enum class request_class { control = 0, read = 1, heavy = 2 };
+      const char *class_name(request_class c);
+
+      /// why a request was (not) admitted
+      enum class verdict { admitted, client_limit, endpoint_limit, heavy_limit };
+      const char *verdict_name(verdict v);
+
+      /*! the limits. Rates are in requests per second with a burst of as
+       * many requests, a rate of 0 disables the limit */
+      struct options {
+        /// per client (IP address), separately for control and other requests
+        double client_rate = 0;
+        double client_burst = 20;
+        /// per endpoint (method and first path component) over all clients
+        double endpoint_rate = 0;
+        double endpoint_burst = 50;
+        /// concurrent heavy requests, 0 means no limit
+        size_t max_heavy = 0;
+      };
+
+      /// counters over all requests, indexed by request_class
+      struct counters {
+        std::atomic<uint64_t> admitted[3]{};
+        std::atomic<uint64_t> client_limited[3]{};
+        std::atomic<uint64_t> endpoint_limited[3]{};
+        std::atomic<uint64_t> heavy_limited{0};
+      };
+      counters& get_counters();
+
+      /* a token bucket of burst tokens that refills at rate tokens per
+       * second; every request takes one */
+      class token_bucket {
+      public:
+        token_bucket(double rate, double burst, clock::time_point now)
+          : rate_(rate), burst_(burst), tokens_(burst), last_(now) {}
+        /// takes a token, returns false if there is none
+        bool take(clock::time_point now);
+        /// true if the bucket would be full at now, i.e., it is not needed
+        bool idle(clock::time_point now) const;
+
+      private:
+        void refill(clock::time_point now);
+
+        double rate_;
+        double burst_;
+        double tokens_;
+        clock::time_point last_;
+      };
+
+      class controller;
+
+      /*! keeps the slot of an admitted heavy request: controller::finish()
+       * is called when the last copy is destroyed. A request that is
+       * answered later, e.g., by a streaming job, keeps a copy of the ticket
+       * until it is done */
+      typedef std::shared_ptr<const request_class> ticket;
+
+      /*! the ticket of the request that the calling (REST) thread is
+       * handling, empty if the request does not hold a slot */
+      ticket& current_ticket();
+
+      /* Decides whether to serve a request. Thread-safe, to be called by all
+       * REST threads before handling a request */
+      class controller {
+      public:
+        explicit controller(const options& opts) : opts_(opts) {}
+
+        static request_class classify(const std::string& method,
+            const std::string& path);
+        /// the endpoint for per-endpoint limits, e.g., "GET /stats"
+        static std::string endpoint(const std::string& method,
+            const std::string& path);
+
+        /*! checks a request of client. If a heavy request is admitted,
+         * finish() must be called when it has been answered */
+        verdict admit(const std::string& client, const std::string& method,
+            const std::string& path, request_class& c,
+            clock::time_point now = clock::now());
+        void finish(request_class c);
+        /*! a ticket that calls ac->finish(c) when released, empty if c
+         * does not need to be finished */
+        static ticket make_ticket(const std::shared_ptr<controller>& ac,
+            request_class c);
+
+        size_t num_heavy() const { return heavy_; }
+        size_t num_buckets() const;
+
+      private:
+        bool take(std::map<std::string, token_bucket>& buckets,
+            const std::string& key, double rate, double burst,
+            clock::time_point now);
+
+        const options opts_;
+        mutable std::mutex mutex_;
+        std::map<std::string, token_bucket> client_buckets_;
+        std::map<std::string, token_bucket> endpoint_buckets_;
+        std::atomic<size_t> heavy_{0};
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* ADMISSION_H_ */
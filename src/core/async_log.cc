@@ -0,0 +1,199 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    async_log.cc
+ *  \brief   asynchronous logging for the RT threads
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <sstream>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include "async_log.h"
+#include "rt_wrapper.h"
+
+namespace alog = flexran::core::async_log;
+
+namespace {
+  /* every thread that logs gets its own single-producer ring, so that the
+   * hot path never contends with other threads */
+  struct ring {
+    ring(size_t capacity) : q(capacity) {}
+    boost::lockfree::spsc_queue<alog::record> q;
+    /* the thread exited, the ring is removed once drained */
+    std::atomic<bool> closed{false};
+  };
+
+  /* closes the ring of a thread when it exits */
+  struct ring_owner {
+    std::shared_ptr<ring> r;
+    ~ring_owner() {
+      if (r) r->closed = true;
+      r.reset();
+    }
+  };
+
+  std::mutex rings_mutex;
+  std::vector<std::shared_ptr<ring>> rings;
+  size_t ring_capacity = 4096;
+
+  std::atomic<bool> running{false};
+  std::thread writer;
+  std::atomic<uint64_t> n_dropped{0};
+  std::atomic<uint64_t> n_written{0};
+
+  thread_local ring_owner own_ring;
+
+  flexran_log::LevelPtr to_log4cxx(alog::level l)
+  {
+    switch (l) {
+      case alog::level::trace: return flexran_log::Level::getTrace();
+      case alog::level::debug: return flexran_log::Level::getDebug();
+      case alog::level::info:  return flexran_log::Level::getInfo();
+      case alog::level::warn:  return flexran_log::Level::getWarn();
+      default:                 return flexran_log::Level::getError();
+    }
+  }
+
+  void write_record(const alog::record& r)
+  {
+    r.logger->forcedLog(to_log4cxx(r.lvl), alog::format(r),
+        flexran_log::spi::LocationInfo(r.file, r.func, r.line));
+  }
+
+  size_t drain()
+  {
+    std::vector<std::shared_ptr<ring>> rs;
+    {
+      std::lock_guard<std::mutex> lg(rings_mutex);
+      rs = rings;
+    }
+    size_t n = 0;
+    bool closed = false;
+    for (auto& r : rs) {
+      /* read before draining: nothing is pushed after closing */
+      closed = r->closed || closed;
+      n += r->q.consume_all(write_record);
+    }
+    n_written += n;
+    if (closed) {
+      std::lock_guard<std::mutex> lg(rings_mutex);
+      rings.erase(std::remove_if(rings.begin(), rings.end(),
+            [] (const std::shared_ptr<ring>& r) {
+              return r->closed && r->q.read_available() == 0;
+            }), rings.end());
+    }
+    return n;
+  }
+
+  void writer_loop()
+  {
+    flexran::core::rt::become_background_thread();
+    pthread_setname_np(pthread_self(), "async_log");
+    uint64_t reported = 0;
+    while (running) {
+      if (drain() == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      const uint64_t d = n_dropped;
+      if (d != reported) {
+        LOG4CXX_WARN(flog::core, "async log: dropped " << d - reported
+            << " messages (" << d << " in total)");
+        reported = d;
+      }
+    }
+  }
+}
+
+void alog::start(size_t capacity)
+{
+  if (running)
+    return;
+  ring_capacity = capacity;
+  running = true;
+  writer = std::thread(writer_loop);
+}
+
+void alog::stop()
+{
+  if (!running)
+    return;
+  running = false;
+  if (writer.joinable())
+    writer.join();
+  drain();
+}
+
+uint64_t alog::dropped()
+{
+  return n_dropped;
+}
+
+uint64_t alog::written()
+{
+  return n_written;
+}
+
+size_t alog::num_rings()
+{
+  std::lock_guard<std::mutex> lg(rings_mutex);
+  return rings.size();
+}
+
+std::string alog::format(const record& r)
+{
+  std::ostringstream ss;
+  uint8_t next = 0;
+  for (const char *c = r.fmt; *c; ++c) {
+    if (c[0] == '{' && c[1] == '}' && next < r.nargs) {
+      const arg& a = r.args[next++];
+      switch (a.t) {
+        case arg::type::i: ss << a.i; break;
+        case arg::type::u: ss << a.u; break;
+        case arg::type::d: ss << a.d; break;
+        case arg::type::s: ss << a.s; break;
+      }
+      ++c;
+    } else {
+      ss << *c;
+    }
+  }
+  return ss.str();
+}
+
+void alog::push(const record& r)
+{
+  if (!running) {
+    write_record(r);
+    return;
+  }
+  if (!own_ring.r) {
+    own_ring.r = std::make_shared<ring>(ring_capacity);
+    std::lock_guard<std::mutex> lg(rings_mutex);
+    rings.push_back(own_ring.r);
+  }
+  if (!own_ring.r->q.push(r))
+    n_dropped++;
+}
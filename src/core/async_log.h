@@ -0,0 +1,149 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    async_log.h
+ *  \brief   asynchronous logging for the RT threads
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef ASYNC_LOG_H_
+#define ASYNC_LOG_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "flexran_log.h"
+
+/* The FLOG_* macros are a drop-in for LOG4CXX_* on hot paths: the level of
+ * the flog:: category is checked in the calling thread as usual, but instead
+ * of formatting the message, only the format string (which has to be a
+ * literal) and up to async_log::MAX_ARGS numbers or literal strings are put
+ * into a lock-free ring buffer of the calling thread. A background thread
+ * formats the messages ("{}" is replaced by the next argument) and hands them
+ * to log4cxx. If a ring is full, the message is dropped and counted.
+ *
+ * Before async_log::start() and after async_log::stop(), messages are
+ * formatted and logged synchronously. */
+#define FLOG_LOG(logger, lvl, enabled, fmt, ...) \
+  do { \
+    if ((logger)->enabled()) \
+      flexran::core::async_log::log(&*(logger), \
+          flexran::core::async_log::level::lvl, fmt, __FILE__, __func__, \
+          __LINE__, ##__VA_ARGS__); \
+  } while (0)
+#define FLOG_TRACE(logger, fmt, ...) FLOG_LOG(logger, trace, isTraceEnabled, fmt, ##__VA_ARGS__)
+#define FLOG_DEBUG(logger, fmt, ...) FLOG_LOG(logger, debug, isDebugEnabled, fmt, ##__VA_ARGS__)
+#define FLOG_INFO(logger, fmt, ...)  FLOG_LOG(logger, info, isInfoEnabled, fmt, ##__VA_ARGS__)
+#define FLOG_WARN(logger, fmt, ...)  FLOG_LOG(logger, warn, isWarnEnabled, fmt, ##__VA_ARGS__)
+#define FLOG_ERROR(logger, fmt, ...) FLOG_LOG(logger, error, isErrorEnabled, fmt, ##__VA_ARGS__)
+
+namespace flexran {
+
+  namespace core {
+
+    namespace async_log {
+
+      enum class level : uint8_t { trace, debug, info, warn, error };
+
+      static constexpr const size_t MAX_ARGS = 6;
+
+      struct arg {
+        enum class type : uint8_t { i, u, d, s } t;
+        union {
+          int64_t i;
+          uint64_t u;
+          double d;
+          const char *s;
+        };
+      };
+
+      struct record {
+        flexran_log::Logger *logger;
+        level lvl;
+        uint8_t nargs;
+        const char *fmt;
+        const char *file;
+        const char *func;
+        int line;
+        arg args[MAX_ARGS];
+      };
+
+      //! start the thread writing out the messages; capacity per thread ring
+      void start(size_t ring_capacity = 4096);
+
+      //! write out all pending messages and stop the writer thread
+      void stop();
+
+      //! number of messages dropped because a ring was full
+      uint64_t dropped();
+
+      //! number of messages written by the background thread
+      uint64_t written();
+
+      //! number of thread rings; rings of exited threads are removed once drained
+      size_t num_rings();
+
+      //! format a record by replacing each "{}" with the next argument
+      std::string format(const record& r);
+
+      //! enqueue a record for the calling thread, or log it synchronously
+      void push(const record& r);
+
+      template<typename T>
+      typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, arg>::type
+      make_arg(T v) { arg a; a.t = arg::type::i; a.i = v; return a; }
+
+      template<typename T>
+      typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, arg>::type
+      make_arg(T v) { arg a; a.t = arg::type::u; a.u = v; return a; }
+
+      template<typename T>
+      typename std::enable_if<std::is_floating_point<T>::value, arg>::type
+      make_arg(T v) { arg a; a.t = arg::type::d; a.d = v; return a; }
+
+      template<typename T>
+      typename std::enable_if<std::is_enum<T>::value, arg>::type
+      make_arg(T v) { arg a; a.t = arg::type::i; a.i = static_cast<int64_t>(v); return a; }
+
+      /* only for string literals: the pointer is dereferenced later. Other
+       * strings (pointers, buffers) do not compile */
+      template<size_t N>
+      inline arg make_arg(const char (&v)[N]) { arg a; a.t = arg::type::s; a.s = v; return a; }
+      template<size_t N>
+      arg make_arg(char (&v)[N]) = delete;
+
+      template<typename... Args>
+      inline void log(flexran_log::Logger *logger, level lvl, const char *fmt,
+          const char *file, const char *func, int line, Args&&... args)
+      {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many arguments for async log");
+        record r{logger, lvl, sizeof...(Args), fmt, file, func, line, {make_arg(args)...}};
+        push(r);
+      }
+
+    }
+
+  }
+
+}
+
+#endif /* ASYNC_LOG_H_ */
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    background_executor.cc
+ *  \brief   low-priority worker pool for work that must not run on RT threads
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "background_executor.h"
+#include "rt_wrapper.h"
+#include "flexran_log.h"
+
+flexran::core::background_executor::background_executor(size_t num_threads,
+    size_t max_queue)
+  : max_queue_(max_queue)
+{
+  for (size_t i = 0; i < num_threads; ++i)
+    threads_.emplace_back(&background_executor::worker, this);
+}
+
+flexran::core::background_executor::~background_executor()
+{
+  stop_threads();
+  /* only left if shutdown() was not called or something posted afterwards */
+  uint64_t left = 0;
+  completions_.consume_all([&left] (std::function<void()> *f) {
+    delete f;
+    left++;
+  });
+  if (left > 0)
+    LOG4CXX_WARN(flog::core, "background executor: dropped " << left
+        << " completions posted after shutdown");
+}
+
+bool flexran::core::background_executor::submit(std::function<void()> work,
+    std::function<void()> done)
+{
+  {
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (stop_ || queue_.size() >= max_queue_) {
+      rejected_++;
+      return false;
+    }
+    queue_.emplace_back(std::move(work), std::move(done));
+    if (queue_.size() > max_depth_)
+      max_depth_ = queue_.size();
+  }
+  submitted_++;
+  cv_.notify_one();
+  return true;
+}
+
+bool flexran::core::background_executor::post(std::function<void()> done)
+{
+  /* the tick thread does not take completions anymore */
+  if (closed_) {
+    dropped_completions_++;
+    return false;
+  }
+  auto f = new std::function<void()>(std::move(done));
+  /* never wait for the tick thread: the caller might be a worker (holding
+   * up queued work) or a dedicated thread with its own deadlines */
+  if (!completions_.bounded_push(f)) {
+    delete f;
+    if (dropped_completions_++ == 0)
+      LOG4CXX_WARN(flog::core, "background executor: completion queue full, "
+          "dropping completions");
+    return false;
+  }
+  return true;
+}
+
+void flexran::core::background_executor::run_completions()
+{
+  completions_.consume_all([] (std::function<void()> *f) {
+    (*f)();
+    delete f;
+  });
+}
+
+void flexran::core::background_executor::shutdown()
+{
+  stop_threads();
+  if (closed_.exchange(true))
+    return;
+  /* the tick thread is gone: run what finished after its last tick here */
+  uint64_t left = 0;
+  completions_.consume_all([&left] (std::function<void()> *f) {
+    (*f)();
+    delete f;
+    left++;
+  });
+  if (left > 0)
+    LOG4CXX_INFO(flog::core, "background executor: ran " << left
+        << " completions on shutdown");
+  if (dropped_completions_ > 0)
+    LOG4CXX_WARN(flog::core, "background executor: " << dropped_completions_
+        << " completions dropped");
+}
+
+void flexran::core::background_executor::stop_threads()
+{
+  {
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (stop_)
+      return;
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& t : threads_)
+    if (t.joinable())
+      t.join();
+  if (completed_ > 0 || rejected_ > 0)
+    LOG4CXX_INFO(flog::core, "background executor: " << completed_
+        << " jobs completed, " << rejected_ << " rejected, max queue depth "
+        << max_depth_);
+}
+
+size_t flexran::core::background_executor::queue_depth() const
+{
+  std::lock_guard<std::mutex> lg(mutex_);
+  return queue_.size();
+}
+
+void flexran::core::background_executor::worker()
+{
+  /* signals are handled by the main thread only */
+  sigset_t sigmask;
+  sigfillset(&sigmask);
+  pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+
+  rt::become_background_thread();
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);
+  pthread_setname_np(pthread_self(), "bg_executor");
+
+  while (true) {
+    std::pair<std::function<void()>, std::function<void()>> job;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+      /* on shutdown, queued work is still done */
+      if (queue_.empty())
+        return;
+      job = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    try {
+      job.first();
+    } catch (const std::exception& e) {
+      LOG4CXX_ERROR(flog::core, "background executor: job failed: " << e.what());
+    }
+    completed_++;
+
+    if (job.second)
+      post(std::move(job.second));
+  }
+}
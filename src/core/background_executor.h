@@ -0,0 +1,126 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    background_executor.h
+ *  \brief   low-priority worker pool for work that must not run on RT threads
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef BACKGROUND_EXECUTOR_H_
+#define BACKGROUND_EXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/lockfree/queue.hpp>
+
+namespace flexran {
+
+  namespace core {
+
+    /* Apps (components) submit work like file I/O or serialization from the
+     * task manager thread. The work runs on a bounded queue served by worker
+     * threads with normal scheduling (niced, on the app CPUs). An optional
+     * completion callback is handed back to the task manager, which runs it
+     * in its own thread during the next tick, so apps need no locking for
+     * the results. */
+    class background_executor {
+    public:
+      background_executor(size_t num_threads = 2, size_t max_queue = 64);
+      ~background_executor();
+
+      /*! enqueue work; done is later run on the tick thread. Returns false if
+       * the queue is full or the executor is shutting down */
+      bool submit(std::function<void()> work, std::function<void()> done = nullptr);
+
+      /*! enqueue work and get a future for its result. If the work cannot be
+       * queued, the future holds a std::runtime_error */
+      template<typename F>
+      std::future<typename std::result_of<F()>::type> submit_future(F f)
+      {
+        typedef typename std::result_of<F()>::type R;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::move(f));
+        std::future<R> res = task->get_future();
+        if (!submit([task] () { (*task)(); })) {
+          std::promise<R> p;
+          p.set_exception(std::make_exception_ptr(
+                std::runtime_error("background executor queue full")));
+          return p.get_future();
+        }
+        return res;
+      }
+
+      /*! hand done to the tick thread from any thread, e.g., when a
+       * dedicated thread finished. Never blocks: returns false (and counts
+       * the drop) if the completion queue is full or the executor shut down */
+      bool post(std::function<void()> done);
+
+      /*! run the completion callbacks of finished work. Called by the task
+       * manager in every tick */
+      void run_completions();
+
+      /*! stop accepting work, finish all queued work and stop the threads.
+       * Completions not yet taken by run_completions() are then run in the
+       * calling thread, so call this after the task manager stopped */
+      void shutdown();
+
+      size_t queue_depth() const;
+      size_t max_queue_depth() const { return max_depth_; }
+      uint64_t num_submitted() const { return submitted_; }
+      uint64_t num_rejected() const { return rejected_; }
+      uint64_t num_completed() const { return completed_; }
+      uint64_t num_dropped_completions() const { return dropped_completions_; }
+
+    private:
+      void worker();
+      void stop_threads();
+
+      const size_t max_queue_;
+      std::vector<std::thread> threads_;
+
+      mutable std::mutex mutex_;
+      std::condition_variable cv_;
+      std::deque<std::pair<std::function<void()>, std::function<void()>>> queue_;
+      std::atomic<bool> stop_{false};
+
+      /* finished work's callbacks, taken by the tick thread without locking */
+      boost::lockfree::queue<std::function<void()> *> completions_{1024};
+      std::atomic<bool> closed_{false};
+
+      std::atomic<size_t> max_depth_{0};
+      std::atomic<uint64_t> submitted_{0};
+      std::atomic<uint64_t> rejected_{0};
+      std::atomic<uint64_t> completed_{0};
+      std::atomic<uint64_t> dropped_completions_{0};
+    };
+
+  }
+
+}
+
+#endif /* BACKGROUND_EXECUTOR_H_ */
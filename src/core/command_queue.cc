@@ -0,0 +1,108 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    command_queue.cc
+ *  \brief   queue of commands from non-RT threads to the task manager thread
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include "command_queue.h"
+
+flexran::core::command_queue::command_queue(size_t capacity)
+  : queue_(capacity),
+    bulk_queue_(capacity)
+{
+}
+
+flexran::core::command_queue::~command_queue()
+{
+  std::shared_ptr<command> *c;
+  while (queue_.pop(c))
+    delete c;
+  while (bulk_queue_.pop(c))
+    delete c;
+}
+
+bool flexran::core::command_queue::push(const std::shared_ptr<command>& c,
+    priority prio)
+{
+  /* bounded_push does not allocate: a full queue is reported, not grown */
+  std::shared_ptr<command> *p = new std::shared_ptr<command>(c);
+  /* counted before pushing, so that the depth never drops below zero */
+  depth_++;
+  auto& q = prio == priority::control ? queue_ : bulk_queue_;
+  if (q.bounded_push(p))
+    return true;
+  depth_--;
+  delete p;
+  return false;
+}
+
+bool flexran::core::command_queue::execute(const std::shared_ptr<command>& c)
+{
+  {
+    std::lock_guard<std::mutex> lg(c->mutex);
+    if (c->status == state::cancelled)
+      return false;
+    c->status = state::running;
+  }
+  /* the packaged_task stores any exception for the caller */
+  c->f();
+  {
+    std::lock_guard<std::mutex> lg(c->mutex);
+    c->status = state::done;
+  }
+  c->cv.notify_all();
+  return true;
+}
+
+size_t flexran::core::command_queue::run_control()
+{
+  size_t n = 0;
+  queue_.consume_all([this, &n] (std::shared_ptr<command> *p) {
+    std::shared_ptr<command> c(std::move(*p));
+    delete p;
+    depth_--;
+    if (!execute(c))
+      return;
+    executed_++;
+    n++;
+  });
+  return n;
+}
+
+size_t flexran::core::command_queue::run_pending()
+{
+  size_t n = run_control();
+  /* control commands that arrive meanwhile overtake the remaining bulk
+   * commands */
+  std::shared_ptr<command> *p;
+  while (bulk_queue_.pop(p)) {
+    std::shared_ptr<command> c(std::move(*p));
+    delete p;
+    depth_--;
+    if (execute(c)) {
+      executed_++;
+      n++;
+    }
+    n += run_control();
+  }
+  return n;
+}
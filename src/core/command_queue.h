@@ -0,0 +1,138 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    command_queue.h
+ *  \brief   queue of commands from non-RT threads to the task manager thread
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef COMMAND_QUEUE_H_
+#define COMMAND_QUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include <boost/lockfree/queue.hpp>
+
+namespace flexran {
+
+  namespace core {
+
+    /* Threads outside of the task manager (e.g., the REST threads) hand
+     * commands to the task manager, which runs them between two ticks, i.e.,
+     * while neither the RIB is updated nor any app runs. All modifications of
+     * the RIB and the apps are thus serialized on the RT thread without any
+     * locking. Commands should be short: they delay the next tick.
+     * Control commands are run before bulk commands (e.g., snapshots for
+     * statistics dumps), so that they are not delayed by many reads. */
+    class command_queue {
+    public:
+      enum class priority { control, bulk };
+
+      command_queue(size_t capacity = 256);
+      ~command_queue();
+
+      /*! run f on the task manager thread and wait for its result.
+       * Exceptions of f are rethrown. If the queue is full or the task
+       * manager did not start f within timeout, f is dropped and a
+       * std::runtime_error thrown. Must not be called from the task manager
+       * thread itself */
+      template<typename F>
+      typename std::result_of<F()>::type run(F f,
+          std::chrono::milliseconds timeout = std::chrono::milliseconds(2000))
+      {
+        return run(std::move(f), priority::control, timeout);
+      }
+
+      //! like run(f, timeout), with the priority p
+      template<typename F>
+      typename std::result_of<F()>::type run(F f, priority p,
+          std::chrono::milliseconds timeout = std::chrono::milliseconds(2000))
+      {
+        typedef typename std::result_of<F()>::type R;
+        /* the task lives on our stack: we return only once the task manager
+         * finished it or we cancelled it before it started */
+        std::packaged_task<R()> task(std::move(f));
+        std::future<R> res = task.get_future();
+        auto c = std::make_shared<command>();
+        c->f = [&task] () { task(); };
+        if (!push(c, p)) {
+          rejected_++;
+          throw std::runtime_error("command queue full");
+        }
+
+        std::unique_lock<std::mutex> lk(c->mutex);
+        if (!c->cv.wait_for(lk, timeout, [&c] { return c->status == state::done; })) {
+          if (c->status == state::pending) {
+            c->status = state::cancelled;
+            timeouts_++;
+            throw std::runtime_error("task manager did not run command in time");
+          }
+          c->cv.wait(lk, [&c] { return c->status == state::done; });
+        }
+        lk.unlock();
+        return res.get();
+      }
+
+      /*! run all queued commands; called by the task manager in every tick.
+       * Returns the number of commands run */
+      size_t run_pending();
+
+      uint64_t num_executed() const { return executed_; }
+      uint64_t num_rejected() const { return rejected_; }
+      uint64_t num_timeouts() const { return timeouts_; }
+      //! number of commands waiting for the task manager
+      size_t queue_depth() const { return depth_; }
+
+    private:
+      enum class state { pending, running, done, cancelled };
+      struct command {
+        std::function<void()> f;
+        std::mutex mutex;
+        std::condition_variable cv;
+        state status = state::pending;
+      };
+
+      bool push(const std::shared_ptr<command>& c, priority p);
+      static bool execute(const std::shared_ptr<command>& c);
+      size_t run_control();
+
+      /* holds an owning pointer to a shared_ptr, so that cancelled commands
+       * stay valid until the task manager dropped them */
+      boost::lockfree::queue<std::shared_ptr<command> *> queue_;
+      boost::lockfree::queue<std::shared_ptr<command> *> bulk_queue_;
+
+      std::atomic<uint64_t> executed_{0};
+      std::atomic<uint64_t> rejected_{0};
+      std::atomic<uint64_t> timeouts_{0};
+      std::atomic<size_t> depth_{0};
+    };
+
+  }
+
+}
+
+#endif /* COMMAND_QUEUE_H_ */
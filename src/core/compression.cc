@@ -0,0 +1,176 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    compression.cc
+ *  \brief   gzip/deflate compression of northbound responses
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <time.h>
+#include <zlib.h>
+
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#include "compression.h"
+
+namespace {
+  uint64_t thread_cpu_ns()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+
+  std::string trim(const std::string& s)
+  {
+    const size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return "";
+    const size_t e = s.find_last_not_of(" \t");
+    return s.substr(b, e - b + 1);
+  }
+}
+
+const char *flexran::core::compression::encoding_name(encoding e)
+{
+  switch (e) {
+    case encoding::gzip:     return "gzip";
+    case encoding::deflate:  return "deflate";
+    case encoding::identity: return "identity";
+  }
+  return "identity";
+}
+
+flexran::core::compression::encoding flexran::core::compression::negotiate(
+    const std::string& accept_encoding)
+{
+  double q_gzip = 0, q_deflate = 0, q_any = -1;
+  bool has_gzip = false, has_deflate = false;
+  std::istringstream ss(accept_encoding);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    const size_t semi = item.find(';');
+    const std::string coding = trim(item.substr(0, semi));
+    double q = 1;
+    if (semi != std::string::npos) {
+      const std::string param = trim(item.substr(semi + 1));
+      if (param.compare(0, 2, "q=") == 0)
+        q = std::strtod(param.c_str() + 2, nullptr);
+    }
+    if (coding == "gzip" || coding == "x-gzip") {
+      q_gzip = q;
+      has_gzip = true;
+    } else if (coding == "deflate") {
+      q_deflate = q;
+      has_deflate = true;
+    } else if (coding == "*") {
+      q_any = q;
+    }
+  }
+  if (!has_gzip && q_any >= 0) q_gzip = q_any;
+  if (!has_deflate && q_any >= 0) q_deflate = q_any;
+
+  if (q_gzip > 0 && q_gzip >= q_deflate) return encoding::gzip;
+  if (q_deflate > 0) return encoding::deflate;
+  return encoding::identity;
+}
+
+flexran::core::compression::counters& flexran::core::compression::get_counters()
+{
+  static counters c;
+  return c;
+}
+
+struct flexran::core::compression::compressor::stream {
+  z_stream z;
+};
+
+flexran::core::compression::compressor::compressor(encoding e, int level)
+  : strm_(new stream)
+{
+  if (e == encoding::identity)
+    throw std::invalid_argument("no compressor for identity encoding");
+  strm_->z.zalloc = Z_NULL;
+  strm_->z.zfree = Z_NULL;
+  strm_->z.opaque = Z_NULL;
+  /* HTTP's "deflate" is the zlib format, gzip adds 16 to the window bits */
+  const int window_bits = e == encoding::gzip ? 15 + 16 : 15;
+  if (deflateInit2(&strm_->z, level, Z_DEFLATED, window_bits, 8,
+        Z_DEFAULT_STRATEGY) != Z_OK)
+    throw std::runtime_error("cannot initialize zlib");
+  get_counters().responses++;
+}
+
+flexran::core::compression::compressor::~compressor()
+{
+  deflateEnd(&strm_->z);
+}
+
+void flexran::core::compression::compressor::write(const char *data,
+    size_t len, std::string& out)
+{
+  if (finished_)
+    throw std::logic_error("write after finish");
+  if (len == 0) return;
+  deflate(data, len, Z_NO_FLUSH, out);
+}
+
+void flexran::core::compression::compressor::finish(std::string& out)
+{
+  if (finished_) return;
+  deflate(nullptr, 0, Z_FINISH, out);
+  finished_ = true;
+}
+
+void flexran::core::compression::compressor::deflate(const char *data,
+    size_t len, int flush, std::string& out)
+{
+  const uint64_t t0 = thread_cpu_ns();
+  z_stream& z = strm_->z;
+  z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  z.avail_in = len;
+  const size_t before = out.size();
+  int ret;
+  do {
+    /* grow out by what zlib thinks is needed at most, then trim */
+    const size_t pos = out.size();
+    const size_t avail = deflateBound(&z, z.avail_in) + 64;
+    out.resize(pos + avail);
+    z.next_out = reinterpret_cast<Bytef *>(&out[pos]);
+    z.avail_out = avail;
+    ret = ::deflate(&z, flush);
+    out.resize(pos + avail - z.avail_out);
+  } while (ret == Z_OK && (z.avail_in > 0 || (flush == Z_FINISH)));
+
+  counters& c = get_counters();
+  c.bytes_in += len;
+  c.bytes_out += out.size() - before;
+  c.cpu_time_ns += thread_cpu_ns() - t0;
+}
+
+std::string flexran::core::compression::compress(encoding e, int level,
+    const std::string& in)
+{
+  std::string out;
+  compressor c(e, level);
+  c.write(in, out);
+  c.finish(out);
+  return out;
+}
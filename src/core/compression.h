@@ -0,0 +1,97 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    compression.h
+ *  \brief   gzip/deflate compression of northbound responses
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef COMPRESSION_H_
+#define COMPRESSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace flexran {
+
+  namespace core {
+
+    namespace compression {
+
+      enum class encoding { identity, gzip, deflate };
+
+      /// the value for the Content-Encoding header
+      const char *encoding_name(encoding e);
+
+      /*! picks the encoding for an Accept-Encoding header value (RFC 7231,
+       * including q-values). gzip is preferred over deflate */
+      encoding negotiate(const std::string& accept_encoding);
+
+      /*! when and how to compress. A level of 0 disables compression,
+       * responses smaller than min_size are never compressed */
+      struct options {
+        int level = 6;
+        size_t min_size = 1024;
+      };
+
+      /// counters over all compressed responses, e.g., to tune the options
+      struct counters {
+        std::atomic<uint64_t> responses{0};
+        std::atomic<uint64_t> skipped{0};
+        std::atomic<uint64_t> bytes_in{0};
+        std::atomic<uint64_t> bytes_out{0};
+        std::atomic<uint64_t> cpu_time_ns{0};
+      };
+      counters& get_counters();
+
+      /* Streaming compressor for one response: input can be passed in
+       * pieces, compressed output is appended to out as it is produced.
+       * Accounts size and CPU time in get_counters() */
+      class compressor {
+      public:
+        compressor(encoding e, int level);
+        ~compressor();
+        compressor(const compressor&) = delete;
+        compressor& operator=(const compressor&) = delete;
+
+        void write(const char *data, size_t len, std::string& out);
+        void write(const std::string& in, std::string& out) { write(in.data(), in.size(), out); }
+        /// ends the stream; write() must not be called afterwards
+        void finish(std::string& out);
+
+      private:
+        void deflate(const char *data, size_t len, int flush, std::string& out);
+
+        struct stream;
+        std::unique_ptr<stream> strm_;
+        bool finished_ = false;
+      };
+
+      //! compresses all of in at once
+      std::string compress(encoding e, int level, const std::string& in);
+
+    }
+
+  }
+
+}
+
+#endif /* COMPRESSION_H_ */
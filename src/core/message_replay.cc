@@ -0,0 +1,71 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    message_replay.cc
+ *  \brief   replays a message trace into the controller in virtual time
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include "message_replay.h"
+#include "flexran_log.h"
+#include "rib_common.h"
+
+bool flexran::core::message_replay::open(const std::string& filename,
+    std::string& error_reason)
+{
+  if (!reader_.open(filename, error_reason))
+    return false;
+  first_ = true;
+  read_next();
+  return true;
+}
+
+bool flexran::core::message_replay::read_next()
+{
+  uint64_t tick;
+  if (!reader_.read(tick, next_)) {
+    next_.reset();
+    return false;
+  }
+  if (first_) {
+    first_tick_ = tick;
+    first_ = false;
+  }
+  next_tick_ = tick - first_tick_;
+  return true;
+}
+
+bool flexran::core::message_replay::feed(uint64_t tick)
+{
+  while (next_ && next_tick_ <= tick) {
+    next_->setArrival(flexran::rib::clock_now());
+    /* the queue is full: keep the message for the next tick, the RIB
+     * updater will have consumed some by then */
+    if (!net_xface_.try_forward_message(next_.get())) {
+      LOG4CXX_WARN(flog::core, "message_replay: input queue full at tick "
+          << tick << ", delaying messages");
+      return true;
+    }
+    /* the network interface took ownership */
+    next_.release();
+    read_next();
+  }
+  return next_ != nullptr;
+}
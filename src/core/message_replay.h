@@ -0,0 +1,68 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    message_replay.h
+ *  \brief   replays a message trace into the controller in virtual time
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef MESSAGE_REPLAY_H_
+#define MESSAGE_REPLAY_H_
+
+#include <memory>
+#include <string>
+
+#include "replay_source.h"
+#include "async_xface.h"
+#include "message_trace.h"
+
+namespace flexran {
+
+  namespace core {
+
+    class message_replay : public replay_source {
+    public:
+      message_replay(flexran::network::async_xface& xface)
+        : net_xface_(xface) {}
+
+      bool open(const std::string& filename, std::string& error_reason);
+
+      /*! forwards all messages recorded up to tick (relative to the first
+       * message in the trace) to the network interface, as if they had been
+       * received from the agents */
+      bool feed(uint64_t tick) override;
+
+    private:
+      bool read_next();
+
+      flexran::network::async_xface& net_xface_;
+      flexran::network::message_trace_reader reader_;
+
+      std::unique_ptr<flexran::network::tagged_message> next_;
+      uint64_t next_tick_ = 0;
+      uint64_t first_tick_ = 0;
+      bool first_ = true;
+    };
+
+  }
+
+}
+
+#endif /* MESSAGE_REPLAY_H_ */
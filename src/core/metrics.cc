@@ -0,0 +1,178 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    metrics.cc
+ *  \brief   histograms and OpenMetrics/Prometheus text exposition
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "metrics.h"
+
+namespace {
+  void append_double(std::string& out, double v)
+  {
+    char buf[32];
+    const int n = snprintf(buf, sizeof(buf), "%.10g", v);
+    out.append(buf, n);
+  }
+}
+
+flexran::core::metrics::histogram::histogram(std::vector<uint64_t> bounds)
+  : bounds_(std::move(bounds)),
+    counts_(new std::atomic<uint64_t>[bounds_.size() + 1])
+{
+  for (size_t i = 0; i <= bounds_.size(); ++i)
+    counts_[i] = 0;
+}
+
+flexran::core::metrics::writer::writer(format f, size_t reserve)
+  : format_(f)
+{
+  out_.reserve(reserve);
+}
+
+const char *flexran::core::metrics::writer::content_type() const
+{
+  return format_ == format::openmetrics
+      ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+      : "text/plain; version=0.0.4; charset=utf-8";
+}
+
+void flexran::core::metrics::writer::family(const char *name, const char *type,
+    const char *help, const char *unit)
+{
+  /* the Prometheus format names counters like their samples */
+  const char *suffix = format_ == format::prometheus && strcmp(type, "counter") == 0
+      ? "_total" : "";
+  out_ += "# TYPE ";
+  out_ += name;
+  out_ += suffix;
+  out_ += ' ';
+  out_ += type;
+  out_ += "\n# HELP ";
+  out_ += name;
+  out_ += suffix;
+  out_ += ' ';
+  out_ += help;
+  out_ += '\n';
+  if (unit && format_ == format::openmetrics) {
+    out_ += "# UNIT ";
+    out_ += name;
+    out_ += ' ';
+    out_ += unit;
+    out_ += '\n';
+  }
+}
+
+void flexran::core::metrics::writer::sample(const char *name, const char *suffix,
+    const std::string& labels, uint64_t v)
+{
+  format_sample(out_, name, suffix, labels, v);
+}
+
+void flexran::core::metrics::writer::sample(const char *name, const char *suffix,
+    const std::string& labels, double v)
+{
+  format_sample(out_, name, suffix, labels, v);
+}
+
+void flexran::core::metrics::writer::format_sample(std::string& out,
+    const char *name, const char *suffix, const std::string& labels, uint64_t v)
+{
+  out += name;
+  out += suffix;
+  out += labels;
+  out += ' ';
+  out += std::to_string(v);
+  out += '\n';
+}
+
+void flexran::core::metrics::writer::format_sample(std::string& out,
+    const char *name, const char *suffix, const std::string& labels, double v)
+{
+  out += name;
+  out += suffix;
+  out += labels;
+  out += ' ';
+  append_double(out, v);
+  out += '\n';
+}
+
+void flexran::core::metrics::writer::write(const char *n,
+    const std::string& labels, const histogram& h, double scale)
+{
+  /* le is added to the given labels */
+  const std::string prefix = labels.empty()
+      ? "{le=\"" : labels.substr(0, labels.size() - 1) + ",le=\"";
+  const std::vector<uint64_t>& bounds = h.bounds();
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i <= bounds.size(); ++i) {
+    cumulative += h.bucket(i);
+    out_ += n;
+    out_ += "_bucket";
+    out_ += prefix;
+    if (i < bounds.size())
+      append_double(out_, bounds[i] * scale);
+    else
+      out_ += "+Inf";
+    out_ += "\"} ";
+    out_ += std::to_string(cumulative);
+    out_ += '\n';
+  }
+  sample(n, "_count", labels, cumulative);
+  sample(n, "_sum", labels, h.sum() * scale);
+}
+
+std::string& flexran::core::metrics::writer::finish()
+{
+  if (format_ == format::openmetrics)
+    out_ += "# EOF\n";
+  return out_;
+}
+
+std::string flexran::core::metrics::writer::labels(
+    std::initializer_list<std::pair<const char *, std::string>> l)
+{
+  if (l.size() == 0) return "";
+  std::string s = "{";
+  for (const auto& p : l) {
+    if (s.size() > 1) s += ',';
+    s += p.first;
+    s += "=\"";
+    for (char c : p.second) {
+      if (c == '\\' || c == '"') s += '\\';
+      if (c == '\n') {
+        s += "\\n";
+        continue;
+      }
+      s += c;
+    }
+    s += '"';
+  }
+  s += '}';
+  return s;
+}
+
+bool flexran::core::metrics::writer::accepts_openmetrics(const std::string& accept)
+{
+  return accept.find("application/openmetrics-text") != std::string::npos;
+}
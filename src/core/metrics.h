@@ -0,0 +1,135 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    metrics.h
+ *  \brief   histograms and OpenMetrics/Prometheus text exposition
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace flexran {
+
+  namespace core {
+
+    namespace metrics {
+
+      /* Histogram with fixed bucket bounds over integer observations (e.g.,
+       * microseconds). observe() only increments atomics and can be called
+       * from the RT thread while other threads read it. */
+      class histogram {
+      public:
+        /// bounds: inclusive upper bounds of the buckets, ascending; values
+        /// above the last bound go into the +Inf bucket
+        explicit histogram(std::vector<uint64_t> bounds);
+
+        void observe(uint64_t v)
+        {
+          size_t i = 0;
+          while (i < bounds_.size() && v > bounds_[i]) ++i;
+          counts_[i].fetch_add(1, std::memory_order_relaxed);
+          sum_.fetch_add(v, std::memory_order_relaxed);
+        }
+
+        const std::vector<uint64_t>& bounds() const { return bounds_; }
+        /// number of observations in bucket i (not cumulative), the last
+        /// bucket is +Inf
+        uint64_t bucket(size_t i) const { return counts_[i].load(std::memory_order_relaxed); }
+        uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+      private:
+        const std::vector<uint64_t> bounds_;
+        std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+        std::atomic<uint64_t> sum_{0};
+      };
+
+      /* Writes metric families in the OpenMetrics text format, or the
+       * Prometheus text format 0.0.4 for older scrapers. Label sets are
+       * passed preformatted (see labels()), so that callers can keep them
+       * between scrapes instead of formatting them for every sample. */
+      class writer {
+      public:
+        enum class format { openmetrics, prometheus };
+
+        explicit writer(format f = format::openmetrics, size_t reserve = 0);
+
+        /// the Content-Type of the output
+        const char *content_type() const;
+
+        /// starts a family of the given type (counter, gauge, histogram).
+        /// If given, unit must be the suffix of name, e.g., "seconds"
+        void family(const char *name, const char *type, const char *help,
+            const char *unit = nullptr);
+        /// a sample of the last family; suffix is appended to its name,
+        /// e.g., "_total" for counters
+        void sample(const char *name, const char *suffix,
+            const std::string& labels, uint64_t v);
+        void sample(const char *name, const char *suffix,
+            const std::string& labels, double v);
+        /// convenience for a counter sample (name_total)
+        void counter(const char *name, const std::string& labels, uint64_t v)
+        { sample(name, "_total", labels, v); }
+        void gauge(const char *name, const std::string& labels, uint64_t v)
+        { sample(name, "", labels, v); }
+        void gauge(const char *name, const std::string& labels, double v)
+        { sample(name, "", labels, v); }
+        /// all samples of a histogram, multiplying bounds and sum with scale
+        /// (e.g., 1e-6 for microsecond observations in seconds)
+        void write(const char *name, const std::string& labels,
+            const histogram& h, double scale = 1);
+
+        /// appends samples formatted with format_sample(), e.g., to write
+        /// several families in a single pass over the data
+        void append(const std::string& samples) { out_ += samples; }
+        static void format_sample(std::string& out, const char *name,
+            const char *suffix, const std::string& labels, uint64_t v);
+        static void format_sample(std::string& out, const char *name,
+            const char *suffix, const std::string& labels, double v);
+
+        /// ends the exposition and returns it
+        std::string& finish();
+
+        /*! formats a label set, e.g., {bs_id="1",rnti="2"}, escaping the
+         * values. An empty set gives an empty string */
+        static std::string labels(
+            std::initializer_list<std::pair<const char *, std::string>> l);
+        /// true if an Accept header asks for the OpenMetrics format
+        static bool accepts_openmetrics(const std::string& accept);
+
+      private:
+        const format format_;
+        std::string out_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* METRICS_H_ */
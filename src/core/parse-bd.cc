@@ -22,8 +22,10 @@
  *  \email   robert.schmidt@eurecom.fr
  */
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <thread>
 #include "recorder.h"
 #include "flexran_log.h"
 
@@ -31,7 +33,7 @@ void usage(char *pr_name)
 {
   std::cerr << "parse-bd: parse binary dumps from the FlexRAN RTController recorder app.\n";
   std::cerr << "usage: " << pr_name << " <input> <output> [<type>]\n";
-  std::cerr << "  <input>  is a binary file generated by the recorder app\n";
+  std::cerr << "  <input>  is a binary file generated by the recorder app (bin or delta)\n";
   std::cerr << "  <output> is a JSON output file\n";
   std::cerr << "  <type>   is an optional format of: all, enb, stats\n";
 }
@@ -59,14 +61,17 @@ int main(int argc, char *argv[])
     std::string format{argv[3]};
     if (format == "all")        info.type = flexran::app::log::job_type::all;
     else if (format == "enb")   info.type = flexran::app::log::job_type::enb;
-    else if (format == "stats") info.type = flexran::app::log::job_type::enb;
+    else if (format == "stats") info.type = flexran::app::log::job_type::stats;
     else {
       LOG4CXX_ERROR(flog::core, "parse-bd: illegal format " << format
           << ", using all");
     }
   }
 
-  flexran::app::log::recorder::write_json(info, v);
+  /* the chunks are rendered on all CPUs */
+  flexran::core::background_executor executor(
+      std::max(1u, std::thread::hardware_concurrency()));
+  flexran::app::log::recorder::write_json(info, v, &executor);
 
   return 0;
 }
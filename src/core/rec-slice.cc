@@ -0,0 +1,151 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    rec-slice.cc
+ *  \brief   extracts time slices of recording files as JSON
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include "recording_file.h"
+#include "flexran_log.h"
+
+namespace alog = flexran::app::log;
+
+void usage(char *pr_name)
+{
+  std::cerr << "rec-slice: extract time slices from recording files of the FlexRAN RTController recorder app.\n";
+  std::cerr << "usage: " << pr_name << " [-l] [-b <bs_id>] [-f <tick>] [-t <tick>] [-y <type>] <input> [<output>]\n";
+  std::cerr << "  -l         lists the BSs and ticks in <input>\n";
+  std::cerr << "  -b <bs_id> only extracts this BS\n";
+  std::cerr << "  -f <tick>  first tick to extract (default: first in recording)\n";
+  std::cerr << "  -t <tick>  last tick to extract (default: last in recording)\n";
+  std::cerr << "  -y <type>  is an optional format of: all, enb, stats\n";
+  std::cerr << "  <input>    is a recording file generated by a delta job\n";
+  std::cerr << "  <output>   is a JSON output file (default: stdout), an object\n";
+  std::cerr << "             with one chunk per tick\n";
+}
+
+int main(int argc, char *argv[])
+{
+  std::string path = "";
+  if(const char* env_p = std::getenv("FLEXRAN_RTC_HOME")) path = env_p;
+  else path = "../";
+  flexran_log::PropertyConfigurator::configure(path + "/log_config/basic_log");
+
+  bool list = false;
+  bool one_bs = false;
+  uint64_t bs_id = 0;
+  uint64_t t0 = 0;
+  uint64_t t1 = UINT64_MAX;
+  alog::job_type type = alog::job_type::all;
+  int opt;
+  try {
+    while ((opt = getopt(argc, argv, "lb:f:t:y:")) != -1) {
+      switch (opt) {
+        case 'l': list = true; break;
+        case 'b': one_bs = true; bs_id = std::stoull(optarg); break;
+        case 'f': t0 = std::stoull(optarg); break;
+        case 't': t1 = std::stoull(optarg); break;
+        case 'y': {
+          const std::string format{optarg};
+          if (format == "all")        type = alog::job_type::all;
+          else if (format == "enb")   type = alog::job_type::enb;
+          else if (format == "stats") type = alog::job_type::stats;
+          else {
+            usage(argv[0]);
+            return 1;
+          }
+          break;
+        }
+        default:
+          usage(argv[0]);
+          return 1;
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "rec-slice: illegal number: " << e.what() << "\n";
+    return 1;
+  }
+  if (optind >= argc || argc - optind > 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  alog::recording_file_reader reader;
+  if (!reader.open(argv[optind]))
+    return 1;
+
+  if (list) {
+    uint64_t first, last;
+    if (!reader.tick_range(first, last)) {
+      std::cout << "empty recording\n";
+      return 0;
+    }
+    std::cout << "ticks " << first << " to " << last << "\n";
+    for (uint64_t bs : reader.base_stations()) {
+      uint64_t chunks = 0, blocks = 0, bytes = 0;
+      for (const alog::index_entry& e : reader.index()) {
+        if (e.bs_id != bs) continue;
+        chunks += e.chunks;
+        blocks++;
+        bytes += e.size;
+      }
+      std::cout << "BS " << bs << ": " << chunks << " chunks in " << blocks
+                << " blocks (" << bytes << " bytes)\n";
+    }
+    return 0;
+  }
+
+  std::map<uint64_t, std::map<uint64_t, alog::bs_dump>> chunks;
+  bool ok;
+  if (one_bs) {
+    std::map<uint64_t, alog::bs_dump> bs_chunks;
+    ok = reader.read(bs_id, t0, t1, bs_chunks);
+    for (auto& c : bs_chunks)
+      chunks[c.first].emplace(bs_id, std::move(c.second));
+  } else {
+    ok = reader.read(t0, t1, chunks);
+  }
+  if (!ok)
+    return 1;
+  LOG4CXX_INFO(flog::app, "read " << chunks.size() << " data sets");
+
+  std::ofstream file;
+  if (argc - optind == 2) {
+    file.open(argv[optind + 1]);
+    if (!file.is_open()) {
+      LOG4CXX_ERROR(flog::core, "rec-slice: cannot open file " << argv[optind + 1]);
+      return 1;
+    }
+  }
+  std::ostream& out = file.is_open() ? file : std::cout;
+  out << "{";
+  for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+    if (it != chunks.begin()) out << ",";
+    out << "\"" << it->first << "\":";
+    alog::recorder::write_json_chunk(out, type, it->second, true);
+  }
+  out << "}\n";
+
+  return 0;
+}
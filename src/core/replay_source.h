@@ -0,0 +1,51 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    replay_source.h
+ *  \brief   interface for inputs that drive the controller in virtual time
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef REPLAY_SOURCE_H_
+#define REPLAY_SOURCE_H_
+
+#include <cstdint>
+
+namespace flexran {
+
+  namespace core {
+
+    /* In virtual time, the task manager does not wait for a timer. Instead,
+     * before running the RIB updater and the apps for a tick, it asks the
+     * replay source to inject everything that happened up to this tick. */
+    class replay_source {
+    public:
+      virtual ~replay_source() {}
+
+      /*! inject all input belonging to tick. Returns false once the source
+       * is exhausted and the controller can stop */
+      virtual bool feed(uint64_t tick) = 0;
+    };
+
+  }
+
+}
+
+#endif /* REPLAY_SOURCE_H_ */
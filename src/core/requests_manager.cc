@@ -37,6 +37,65 @@ void flexran::core::requests_manager::send_message(uint64_t bs_id,
     return;
   }
   /* TODO verify which agent really needs to receive this */
-  for (auto a : bs->get_agents())
-    net_xface_.send_msg(msg, a->agent_id);
+  for (auto a : bs->get_agents()) {
+    if (!net_xface_.send_msg(msg, a->agent_id))
+      continue;
+    /* send_msg() computed the size */
+    a->tx_packets.fetch_add(1, std::memory_order_relaxed);
+    a->tx_bytes.fetch_add(msg.GetCachedSize(), std::memory_order_relaxed);
+  }
+}
+
+void flexran::core::requests_manager::send_message(const std::vector<uint64_t>& bs_ids,
+    const protocol::flexran_message& msg) const
+{
+  const std::string serialized = msg.SerializeAsString();
+  for (uint64_t bs_id : bs_ids) {
+    auto bs = rib_.get_bs(bs_id);
+    if (!bs) {
+      LOG4CXX_ERROR(flog::core, "RequestsManager: unknown BS ID " << bs_id);
+      continue;
+    }
+    for (auto a : bs->get_agents()) {
+      if (!net_xface_.send_msg(serialized, a->agent_id))
+        continue;
+      a->tx_packets.fetch_add(1, std::memory_order_relaxed);
+      a->tx_bytes.fetch_add(serialized.size(), std::memory_order_relaxed);
+    }
+  }
+}
+
+uint32_t flexran::core::requests_manager::send_request(uint64_t bs_id,
+    protocol::flexran_message& msg, transaction_table::callback cb) const
+{
+  const uint32_t xid = transactions_->next_xid();
+  protocol::flex_header *h = transaction_table::mutable_header(msg);
+  if (h) h->set_xid(xid);
+  auto bs = rib_.get_bs(bs_id);
+  if (!bs) {
+    LOG4CXX_ERROR(flog::core, "RequestsManager: unknown BS ID " << bs_id);
+    return xid;
+  }
+  for (auto a : bs->get_agents()) {
+    /* tracked before sending, the reply might otherwise arrive first */
+    transactions_->add(a->agent_id, msg, cb);
+    if (!net_xface_.send_msg(msg, a->agent_id)) {
+      /* the request never left, so there is nothing to wait for */
+      transactions_->cancel(a->agent_id, xid);
+      continue;
+    }
+    a->tx_packets.fetch_add(1, std::memory_order_relaxed);
+    a->tx_bytes.fetch_add(msg.GetCachedSize(), std::memory_order_relaxed);
+  }
+  return xid;
+}
+
+uint32_t flexran::core::requests_manager::send_request(
+    const std::vector<uint64_t>& bs_ids, protocol::flexran_message& msg) const
+{
+  const uint32_t xid = transactions_->next_xid();
+  protocol::flex_header *h = transaction_table::mutable_header(msg);
+  if (h) h->set_xid(xid);
+  send_message(bs_ids, msg);
+  return xid;
 }
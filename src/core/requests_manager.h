@@ -25,7 +25,11 @@
 #ifndef REQUESTS_MANAGER_H_
 #define REQUESTS_MANAGER_H_
 
+#include <memory>
+#include <vector>
+
 #include "flexran.pb.h"
+#include "transaction_table.h"
 
 namespace flexran {
 
@@ -42,13 +46,33 @@ namespace flexran {
 
     public:
       requests_manager(flexran::rib::Rib& rib, flexran::network::async_xface& xface)
-        : rib_(rib), net_xface_(xface) {}
+        : rib_(rib), net_xface_(xface), transactions_(new transaction_table) {}
       
       void send_message(uint64_t bs_id, const protocol::flexran_message& msg) const;
+      //! sends the same message to many BSs, serializing it only once
+      void send_message(const std::vector<uint64_t>& bs_ids,
+          const protocol::flexran_message& msg) const;
+
+      /*! sends msg with a new xid to bs_id. If msg is a request that is
+       * answered (e.g., a configuration request), it is tracked in
+       * transactions() and cb called for the reply (or timeout) of every
+       * agent of the BS it was sent to; if sending to an agent fails, cb is
+       * not called for it. Returns the xid */
+      uint32_t send_request(uint64_t bs_id, protocol::flexran_message& msg,
+          transaction_table::callback cb = nullptr) const;
+      //! like send_message(bs_ids, msg), with a new xid
+      uint32_t send_request(const std::vector<uint64_t>& bs_ids,
+          protocol::flexran_message& msg) const;
+
+      //! a new xid, e.g., for requests sent through send_message()
+      uint32_t next_xid() const { return transactions_->next_xid(); }
+      transaction_table& transactions() const { return *transactions_; }
       
     private:
       const flexran::rib::Rib& rib_;
       flexran::network::async_xface& net_xface_;
+      /* shared with the RIB updater, which matches the replies */
+      std::unique_ptr<transaction_table> transactions_;
       
     };
 
@@ -40,8 +40,11 @@
 #include "rib_updater.h"
 #include "rib.h"
 #include "task_manager.h"
+#include "message_replay.h"
+#include "recording_replay.h"
 #include "subscription.h"
 #include "stats_manager.h"
+#include "stats_stream.h"
 #include "plmn_management.h"
 #include "rrm_management.h"
 //#include "remote_scheduler.h"
@@ -53,6 +56,7 @@
 #include "requests_manager.h"
 #include "rib_management.h"
 #include "recorder.h"
+#include "flight_recorder.h"
 
 //#ifdef NEO4J_SUPPORT
 //#include "neo4j_client.h"
@@ -70,7 +74,10 @@
 #include "rrm_calls.h"
 #include "rrc_triggering_calls.h"
 #include "stats_manager_calls.h"
+#include "stats_stream_calls.h"
 #include "recorder_calls.h"
+#include "flight_recorder_calls.h"
+#include "metrics_calls.h"
 #ifdef ELASTIC_SEARCH_SUPPORT
 #include "elastic_calls.h"
 #endif
@@ -86,6 +93,7 @@
 #include <stdio.h>
 
 #include "flexran_log.h"
+#include "async_log.h"
 
 std::atomic_bool g_exit_controller{false};
 
@@ -101,12 +109,31 @@ int main(int argc, char* argv[]) {
   int cport = 2210;
 #ifdef REST_NORTHBOUND
   int north_port = 9999;
+  int rest_threads = 2;
+  flexran::core::compression::options compression;
+  flexran::core::admission::options admission;
 #endif
   
   bool debug = false;
 
   bool expl_log_config = false;
 
+  flexran::core::timing_mode tm_mode = flexran::core::timing_mode::timer;
+  int sf_offset = 0;
+  std::string trace_file;
+  std::string replay_file;
+  std::string replay_recording;
+  double replay_speed = 0;
+  int record_compression = 1;
+  uint64_t flight_pre = 10000;
+  uint64_t flight_post = 2000;
+  size_t flight_max_mb = 16;
+
+  // RT placement profile
+  int prefault_mb = 0;
+  flexran::core::rt::placement net_placement, tm_placement, rest_placement,
+      app_placement;
+
   sigset_t sigmask;
   int rc, sig;
 
@@ -128,8 +155,56 @@ int main(int argc, char* argv[]) {
       ("help,h", "Prints this help message")
       ("nport,n", po::value<int>()->default_value(9999),
        "Port for northbound API calls")
+      ("rest-threads", po::value<int>()->default_value(2),
+       "Number of threads serving northbound API calls")
+      ("compression-level", po::value<int>()->default_value(6),
+       "gzip/deflate level (1-9) of northbound responses, 0 disables compression")
+      ("compression-min-size", po::value<size_t>()->default_value(1024),
+       "Smallest northbound response (in bytes) to compress")
+      ("nb-client-rate", po::value<double>()->default_value(0),
+       "Northbound requests per second per client, separately for control "
+       "and read requests; 0 disables the limit")
+      ("nb-client-burst", po::value<double>()->default_value(20),
+       "Burst of northbound requests per client")
+      ("nb-endpoint-rate", po::value<double>()->default_value(0),
+       "Northbound requests per second per endpoint over all clients; 0 "
+       "disables the limit")
+      ("nb-endpoint-burst", po::value<double>()->default_value(50),
+       "Burst of northbound requests per endpoint")
+      ("nb-max-heavy", po::value<size_t>()->default_value(0),
+       "Concurrent northbound statistics dumps; 0 disables the limit")
+      ("record-compression", po::value<int>()->default_value(1),
+       "deflate level (1-9) of delta recordings, 0 disables compression")
+      ("flight-pre", po::value<uint64_t>()->default_value(10000),
+       "Milliseconds of RAN state the flight recorder keeps before a trigger; "
+       "0 disables the flight recorder")
+      ("flight-post", po::value<uint64_t>()->default_value(2000),
+       "Milliseconds the flight recorder records after a trigger")
+      ("flight-max-mb", po::value<size_t>()->default_value(16),
+       "Memory (in MB) the flight recorder uses at most; less time is kept "
+       "before a trigger if it is exceeded")
       ("port,p", po::value<int>()->default_value(2210),
-       "Port for incoming agent connections");
+       "Port for incoming agent connections")
+      ("sf-sync,s", po::value<int>(), "Synchronize to the subframe triggers "
+       "of the BSs; apps run the given offset (in us) before each subframe")
+      ("sf-trigger", "Run the apps as soon as a subframe trigger of a BS "
+       "arrives, instead of on a 1ms timer")
+      ("trace,t", po::value<std::string>(), "Record all agent messages into "
+       "the given file for later replay")
+      ("replay,r", po::value<std::string>(), "Run in virtual time, replaying "
+       "the agent messages recorded in the given file")
+      ("replay-recording", po::value<std::string>(), "Run in virtual time "
+       "without agents, replaying the RAN state of the given file of the "
+       "recorder app into the RIB")
+      ("replay-speed", po::value<double>()->default_value(0), "Speed of a "
+       "replay as a multiple of real time; 0 replays as fast as possible")
+      ("rt-profile", po::value<int>()->implicit_value(64), "Lock all memory, "
+       "prefault the given heap size (in MiB) and thread stacks, and allocate "
+       "on the local NUMA node")
+      ("cpu-net", po::value<std::string>(), "CPUs for the network thread (e.g. 2,4-5)")
+      ("cpu-tm", po::value<std::string>(), "CPUs for the task manager thread")
+      ("cpu-rest", po::value<std::string>(), "CPUs for the REST threads")
+      ("cpu-apps", po::value<std::string>(), "CPUs for helper threads of apps");
     
     po::variables_map opts;
     po::store(po::parse_command_line(argc, argv, desc), opts);
@@ -158,8 +233,104 @@ int main(int argc, char* argv[]) {
     }
     
     cport = opts["port"].as<int>(); 
+    if (opts.count("sf-sync")) {
+      sf_offset = opts["sf-sync"].as<int>();
+      if (sf_offset < 0 || sf_offset >= 1000) {
+        std::cerr << "Error: subframe offset must be within [0,1000) us\n";
+        return 1;
+      }
+      tm_mode = flexran::core::timing_mode::sf_sync;
+    }
+    if (opts.count("sf-trigger")) {
+      if (opts.count("sf-sync")) {
+        std::cerr << "Error: cannot synchronize to subframes and triggers at the same time\n";
+        return 1;
+      }
+      tm_mode = flexran::core::timing_mode::sf_trigger;
+    }
+    if (opts.count("trace"))
+      trace_file = opts["trace"].as<std::string>();
+    if (opts.count("replay")) {
+      if (opts.count("sf-sync") || opts.count("sf-trigger")) {
+        std::cerr << "Error: cannot replay in subframe-synchronous mode\n";
+        return 1;
+      }
+      replay_file = opts["replay"].as<std::string>();
+      tm_mode = flexran::core::timing_mode::virtual_time;
+    }
+    if (opts.count("replay-recording")) {
+      if (opts.count("sf-sync") || opts.count("sf-trigger") || opts.count("replay")) {
+        std::cerr << "Error: cannot replay a recording in subframe-synchronous "
+                  << "mode or together with agent messages\n";
+        return 1;
+      }
+      replay_recording = opts["replay-recording"].as<std::string>();
+      tm_mode = flexran::core::timing_mode::virtual_time;
+    }
+    replay_speed = opts["replay-speed"].as<double>();
+    if (replay_speed < 0) {
+      std::cerr << "Error: replay speed must not be negative\n";
+      return 1;
+    }
+
+    if (opts.count("rt-profile")) {
+      prefault_mb = opts["rt-profile"].as<int>();
+      if (prefault_mb < 0) {
+        std::cerr << "Error: heap size to prefault must be positive\n";
+        return 1;
+      }
+      net_placement.prefault = true;
+      tm_placement.prefault = true;
+    }
+    const std::vector<std::pair<std::string, flexran::core::rt::placement *>> cpu_opts = {
+      {"cpu-net", &net_placement}, {"cpu-tm", &tm_placement},
+      {"cpu-rest", &rest_placement}, {"cpu-apps", &app_placement}
+    };
+    for (auto& o : cpu_opts) {
+      if (!opts.count(o.first))
+        continue;
+      std::string error_reason;
+      if (!flexran::core::rt::parse_cpu_list(opts[o.first].as<std::string>(),
+            o.second->cpus, error_reason)) {
+        std::cerr << "Error: --" << o.first << ": " << error_reason << "\n";
+        return 1;
+      }
+    }
+    flight_pre = opts["flight-pre"].as<uint64_t>();
+    flight_post = opts["flight-post"].as<uint64_t>();
+    flight_max_mb = opts["flight-max-mb"].as<size_t>();
+    if (flight_pre > 0 && flight_max_mb == 0) {
+      std::cerr << "Error: the flight recorder needs memory (--flight-max-mb)\n";
+      return 1;
+    }
+    record_compression = opts["record-compression"].as<int>();
+    if (record_compression < 0 || record_compression > 9) {
+      std::cerr << "Error: record compression level must be between 0 and 9\n";
+      return 1;
+    }
 #ifdef REST_NORTHBOUND
     north_port = opts["nport"].as<int>();
+    rest_threads = opts["rest-threads"].as<int>();
+    if (rest_threads < 1) {
+      std::cerr << "Error: need at least one REST thread\n";
+      return 1;
+    }
+    compression.level = opts["compression-level"].as<int>();
+    if (compression.level < 0 || compression.level > 9) {
+      std::cerr << "Error: compression level must be between 0 and 9\n";
+      return 1;
+    }
+    compression.min_size = opts["compression-min-size"].as<size_t>();
+    admission.client_rate = opts["nb-client-rate"].as<double>();
+    admission.client_burst = opts["nb-client-burst"].as<double>();
+    admission.endpoint_rate = opts["nb-endpoint-rate"].as<double>();
+    admission.endpoint_burst = opts["nb-endpoint-burst"].as<double>();
+    admission.max_heavy = opts["nb-max-heavy"].as<size_t>();
+    if (admission.client_rate < 0 || admission.endpoint_rate < 0
+        || admission.client_burst < 1 || admission.endpoint_burst < 1) {
+      std::cerr << "Error: northbound rates must not be negative, bursts at least 1\n";
+      return 1;
+    }
 #endif
     
   } catch(std::exception& e) {
@@ -182,8 +353,27 @@ int main(int argc, char* argv[]) {
   LOG4CXX_WARN(flog::core, "Compiled with profiling support (send USR2 to controller)");
 #endif
     
-  LOG4CXX_INFO(flog::core, "Listening on port " << cport << " for incoming agent connections");
+  if (net_placement.prefault) {
+    std::string error_reason;
+    if (!flexran::core::rt::lock_memory(error_reason))
+      LOG4CXX_ERROR(flog::core, "Cannot lock memory: " << error_reason);
+    flexran::core::rt::prefault_heap(static_cast<size_t>(prefault_mb) << 20);
+    LOG4CXX_INFO(flog::core, "Memory locked, prefaulted " << prefault_mb
+        << " MiB of heap");
+  }
+  /* helper threads of apps inherit the placement of the (RT) thread that
+   * creates them; without explicit CPUs, they go back to the CPUs the
+   * controller was started on */
+  if (app_placement.cpus.empty())
+    flexran::core::rt::get_cpu_affinity(app_placement.cpus);
+  flexran::core::rt::set_background_placement(app_placement);
+
   flexran::network::async_xface net_xface(cport);
+  /* in a replay, no agent must interfere */
+  if (tm_mode == flexran::core::timing_mode::virtual_time)
+    net_xface.set_offline();
+  else
+    LOG4CXX_INFO(flog::core, "Listening on port " << cport << " for incoming agent connections");
   
   // Create the rib
   flexran::rib::Rib rib;
@@ -196,17 +386,69 @@ int main(int argc, char* argv[]) {
 
   // Create the rib update manager
   flexran::rib::rib_updater r_updater(rib, net_xface, rm, ev);
+  if (!trace_file.empty()) {
+    std::string error_reason;
+    auto trace = std::make_shared<flexran::network::message_trace_writer>();
+    if (!trace->open(trace_file, error_reason)) {
+      LOG4CXX_FATAL(flog::core, "Cannot record messages: " << error_reason);
+      return 1;
+    }
+    LOG4CXX_INFO(flog::core, "Recording agent messages to " << trace_file);
+    r_updater.set_message_trace(trace);
+  }
+
+  std::shared_ptr<flexran::core::replay_source> replay;
+  if (!replay_file.empty()) {
+    std::string error_reason;
+    auto messages = std::make_shared<flexran::core::message_replay>(net_xface);
+    if (!messages->open(replay_file, error_reason)) {
+      LOG4CXX_FATAL(flog::core, "Cannot replay messages: " << error_reason);
+      return 1;
+    }
+    LOG4CXX_INFO(flog::core, "Replaying agent messages from " << replay_file);
+    replay = messages;
+  }
+  if (!replay_recording.empty()) {
+    std::string error_reason;
+    auto recording = std::make_shared<flexran::app::log::recording_replay>(rib, ev);
+    if (!recording->open(replay_recording, error_reason)) {
+      LOG4CXX_FATAL(flog::core, "Cannot replay recording: " << error_reason);
+      return 1;
+    }
+    LOG4CXX_INFO(flog::core, "Replaying recording " << replay_recording);
+    replay = recording;
+  }
+
+  // Create the executor for background work of apps
+  flexran::core::background_executor executor;
+
+  // Create the queue through which the northbound modifies apps and RIB
+  flexran::core::command_queue commands;
 
   // Create the task manager
-  flexran::core::task_manager tm(r_updater, ev);
+  flexran::core::task_manager tm(r_updater, ev, rib, executor, commands,
+      tm_mode, std::chrono::microseconds(sf_offset), replay, replay_speed);
+  if (tm_mode == flexran::core::timing_mode::sf_trigger)
+    tm.set_sf_trigger_fd(net_xface.enable_sf_trigger_notification());
 
   // Register any applications that we might want to execute in the controller
   auto stats_app = std::make_shared<flexran::app::stats::stats_manager>(rib, rm, ev);
+  auto stats_stream = std::make_shared<flexran::app::stats::stats_stream>(rib, rm, ev);
   auto plmn_management = std::make_shared<flexran::app::management::plmn_management>(rib, rm, ev);
   auto rrm_management = std::make_shared<flexran::app::management::rrm_management>(rib, rm, ev);
   auto rrc_trigger = std::make_shared<flexran::app::rrc::rrc_triggering>(rib, rm, ev);
   auto rib_management = std::make_shared<flexran::app::management::rib_management>(rib, rm, ev);
-  auto recorder = std::make_shared<flexran::app::log::recorder>(rib, rm, ev);
+  auto recorder = std::make_shared<flexran::app::log::recorder>(rib, rm, ev, executor,
+      record_compression);
+  std::shared_ptr<flexran::app::log::flight_recorder> flight_recorder;
+  if (flight_pre > 0) {
+    flight_recorder = std::make_shared<flexran::app::log::flight_recorder>(rib, rm, ev,
+        executor, flight_pre, flight_post, record_compression, flight_max_mb << 20);
+    rib_management->subscribe_bs_inactive([flight_recorder] (uint64_t bs_id) {
+        std::string id;
+        flight_recorder->trigger("BS " + std::to_string(bs_id) + " inactive", id);
+      });
+  }
 
   /* More examples of developed applications are available in the commented section.
      WARNING: Some of them might still contain bugs or might be from previous versions of the controller. */
@@ -231,17 +473,27 @@ int main(int argc, char* argv[]) {
     exit(rc);
   }
 
+  // Log messages from the RT threads are written by a background thread
+  flexran::core::async_log::start();
+
+  net_xface.set_placement("network", net_placement);
+  tm.set_placement("task_manager", tm_placement);
+
   // Start the task manager thread
   std::thread task_manager_thread(&flexran::core::task_manager::execute_task, &tm);
 
   // Start the network thread
-  std::thread networkThread(&flexran::network::async_xface::execute_task, &net_xface);
+  std::thread networkThread;
+  if (!net_xface.is_offline())
+    networkThread = std::thread(&flexran::network::async_xface::execute_task, &net_xface);
 
 #ifdef REST_NORTHBOUND
   // Set the port and the IP to listen for REST calls and initialize the call manager
   Pistache::Port port(north_port);
   Pistache::Address addr(Pistache::Ipv4::any(), port);
-  flexran::north_api::manager::call_manager north_api(addr);
+  flexran::north_api::manager::call_manager north_api(addr, commands);
+  north_api.set_compression(compression);
+  north_api.set_admission(admission);
 
   flexran::north_api::plmn_calls plmn_calls(plmn_management);
   north_api.register_calls(plmn_calls);
@@ -249,27 +501,51 @@ int main(int argc, char* argv[]) {
   north_api.register_calls(rrm_calls);
   flexran::north_api::stats_manager_calls stats_calls(stats_app);
   north_api.register_calls(stats_calls);
+  flexran::north_api::stats_stream_calls stats_stream_calls(stats_stream);
+  north_api.register_calls(stats_stream_calls);
   flexran::north_api::recorder_calls recorder_calls(recorder);
   north_api.register_calls(recorder_calls);
+  std::unique_ptr<flexran::north_api::flight_recorder_calls> flight_calls;
+  if (flight_recorder) {
+    flight_calls.reset(new flexran::north_api::flight_recorder_calls(flight_recorder));
+    north_api.register_calls(*flight_calls);
+  }
   flexran::north_api::rrc_triggering_calls rrc_calls(rrc_trigger);
   north_api.register_calls(rrc_calls);
+  flexran::north_api::metrics_calls metrics_calls(stats_app, tm, commands,
+      executor, net_xface, rm);
+  north_api.register_calls(metrics_calls);
 #ifdef ELASTIC_SEARCH_SUPPORT
   flexran::north_api::elastic_calls elastic_calls(elastic);
   north_api.register_calls(elastic_calls);
 #endif
 
   // Start the call manager threaded. Once task_manager_thread and
-  // networkThread return, north_api will be shut down too
-  north_api.init(1);
+  // networkThread return, north_api will be shut down too. The REST threads
+  // are created by Pistache and inherit the affinity of this thread
+  std::vector<int> main_cpus;
+  flexran::core::rt::get_cpu_affinity(main_cpus);
+  if (!rest_placement.cpus.empty()) {
+    std::string error_reason;
+    if (!flexran::core::rt::set_cpu_affinity(rest_placement.cpus, error_reason))
+      LOG4CXX_ERROR(flog::core, "Cannot set REST CPUs: " << error_reason);
+  }
+  north_api.init(rest_threads);
   north_api.start();
+  LOG4CXX_INFO(flog::core, "REST placement: " << flexran::core::rt::describe_placement());
+  if (!rest_placement.cpus.empty()) {
+    std::string error_reason;
+    flexran::core::rt::set_cpu_affinity(main_cpus, error_reason);
+  }
   LOG4CXX_INFO(flog::core, "Listening on port " << north_port << " for incoming"
-      << " REST connections");
+      << " REST connections (" << rest_threads << " threads)");
 #endif
 
-  // handle SIGINT and SIGUSR1 as end signals
+  // handle SIGINT and SIGUSR1 as end signals, SIGHUP dumps the flight recorder
   sigemptyset(&sigmask);
   sigaddset(&sigmask, SIGINT);
   sigaddset(&sigmask, SIGUSR1);
+  sigaddset(&sigmask, SIGHUP);
 #ifdef PROFILE
   sigaddset(&sigmask, SIGUSR2);
 #endif
@@ -284,6 +560,14 @@ int main(int argc, char* argv[]) {
     if (sig == SIGINT || sig == SIGUSR1 || sig == SIGTERM) {
       g_exit_controller = true;
     }
+    if (sig == SIGHUP && flight_recorder) {
+      try {
+        std::string id;
+        commands.run([&] { return flight_recorder->trigger("signal", id); });
+      } catch (const std::runtime_error& e) {
+        LOG4CXX_ERROR(flog::core, "cannot trigger flight recorder: " << e.what());
+      }
+    }
 #ifdef PROFILE
     if (sig == SIGUSR2) {
       if (!g_doprof) {
@@ -298,6 +582,9 @@ int main(int argc, char* argv[]) {
 
   if (task_manager_thread.joinable())
     task_manager_thread.join();
+
+  // finish pending background work, e.g., recordings being written
+  executor.shutdown();
   
   net_xface.end();
   if (networkThread.joinable())
@@ -307,6 +594,10 @@ int main(int argc, char* argv[]) {
   north_api.shutdown();
 #endif
 
+  flexran::core::async_log::stop();
+  if (flexran::core::async_log::dropped() > 0)
+    LOG4CXX_WARN(flog::core, "Dropped " << flexran::core::async_log::dropped()
+        << " log messages");
   LOG4CXX_INFO(flog::core, "Exiting FlexRAN RTController, bye.");
 
   return 0;
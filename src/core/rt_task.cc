@@ -101,6 +101,13 @@ void flexran::core::rt::rt_task::set_scheduling_policy(Policy pol,
 
 #endif
 
+void flexran::core::rt::rt_task::set_placement(const std::string& name,
+    const placement& p)
+{
+  name_ = name;
+  placement_ = p;
+}
+
 void flexran::core::rt::rt_task::execute_task() {
 #ifdef LOWLATENCY
   
@@ -114,5 +121,14 @@ void flexran::core::rt::rt_task::execute_task() {
 
 #endif
 
+  if (!name_.empty()) {
+    /* thread names are limited to 16 characters including \0 */
+    pthread_setname_np(pthread_self(), name_.substr(0, 15).c_str());
+    std::string error_reason;
+    if (!apply_placement(placement_, error_reason))
+      LOG4CXX_ERROR(flog::core, name_ << ": cannot apply placement: " << error_reason);
+    LOG4CXX_INFO(flog::core, name_ << " placement: " << describe_placement());
+  }
+
   run();
 }
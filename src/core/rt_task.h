@@ -55,10 +55,17 @@ namespace flexran {
             sched_time deadline = 0, sched_time period = 0);
 	
 	void execute_task();
+
+	/*! CPUs and memory placement applied when the task starts executing;
+	 * the name is given to the thread and used in the placement report */
+	void set_placement(const std::string& name, const placement& p);
 	
       private:
 	
 	virtual void run() = 0; 
+
+	std::string name_;
+	placement placement_;
 	
 #ifdef LOWLATENCY
   
@@ -25,6 +25,15 @@
 #include "rt_wrapper.h"
 #include <unistd.h> 
 #include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <mutex>
+#include <sched.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <linux/mempolicy.h>
+
+#include "flexran_log.h"
 
 static int latency_target_fd = -1;
 
@@ -97,6 +106,191 @@ void flexran::core::rt::check_clock(void) {
   }
 }
 
+bool flexran::core::rt::parse_cpu_list(const std::string& list,
+    std::vector<int>& cpus, std::string& error_reason)
+{
+  cpus.clear();
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    const size_t dash = item.find('-');
+    try {
+      size_t pos;
+      const int first = std::stoi(item.substr(0, dash), &pos);
+      if (pos != item.substr(0, dash).length())
+        throw std::invalid_argument(item);
+      int last = first;
+      if (dash != std::string::npos) {
+        last = std::stoi(item.substr(dash + 1), &pos);
+        if (pos != item.substr(dash + 1).length())
+          throw std::invalid_argument(item);
+      }
+      if (first < 0 || last < first || last >= CPU_SETSIZE) {
+        error_reason = "invalid CPU range " + item;
+        return false;
+      }
+      for (int c = first; c <= last; ++c)
+        cpus.push_back(c);
+    } catch (const std::exception& e) {
+      error_reason = "invalid CPU list entry '" + item + "'";
+      return false;
+    }
+  }
+  if (cpus.empty()) {
+    error_reason = "empty CPU list";
+    return false;
+  }
+  return true;
+}
+
+bool flexran::core::rt::get_cpu_affinity(std::vector<int>& cpus)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    return false;
+  cpus.clear();
+  for (int c = 0; c < CPU_SETSIZE; ++c)
+    if (CPU_ISSET(c, &set))
+      cpus.push_back(c);
+  return true;
+}
+
+bool flexran::core::rt::set_cpu_affinity(const std::vector<int>& cpus,
+    std::string& error_reason)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c : cpus)
+    CPU_SET(c, &set);
+  const int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (rc != 0) {
+    error_reason = std::string("pthread_setaffinity_np(): ") + std::strerror(rc);
+    return false;
+  }
+  return true;
+}
+
+bool flexran::core::rt::apply_placement(const placement& p,
+    std::string& error_reason)
+{
+  if (!p.cpus.empty() && !set_cpu_affinity(p.cpus, error_reason))
+    return false;
+  if (p.prefault) {
+    /* after pinning, so that first-touch places the stack locally */
+    if (!set_local_numa_policy(error_reason))
+      return false;
+    prefault_stack(256 * 1024);
+  }
+  return true;
+}
+
+bool flexran::core::rt::lock_memory(std::string& error_reason)
+{
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    error_reason = std::string("mlockall(): ") + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+void flexran::core::rt::prefault_heap(size_t size)
+{
+  /* keep freed memory in the heap instead of returning it to the OS, and
+   * serve large allocations from the heap instead of fresh mmap()s */
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+  char *buf = static_cast<char *>(malloc(size));
+  if (!buf)
+    return;
+  const long page = sysconf(_SC_PAGESIZE);
+  for (size_t i = 0; i < size; i += page)
+    buf[i] = 0;
+  free(buf);
+}
+
+void flexran::core::rt::prefault_stack(size_t size)
+{
+  volatile char *buf = static_cast<volatile char *>(alloca(size));
+  const long page = sysconf(_SC_PAGESIZE);
+  for (size_t i = 0; i < size; i += page)
+    buf[i] = 0;
+}
+
+bool flexran::core::rt::set_local_numa_policy(std::string& error_reason)
+{
+  /* no libnuma dependency: MPOL_LOCAL allocates on the node of the CPU the
+   * thread runs on, which is stable once the thread is pinned */
+  if (syscall(SYS_set_mempolicy, MPOL_LOCAL, NULL, 0) != 0) {
+    error_reason = std::string("set_mempolicy(): ") + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+std::string flexran::core::rt::describe_placement()
+{
+  std::stringstream ss;
+  std::vector<int> cpus;
+  if (get_cpu_affinity(cpus)) {
+    /* print consecutive CPUs as ranges */
+    ss << "CPUs ";
+    for (size_t i = 0; i < cpus.size(); ++i) {
+      size_t j = i;
+      while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+        ++j;
+      ss << (i > 0 ? "," : "") << cpus[i];
+      if (j > i)
+        ss << "-" << cpus[j];
+      i = j;
+    }
+  }
+  unsigned int cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+    ss << " (on CPU " << cpu << ", NUMA node " << node << ")";
+  struct sched_param sp;
+  int policy;
+  if (pthread_getschedparam(pthread_self(), &policy, &sp) == 0) {
+    ss << ", ";
+    switch (policy) {
+    case SCHED_FIFO:  ss << "SCHED_FIFO/" << sp.sched_priority; break;
+    case SCHED_RR:    ss << "SCHED_RR/" << sp.sched_priority; break;
+    case SCHED_OTHER: ss << "SCHED_OTHER"; break;
+    default:          ss << "policy " << policy; break;
+    }
+  }
+  return ss.str();
+}
+
+namespace {
+  std::mutex background_mutex;
+  flexran::core::rt::placement background;
+}
+
+void flexran::core::rt::set_background_placement(const placement& p)
+{
+  std::lock_guard<std::mutex> lg(background_mutex);
+  background = p;
+}
+
+void flexran::core::rt::become_background_thread()
+{
+  struct sched_param sp;
+  sp.sched_priority = 0;
+  int rc = pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+  if (rc != 0)
+    LOG4CXX_ERROR(flog::core, "cannot set background scheduling: "
+        << std::strerror(rc));
+
+  placement p;
+  {
+    std::lock_guard<std::mutex> lg(background_mutex);
+    p = background;
+  }
+  std::string error_reason;
+  if (!p.cpus.empty() && !set_cpu_affinity(p.cpus, error_reason))
+    LOG4CXX_ERROR(flog::core, "cannot move background thread: " << error_reason);
+}
 
 #ifdef LOWLATENCY
 int flexran::core::rt::sched_setattr(pid_t pid, const struct sched_attr *attr, unsigned int flags) {
@@ -36,6 +36,9 @@
 #include <syscall.h>
 #include <math.h>
 
+#include <string>
+#include <vector>
+
 namespace flexran {
 
   namespace core {
@@ -54,6 +57,49 @@ namespace flexran {
     
       void check_clock(void);
 
+      /* Placement of a thread: the CPUs it may run on and whether its stack
+       * should be prefaulted and its memory be allocated from the local NUMA
+       * node (both avoid page faults and remote accesses in the RT path) */
+      struct placement {
+        std::vector<int> cpus;
+        bool prefault = false;
+      };
+
+      //! parse a CPU list like "2,4-6" into its CPU numbers
+      bool parse_cpu_list(const std::string& list, std::vector<int>& cpus,
+          std::string& error_reason);
+
+      //! CPUs the calling thread may currently run on
+      bool get_cpu_affinity(std::vector<int>& cpus);
+
+      //! pin the calling thread to the given CPUs
+      bool set_cpu_affinity(const std::vector<int>& cpus, std::string& error_reason);
+
+      //! apply a placement to the calling thread
+      bool apply_placement(const placement& p, std::string& error_reason);
+
+      //! lock all current and future pages of the process into RAM
+      bool lock_memory(std::string& error_reason);
+
+      //! touch size bytes of heap that are then kept by malloc for later use
+      void prefault_heap(size_t size);
+
+      //! touch size bytes of the stack of the calling thread
+      void prefault_stack(size_t size);
+
+      //! make the calling thread allocate memory on its local NUMA node
+      bool set_local_numa_policy(std::string& error_reason);
+
+      //! human-readable CPU, NUMA node and scheduling of the calling thread
+      std::string describe_placement();
+
+      /*! placement for non-RT helper threads (e.g., file writers) that should
+       * run neither on the CPUs nor with the priority of the RT threads */
+      void set_background_placement(const placement& p);
+
+      //! move the calling thread to normal scheduling and the background CPUs
+      void become_background_thread();
+
 #ifdef LOWLATENCY
 
 #define SCHED_DEADLINE  6
@@ -24,11 +24,17 @@
 
 #include <vector>
 #include <thread>
+#include <algorithm>
+#include <stdexcept>
 #include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <cerrno>
 #include <iostream>
 
 #include "task_manager.h"
 #include "flexran_log.h"
+#include "async_log.h"
 
 extern std::atomic_bool g_exit_controller;
 
@@ -37,24 +43,45 @@ extern std::atomic_bool g_exit_controller;
 #include <fstream>
 #include <sstream>
 #include <iomanip>
-#ifdef LOWLATENCY
-#include <linux/types.h>
-#include <sched.h>
-#include <cerrno>
-#include <cstring>
-#endif
 
 extern std::atomic_bool g_doprof;
 extern std::chrono::time_point<std::chrono::steady_clock> start;
 #endif
 
 flexran::core::task_manager::task_manager(flexran::rib::rib_updater& r_updater,
-    flexran::event::subscription& ev)
-  : rt_task(Policy::FIFO, 80), r_updater_(r_updater), event_sub_(ev) {
+    flexran::event::subscription& ev, const flexran::rib::Rib& rib,
+    background_executor& executor, command_queue& commands, timing_mode mode,
+    std::chrono::microseconds sf_offset, std::shared_ptr<replay_source> source,
+    double replay_speed)
+  : rt_task(Policy::FIFO, 80), r_updater_(r_updater), event_sub_(ev),
+    rib_(rib), executor_(executor), commands_(commands), mode_(mode),
+    sf_offset_(sf_offset), source_(source), replay_speed_(replay_speed) {
   struct itimerspec its;
   
   sfd = timerfd_create(CLOCK_MONOTONIC, 0);
-  
+  last_wakeup_ = st_clock::now();
+
+  /* in sf_sync mode, the timer is armed anew in every cycle */
+  if (mode_ == timing_mode::sf_sync) {
+    LOG4CXX_INFO(flog::core, "task_manager: synchronizing to BS subframes, "
+        << "apps run " << sf_offset_.count() << " us before each subframe");
+    return;
+  }
+  if (mode_ == timing_mode::sf_trigger) {
+    LOG4CXX_INFO(flog::core, "task_manager: running apps on subframe triggers");
+    return;
+  }
+  if (mode_ == timing_mode::virtual_time) {
+    if (!source_)
+      throw std::invalid_argument("virtual time needs a replay source");
+    if (replay_speed_ > 0)
+      LOG4CXX_INFO(flog::core, "task_manager: running in virtual time at "
+          << replay_speed_ << "x real time");
+    else
+      LOG4CXX_INFO(flog::core, "task_manager: running in virtual time");
+    return;
+  }
+
   /* Start the timer */
   its.it_value.tv_sec = 0;
   its.it_value.tv_nsec = 1000 * 1000;
@@ -75,13 +102,16 @@ void flexran::core::task_manager::manage_rt_tasks()
   uint64_t t = 0;
   std::chrono::steady_clock::time_point loop_start;
   std::chrono::duration<float, std::micro> loop_dur;
+  unsigned int processed;
+  bool replay_done = false;
+  replay_start_ = st_clock::now();
+  sf_start_ = last_wakeup_ = replay_start_;
 #ifdef PROFILE
   std::chrono::steady_clock::time_point app_start;
   std::chrono::duration<float, std::micro> rib_dur, app_dur, inter_dur;
 
   std::unique_ptr<std::stringstream> ss(nullptr);
   int rounds = 10000;
-  unsigned int processed;
 #endif
 
   while (!g_exit_controller) {
@@ -90,11 +120,16 @@ void flexran::core::task_manager::manage_rt_tasks()
 #endif
     loop_start = std::chrono::steady_clock::now();
 
+    /* the RIB and the apps see the time of the tick, not the wall clock */
+    if (mode_ == timing_mode::virtual_time)
+      flexran::rib::set_virtual_clock(t);
+    if (mode_ == timing_mode::virtual_time && !replay_done && !source_->feed(t)) {
+      LOG4CXX_INFO(flog::core, "task_manager: replay finished at tick " << t);
+      replay_done = true;
+    }
+
     // First run the RIB updater
-#ifdef PROFILE
-    processed =
-#endif
-    r_updater_.run();
+    processed = r_updater_.run(t);
 
 #ifdef PROFILE
     app_start = std::chrono::steady_clock::now();
@@ -104,10 +139,18 @@ void flexran::core::task_manager::manage_rt_tasks()
     event_sub_.task_tick_(t);
     event_sub_.last_tick_ = t;
 
+    // Hand results of background work back to the apps
+    executor_.run_completions();
+
+    // Run commands of the northbound, e.g., policies posted to the REST API
+    commands_.run_pending();
+
     loop_dur = std::chrono::steady_clock::now() - loop_start;
     if (loop_dur.count() > 990)
-      LOG4CXX_WARN(flog::app, "task_manager: loop duration was "
-          << loop_dur.count() << " us");
+      FLOG_WARN(flog::app, "task_manager: loop duration was {} us", loop_dur.count());
+    loop_durations_.observe(loop_dur.count());
+    ticks_.fetch_add(1, std::memory_order_relaxed);
+    messages_.fetch_add(processed, std::memory_order_relaxed);
 #ifdef PROFILE
     app_dur = std::chrono::steady_clock::now() - app_start;
     loop_dur = std::chrono::steady_clock::now() - loop_start;
@@ -122,34 +165,34 @@ void flexran::core::task_manager::manage_rt_tasks()
       if (rounds == 0) {
         g_doprof = false;
         rounds = 10000;
-        std::thread t(flexran::core::task_manager::profiler_wb_thread, std::move(ss), event_sub_.task_tick_.num_slots());
-        t.detach();
+        std::shared_ptr<std::stringstream> prof(std::move(ss));
+        const size_t num_apps = event_sub_.task_tick_.num_slots();
+        if (!executor_.submit([prof, num_apps] () { profiler_wb_thread(prof, num_apps); }))
+          LOG4CXX_ERROR(flog::core, "cannot write profiling info: executor busy");
         LOG4CXX_WARN(flog::core, "profiling done");
         r_updater_.print_prof_results(std::chrono::steady_clock::now() - start);
       }
     }
 #endif
-    t++;
-    wait_for_cycle();
+    /* stop once the replayed messages have been processed */
+    if (replay_done && processed == 0) {
+      g_exit_controller = true;
+      /* wake up the main thread waiting for signals */
+      kill(getpid(), SIGUSR1);
+    }
+
+    t += wait_for_cycle();
   }
+  if (missed_ticks_ > 0)
+    LOG4CXX_WARN(flog::core, "task_manager: missed " << missed_ticks_
+        << " ticks in total");
 }
 
 
 #ifdef PROFILE
 void flexran::core::task_manager::profiler_wb_thread(
-    std::unique_ptr<std::stringstream> ss, size_t num_apps)
+    std::shared_ptr<std::stringstream> ss, size_t num_apps)
 {
-#ifdef LOWLATENCY
-  /* set back priority to standard */
-  struct sched_param sp;
-  sp.sched_priority = 0;
-  int ret = sched_setscheduler(0, SCHED_OTHER, &sp);
-  if (ret != 0) {
-    LOG4CXX_ERROR(flog::core, "error for sched_setscheduler(): "
-        << std::strerror(errno));
-  }
-#endif
-
   auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
   std::stringstream h;
   h << std::put_time(std::localtime(&now), "%H.%M.%S");
@@ -167,15 +210,159 @@ void flexran::core::task_manager::profiler_wb_thread(
 }
 #endif
 
-void flexran::core::task_manager::wait_for_cycle() {
+uint64_t flexran::core::task_manager::wait_for_cycle() {
   uint64_t exp;
   ssize_t res;
 
+  if (mode_ == timing_mode::sf_sync)
+    return wait_for_subframe();
+  if (mode_ == timing_mode::sf_trigger)
+    return wait_for_sf_trigger();
+  if (mode_ == timing_mode::virtual_time) {
+    /* tick n is due n / speed ms after the start; if the apps are slower,
+     * the virtual clock falls behind instead of skipping ticks */
+    if (replay_speed_ > 0) {
+      replay_ticks_++;
+      std::this_thread::sleep_until(replay_start_
+          + std::chrono::duration_cast<st_clock::duration>(
+              std::chrono::duration<double, std::milli>(replay_ticks_ / replay_speed_)));
+    }
+    return 1;
+  }
+
   if (sfd > 0) {
     res = read(sfd, &exp, sizeof(exp));
 
     if ((res < 0) || (res != sizeof(exp))) {
       LOG4CXX_ERROR(flog::core, "Failed in task manager timer wait");
+      return 1;
+    }
+    /* more than one expiration: the last cycle overran and the apps did not
+     * run for some ticks. Advance time accordingly so that the ticks stay in
+     * line with the wall clock */
+    if (exp > 1) {
+      missed_ticks_ += exp - 1;
+      FLOG_WARN(flog::core, "task_manager: missed {} ticks", exp - 1);
     }
+    return exp;
+  }
+  return 1;
+}
+
+std::shared_ptr<const flexran::rib::enb_rib_info>
+flexran::core::task_manager::reference_bs()
+{
+  /* keep the current reference as long as it is connected and synced */
+  if (ref_bs_ && ref_bs_->is_sf_synced() && rib_.has_eNB_config_entry(ref_bs_->get_id()))
+    return ref_bs_;
+
+  std::shared_ptr<const flexran::rib::enb_rib_info> old = ref_bs_;
+  ref_bs_.reset();
+  for (uint64_t bs_id : rib_.get_available_base_stations()) {
+    auto bs = rib_.get_bs(bs_id);
+    if (bs && bs->is_sf_synced()) {
+      ref_bs_ = bs;
+      break;
+    }
+  }
+  if (ref_bs_ && ref_bs_ != old)
+    LOG4CXX_INFO(flog::core, "task_manager: BS " << ref_bs_->get_id()
+        << " is new subframe timing reference");
+  else if (!ref_bs_ && old)
+    LOG4CXX_WARN(flog::core, "task_manager: no BS with subframe timing, "
+        << "falling back to 1ms timer");
+  return ref_bs_;
+}
+
+uint64_t flexran::core::task_manager::wait_for_subframe()
+{
+  const st_clock::time_point now = st_clock::now();
+  st_clock::time_point wakeup;
+  const st_clock::time_point last = last_wakeup_;
+
+  auto bs = reference_bs();
+  if (bs) {
+    /* the earliest subframe for which we are not late and which is not the
+     * one we just ran for (min. 0.5ms between consecutive cycles) */
+    st_clock::time_point earliest = std::max(now,
+        last_wakeup_ + std::chrono::microseconds(500));
+    wakeup = bs->next_subframe_start(earliest + sf_offset_) - sf_offset_;
+  } else {
+    wakeup = std::max(now, last_wakeup_ + std::chrono::milliseconds(1));
+  }
+  last_wakeup_ = wakeup;
+
+  /* number of subframes since the last cycle, rounded */
+  const uint64_t elapsed = std::max<int64_t>(1,
+      std::chrono::duration_cast<std::chrono::microseconds>(wakeup - last
+        + std::chrono::microseconds(500)).count() / 1000);
+  if (elapsed > 1) {
+    missed_ticks_ += elapsed - 1;
+    FLOG_WARN(flog::core, "task_manager: missed {} subframes", elapsed - 1);
+  }
+
+  if (wakeup <= now || sfd < 0)
+    return elapsed;
+
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      wakeup.time_since_epoch()).count();
+  struct itimerspec its;
+  its.it_value.tv_sec = ns / 1000000000;
+  its.it_value.tv_nsec = ns % 1000000000;
+  its.it_interval.tv_sec = 0;
+  its.it_interval.tv_nsec = 0;
+  if (timerfd_settime(sfd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+    LOG4CXX_ERROR(flog::core, "Failed to set subframe timer for task manager");
+    return elapsed;
+  }
+
+  uint64_t exp;
+  ssize_t res = read(sfd, &exp, sizeof(exp));
+  if ((res < 0) || (res != sizeof(exp))) {
+    LOG4CXX_ERROR(flog::core, "Failed in task manager subframe wait");
+  }
+  return elapsed;
+}
+
+uint64_t flexran::core::task_manager::wait_for_sf_trigger()
+{
+  /* triggers of other BSs shortly after the last cycle are absorbed by it;
+   * without any trigger, fall back to a slower timer */
+  const st_clock::time_point earliest = last_wakeup_ + std::chrono::microseconds(900);
+  const st_clock::time_point latest = last_wakeup_ + std::chrono::microseconds(1500);
+  st_clock::time_point now = st_clock::now();
+  const bool overrun = now >= latest;
+  while (now < latest) {
+    const auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(latest - now);
+    struct timespec ts;
+    ts.tv_sec = wait.count() / 1000000000;
+    ts.tv_nsec = wait.count() % 1000000000;
+    struct pollfd pfd = {sf_trigger_fd_, POLLIN, 0};
+    const int rc = ppoll(&pfd, sf_trigger_fd_ >= 0 ? 1 : 0, &ts, NULL);
+    now = st_clock::now();
+    if (rc < 0 && errno != EINTR) {
+      LOG4CXX_ERROR(flog::core, "Failed in task manager subframe trigger wait");
+      break;
+    }
+    if (rc <= 0)
+      continue;
+    uint64_t n;
+    if (read(sf_trigger_fd_, &n, sizeof(n)) < 0)
+      continue;
+    if (now >= earliest)
+      break;
+  }
+  last_wakeup_ = now;
+
+  /* ticks follow the wall clock since the start, rounded */
+  const uint64_t target = std::chrono::duration_cast<std::chrono::microseconds>(
+      now - sf_start_ + std::chrono::microseconds(500)).count() / 1000;
+  const uint64_t elapsed = target > sf_ticks_ ? target - sf_ticks_ : 1;
+  sf_ticks_ += elapsed;
+  /* without triggers, every other cycle spans two ticks */
+  if (elapsed > 1 && overrun) {
+    missed_ticks_ += elapsed - 1;
+    FLOG_WARN(flog::core, "task_manager: missed {} ticks", elapsed - 1);
   }
+  return elapsed;
 }
@@ -30,10 +30,15 @@
 #include "rt_wrapper.h"
 #include "component.h"
 #include "subscription.h"
+#include "replay_source.h"
+#include "background_executor.h"
+#include "command_queue.h"
+#include "metrics.h"
 
 #include <linux/types.h>
 #include <vector>
 #include <memory>
+#include <chrono>
 
 #include <sys/timerfd.h>
 
@@ -41,28 +46,93 @@ namespace flexran {
 
   namespace core {
 
+    enum class timing_mode {
+      //! free-running 1ms timer, independent of any BS
+      timer,
+      /*! follow the subframe triggers (flex_sf_trigger) of a reference BS and
+       * run the apps a fixed offset before each of its subframes */
+      sf_sync,
+      /*! run the apps as soon as a subframe trigger of any BS arrives (see
+       * async_xface::enable_sf_trigger_notification()), at most every
+       * 0.9ms and at the latest 1.5ms after the last cycle */
+      sf_trigger,
+      /*! do not wait between ticks but run as fast as possible, or paced
+       * at a multiple of real time, with all input coming from a
+       * replay_source: the apps see the same sequence of messages and ticks
+       * in every run */
+      virtual_time
+    };
+
     class task_manager : public rt::rt_task {
     public:
 
-      task_manager(flexran::rib::rib_updater& r_updater, flexran::event::subscription& ev);
+      task_manager(flexran::rib::rib_updater& r_updater,
+          flexran::event::subscription& ev,
+          const flexran::rib::Rib& rib,
+          background_executor& executor,
+          command_queue& commands,
+          timing_mode mode = timing_mode::timer,
+          std::chrono::microseconds sf_offset = std::chrono::microseconds(0),
+          std::shared_ptr<replay_source> source = nullptr,
+          double replay_speed = 0);
 
       void manage_rt_tasks();
 
+      //! eventfd signalling subframe triggers, for timing_mode::sf_trigger
+      void set_sf_trigger_fd(int fd) { sf_trigger_fd_ = fd; }
+
+      //! number of ticks that elapsed without running the apps (overruns)
+      uint64_t missed_ticks() const { return missed_ticks_; }
+      //! number of ticks in which the apps ran
+      uint64_t num_ticks() const { return ticks_; }
+      //! number of agent messages processed by the RIB updater
+      uint64_t num_messages() const { return messages_; }
+      //! durations of all loops (RIB update, apps, commands), in us
+      const metrics::histogram& loop_durations() const { return loop_durations_; }
+
     private:
       
       void run();
   
-      void wait_for_cycle();
+      uint64_t wait_for_cycle();
+
+      uint64_t wait_for_subframe();
+      uint64_t wait_for_sf_trigger();
+      std::shared_ptr<const flexran::rib::enb_rib_info> reference_bs();
 
 #ifdef PROFILE
-      static void profiler_wb_thread(std::unique_ptr<std::stringstream> ss, size_t num_app);
+      static void profiler_wb_thread(std::shared_ptr<std::stringstream> ss, size_t num_app);
 #endif
       
       flexran::rib::rib_updater& r_updater_;
       flexran::event::subscription& event_sub_;
+      const flexran::rib::Rib& rib_;
+      background_executor& executor_;
+      command_queue& commands_;
 
       int sfd;
 
+      const timing_mode mode_;
+      /* in sf_sync mode, time by which the apps run before the subframe */
+      const std::chrono::microseconds sf_offset_;
+      std::shared_ptr<const flexran::rib::enb_rib_info> ref_bs_;
+      st_clock::time_point last_wakeup_;
+      /* in sf_trigger mode, ticks are counted from sf_start_ */
+      int sf_trigger_fd_ = -1;
+      st_clock::time_point sf_start_;
+      uint64_t sf_ticks_ = 0;
+
+      std::shared_ptr<replay_source> source_;
+      /* in virtual time, ticks per ms of wall clock (0: as fast as
+       * possible), counted from replay_start_ */
+      const double replay_speed_;
+      st_clock::time_point replay_start_;
+      uint64_t replay_ticks_ = 0;
+      std::atomic<uint64_t> missed_ticks_{0};
+      std::atomic<uint64_t> ticks_{0};
+      std::atomic<uint64_t> messages_{0};
+      metrics::histogram loop_durations_{{100, 250, 500, 750, 900, 990, 1500, 3000, 10000}};
+
     };
   }
 }
@@ -0,0 +1,289 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    transaction_table.cc
+ *  \brief   correlation of agent requests and replies through their xid
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include "transaction_table.h"
+#include "flexran_log.h"
+
+namespace {
+  typedef protocol::flexran_message::MsgCase msg_case;
+
+  /// the oneof field name of a message type, e.g., enb_config_request_msg
+  std::string case_name(msg_case c)
+  {
+    const google::protobuf::FieldDescriptor *fd =
+        protocol::flexran_message::descriptor()->FindFieldByNumber(c);
+    return fd ? fd->name() : "unknown";
+  }
+}
+
+constexpr const uint32_t flexran::core::transaction_table::first_xid;
+
+flexran::core::transaction_table::transaction_table(uint64_t timeout_ms)
+  : timeout_(timeout_ms),
+    wheel_(timeout_ms + 1)
+{
+}
+
+uint32_t flexran::core::transaction_table::next_xid()
+{
+  uint32_t xid = next_xid_;
+  uint32_t next;
+  do {
+    next = xid == UINT32_MAX ? first_xid : xid + 1;
+  } while (!next_xid_.compare_exchange_weak(xid, next));
+  return xid;
+}
+
+protocol::flexran_message::MsgCase flexran::core::transaction_table::reply_case(
+    const protocol::flexran_message& request)
+{
+  switch (request.msg_case()) {
+    case protocol::flexran_message::kEchoRequestMsg:
+      return protocol::flexran_message::kEchoReplyMsg;
+    case protocol::flexran_message::kEnbConfigRequestMsg:
+      return protocol::flexran_message::kEnbConfigReplyMsg;
+    case protocol::flexran_message::kUeConfigRequestMsg:
+      return protocol::flexran_message::kUeConfigReplyMsg;
+    case protocol::flexran_message::kLcConfigRequestMsg:
+      return protocol::flexran_message::kLcConfigReplyMsg;
+    case protocol::flexran_message::kStatsRequestMsg:
+      /* periodic statistics are a subscription, not a transaction */
+      if (request.stats_request_msg().has_complete_stats_request()
+          && request.stats_request_msg().complete_stats_request().report_frequency()
+              == protocol::FLSRF_ONCE)
+        return protocol::flexran_message::kStatsReplyMsg;
+      return protocol::flexran_message::MSG_NOT_SET;
+    default:
+      return protocol::flexran_message::MSG_NOT_SET;
+  }
+}
+
+const protocol::flex_header *flexran::core::transaction_table::header(
+    const protocol::flexran_message& msg)
+{
+  /* every message has its header as field "header" */
+  const google::protobuf::FieldDescriptor *fd =
+      msg.GetDescriptor()->FindFieldByNumber(msg.msg_case());
+  if (!fd) return nullptr;
+  const google::protobuf::Message& m = msg.GetReflection()->GetMessage(msg, fd);
+  const google::protobuf::FieldDescriptor *hfd = m.GetDescriptor()->FindFieldByName("header");
+  if (!hfd || !m.GetReflection()->HasField(m, hfd)) return nullptr;
+  return static_cast<const protocol::flex_header *>(&m.GetReflection()->GetMessage(m, hfd));
+}
+
+const protocol::flex_header *flexran::core::transaction_table::reply_header(
+    const protocol::flexran_message& msg)
+{
+  switch (msg.msg_case()) {
+    case protocol::flexran_message::kEchoReplyMsg:
+      return msg.echo_reply_msg().has_header() ? &msg.echo_reply_msg().header() : nullptr;
+    case protocol::flexran_message::kEnbConfigReplyMsg:
+      return msg.enb_config_reply_msg().has_header() ? &msg.enb_config_reply_msg().header() : nullptr;
+    case protocol::flexran_message::kUeConfigReplyMsg:
+      return msg.ue_config_reply_msg().has_header() ? &msg.ue_config_reply_msg().header() : nullptr;
+    case protocol::flexran_message::kLcConfigReplyMsg:
+      return msg.lc_config_reply_msg().has_header() ? &msg.lc_config_reply_msg().header() : nullptr;
+    case protocol::flexran_message::kStatsReplyMsg:
+      return msg.stats_reply_msg().has_header() ? &msg.stats_reply_msg().header() : nullptr;
+    default:
+      return nullptr;
+  }
+}
+
+protocol::flex_header *flexran::core::transaction_table::mutable_header(
+    protocol::flexran_message& msg)
+{
+  const google::protobuf::FieldDescriptor *fd =
+      msg.GetDescriptor()->FindFieldByNumber(msg.msg_case());
+  if (!fd) return nullptr;
+  google::protobuf::Message *m = msg.GetReflection()->MutableMessage(&msg, fd);
+  const google::protobuf::FieldDescriptor *hfd = m->GetDescriptor()->FindFieldByName("header");
+  if (!hfd) return nullptr;
+  return static_cast<protocol::flex_header *>(m->GetReflection()->MutableMessage(m, hfd));
+}
+
+void flexran::core::transaction_table::add(int agent_id,
+    const protocol::flexran_message& request, callback cb)
+{
+  const msg_case reply = reply_case(request);
+  const protocol::flex_header *h = header(request);
+  if (reply == protocol::flexran_message::MSG_NOT_SET || !h)
+    return;
+
+  std::lock_guard<std::mutex> lg(mutex_);
+  const uint64_t k = key(agent_id, h->xid());
+  const uint64_t deadline = now_ + timeout_;
+  auto r = outstanding_.emplace(k, transaction{request.msg_case(), reply, deadline,
+      std::chrono::steady_clock::now(), std::move(cb)});
+  if (!r.second) {
+    LOG4CXX_WARN(flog::core, "agent " << agent_id << ": xid " << h->xid()
+        << " is still outstanding, not tracking new "
+        << case_name(request.msg_case()));
+    return;
+  }
+  per_agent_[agent_id]++;
+  num_outstanding_++;
+  wheel_[deadline % wheel_.size()].push_back(k);
+}
+
+bool flexran::core::transaction_table::cancel(int agent_id, uint32_t xid)
+{
+  std::lock_guard<std::mutex> lg(mutex_);
+  auto it = outstanding_.find(key(agent_id, xid));
+  if (it == outstanding_.end())
+    return false;
+  /* its key in the wheel is dropped when the slot is reached */
+  erase(it);
+  return true;
+}
+
+bool flexran::core::transaction_table::complete(int agent_id,
+    const protocol::flexran_message& msg)
+{
+  if (num_outstanding_ == 0) return false;
+  const protocol::flex_header *h = reply_header(msg);
+  if (!h) return false;
+
+  callback cb;
+  {
+    std::lock_guard<std::mutex> lg(mutex_);
+    auto it = outstanding_.find(key(agent_id, h->xid()));
+    if (it == outstanding_.end() || it->second.reply != msg.msg_case())
+      return false;
+    const auto d = std::chrono::steady_clock::now() - it->second.sent;
+    latency(it->second.request).observe(
+        std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    cb = std::move(it->second.cb);
+    erase(it);
+  }
+  replies_++;
+  if (cb) cb(result::reply, &msg);
+  return true;
+}
+
+void flexran::core::transaction_table::expire(uint64_t tick)
+{
+  std::vector<callback> cbs;
+  {
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (tick <= now_) return;
+    /* after a long pause, every slot is visited once */
+    const uint64_t from = tick - now_ > wheel_.size() ? tick - wheel_.size() + 1 : now_ + 1;
+    for (uint64_t t = from; t <= tick; ++t) {
+      std::vector<uint64_t>& slot = wheel_[t % wheel_.size()];
+      size_t keep = 0;
+      for (uint64_t k : slot) {
+        auto it = outstanding_.find(k);
+        if (it == outstanding_.end())
+          continue;
+        if (it->second.deadline > tick) {
+          slot[keep++] = k;
+          continue;
+        }
+        LOG4CXX_WARN(flog::core, "agent " << (k >> 32) << ": no reply to "
+            << case_name(it->second.request) << " (xid " << (k & 0xffffffff)
+            << ") within " << timeout_ << " ms");
+        if (it->second.cb) cbs.push_back(std::move(it->second.cb));
+        erase(it);
+        timeouts_++;
+      }
+      slot.resize(keep);
+    }
+    now_ = tick;
+  }
+  for (auto& cb : cbs)
+    cb(result::timeout, nullptr);
+}
+
+void flexran::core::transaction_table::remove_agent(int agent_id)
+{
+  std::vector<callback> cbs;
+  {
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (per_agent_.find(agent_id) == per_agent_.end())
+      return;
+    for (auto it = outstanding_.begin(); it != outstanding_.end(); ) {
+      auto cur = it++;
+      if (static_cast<int>(cur->first >> 32) != agent_id)
+        continue;
+      if (cur->second.cb) cbs.push_back(std::move(cur->second.cb));
+      erase(cur);
+      disconnects_++;
+    }
+  }
+  for (auto& cb : cbs)
+    cb(result::disconnect, nullptr);
+}
+
+size_t flexran::core::transaction_table::num_outstanding(int agent_id) const
+{
+  std::lock_guard<std::mutex> lg(mutex_);
+  auto it = per_agent_.find(agent_id);
+  return it != per_agent_.end() ? it->second : 0;
+}
+
+void flexran::core::transaction_table::write_metrics(metrics::writer& w) const
+{
+  typedef metrics::writer writer;
+  w.family("flexran_agent_transactions_outstanding", "gauge",
+      "Requests to agents waiting for their reply");
+  w.gauge("flexran_agent_transactions_outstanding", "",
+      static_cast<uint64_t>(num_outstanding()));
+  w.family("flexran_agent_transactions", "counter",
+      "Requests to agents by how they completed");
+  w.counter("flexran_agent_transactions", writer::labels({{"result", "reply"}}),
+      num_replies());
+  w.counter("flexran_agent_transactions", writer::labels({{"result", "timeout"}}),
+      num_timeouts());
+  w.counter("flexran_agent_transactions", writer::labels({{"result", "disconnect"}}),
+      num_disconnects());
+
+  w.family("flexran_agent_request_latency_seconds", "histogram",
+      "Time from a request to its reply, by request type", "seconds");
+  std::lock_guard<std::mutex> lg(mutex_);
+  for (const auto& l : latencies_)
+    w.write("flexran_agent_request_latency_seconds",
+        writer::labels({{"type", case_name(l.first)}}), *l.second, 1e-6);
+}
+
+flexran::core::metrics::histogram& flexran::core::transaction_table::latency(
+    protocol::flexran_message::MsgCase request)
+{
+  std::unique_ptr<metrics::histogram>& h = latencies_[request];
+  if (!h)
+    h.reset(new metrics::histogram(
+        {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000}));
+  return *h;
+}
+
+void flexran::core::transaction_table::erase(
+    std::unordered_map<uint64_t, transaction>::iterator it)
+{
+  const int agent_id = static_cast<int>(it->first >> 32);
+  auto a = per_agent_.find(agent_id);
+  if (a != per_agent_.end() && --a->second == 0)
+    per_agent_.erase(a);
+  outstanding_.erase(it);
+  num_outstanding_--;
+}
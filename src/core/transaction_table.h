@@ -0,0 +1,154 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    transaction_table.h
+ *  \brief   correlation of agent requests and replies through their xid
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef TRANSACTION_TABLE_H_
+#define TRANSACTION_TABLE_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "flexran.pb.h"
+#include "metrics.h"
+
+namespace flexran {
+
+  namespace core {
+
+    /* Tracks requests to agents that are answered with a reply (e.g., a
+     * configuration request) until the reply arrives, the request times out,
+     * or the agent disconnects. Requests get unique xids, so that replies
+     * can be matched, and the latency from request to reply is recorded per
+     * message type.
+     * Timeouts are checked in a timer wheel advanced by the task manager's
+     * ticks (ms), i.e., they follow virtual time when replaying. All methods
+     * are thread-safe; callbacks are called without holding the lock, so
+     * they can send new requests. */
+    class transaction_table {
+    public:
+      enum class result { reply, timeout, disconnect };
+      /// reply is only set for result::reply
+      typedef std::function<void(result r, const protocol::flexran_message *reply)> callback;
+
+      /// xids below first_xid are never handed out, as messages that are
+      /// not sent through requests_manager::send_request() carry small xids
+      /// (e.g., 0). Statistics subscriptions get their xid from next_xid()
+      /// as well: they are not tracked, but identified by it at the agent
+      static constexpr const uint32_t first_xid = 1 << 16;
+
+      explicit transaction_table(uint64_t timeout_ms = 1000);
+
+      /// a unique xid, wrapping around to first_xid
+      uint32_t next_xid();
+
+      /*! the message type that answers request, or MSG_NOT_SET if it is
+       * not answered (e.g., reconfigurations, periodic statistics) */
+      static protocol::flexran_message::MsgCase reply_case(
+          const protocol::flexran_message& request);
+      /// the header of msg, nullptr if it has none
+      static const protocol::flex_header *header(const protocol::flexran_message& msg);
+      static protocol::flex_header *mutable_header(protocol::flexran_message& msg);
+
+      /*! tracks request (with its xid already set) sent to agent_id. Does
+       * nothing if the request is not answered (see reply_case()) */
+      void add(int agent_id, const protocol::flexran_message& request,
+          callback cb = nullptr);
+
+      /*! stops tracking the request with xid to agent_id without calling its
+       * callback, e.g., if it could not be sent. Returns false if there is
+       * no such request */
+      bool cancel(int agent_id, uint32_t xid);
+
+      /*! matches a message received from agent_id to an outstanding request.
+       * Returns true if it was a reply to one */
+      bool complete(int agent_id, const protocol::flexran_message& msg);
+
+      /// times out all requests whose deadline is at or before tick
+      void expire(uint64_t tick);
+
+      /// completes all requests to agent_id with result::disconnect
+      void remove_agent(int agent_id);
+
+      size_t num_outstanding() const { return num_outstanding_; }
+      size_t num_outstanding(int agent_id) const;
+      uint64_t num_replies() const { return replies_; }
+      uint64_t num_timeouts() const { return timeouts_; }
+      uint64_t num_disconnects() const { return disconnects_; }
+
+      /// writes the counters and request latencies (per request type)
+      void write_metrics(metrics::writer& w) const;
+
+    private:
+      struct transaction {
+        protocol::flexran_message::MsgCase request;
+        protocol::flexran_message::MsgCase reply;
+        uint64_t deadline;
+        std::chrono::steady_clock::time_point sent;
+        callback cb;
+      };
+      static uint64_t key(int agent_id, uint32_t xid)
+      { return static_cast<uint64_t>(static_cast<uint32_t>(agent_id)) << 32 | xid; }
+
+      /* the header of msg if it is of a type that answers a request (see
+       * reply_case()), otherwise nullptr. Reads the header directly, so
+       * that the many other messages cost no reflection */
+      static const protocol::flex_header *reply_header(
+          const protocol::flexran_message& msg);
+
+      /* all following functions expect mutex_ to be held */
+      metrics::histogram& latency(protocol::flexran_message::MsgCase request);
+      void erase(std::unordered_map<uint64_t, transaction>::iterator it);
+
+      const uint64_t timeout_;
+      std::atomic<uint32_t> next_xid_{first_xid};
+      /* size of outstanding_, to skip the lookup for the many messages
+       * that are not replies */
+      std::atomic<size_t> num_outstanding_{0};
+
+      mutable std::mutex mutex_;
+      std::unordered_map<uint64_t, transaction> outstanding_;
+      std::map<int, size_t> per_agent_;
+      /* timer wheel: slot t % size holds the keys of requests with deadline
+       * t. Keys of completed requests are dropped lazily when their slot is
+       * reached */
+      std::vector<std::vector<uint64_t>> wheel_;
+      uint64_t now_ = 0;
+      std::map<protocol::flexran_message::MsgCase,
+               std::unique_ptr<metrics::histogram>> latencies_;
+
+      std::atomic<uint64_t> replies_{0};
+      std::atomic<uint64_t> timeouts_{0};
+      std::atomic<uint64_t> disconnects_{0};
+    };
+
+  }
+
+}
+
+#endif /* TRANSACTION_TABLE_H_ */
@@ -24,6 +24,7 @@
 
 #include "subscription.h"
 #include <algorithm>
+#include <memory>
 
 bs2::connection
 flexran::event::subscription::subscribe_bs_add(const bs_cb::slot_type& cb)
@@ -89,9 +90,14 @@ bs2::connection
 flexran::event::subscription::subscribe_task_tick(const task_cb::slot_type& cb,
     uint64_t period, uint64_t start)
 {
-  auto f = [period,start,cb] (uint64_t t)
+  /* the task manager might skip ticks when overloaded, so fire on the first
+   * tick at or after the next due tick instead of only on exact multiples */
+  auto next = std::make_shared<uint64_t>(start);
+  auto f = [period,start,cb,next] (uint64_t t)
            {
-             if (t >= start && (t - start) % period == 0) cb(t);
+             if (t < *next) return;
+             *next = start + ((t - start) / period + 1) * period;
+             cb(t);
            };
   return task_tick_.connect(f);
 }
@@ -100,9 +106,12 @@ bs2::connection
 flexran::event::subscription::subscribe_task_tick_extended(const task_cb::extended_slot_type& cb,
     uint64_t period, uint64_t start)
 {
-  auto f = [period,start,cb] (const bs2::connection& c, uint64_t t)
+  auto next = std::make_shared<uint64_t>(start);
+  auto f = [period,start,cb,next] (const bs2::connection& c, uint64_t t)
            {
-             if (t >= start && (t - start) % period == 0) cb(c, t);
+             if (t < *next) return;
+             *next = start + ((t - start) / period + 1) * period;
+             cb(c, t);
            };
   return task_tick_.connect_extended(f);
 }
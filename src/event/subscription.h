@@ -38,6 +38,11 @@ namespace flexran {
   namespace core {
     class task_manager;
   }
+  namespace app {
+    namespace log {
+      class recording_replay;
+    }
+  }
 }
 
 namespace flexran {
@@ -47,6 +52,7 @@ namespace flexran {
       // friend classes can access private fields
       friend class flexran::rib::rib_updater;
       friend class flexran::core::task_manager;
+      friend class flexran::app::log::recording_replay;
 
       subscription() : last_tick_(0) {}
       uint64_t last_tick() const { return last_tick_; }
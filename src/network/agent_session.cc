@@ -62,6 +62,7 @@ void flexran::network::agent_session::do_read_body() {
 			      tagged_message *th = new tagged_message(read_msg_.body(),
 								    read_msg_.body_length(),
 								    session_id_);
+			      th->setArrival(std::chrono::steady_clock::now());
 			      xface_.forward_message(th);
 			      do_read_header();
 			    } else {
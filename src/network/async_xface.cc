@@ -22,11 +22,20 @@
  *  \email   x.foukas@sms.ed.ac.uk
  */
 
+#include <cstring>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #include <boost/bind.hpp>
 
 #include "async_xface.h"
 #include "rt_wrapper.h"
 
+flexran::network::async_xface::~async_xface() {
+  if (sf_trigger_fd_ >= 0)
+    close(sf_trigger_fd_);
+}
+
 void flexran::network::async_xface::run() {
   establish_xface();
 }
@@ -41,12 +50,41 @@ void flexran::network::async_xface::establish_xface() {
   io_service.run();
 }
 
-void flexran::network::async_xface::forward_message(tagged_message *msg) {
-  in_queue_.push(msg);
+int flexran::network::async_xface::enable_sf_trigger_notification()
+{
+  if (sf_trigger_fd_ < 0)
+    sf_trigger_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  return sf_trigger_fd_;
+}
+
+bool flexran::network::async_xface::forward_message(tagged_message *msg) {
+  if (try_forward_message(msg))
+    return true;
+  in_dropped_++;
+  delete msg;
+  return false;
+}
+
+bool flexran::network::async_xface::try_forward_message(tagged_message *msg) {
+  /* check before pushing, afterwards the RIB updater might have taken it */
+  const bool notify = sf_trigger_fd_ >= 0 && msg->isSfTrigger();
+  in_depth_++;
+  if (in_queue_.push(msg)) {
+    if (notify) {
+      const uint64_t one = 1;
+      if (write(sf_trigger_fd_, &one, sizeof(one)) < 0) {
+        /* the counter is saturated, the task manager is woken anyway */
+      }
+    }
+    return true;
+  }
+  in_depth_--;
+  return false;
 }
 
 bool flexran::network::async_xface::get_msg_from_network(std::shared_ptr<tagged_message>& msg) {
   return in_queue_.consume_one([&] (tagged_message *tm) {
+      in_depth_--;
       std::shared_ptr<tagged_message> p(std::move(tm));
       msg = p;});
 }
@@ -54,22 +92,44 @@ bool flexran::network::async_xface::get_msg_from_network(std::shared_ptr<tagged_
 bool flexran::network::async_xface::send_msg(const protocol::flexran_message& msg, int agent_tag) const {
   tagged_message *tm =  new tagged_message(msg.ByteSize(), agent_tag);
   msg.SerializeToArray(tm->getMessageArray(), msg.ByteSize());
+  return push_out(tm);
+}
+
+bool flexran::network::async_xface::send_msg(const std::string& serialized, int agent_tag) const {
+  tagged_message *tm = new tagged_message(serialized.size(), agent_tag);
+  std::memcpy(tm->getMessageArray(), serialized.data(), serialized.size());
+  return push_out(tm);
+}
+
+bool flexran::network::async_xface::push_out(tagged_message *tm) const {
+  /* the replayed agents do not exist */
+  if (offline_) {
+    delete tm;
+    return true;
+  }
+  out_depth_++;
   if (out_queue_.push(tm)) {
     io_service.post(boost::bind(&async_xface::forward_msg_to_agent, self_));
     return true;
   } else {
+    out_depth_--;
+    out_dropped_++;
+    delete tm;
     return false;
   }
 }
 
 std::string flexran::network::async_xface::get_endpoint(int agent_id) const
 {
+  if (offline_)
+    return "replay";
   return manager_->get_endpoint(agent_id);
 }
 
 void flexran::network::async_xface::forward_msg_to_agent() {
   tagged_message *msg;
   out_queue_.pop(msg);
+  out_depth_--;
   std::shared_ptr<tagged_message> message(msg);
   manager_->send_msg_to_agent(message);
 }
@@ -77,10 +137,12 @@ void flexran::network::async_xface::forward_msg_to_agent() {
 
 void flexran::network::async_xface::initialize_connection(int session_id) {
   tagged_message *th = new tagged_message(0, session_id);
-  in_queue_.push(th);
+  forward_message(th);
 }
 
 void flexran::network::async_xface::release_connection(int session_id)
 {
+  if (offline_)
+    return;
   manager_->close_connection(session_id);
 }
@@ -25,6 +25,8 @@
 #ifndef ASYNC_XFACE_H_
 #define ASYNC_XFACE_H_
 
+#include <atomic>
+
 #include <boost/asio.hpp>
 #include <boost/lockfree/queue.hpp>
 
@@ -41,31 +43,65 @@ namespace flexran {
     public:
     async_xface(int port): rt_task(Policy::FIFO, 60),
         endpoint_(boost::asio::ip::tcp::v4(), port), port_(port)  {}
+      ~async_xface();
       
       void run();
       void end();
       
       void establish_xface();
       
-      void forward_message(tagged_message *msg);
+      bool forward_message(tagged_message *msg);
+      /*! as forward_message(), but the caller keeps msg if the queue is
+       * full */
+      bool try_forward_message(tagged_message *msg);
+
+      /*! no agents connect, all input comes from a replay: the network
+       * thread must not be started, messages to agents are discarded.
+       * Must be called before any message is sent */
+      void set_offline() { offline_ = true; }
+      bool is_offline() const { return offline_; }
       
       bool get_msg_from_network(std::shared_ptr<tagged_message>& msg);
       
       bool send_msg(const protocol::flexran_message& msg, int agent_tag) const;
+      //! sends an already serialized message, e.g., to send it to many agents
+      bool send_msg(const std::string& serialized, int agent_tag) const;
       std::string get_endpoint(int agent_id) const;
       
       void forward_msg_to_agent();
 
       void initialize_connection(int session_id);
       void release_connection(int session_id);
+
+      //! messages received from agents, not yet taken by the RIB updater
+      size_t in_queue_depth() const { return in_depth_; }
+      //! messages to agents, not yet handed to their sessions
+      size_t out_queue_depth() const { return out_depth_; }
+
+      /*! returns an eventfd which becomes readable when a subframe trigger
+       * arrives, so that the task manager can wake up on it. Must be called
+       * before the network thread starts */
+      int enable_sf_trigger_notification();
+      //! messages dropped because a queue was full
+      uint64_t num_in_dropped() const { return in_dropped_; }
+      uint64_t num_out_dropped() const { return out_dropped_; }
       
     private:
+
+      bool push_out(tagged_message *tm) const;
       
       mutable boost::asio::io_service io_service;
       std::unique_ptr<boost::asio::io_service::work> work_ptr_;
 
       mutable boost::lockfree::queue<tagged_message *, boost::lockfree::fixed_sized<true>> in_queue_{10000};
       mutable boost::lockfree::queue<tagged_message *, boost::lockfree::fixed_sized<true>> out_queue_{10000};
+      /* counted before pushing, so that they never drop below zero */
+      std::atomic<size_t> in_depth_{0};
+      mutable std::atomic<size_t> out_depth_{0};
+      std::atomic<uint64_t> in_dropped_{0};
+      mutable std::atomic<uint64_t> out_dropped_{0};
+      int sf_trigger_fd_ = -1;
+      bool offline_ = false;
 
       mutable boost::asio::ip::tcp::endpoint endpoint_;
 
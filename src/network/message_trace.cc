@@ -0,0 +1,151 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    message_trace.cc
+ *  \brief   record and read back the agent messages received by the controller
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "message_trace.h"
+#include "rt_wrapper.h"
+
+bool flexran::network::message_trace_writer::open(const std::string& filename,
+    std::string& error_reason)
+{
+  close();
+  file_.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file_.is_open()) {
+    error_reason = "cannot open file " + filename;
+    return false;
+  }
+  file_.write(reinterpret_cast<const char *>(&MESSAGE_TRACE_MAGIC), sizeof(uint32_t));
+  file_.write(reinterpret_cast<const char *>(&MESSAGE_TRACE_VERSION), sizeof(uint32_t));
+  written_ = 0;
+  stop_ = false;
+  failed_ = false;
+  thread_ = std::thread(&message_trace_writer::run, this);
+  return true;
+}
+
+bool flexran::network::message_trace_writer::write(uint64_t tick,
+    std::shared_ptr<const tagged_message> msg)
+{
+  if (failed_ || !thread_.joinable())
+    return false;
+  record *r = new record{tick, std::move(msg)};
+  if (!queue_.push(r)) {
+    delete r;
+    return false;
+  }
+  written_++;
+  return true;
+}
+
+bool flexran::network::message_trace_writer::write(uint64_t tick,
+    const tagged_message& msg)
+{
+  return write(tick, std::make_shared<const tagged_message>(msg));
+}
+
+void flexran::network::message_trace_writer::close()
+{
+  if (!thread_.joinable())
+    return;
+  stop_ = true;
+  thread_.join();
+  file_.close();
+}
+
+void flexran::network::message_trace_writer::run()
+{
+  /* signals are handled by the main thread only */
+  sigset_t sigmask;
+  sigfillset(&sigmask);
+  pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+
+  flexran::core::rt::become_background_thread();
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);
+  pthread_setname_np(pthread_self(), "trace_writer");
+
+  while (true) {
+    record *r;
+    if (!queue_.pop(r)) {
+      /* on shutdown, queued messages are still written */
+      if (stop_)
+        break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    const int32_t tag = r->msg->getTag();
+    const uint32_t size = r->msg->getSize();
+    file_.write(reinterpret_cast<const char *>(&r->tick), sizeof(r->tick));
+    file_.write(reinterpret_cast<const char *>(&tag), sizeof(tag));
+    file_.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    file_.write(r->msg->getMessageContents(), size);
+    delete r;
+    if (!file_.good())
+      failed_ = true;
+  }
+  file_.flush();
+}
+
+bool flexran::network::message_trace_reader::open(const std::string& filename,
+    std::string& error_reason)
+{
+  file_.open(filename, std::ios::in | std::ios::binary);
+  if (!file_.is_open()) {
+    error_reason = "cannot open file " + filename;
+    return false;
+  }
+  uint32_t magic = 0, version = 0;
+  file_.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  file_.read(reinterpret_cast<char *>(&version), sizeof(version));
+  if (!file_ || magic != MESSAGE_TRACE_MAGIC) {
+    error_reason = filename + " is not a message trace";
+    file_.close();
+    return false;
+  }
+  if (version != MESSAGE_TRACE_VERSION) {
+    error_reason = "unsupported message trace version " + std::to_string(version);
+    file_.close();
+    return false;
+  }
+  return true;
+}
+
+bool flexran::network::message_trace_reader::read(uint64_t& tick,
+    std::unique_ptr<tagged_message>& msg)
+{
+  int32_t tag;
+  uint32_t size;
+  file_.read(reinterpret_cast<char *>(&tick), sizeof(tick));
+  file_.read(reinterpret_cast<char *>(&tag), sizeof(tag));
+  file_.read(reinterpret_cast<char *>(&size), sizeof(size));
+  if (!file_)
+    return false;
+  msg.reset(new tagged_message(size, tag));
+  file_.read(msg->getMessageArray(), size);
+  return static_cast<bool>(file_);
+}
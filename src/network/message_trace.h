@@ -0,0 +1,104 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    message_trace.h
+ *  \brief   record and read back the agent messages received by the controller
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef MESSAGE_TRACE_H_
+#define MESSAGE_TRACE_H_
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include "tagged_message.h"
+
+namespace flexran {
+
+  namespace network {
+
+    /* A trace file consists of a header (magic and version) followed by one
+     * record per received message: the task manager tick at which it was
+     * processed, the agent tag, the size and the serialized message. A
+     * message of size zero denotes a new agent connection.
+     * The writer only queues messages, a writer thread writes them to the
+     * file, so that the RIB updater does not wait for the disk. open(),
+     * write() and close() must be called from the same thread. */
+    class message_trace_writer {
+    public:
+      message_trace_writer(size_t capacity = 4096) : queue_(capacity) {}
+      ~message_trace_writer() { close(); }
+      message_trace_writer(const message_trace_writer&) = delete;
+      message_trace_writer& operator=(const message_trace_writer&) = delete;
+
+      bool open(const std::string& filename, std::string& error_reason);
+      /*! queues a message; false if the queue is full (the message is not
+       * in the trace) or writing failed */
+      bool write(uint64_t tick, std::shared_ptr<const tagged_message> msg);
+      //! as above, copies the message
+      bool write(uint64_t tick, const tagged_message& msg);
+      //! writes all queued messages and closes the file
+      void close();
+      bool is_open() const { return thread_.joinable(); }
+      //! messages queued for writing
+      uint64_t num_written() const { return written_; }
+
+    private:
+      struct record {
+        uint64_t tick;
+        std::shared_ptr<const tagged_message> msg;
+      };
+
+      void run();
+
+      std::ofstream file_;
+      uint64_t written_ = 0;
+      boost::lockfree::spsc_queue<record *> queue_;
+      std::atomic<bool> stop_{false};
+      std::atomic<bool> failed_{false};
+      std::thread thread_;
+    };
+
+    class message_trace_reader {
+    public:
+      bool open(const std::string& filename, std::string& error_reason);
+      /*! reads the next message. Returns false at the end of the trace or if
+       * the trace is truncated */
+      bool read(uint64_t& tick, std::unique_ptr<tagged_message>& msg);
+      void close() { file_.close(); }
+
+    private:
+      std::ifstream file_;
+    };
+
+    static constexpr const uint32_t MESSAGE_TRACE_MAGIC = 0x52544c46; // "FLTR"
+    static constexpr const uint32_t MESSAGE_TRACE_VERSION = 1;
+
+  }
+
+}
+
+#endif /* MESSAGE_TRACE_H_ */
@@ -22,6 +22,8 @@
  *  \email   x.foukas@sms.ed.ac.uk
  */
 
+#include <cstdint>
+
 #include "tagged_message.h"
 
 flexran::network::tagged_message::tagged_message(char * msg, std::size_t size, int tag):
@@ -50,6 +52,7 @@ flexran::network::tagged_message::tagged_message(std::size_t size, int tag):
 flexran::network::tagged_message::tagged_message(const tagged_message& m) {
   tag_ = m.getTag();
   size_ = m.getSize();
+  arrival_ = m.getArrival();
   if (size_ > max_normal_msg_size) {
     msg_contents_ = new char[size_];
     dynamic_alloc_ = true;
@@ -63,6 +66,7 @@ flexran::network::tagged_message::tagged_message(const tagged_message& m) {
 flexran::network::tagged_message::tagged_message(tagged_message&& other) {
   tag_ = other.getTag();
   size_ = other.getSize();
+  arrival_ = other.getArrival();
 
   if (size_ > max_normal_msg_size) {
     msg_contents_ = new char[size_];
@@ -81,6 +85,7 @@ flexran::network::tagged_message& flexran::network::tagged_message::operator=(fl
 
   tag_ = other.getTag();
   size_ = other.getSize();
+  arrival_ = other.getArrival();
   if (size_ > max_normal_msg_size) {
     msg_contents_ = new char[size_];
     dynamic_alloc_ = true;
@@ -97,3 +102,43 @@ flexran::network::tagged_message::~tagged_message() {
     delete [] msg_contents_;
   }
 }
+
+namespace {
+  bool read_varint(const unsigned char *& p, const unsigned char *end, uint64_t& v)
+  {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+      const unsigned char b = *p++;
+      v |= static_cast<uint64_t>(b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return true;
+    }
+    return false;
+  }
+}
+
+bool flexran::network::tagged_message::isSfTrigger() const
+{
+  /* walk the top-level fields of the flexran_message: the message type is
+   * the field number of the oneof msg (sf_trigger_msg = 6) */
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(msg_contents_);
+  const unsigned char *end = p + size_;
+  while (p < end) {
+    uint64_t key, v;
+    if (!read_varint(p, end, key))
+      return false;
+    if ((key >> 3) == 6)
+      return (key & 7) == 2;
+    switch (key & 7) {
+      case 0: if (!read_varint(p, end, v)) return false; break;
+      case 1: p += 8; break;
+      case 2:
+        if (!read_varint(p, end, v) || v > static_cast<uint64_t>(end - p)) return false;
+        p += v;
+        break;
+      case 5: p += 4; break;
+      default: return false;
+    }
+  }
+  return false;
+}
@@ -27,6 +27,7 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <chrono>
 
 namespace flexran {
 
@@ -55,6 +56,14 @@ namespace flexran {
       char * getMessageArray() {return msg_contents_;}
   
       const char* getMessageContents() const { return msg_contents_; }
+
+      //! time at which the message has been received from the socket
+      std::chrono::steady_clock::time_point getArrival() const { return arrival_; }
+      void setArrival(std::chrono::steady_clock::time_point t) { arrival_ = t; }
+
+      /*! true if this is a flexran_message with a flex_sf_trigger, found
+       * without parsing the message */
+      bool isSfTrigger() const;
       
       ~tagged_message();
   
@@ -65,6 +74,7 @@ namespace flexran {
       char p_msg_[max_normal_msg_size];
       char *msg_contents_;
       bool dynamic_alloc_;
+      std::chrono::steady_clock::time_point arrival_;
     };
 
   }
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    app_calls.cc
+ *  \brief   base class of FlexRAN NB API
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <pistache/http.h>
+#include <pistache/http_header.h>
+
+#include "app_calls.h"
+
+flexran::core::compression::encoding flexran::north_api::app_calls::response_encoding(
+    const Pistache::Rest::Request& request, size_t size) const
+{
+  namespace cmp = flexran::core::compression;
+  if (!compression_ || compression_->level == 0)
+    return cmp::encoding::identity;
+  if (size < compression_->min_size) {
+    cmp::get_counters().skipped++;
+    return cmp::encoding::identity;
+  }
+  auto ae = request.headers().tryGetRaw("Accept-Encoding");
+  if (ae.isEmpty())
+    return cmp::encoding::identity;
+  return cmp::negotiate(ae.get().value());
+}
+
+void flexran::north_api::app_calls::send_compressed(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter& response,
+    Pistache::Http::Code code, const std::string& body,
+    const Pistache::Http::Mime::MediaType& mime)
+{
+  const auto e = response_encoding(request, body.size());
+  add_encoding_headers(response, e);
+  if (e == flexran::core::compression::encoding::identity) {
+    response.send(code, body, mime);
+    return;
+  }
+  response.send(code, flexran::core::compression::compress(e,
+        compression_->level, body), mime);
+}
+
+void flexran::north_api::app_calls::add_encoding_headers(
+    Pistache::Http::ResponseWriter& response, flexran::core::compression::encoding e)
+{
+  response.headers().addRaw(Pistache::Http::Header::Raw("Vary", "Accept-Encoding"));
+  if (e != flexran::core::compression::encoding::identity)
+    response.headers().addRaw(Pistache::Http::Header::Raw("Content-Encoding",
+          flexran::core::compression::encoding_name(e)));
+}
+
+std::string flexran::north_api::app_calls::encoded_etag(const std::string& etag,
+    flexran::core::compression::encoding e)
+{
+  if (e == flexran::core::compression::encoding::identity || etag.empty())
+    return etag;
+  return etag.substr(0, etag.size() - 1) + "-"
+      + flexran::core::compression::encoding_name(e) + "\"";
+}
+
+std::string flexran::north_api::app_calls::format_batch_results(
+    const flexran::app::batch_results& results)
+{
+  std::string s = "{\"results\":[";
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (i > 0) s += ",";
+    s += "{\"bs_id\":" + std::to_string(results[i].bs_id);
+    if (results[i].error.empty())
+      s += ",\"status\":\"Ok\"}";
+    else
+      s += ",\"error\":\"" + results[i].error + "\"}";
+  }
+  return s + "]}\n";
+}
@@ -25,8 +25,13 @@
 #ifndef APP_CALLS_H_
 #define APP_CALLS_H_
 
+#include <string>
 #include <pistache/router.h>
 
+#include "command_queue.h"
+#include "compression.h"
+#include "component.h"
+
 namespace REQ_TYPE {
   constexpr const char *ALL_STATS  = "all";
   constexpr const char *ENB_CONFIG = "enb_config";
@@ -42,9 +47,124 @@ namespace flexran {
     public:
 
       virtual void register_calls(Pistache::Rest::Description& desc) = 0;
+
+      /// sets the queue through which handlers run commands on the task
+      /// manager thread, see in_rt()
+      void set_command_queue(flexran::core::command_queue *commands) { commands_ = commands; }
+      /// sets the options for compressing responses, see send_compressed()
+      void set_compression(const flexran::core::compression::options *opts) { compression_ = opts; }
       static constexpr const size_t AGENT_ID_LENGTH_LIMIT = 3;
       static constexpr const size_t RNTI_ID_LENGTH_LIMIT  = 6;
 
+      /// returns true if the request has an If-None-Match header matching
+      /// etag (RFC 7232, weak comparison)
+      static bool etag_matches(const Pistache::Rest::Request& request,
+          const std::string& etag)
+      {
+        auto inm = request.headers().tryGetRaw("If-None-Match");
+        if (inm.isEmpty()) return false;
+        const std::string& tags = inm.get().value();
+        size_t pos = 0;
+        while (pos < tags.size()) {
+          size_t end = tags.find(',', pos);
+          if (end == std::string::npos) end = tags.size();
+          size_t b = tags.find_first_not_of(" \t", pos);
+          size_t e = tags.find_last_not_of(" \t", end - 1);
+          if (b != std::string::npos && b < end && e >= b) {
+            std::string t = tags.substr(b, e - b + 1);
+            if (t == "*") return true;
+            if (t.compare(0, 2, "W/") == 0) t = t.substr(2);
+            if (t == etag) return true;
+          }
+          pos = end + 1;
+        }
+        return false;
+      }
+
+    protected:
+
+      /// runs f in the task manager thread and returns its result. All
+      /// handlers that modify apps or the RIB need to go through here, as
+      /// the REST threads run concurrently to the task manager. Throws
+      /// std::runtime_error if the command queue is full or the task
+      /// manager does not respond, which the call manager answers with 503
+      /// Service Unavailable, so handlers need not catch it. Without a
+      /// command queue (e.g., in tests), f runs directly. Commands for bulk
+      /// reads should use priority bulk, so that control commands go first
+      template<typename F>
+      typename std::result_of<F()>::type in_rt(F f,
+          flexran::core::command_queue::priority p = flexran::core::command_queue::priority::control)
+      {
+        if (!commands_) return f();
+        return commands_->run(std::move(f), p);
+      }
+
+      /// the encoding for a response of size bytes to request, according
+      /// to its Accept-Encoding and the compression options. Without
+      /// compression options, responses are not compressed
+      flexran::core::compression::encoding response_encoding(
+          const Pistache::Rest::Request& request, size_t size) const;
+
+      /// sends body, compressed if the client accepts it (see
+      /// response_encoding()). The compressed body can be passed if it is
+      /// already known, e.g., cached
+      void send_compressed(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter& response, Pistache::Http::Code code,
+          const std::string& body, const Pistache::Http::Mime::MediaType& mime);
+
+      /// adds the Content-Encoding (if not identity) and Vary headers
+      static void add_encoding_headers(Pistache::Http::ResponseWriter& response,
+          flexran::core::compression::encoding e);
+
+      /// the entity tag of the body with entity tag etag in content coding
+      /// e: differently encoded bodies must not share a strong tag
+      static std::string encoded_etag(const std::string& etag,
+          flexran::core::compression::encoding e);
+
+      const flexran::core::compression::options *compression_options() const { return compression_; }
+
+      /// runs the batch operation f(bs_ids, results) in the task manager on
+      /// the BSs selected by the :bs parameter (see Rib::select_bs()) and
+      /// sends the results per BS. f reports an invalid policy by throwing
+      /// std::invalid_argument, which is sent as BadRequest
+      template<typename F>
+      void run_batch(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter& response,
+          const flexran::app::component& app, F f)
+      {
+        const std::string selector = request.param(":bs").as<std::string>();
+        flexran::app::batch_results results;
+        std::string error_reason;
+        bool valid;
+        try {
+          valid = in_rt([&] {
+              std::vector<uint64_t> bs_ids;
+              if (!app.select_bs(selector, bs_ids, error_reason))
+                return false;
+              f(bs_ids, results);
+              return true;
+            });
+        } catch (const std::invalid_argument& e) {
+          valid = false;
+          error_reason = e.what();
+        }
+        if (!valid) {
+          response.send(Pistache::Http::Code::Bad_Request,
+              "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
+          return;
+        }
+        send_compressed(request, response, Pistache::Http::Code::Ok,
+            format_batch_results(results), MIME(Application, Json));
+      }
+
+      /// {"results":[{"bs_id":..,"status":"Ok"},{"bs_id":..,"error":".."}]}
+      static std::string format_batch_results(const flexran::app::batch_results& results);
+
+    private:
+
+      flexran::core::command_queue *commands_ = nullptr;
+      const flexran::core::compression::options *compression_ = nullptr;
+
     };
   }
 }
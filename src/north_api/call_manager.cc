@@ -24,12 +24,81 @@
 
 #include "call_manager.h"
 #include "rt_controller_common.h"
+#include "flexran_log.h"
 #include <pistache/router.h>
 #include <iostream>
+#include <stdexcept>
 
-flexran::north_api::manager::call_manager::call_manager(Pistache::Address addr)
+namespace {
+  /* makes a ticket the current one of this thread while a request is handled */
+  struct ticket_scope {
+    explicit ticket_scope(flexran::core::admission::ticket t)
+    { flexran::core::admission::current_ticket() = std::move(t); }
+    ~ticket_scope() { flexran::core::admission::current_ticket().reset(); }
+  };
+
+  /* Checks every request with the admission controller (if any) before
+   * handing it to the router. Rejected requests are answered with 429 Too
+   * Many Requests. Requests that could not be run in the task manager (see
+   * app_calls::in_rt()) are answered with 503 Service Unavailable */
+  class admission_handler : public Pistache::Http::Handler {
+  public:
+    HTTP_PROTOTYPE(admission_handler)
+
+    admission_handler(std::shared_ptr<Pistache::Http::Handler> next,
+        std::shared_ptr<flexran::core::admission::controller> admission)
+      : next_(next), admission_(admission) {}
+    /* every REST thread gets its own clone, the router is cloned as well
+     * but the limits are shared */
+    admission_handler(const admission_handler& h)
+      : next_(h.next_->clone()), admission_(h.admission_) {}
+
+    void onRequest(const Pistache::Http::Request& request,
+        Pistache::Http::ResponseWriter response) override
+    {
+      namespace admission = flexran::core::admission;
+      admission::request_class c = admission::request_class::read;
+      const admission::verdict v = !admission_ ? admission::verdict::admitted
+          : admission_->admit(request.address().host(),
+                Pistache::Http::methodString(request.method()),
+                request.resource(), c);
+      if (v != admission::verdict::admitted) {
+        response.headers().addRaw(Pistache::Http::Header::Raw("Retry-After", "1"));
+        response.send(Pistache::Http::Code::Too_Many_Requests,
+            std::string("{ \"error\": \"too many requests (")
+            + admission::verdict_name(v) + " limit)\" }\n",
+            MIME(Application, Json));
+        return;
+      }
+      /* a handler that answers later keeps a copy of the ticket, otherwise
+       * the slot is released when the handler returns */
+      ticket_scope ts(admission_ ? admission::controller::make_ticket(admission_, c)
+                                 : nullptr);
+      /* the command queue is full or the task manager does not respond: the
+       * controller is overloaded, so the client should come back later */
+      try {
+        next_->onRequest(request, response.clone());
+      } catch (const std::runtime_error& e) {
+        LOG4CXX_WARN(flog::app, "northbound request " << request.resource()
+            << " not served: " << e.what());
+        response.headers().addRaw(Pistache::Http::Header::Raw("Retry-After", "1"));
+        response.send(Pistache::Http::Code::Service_Unavailable,
+            std::string("{ \"error\": \"controller overloaded (") + e.what() + ")\" }\n",
+            MIME(Application, Json));
+      }
+    }
+
+  private:
+    std::shared_ptr<Pistache::Http::Handler> next_;
+    std::shared_ptr<flexran::core::admission::controller> admission_;
+  };
+}
+
+flexran::north_api::manager::call_manager::call_manager(Pistache::Address addr,
+    flexran::core::command_queue& commands)
 	: httpEndpoint(std::make_shared<Pistache::Http::Endpoint>(addr)),
-    desc_("FlexRAN NB API", RTC_VERSION)
+    desc_("FlexRAN NB API", RTC_VERSION),
+    commands_(commands)
 {
   desc_.info()
        .license("Apache", "http://www.apache.org/licenses/LICENSE-2.0");
@@ -88,7 +157,7 @@ void flexran::north_api::manager::call_manager::start()
 {
   Pistache::Rest::Router router;
   router.initFromDescription(desc_);
-  httpEndpoint->setHandler(router.handler());
+  httpEndpoint->setHandler(std::make_shared<admission_handler>(router.handler(), admission_));
   httpEndpoint->serveThreaded();
 }
 
@@ -96,8 +165,16 @@ void flexran::north_api::manager::call_manager::shutdown() {
   httpEndpoint->shutdown();
 }
 
+void flexran::north_api::manager::call_manager::set_admission(
+    const flexran::core::admission::options& opts)
+{
+  admission_ = std::make_shared<flexran::core::admission::controller>(opts);
+}
+
 void flexran::north_api::manager::call_manager::register_calls(flexran::north_api::app_calls& calls)
 {
+  calls.set_command_queue(&commands_);
+  calls.set_compression(&compression_);
   calls.register_calls(desc_);
 }
 
@@ -29,6 +29,7 @@
 #include <pistache/http.h>
 #include <pistache/description.h>
 
+#include "admission.h"
 #include "app_calls.h"
 
 namespace flexran {
@@ -41,7 +42,9 @@ namespace flexran {
 
       public:
 
-        call_manager(Pistache::Address addr);
+        /// commands: queue through which all registered calls modify apps
+        /// in the task manager thread
+        call_manager(Pistache::Address addr, flexran::core::command_queue& commands);
 
 	void init(size_t thr = 1);
 
@@ -50,6 +53,13 @@ namespace flexran {
 	void shutdown();
 
 	void register_calls(flexran::north_api::app_calls& calls);
+
+        /// how responses of all registered calls are compressed
+        void set_compression(const flexran::core::compression::options& opts) { compression_ = opts; }
+
+        /// limits for admitting requests, see admission::controller. Must be
+        /// called before start()
+        void set_admission(const flexran::core::admission::options& opts);
 	
       private:
 
@@ -59,6 +69,9 @@ namespace flexran {
 	
 	std::shared_ptr<Pistache::Http::Endpoint> httpEndpoint;
         Pistache::Rest::Description desc_;
+        flexran::core::command_queue& commands_;
+        flexran::core::compression::options compression_;
+        std::shared_ptr<flexran::core::admission::controller> admission_;
       };
       
     }
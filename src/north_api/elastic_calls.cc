@@ -57,6 +57,17 @@ void flexran::north_api::elastic_calls::register_calls(Pistache::Rest::Descripti
    * logging session, i.e. for which HTTP response code 200 has been received.
    * Note that multiple samples might be sent in one batch, equalling one
    * packet.
+   * @apiSuccess {Number} failedPackets The number of request packets for which
+   * no HTTP response code 200 has been received (e.g., time out).
+   * @apiSuccess {Number} pendingTransfers The number of request packets that
+   * are currently being transferred.
+   * @apiSuccess {Number} droppedBatches The number of batches that have not
+   * been sent since too many transfers were pending.
+   * @apiSuccess {Number} backlog The number of samples taken but not yet
+   * processed. Samples are formatted and sent in a separate thread.
+   * @apiSuccess {Number} droppedSamples The number of samples that have been
+   * dropped since the backlog was full, i.e., the sending thread could not
+   * keep up.
    * @apiSuccess {[String]} endpoint The list of endpoints to which information
    * will be streamed in the form `IP:Port`.
    * @apiSuccess {Number} intervalStats The interval between two consecutive
@@ -81,6 +92,11 @@ void flexran::north_api::elastic_calls::register_calls(Pistache::Rest::Descripti
    *      "active": true,
    *      "activeSince": "2019-02-18 14:55:11",
    *      "sentPackets": 22,
+   *      "failedPackets": 0,
+   *      "pendingTransfers": 1,
+   *      "droppedBatches": 0,
+   *      "backlog": 0,
+   *      "droppedSamples": 0,
    *      "endpoint": [
    *        "localhost:9200"
    *      ],
@@ -342,29 +358,38 @@ void flexran::north_api::elastic_calls::status(
     Pistache::Http::ResponseWriter response)
 {
   _unused(request);
-  /* provide a JSON representation of the most important parameters */
-  std::string s;
-  std::vector<std::string> eps = elastic_app->get_endpoint();
-  s  = "{";
-  s +=   "\"active\":"; /* need to end statement here, otherwise it is cut */
-  s +=                                elastic_app->is_active() ? "true" : "false";
-  if (elastic_app->is_active()) {
-    const auto t = std::chrono::system_clock::to_time_t(elastic_app->get_active_since());
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&t), "%F %T");
-    s +=  ",\"activeSince\":\""     + ss.str() + "\"";
-  }
-  s +=  ",\"sentPackets\":"         + std::to_string(elastic_app->get_sent_packets());
-  s +=   ",\"endpoint\":[";
-  for (auto it = eps.begin(); it != eps.end(); it++) {
-    if (it != eps.begin()) s += ",";
-    s +=    "\"" + *it + "\"";
-  }
-  s +=   "],\"intervalStats\":"    + std::to_string(elastic_app->get_freq_stats());
-  s +=   ",\"intervalConfig\":"     + std::to_string(elastic_app->get_freq_config());
-  s +=   ",\"batchStatsMaxSize\":"  + std::to_string(elastic_app->get_batch_stats_max_size());
-  s +=   ",\"batchConfigMaxSize\":" + std::to_string(elastic_app->get_batch_config_max_size());
-  s += "}";
+  /* provide a JSON representation of the most important parameters, read
+   * in the task manager thread that modifies them */
+  const std::string s = in_rt([this] {
+    std::string s;
+    std::vector<std::string> eps = elastic_app->get_endpoint();
+    s  = "{";
+    s +=   "\"active\":"; /* need to end statement here, otherwise it is cut */
+    s +=                                elastic_app->is_active() ? "true" : "false";
+    if (elastic_app->is_active()) {
+      const auto t = std::chrono::system_clock::to_time_t(elastic_app->get_active_since());
+      std::stringstream ss;
+      ss << std::put_time(std::localtime(&t), "%F %T");
+      s +=  ",\"activeSince\":\""     + ss.str() + "\"";
+    }
+    s +=  ",\"sentPackets\":"         + std::to_string(elastic_app->get_sent_packets());
+    s +=  ",\"failedPackets\":"       + std::to_string(elastic_app->get_failed_packets());
+    s +=  ",\"pendingTransfers\":"    + std::to_string(elastic_app->get_pending_transfers());
+    s +=  ",\"droppedBatches\":"      + std::to_string(elastic_app->get_dropped_batches());
+    s +=  ",\"backlog\":"             + std::to_string(elastic_app->get_backlog());
+    s +=  ",\"droppedSamples\":"      + std::to_string(elastic_app->get_dropped_samples());
+    s +=   ",\"endpoint\":[";
+    for (auto it = eps.begin(); it != eps.end(); it++) {
+      if (it != eps.begin()) s += ",";
+      s +=    "\"" + *it + "\"";
+    }
+    s +=   "],\"intervalStats\":"    + std::to_string(elastic_app->get_freq_stats());
+    s +=   ",\"intervalConfig\":"     + std::to_string(elastic_app->get_freq_config());
+    s +=   ",\"batchStatsMaxSize\":"  + std::to_string(elastic_app->get_batch_stats_max_size());
+    s +=   ",\"batchConfigMaxSize\":" + std::to_string(elastic_app->get_batch_config_max_size());
+    s += "}";
+    return s;
+  });
   response.send(Pistache::Http::Code::Ok, s);
 }
 
@@ -373,7 +398,7 @@ void flexran::north_api::elastic_calls::add_endpoint(
     Pistache::Http::ResponseWriter response)
 {
   std::string ep = request.param(":ep").as<std::string>();
-  if (elastic_app->add_endpoint(ep))
+  if (in_rt([&] { return elastic_app->add_endpoint(ep); }))
     response.send(Pistache::Http::Code::Ok, "");
   else
     response.send(Pistache::Http::Code::Bad_Request,
@@ -385,7 +410,7 @@ void flexran::north_api::elastic_calls::remove_endpoint(
     Pistache::Http::ResponseWriter response)
 {
   std::string ep = request.param(":ep").as<std::string>();
-  if (elastic_app->remove_endpoint(ep))
+  if (in_rt([&] { return elastic_app->remove_endpoint(ep); }))
     response.send(Pistache::Http::Code::Ok, "");
   else
     response.send(Pistache::Http::Code::Bad_Request,
@@ -397,7 +422,7 @@ void flexran::north_api::elastic_calls::set_freq_stats(
     Pistache::Http::ResponseWriter response)
 {
   int freq = request.param(":itvl").as<int>();
-  if (elastic_app->set_freq_stats(freq))
+  if (in_rt([&] { return elastic_app->set_freq_stats(freq); }))
     response.send(Pistache::Http::Code::Ok, "");
   else
     response.send(Pistache::Http::Code::Bad_Request,
@@ -410,7 +435,7 @@ void flexran::north_api::elastic_calls::set_freq_config(
     Pistache::Http::ResponseWriter response)
 {
   int freq = request.param(":itvl").as<int>();
-  if (elastic_app->set_freq_config(freq))
+  if (in_rt([&] { return elastic_app->set_freq_config(freq); }))
     response.send(Pistache::Http::Code::Ok, "");
   else
     response.send(Pistache::Http::Code::Bad_Request,
@@ -422,7 +447,7 @@ void flexran::north_api::elastic_calls::set_batch_stats_size(
     Pistache::Http::ResponseWriter response)
 {
   int size = request.param(":size").as<int>();
-  if (elastic_app->set_batch_stats_max_size(size))
+  if (in_rt([&] { return elastic_app->set_batch_stats_max_size(size); }))
     response.send(Pistache::Http::Code::Ok, "");
   else
     response.send(Pistache::Http::Code::Bad_Request,
@@ -435,7 +460,7 @@ void flexran::north_api::elastic_calls::set_batch_config_size(
     Pistache::Http::ResponseWriter response)
 {
   int size = request.param(":size").as<int>();
-  if (elastic_app->set_batch_config_max_size(size))
+  if (in_rt([&] { return elastic_app->set_batch_config_max_size(size); }))
     response.send(Pistache::Http::Code::Ok, "");
   else
     response.send(Pistache::Http::Code::Bad_Request,
@@ -449,7 +474,7 @@ void flexran::north_api::elastic_calls::enable(
     Pistache::Http::ResponseWriter response)
 {
   _unused(request);
-  if (elastic_app->enable_logging())
+  if (in_rt([&] { return elastic_app->enable_logging(); }))
     response.send(Pistache::Http::Code::Ok, "");
   else
     response.send(Pistache::Http::Code::Bad_Request,
@@ -462,7 +487,7 @@ void flexran::north_api::elastic_calls::disable(
     Pistache::Http::ResponseWriter response)
 {
   _unused(request);
-  if (elastic_app->disable_logging())
+  if (in_rt([&] { return elastic_app->disable_logging(); }))
     response.send(Pistache::Http::Code::Ok, "");
   else
     response.send(Pistache::Http::Code::Bad_Request,
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    flight_recorder_calls.cc
+ *  \brief   NB API for the flight recorder app
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <pistache/http.h>
+#include <pistache/http_header.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+#include "flight_recorder_calls.h"
+#include "rt_controller_common.h"
+
+void flexran::north_api::flight_recorder_calls::register_calls(Pistache::Rest::Description& desc)
+{
+  auto flight = desc.path("/flight_recorder");
+
+  /**
+   * @api {post} /flight_recorder  Dump the flight recorder
+   * @apiName triggerFlightRecorder
+   * @apiGroup Recorder
+   *
+   * @apiDescription Unless disabled (controller option `--flight-pre`, limited
+   * by `--flight-max-mb`), the flight recorder continuously keeps the RAN
+   * state of the last seconds. This call triggers
+   * a dump: the controller keeps recording for some more time (option
+   * `--flight-post`) and then writes everything to a file in `/tmp/`, which
+   * can be downloaded when finished. The file can be read with `rec-slice`
+   * and `parse-bd`. Dumps are also triggered when the connection to a BS is
+   * lost and by the signal SIGHUP.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X POST http://127.0.0.1:9999/flight_recorder
+   * @apiSuccess id An identifier through which the dump can be recovered.
+   * @apiSuccessExample Example success response:
+   *     HTTP/1.1 200 OK
+   *     { "id" : 123456 }
+   * @apiError Conflict A dump is in progress, its id is returned.
+   * @apiErrorExample Example error response:
+   *     HTTP/1.1 409 Conflict
+   *     { "error": "dump in progress", "id" : 123456 }
+   */
+  flight.route(desc.post("/"),
+               "Dump the flight recorder")
+          .bind(&flexran::north_api::flight_recorder_calls::trigger, this);
+
+  /**
+   * @api {get} /flight_recorder  List the flight recorder dumps
+   * @apiName listFlightRecorder
+   * @apiGroup Recorder
+   *
+   * @apiDescription Lists all dumps with their trigger and whether they have
+   * been written completely.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl http://127.0.0.1:9999/flight_recorder
+   * @apiSuccessExample Example success response:
+   *     HTTP/1.1 200 OK
+   *     [ { "id": 123456, "reason": "BS 3584 inactive", "file":
+   *         "/tmp/flight.123456.delta", "done": true } ]
+   */
+  flight.route(desc.get("/"),
+               "List the flight recorder dumps")
+          .bind(&flexran::north_api::flight_recorder_calls::list_dumps, this);
+
+  /**
+   * @api {get} /flight_recorder/:id  Download a flight recorder dump
+   * @apiName getFlightRecorder
+   * @apiGroup Recorder
+   * @apiParam {Number} id Identifier of the dump.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -o dump.delta http://127.0.0.1:9999/flight_recorder/123456
+   * @apiError BadRequest There is no such dump or it could not be opened.
+   * @apiError Conflict The dump has not been written completely.
+   */
+  flight.route(desc.get("/:id"),
+               "Download a flight recorder dump")
+          .bind(&flexran::north_api::flight_recorder_calls::obtain_dump, this);
+}
+
+void flexran::north_api::flight_recorder_calls::trigger(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+
+  std::string id;
+  const bool success = in_rt([&] { return flight_app->trigger("REST", id); });
+  if (success)
+    response.send(Pistache::Http::Code::Ok, "{\"id\":" + id + "}");
+  else
+    response.send(Pistache::Http::Code::Conflict,
+        "{\"error\":\"dump in progress\",\"id\":" + id + "}");
+}
+
+void flexran::north_api::flight_recorder_calls::list_dumps(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+
+  const std::vector<flexran::app::log::flight_recorder::dump_info> dumps =
+      in_rt([&] { return flight_app->dumps(); });
+  std::string s = "[";
+  for (auto it = dumps.begin(); it != dumps.end(); ++it) {
+    if (it != dumps.begin()) s += ",";
+    s += "{\"id\":" + it->id + ",\"reason\":\"" + it->reason + "\",\"file\":\""
+        + it->filename + "\",\"done\":" + (it->done ? "true" : "false") + "}";
+  }
+  s += "]";
+  response.setMime(MIME(Application, Json));
+  response.send(Pistache::Http::Code::Ok, s);
+}
+
+void flexran::north_api::flight_recorder_calls::obtain_dump(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  const std::string id = request.param(":id").as<std::string>();
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+
+  flexran::app::log::flight_recorder::dump_info info;
+  if (!in_rt([&] { return flight_app->get_dump(id, info); })) {
+    response.send(Pistache::Http::Code::Bad_Request, "{\"error\":\"Invalid ID (no such dump)\"}");
+    return;
+  }
+  if (!info.done) {
+    response.send(Pistache::Http::Code::Conflict, "{\"error\":\"dump not finished\"}");
+    return;
+  }
+
+  std::ifstream file(info.filename, std::ios::binary);
+  if (!file.is_open()) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{\"error\":\"Corresponding file " + info.filename + " could not be opened\"}");
+    return;
+  }
+  std::stringstream ss;
+  ss << file.rdbuf();
+
+  auto mime = Pistache::Http::Mime::MediaType::fromString("application/octet-string");
+  response.setMime(mime);
+  response.send(Pistache::Http::Code::Ok, ss.str());
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    metrics_calls.cc
+ *  \brief   NB API for controller and RAN metrics in OpenMetrics format
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <pistache/http.h>
+#include <pistache/http_header.h>
+
+#include "metrics_calls.h"
+#include "admission.h"
+#include "compression.h"
+
+namespace {
+  /* scrape intervals are seconds, so this rarely triggers a new snapshot
+   * if the statistics are also read */
+  const std::chrono::milliseconds snapshot_max_age(100);
+}
+
+void flexran::north_api::metrics_calls::register_calls(Pistache::Rest::Description& desc)
+{
+  auto metrics = desc.path("/metrics");
+
+  /**
+   * @api {get} /metrics Get controller and RAN metrics
+   * @apiName GetMetrics
+   * @apiGroup Metrics
+   *
+   * @apiDescription Returns metrics for Prometheus and other OpenMetrics
+   * scrapers. Clients accepting `application/openmetrics-text` get the
+   * OpenMetrics format, all others the Prometheus text format 0.0.4. The
+   * metrics comprise the controller's internals (task manager loop
+   * durations, queue depths, messages and bytes exchanged with each agent,
+   * request/reply latencies per agent request type, admission and
+   * compression of responses) and RAN KPIs read from the same RIB snapshot
+   * as the statistics: UEs per cell and DL slice, and per UE the DL CQI,
+   * MCS, and the DL/UL traffic. UE samples carry the labels bs_id,
+   * cell_id, slice_id, rnti and imsi, so per-cell or per-slice throughput
+   * is, e.g., `sum by (bs_id, cell_id) (rate(flexran_ue_dl_bytes_total[1m]))`.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl http://127.0.0.1:9999/metrics
+   *    curl -H "Accept: application/openmetrics-text" http://127.0.0.1:9999/metrics
+   *
+   * @apiSuccessExample Success-Response:
+   *    HTTP/1.1 200 OK
+   *    # TYPE flexran_agent_rx_bytes counter
+   *    # HELP flexran_agent_rx_bytes Bytes received from the agent
+   *    # UNIT flexran_agent_rx_bytes bytes
+   *    flexran_agent_rx_bytes_total{agent_id="0",bs_id="3584"} 1823404
+   *    ...
+   *    # TYPE flexran_ue_dl_cqi gauge
+   *    # HELP flexran_ue_dl_cqi Last reported DL wideband CQI
+   *    flexran_ue_dl_cqi{bs_id="3584",cell_id="0",slice_id="0",rnti="4660",imsi="208950000000001"} 15
+   *    ...
+   *    # EOF
+   */
+  metrics.route(desc.get(""), "Get controller and RAN metrics")
+         .bind(&flexran::north_api::metrics_calls::get_metrics, this);
+}
+
+void flexran::north_api::metrics_calls::get_metrics(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  namespace metrics = flexran::core::metrics;
+  stats_app->refresh_snapshot(snapshot_max_age,
+      [this] { return in_rt([this] { return stats_app->prepare_snapshot(); },
+                            flexran::core::command_queue::priority::bulk); });
+
+  auto accept = request.headers().tryGetRaw("Accept");
+  const metrics::writer::format f =
+      !accept.isEmpty() && metrics::writer::accepts_openmetrics(accept.get().value())
+      ? metrics::writer::format::openmetrics : metrics::writer::format::prometheus;
+  std::string body;
+  std::string content_type;
+  {
+    std::lock_guard<std::mutex> lg(mutex_);
+    /* the output has about the size of the last one */
+    metrics::writer w(f, last_size_ + last_size_ / 8);
+    content_type = w.content_type();
+    write_internal(w);
+    std::shared_ptr<const flexran::rib::Rib> snapshot = stats_app->current_snapshot();
+    if (snapshot)
+      ran_.write(*snapshot, w);
+    body = std::move(w.finish());
+    last_size_ = body.size();
+  }
+  send_compressed(request, response, Pistache::Http::Code::Ok, body,
+      Pistache::Http::Mime::MediaType::fromString(content_type));
+}
+
+void flexran::north_api::metrics_calls::write_internal(
+    flexran::core::metrics::writer& w) const
+{
+  using flexran::core::metrics::writer;
+  w.family("flexran_task_manager_loop_duration_seconds", "histogram",
+      "Duration of a task manager loop (RIB update, apps, commands)", "seconds");
+  w.write("flexran_task_manager_loop_duration_seconds", "", tm_.loop_durations(), 1e-6);
+  w.family("flexran_task_manager_ticks", "counter", "Ticks in which the apps ran");
+  w.counter("flexran_task_manager_ticks", "", tm_.num_ticks());
+  w.family("flexran_task_manager_missed_ticks", "counter",
+      "Ticks that elapsed without running the apps");
+  w.counter("flexran_task_manager_missed_ticks", "", tm_.missed_ticks());
+  w.family("flexran_task_manager_messages", "counter",
+      "Agent messages processed by the RIB updater");
+  w.counter("flexran_task_manager_messages", "", tm_.num_messages());
+
+  static const std::string in = writer::labels({{"queue", "in"}});
+  static const std::string out = writer::labels({{"queue", "out"}});
+  w.family("flexran_network_queue_depth", "gauge",
+      "Messages queued between the network and task manager threads");
+  w.gauge("flexran_network_queue_depth", in, static_cast<uint64_t>(xface_.in_queue_depth()));
+  w.gauge("flexran_network_queue_depth", out, static_cast<uint64_t>(xface_.out_queue_depth()));
+  w.family("flexran_network_dropped_messages", "counter",
+      "Messages dropped because a queue was full");
+  w.counter("flexran_network_dropped_messages", in, xface_.num_in_dropped());
+  w.counter("flexran_network_dropped_messages", out, xface_.num_out_dropped());
+  req_manager_.transactions().write_metrics(w);
+
+  w.family("flexran_command_queue_depth", "gauge",
+      "Northbound commands waiting for the task manager");
+  w.gauge("flexran_command_queue_depth", "", static_cast<uint64_t>(commands_.queue_depth()));
+  w.family("flexran_commands", "counter", "Northbound commands by result");
+  w.counter("flexran_commands", writer::labels({{"result", "executed"}}),
+      commands_.num_executed());
+  w.counter("flexran_commands", writer::labels({{"result", "rejected"}}),
+      commands_.num_rejected());
+  w.counter("flexran_commands", writer::labels({{"result", "timeout"}}),
+      commands_.num_timeouts());
+
+  w.family("flexran_executor_queue_depth", "gauge",
+      "Background work waiting for an executor thread");
+  w.gauge("flexran_executor_queue_depth", "", static_cast<uint64_t>(executor_.queue_depth()));
+  w.family("flexran_executor_jobs", "counter", "Background work by result");
+  w.counter("flexran_executor_jobs", writer::labels({{"result", "completed"}}),
+      executor_.num_completed());
+  w.counter("flexran_executor_jobs", writer::labels({{"result", "rejected"}}),
+      executor_.num_rejected());
+
+  const flexran::core::compression::counters& c =
+      flexran::core::compression::get_counters();
+  w.family("flexran_http_compressed_responses", "counter",
+      "Responses compressed with gzip or deflate");
+  w.counter("flexran_http_compressed_responses", "", c.responses.load());
+  w.family("flexran_http_uncompressed_small_responses", "counter",
+      "Responses not compressed since they were too small");
+  w.counter("flexran_http_uncompressed_small_responses", "", c.skipped.load());
+  w.family("flexran_http_compression_input_bytes", "counter",
+      "Bytes before compression", "bytes");
+  w.counter("flexran_http_compression_input_bytes", "", c.bytes_in.load());
+  w.family("flexran_http_compression_output_bytes", "counter",
+      "Bytes after compression", "bytes");
+  w.counter("flexran_http_compression_output_bytes", "", c.bytes_out.load());
+  w.family("flexran_http_compression_cpu_seconds", "counter",
+      "CPU time spent compressing", "seconds");
+  w.sample("flexran_http_compression_cpu_seconds", "_total", "",
+      c.cpu_time_ns.load() * 1e-9);
+
+  namespace admission = flexran::core::admission;
+  const admission::counters& a = admission::get_counters();
+  w.family("flexran_http_requests", "counter",
+      "Northbound requests by class and admission result");
+  for (int i = 0; i < 3; ++i) {
+    const char *cls = admission::class_name(static_cast<admission::request_class>(i));
+    w.counter("flexran_http_requests",
+        writer::labels({{"class", cls}, {"result", "admitted"}}), a.admitted[i].load());
+    w.counter("flexran_http_requests",
+        writer::labels({{"class", cls}, {"result", "client_limited"}}),
+        a.client_limited[i].load());
+    w.counter("flexran_http_requests",
+        writer::labels({{"class", cls}, {"result", "endpoint_limited"}}),
+        a.endpoint_limited[i].load());
+  }
+  w.counter("flexran_http_requests",
+      writer::labels({{"class", "heavy"}, {"result", "heavy_limited"}}),
+      a.heavy_limited.load());
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    metrics_calls.h
+ *  \brief   NB API for controller and RAN metrics in OpenMetrics format
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef _METRICS_CALLS_H_
+#define _METRICS_CALLS_H_
+
+#include <mutex>
+
+#include <pistache/http.h>
+#include <pistache/description.h>
+
+#include "app_calls.h"
+#include "stats_manager.h"
+#include "ran_metrics.h"
+#include "metrics.h"
+#include "task_manager.h"
+#include "background_executor.h"
+#include "async_xface.h"
+#include "requests_manager.h"
+
+namespace flexran {
+
+  namespace north_api {
+
+    class metrics_calls : public app_calls {
+
+    public:
+
+      metrics_calls(std::shared_ptr<flexran::app::stats::stats_manager> stats,
+          const flexran::core::task_manager& tm,
+          const flexran::core::command_queue& commands,
+          const flexran::core::background_executor& executor,
+          const flexran::network::async_xface& xface,
+          const flexran::core::requests_manager& rm)
+        : stats_app(stats), tm_(tm), commands_(commands), executor_(executor),
+          xface_(xface), req_manager_(rm)
+      {}
+
+      void register_calls(Pistache::Rest::Description& desc);
+
+      void get_metrics(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+    private:
+
+      /* counters of the controller itself */
+      void write_internal(flexran::core::metrics::writer& w) const;
+
+      std::shared_ptr<flexran::app::stats::stats_manager> stats_app;
+      const flexran::core::task_manager& tm_;
+      const flexran::core::command_queue& commands_;
+      const flexran::core::background_executor& executor_;
+      const flexran::network::async_xface& xface_;
+      const flexran::core::requests_manager& req_manager_;
+
+      /* scrapes are serialized: they share the label sets of ran_ */
+      std::mutex mutex_;
+      flexran::app::stats::ran_metrics ran_;
+      size_t last_size_ = 0;
+
+    };
+  }
+}
+
+#endif /* _METRICS_CALLS_H_ */
@@ -127,6 +127,68 @@ void flexran::north_api::plmn_calls::register_calls(Pistache::Rest::Description&
                   "Remove an MME")
            .bind(&flexran::north_api::plmn_calls::remove_mme, this);
 
+  /**
+   * @api {post} /mme/batch/:bs Add a new MME at many BSs
+   * @apiName AddMmeBatch
+   * @apiGroup PlmnManagement
+   * @apiParam (URL parameter) {String} bs The BSs to which to add the MME:
+   * `all` (all connected BSs), a comma-separated list of BS or agent IDs (as
+   * for <a href="#api-PlmnManagement-AddMme">AddMme</a>), or `label=<label>`
+   * for all connected BSs with this label (see <a
+   * href="#api-BSLabels-AddLabel">AddLabel</a>).
+   * @apiParam (JSON parameter) {Object[]} mme As for <a
+   * href="#api-PlmnManagement-AddMme">AddMme</a>.
+   *
+   * @apiDescription Like <a href="#api-PlmnManagement-AddMme">AddMme</a>,
+   * but for many BSs at once. The request is validated once and rejected as
+   * a whole if it is invalid. Otherwise, the result is reported per BS, e.g.,
+   * if the MME is already present at a BS, and the same message is sent to
+   * all other BSs.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -XPOST localhost:9999/mme/batch/label=north --data-binary @mme.json
+   *
+   * @apiSuccessExample Success-Response:
+   *    HTTP/1.1 200 OK
+   *    {"results":[{"bs_id":234881024,"status":"Ok"},{"bs_id":234881025,"error":"MME at IP 192.168.12.4 already present"}]}
+   *
+   * @apiError BadRequest Missing or wrong parameters, or no BS selected,
+   * reported as JSON.
+   *
+   * @apiErrorExample Error-Response:
+   *    HTTP/1.1 400 BadRequest
+   *    { "error": "no BS selected by label=north" }
+   */
+  mme_calls.route(desc.post("/batch/:bs"),
+                  "Post an MME configuration to many BSs")
+           .bind(&flexran::north_api::plmn_calls::add_mme_batch, this);
+
+  /**
+   * @api {delete} /mme/batch/:bs Remove an MME at many BSs
+   * @apiName RemoveMmeBatch
+   * @apiGroup PlmnManagement
+   * @apiParam (URL parameter) {String} bs The BSs from which to remove the
+   * MME, see <a href="#api-PlmnManagement-AddMmeBatch">AddMmeBatch</a>.
+   * @apiParam (JSON parameter) {Object[]} mme As for <a
+   * href="#api-PlmnManagement-RemoveMme">RemoveMme</a>.
+   *
+   * @apiDescription Like <a href="#api-PlmnManagement-RemoveMme">RemoveMme</a>,
+   * but for many BSs at once, with results per BS.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -XDELETE localhost:9999/mme/batch/all --data-binary @mme.json
+   *
+   * @apiError BadRequest Missing or wrong parameters, or no BS selected,
+   * reported as JSON.
+   */
+  mme_calls.route(desc.del("/batch/:bs"),
+                  "Remove an MME at many BSs")
+           .bind(&flexran::north_api::plmn_calls::remove_mme_batch, this);
+
   auto plmn_calls = desc.path("/plmn");
 
   /**
@@ -188,6 +250,30 @@ void flexran::north_api::plmn_calls::register_calls(Pistache::Rest::Description&
   plmn_calls.route(desc.post("/enb/:id?"),
                    "Post a new set of PLMNs")
             .bind(&flexran::north_api::plmn_calls::change_plmn, this);
+
+  /**
+   * @api {post} /plmn/batch/:bs Push PLMNs to many BSs
+   * @apiName PushPLMNsBatch
+   * @apiGroup PlmnManagement
+   * @apiParam (URL parameter) {String} bs The BSs to push the PLMNs to, see
+   * <a href="#api-PlmnManagement-AddMmeBatch">AddMmeBatch</a>.
+   * @apiParam (JSON parameter) {Object[]} plmnId As for <a
+   * href="#api-PlmnManagement-PushPLMNs">PushPLMNs</a>.
+   *
+   * @apiDescription Like <a href="#api-PlmnManagement-PushPLMNs">PushPLMNs</a>,
+   * but for many BSs at once, with results per BS.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -XPOST localhost:9999/plmn/batch/0xe000,0xe001 --data-binary @plmn.json
+   *
+   * @apiError BadRequest Missing or wrong parameters, or no BS selected,
+   * reported as JSON.
+   */
+  plmn_calls.route(desc.post("/batch/:bs"),
+                   "Post a new set of PLMNs to many BSs")
+            .bind(&flexran::north_api::plmn_calls::change_plmn_batch, this);
 }
 
 void flexran::north_api::plmn_calls::add_mme(
@@ -204,7 +290,7 @@ void flexran::north_api::plmn_calls::add_mme(
   }
 
   try {
-    plmn_app->add_mme(bs, policy);
+    in_rt([&] { plmn_app->add_mme(bs, policy); });
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -230,7 +316,7 @@ void flexran::north_api::plmn_calls::remove_mme(
   }
 
   try {
-    plmn_app->remove_mme(bs, policy);
+    in_rt([&] { plmn_app->remove_mme(bs, policy); });
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -256,7 +342,7 @@ void flexran::north_api::plmn_calls::change_plmn(
   }
 
   try {
-    plmn_app->change_plmn(bs, policy);
+    in_rt([&] { plmn_app->change_plmn(bs, policy); });
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -267,3 +353,54 @@ void flexran::north_api::plmn_calls::change_plmn(
 
   response.send(Pistache::Http::Code::Ok, "{ \"status\": \"Ok\" }\n");
 }
+
+void flexran::north_api::plmn_calls::add_mme_batch(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  std::string policy = request.body();
+  if (policy.length() == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"empty request body\" }\n", MIME(Application, Json));
+    return;
+  }
+
+  run_batch(request, response, *plmn_app,
+      [&] (const std::vector<uint64_t>& bs_ids, flexran::app::batch_results& results) {
+        plmn_app->add_mme(bs_ids, policy, results);
+      });
+}
+
+void flexran::north_api::plmn_calls::remove_mme_batch(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  std::string policy = request.body();
+  if (policy.length() == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"empty request body\" }\n", MIME(Application, Json));
+    return;
+  }
+
+  run_batch(request, response, *plmn_app,
+      [&] (const std::vector<uint64_t>& bs_ids, flexran::app::batch_results& results) {
+        plmn_app->remove_mme(bs_ids, policy, results);
+      });
+}
+
+void flexran::north_api::plmn_calls::change_plmn_batch(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  std::string policy = request.body();
+  if (policy.length() == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"empty request body\" }\n", MIME(Application, Json));
+    return;
+  }
+
+  run_batch(request, response, *plmn_app,
+      [&] (const std::vector<uint64_t>& bs_ids, flexran::app::batch_results& results) {
+        plmn_app->change_plmn(bs_ids, policy, results);
+      });
+}
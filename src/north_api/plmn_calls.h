@@ -54,6 +54,15 @@ namespace flexran {
       void change_plmn(const Pistache::Rest::Request& request,
                        Pistache::Http::ResponseWriter response);
 
+      void add_mme_batch(const Pistache::Rest::Request& request,
+                         Pistache::Http::ResponseWriter response);
+
+      void remove_mme_batch(const Pistache::Rest::Request& request,
+                            Pistache::Http::ResponseWriter response);
+
+      void change_plmn_batch(const Pistache::Rest::Request& request,
+                             Pistache::Http::ResponseWriter response);
+
     private:
 
       std::shared_ptr<flexran::app::management::plmn_management> plmn_app;
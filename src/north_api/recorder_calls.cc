@@ -40,7 +40,8 @@ void flexran::north_api::recorder_calls::register_calls(Pistache::Rest::Descript
    * @apiName postJob
    * @apiGroup Recorder
    * @apiParam {String} type The type specifies the output format. Available
-   * types are : all (default), enb, stats, bin (binary)
+   * types are : all (default), enb, stats, bin (binary), delta (binary,
+   * storing only what changed between milliseconds)
    * @apiParam {Number{1-}} duration=1000 Duration of record in milliseconds,
    * must be a positive value.
    *
@@ -49,7 +50,11 @@ void flexran::north_api::recorder_calls::register_calls(Pistache::Rest::Descript
    * optional. There is only one job at a time possible. Even if the all type
    * is the default, the bin type provides the highest flexibility as the
    * different all other representations (all, enb, stats) can be reproduced
-   * using the `parse-bd` utility. Note that the file written by the recorder
+   * using the `parse-bd` utility. The delta type stores the same information
+   * in a fraction of the space and should be preferred for long records; it
+   * is read by `parse-bd` as well, and `rec-slice` extracts time slices of
+   * single BSs without reading the whole file. Its blocks are compressed
+   * (see the `--record-compression` option of the controller). Note that the file written by the recorder
    * will be located in the `/tmp/` folder and could be directly copied from
    * there.
    *
@@ -85,7 +90,7 @@ void flexran::north_api::recorder_calls::register_calls(Pistache::Rest::Descript
    *
    * @apiDescription This API returns the recorded data corresponding to a
    * record job and according to the previously requested type and duration. In
-   * the case of the binary type, this call returns a binary representation
+   * the case of the binary types, this call returns a binary representation
    * that can be parsed with the `parse-bd` utility located in `build/`. For
    * more information, execute it without any parameters (`build/parse-bd`).
    *
@@ -354,6 +359,38 @@ void flexran::north_api::recorder_calls::register_calls(Pistache::Rest::Descript
   recorder.route(desc.get("/:id"),
                  "Return the recorded data corresponding to a record job")
           .bind(&flexran::north_api::recorder_calls::obtain_json_stats, this);
+
+  /**
+   * @api {get} /record/:id/progress  Get the progress of a record job
+   * @apiName jobProgress
+   * @apiGroup Recorder
+   * @apiParam {Number} id Identifier of the record job, obtained by a
+   *                       successful POST.
+   *
+   * @apiDescription This API returns the state of a record job: `scheduled`
+   * (it starts after the previous job), `recording`, `writing` (the recording
+   * ended, but the file is not complete yet), or `finished` (the data can be
+   * downloaded). It also returns the number of chunks (one per millisecond)
+   * recorded, written to the file, dropped since the writer was too slow, and
+   * the total of the job.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9999/record/1/progress
+   * @apiSuccessExample Success-Response:
+   *     HTTP/1.1 200 OK
+   *     { "id": 1, "state": "writing", "recorded": 1000, "written": 640,
+   *       "dropped": 0, "total": 1000 }
+   *
+   * @apiError BadRequest The ID has not been found.
+   * @apiErrorExample Example error response (no corresponding job)
+   *    HTTP/1.1 400 BadRequest
+   *    { "error": "Invalid ID (no such job)" }
+   */
+  recorder.route(desc.get("/:id/progress"),
+                 "Return the progress of a record job")
+          .bind(&flexran::north_api::recorder_calls::job_progress, this);
 }
 
 void flexran::north_api::recorder_calls::start_meas(const Pistache::Rest::Request& request,
@@ -365,7 +402,7 @@ void flexran::north_api::recorder_calls::start_meas(const Pistache::Rest::Reques
   response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
 
   std::string id;
-  bool success = json_app->start_meas(duration, type, id);
+  bool success = in_rt([&] { return json_app->start_meas(duration, type, id); });
   if (success) {
     response.setMime(MIME(Text, Plain));
     response.headers().add<Pistache::Http::Header::ContentLength>(id.length());
@@ -385,14 +422,15 @@ void flexran::north_api::recorder_calls::obtain_json_stats(const Pistache::Rest:
 
   // dummy initialization
   flexran::app::log::job_info info{0, 0, id, flexran::app::log::job_type::all};
-  if (!json_app->get_job_info(id, info)) {
+  if (!in_rt([&] { return json_app->get_job_info(id, info); })) {
     response.send(Pistache::Http::Code::Bad_Request, "{\"error\":\"Invalid ID (no such job)\"}");
     return;
   }
 
   std::ifstream file;
 
-  if (info.type == flexran::app::log::job_type::bin)
+  if (info.type == flexran::app::log::job_type::bin
+      || info.type == flexran::app::log::job_type::delta)
     file.open(info.filename, std::ios::binary);
   else
     file.open(info.filename);
@@ -413,3 +451,25 @@ void flexran::north_api::recorder_calls::obtain_json_stats(const Pistache::Rest:
 
   response.send(Pistache::Http::Code::Ok, ss.str());
 }
+
+void flexran::north_api::recorder_calls::job_progress(const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  std::string id = request.param(":id").as<std::string>();
+
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+
+  flexran::app::log::recorder::job_progress p;
+  if (!in_rt([&] { return json_app->get_job_progress(id, p); })) {
+    response.send(Pistache::Http::Code::Bad_Request, "{\"error\":\"Invalid ID (no such job)\"}");
+    return;
+  }
+
+  response.setMime(MIME(Application, Json));
+  response.send(Pistache::Http::Code::Ok, "{\"id\":" + id
+      + ",\"state\":\"" + flexran::app::log::recorder::to_string(p.s) + "\""
+      + ",\"recorded\":" + std::to_string(p.recorded)
+      + ",\"written\":" + std::to_string(p.written)
+      + ",\"dropped\":" + std::to_string(p.dropped)
+      + ",\"total\":" + std::to_string(p.total) + "}");
+}
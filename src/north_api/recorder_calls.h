@@ -51,6 +51,9 @@ namespace flexran {
       void obtain_json_stats(const Pistache::Rest::Request& request,
           Pistache::Http::ResponseWriter response);
 
+      void job_progress(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
 
     private:
 
@@ -108,6 +108,36 @@ void flexran::north_api::rrc_triggering_calls::register_calls(Pistache::Rest::De
   rrc_trigger.route(desc.post("/reconf/enb/:id?"), "Reconfigure RRC parameters")
              .bind(&flexran::north_api::rrc_triggering_calls::rrc_reconf, this);
 
+  /**
+   * @api {post} /rrc/reconf/batch/:bs Reconfigure RRC parameters of many BSs
+   * @apiName ReconfigureRrcParamBatch
+   * @apiGroup RRC Control
+   *
+   * @apiParam (URL parameter) {String} bs The affected BSs: `all` (all
+   * connected BSs), a comma-separated list of BS or agent IDs, or
+   * `label=<label>` for all connected BSs with this label (see <a
+   * href="#api-BSLabels-AddLabel">AddLabel</a>).
+   *
+   * @apiDescription Like <a
+   * href="#api-RRC_Control-ReconfigureRrcParam">ReconfigureRrcParam</a>, but
+   * for many BSs at once. The parameters are parsed once and the same
+   * message is sent to all BSs. The result is reported per BS.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -X POST http://127.0.0.1:9999/rrc/reconf/batch/all --data-binary "@json-file"
+   *
+   * @apiSuccessExample Success-Response:
+   *    HTTP/1.1 200 OK
+   *    {"results":[{"bs_id":234881024,"status":"Ok"},{"bs_id":234881025,"status":"Ok"}]}
+   *
+   * @apiError BadRequest Missing or wrong parameters, or no BS selected,
+   * reported as JSON.
+   */
+  rrc_trigger.route(desc.post("/reconf/batch/:bs"), "Reconfigure RRC parameters of many BSs")
+             .bind(&flexran::north_api::rrc_triggering_calls::rrc_reconf_batch, this);
+
   /**
    * @api {post} /rrc/ho/senb/:sid/ue/:ue/tenb/:tid Trigger HO
    * @apiName TriggerHO
@@ -179,6 +209,31 @@ void flexran::north_api::rrc_triggering_calls::register_calls(Pistache::Rest::De
   rrc_trigger.route(desc.post("/x2_ho_net_control/enb/:id/:bool"),
                     "Enable/Disable X2 handover network control")
              .bind(&flexran::north_api::rrc_triggering_calls::rrc_x2_ho_net_control, this);
+
+  /**
+   * @api {post} /rrc/x2_ho_net_control/batch/:bs/:bool Toggle HO NetControl State of many BSs
+   * @apiName ToggleHONetControlBatch
+   * @apiGroup RRC Control
+   *
+   * @apiParam (URL parameter) {String} bs The affected BSs, see <a
+   * href="#api-RRC_Control-ReconfigureRrcParamBatch">ReconfigureRrcParamBatch</a>.
+   * @apiParam (URL parameter) {Bool=0,1} bool Whether HO control is network-
+   * or user-initiated.
+   *
+   * @apiDescription Like <a
+   * href="#api-RRC_Control-ToggleHONetControl">ToggleHONetControl</a>, but
+   * for many BSs at once, with results per BS.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -X POST http://127.0.0.1:9999/rrc/x2_ho_net_control/batch/label=campus/1
+   *
+   * @apiError BadRequest No BS selected, reported as JSON.
+   */
+  rrc_trigger.route(desc.post("/x2_ho_net_control/batch/:bs/:bool"),
+                    "Enable/Disable X2 handover network control of many BSs")
+             .bind(&flexran::north_api::rrc_triggering_calls::rrc_x2_ho_net_control_batch, this);
 }
 
 void flexran::north_api::rrc_triggering_calls::rrc_reconf(
@@ -196,7 +251,7 @@ void flexran::north_api::rrc_triggering_calls::rrc_reconf(
   }
 
   std::string error_reason;
-  if (!rrc_trigger->rrc_reconf(bs, policy, error_reason)) {
+  if (!in_rt([&] { return rrc_trigger->rrc_reconf(bs, policy, error_reason); })) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
     return;
@@ -213,7 +268,7 @@ void flexran::north_api::rrc_triggering_calls::rrc_ho(
   std::string tenb = request.param(":tid").as<std::string>();
 
   std::string error_reason;
-  if (!rrc_trigger->rrc_ho(senb, ue, tenb, error_reason)) {
+  if (!in_rt([&] { return rrc_trigger->rrc_ho(senb, ue, tenb, error_reason); })) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
     return;
@@ -228,10 +283,42 @@ void flexran::north_api::rrc_triggering_calls::rrc_x2_ho_net_control(
   bool x2_ho_net_control = request.param(":bool").as<bool>();
   std::string enb = request.param(":id").as<std::string>();
   std::string error_reason;
-  if (!rrc_trigger->rrc_x2_ho_net_control(enb, x2_ho_net_control, error_reason)) {
+  if (!in_rt([&] {
+        return rrc_trigger->rrc_x2_ho_net_control(enb, x2_ho_net_control, error_reason);
+      })) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
     return;
   }
   response.send(Pistache::Http::Code::Ok, "");
 }
+
+void flexran::north_api::rrc_triggering_calls::rrc_reconf_batch(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  std::string policy = request.body();
+  if (policy.length() == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"empty request body\" }\n", MIME(Application, Json));
+    return;
+  }
+
+  run_batch(request, response, *rrc_trigger,
+      [&] (const std::vector<uint64_t>& bs_ids, flexran::app::batch_results& results) {
+        std::string error_reason;
+        if (!rrc_trigger->rrc_reconf(bs_ids, policy, results, error_reason))
+          throw std::invalid_argument(error_reason);
+      });
+}
+
+void flexran::north_api::rrc_triggering_calls::rrc_x2_ho_net_control_batch(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  bool x2_ho_net_control = request.param(":bool").as<bool>();
+  run_batch(request, response, *rrc_trigger,
+      [&] (const std::vector<uint64_t>& bs_ids, flexran::app::batch_results& results) {
+        rrc_trigger->rrc_x2_ho_net_control(bs_ids, x2_ho_net_control, results);
+      });
+}
@@ -51,6 +51,10 @@ namespace flexran {
                   Pistache::Http::ResponseWriter response);
       void rrc_x2_ho_net_control(const Pistache::Rest::Request& request,
                                  Pistache::Http::ResponseWriter response);
+      void rrc_reconf_batch(const Pistache::Rest::Request& request,
+                            Pistache::Http::ResponseWriter response);
+      void rrc_x2_ho_net_control_batch(const Pistache::Rest::Request& request,
+                                       Pistache::Http::ResponseWriter response);
 
     private:
 
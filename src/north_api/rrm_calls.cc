@@ -440,6 +440,69 @@ void flexran::north_api::rrm_calls::register_calls(Pistache::Rest::Description&
                   "Delete slices as specified in the JSON")
            .bind(&flexran::north_api::rrm_calls::remove_slice_config, this);
 
+  /**
+   * @api {post} /slice/batch/:bs Post a slice configuration to many BSs
+   * @apiName ApplySliceConfigurationBatch
+   * @apiGroup SliceConfiguration
+   *
+   * @apiParam (URL parameter) {String} bs The BSs to configure: `all` (all
+   * connected BSs), a comma-separated list of BS or agent IDs (as for <a
+   * href="#api-SliceConfiguration-ApplySliceConfiguration">ApplySliceConfiguration</a>),
+   * or `label=<label>` for all connected BSs with this label (see <a
+   * href="#api-BSLabels-AddLabel">AddLabel</a>).
+   *
+   * @apiDescription Applies the same slice configuration as <a
+   * href="#api-SliceConfiguration-ApplySliceConfiguration">ApplySliceConfiguration</a>
+   * to many BSs. The configuration is parsed once and rejected as a whole if
+   * it is mal-formed. Checks against the current configuration of a BS
+   * (e.g., the resources of static slices) are made per BS, and the result
+   * of each BS is reported. All BSs that receive the same configuration get
+   * the same message.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -X POST http://127.0.0.1:9999/slice/batch/label=campus --data-binary "@file"
+   *
+   * @apiSuccessExample Success-Response:
+   *    HTTP/1.1 200 OK
+   *    {"results":[{"bs_id":234881024,"status":"Ok"},{"bs_id":234881025,"error":"overlapping slices at RBG 3 for existing slice 1"}]}
+   *
+   * @apiError BadRequest Mal-formed request, or no BS selected, reported as
+   * JSON.
+   *
+   * @apiErrorExample Error-Response:
+   *    HTTP/1.1 400 BadRequest
+   *    { "error": "can not find BS 0xe001" }
+   */
+  rrm_calls.route(desc.post("/slice/batch/:bs"),
+                  "Post a new slice configuration to many BSs")
+           .bind(&flexran::north_api::rrm_calls::apply_slice_config_batch, this);
+
+  /**
+   * @api {delete} /slice/batch/:bs Delete slices at many BSs
+   * @apiName DeleteSliceBatch
+   * @apiGroup SliceConfiguration
+   *
+   * @apiParam (URL parameter) {String} bs The BSs to configure, see <a
+   * href="#api-SliceConfiguration-ApplySliceConfigurationBatch">ApplySliceConfigurationBatch</a>.
+   *
+   * @apiDescription Like <a
+   * href="#api-SliceConfiguration-DeleteSlice">DeleteSlice</a>, but for many
+   * BSs at once, with results per BS.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -X DELETE http://127.0.0.1:9999/slice/batch/all --data-binary "@file"
+   *
+   * @apiError BadRequest Mal-formed request, or no BS selected, reported as
+   * JSON.
+   */
+  rrm_calls.route(desc.del("/slice/batch/:bs"),
+                  "Delete slices at many BSs")
+           .bind(&flexran::north_api::rrm_calls::remove_slice_config_batch, this);
+
   /**
    * @api {post} /ue_slice_assoc/enb/:id? Change the UE-slice association
    * @apiName ChangeUeSliceAssociation
@@ -583,6 +646,83 @@ void flexran::north_api::rrm_calls::register_calls(Pistache::Rest::Description&
                   "Change the cell configuration of the eNodeB")
            .bind(&flexran::north_api::rrm_calls::cell_reconfiguration, this);
 
+  /**
+   * @api {post} /conf/batch/:bs Change the cell configuration of many BSs
+   * @apiName CellReconfigurationBatch
+   * @apiGroup CellConfigurationPolicy
+   *
+   * @apiParam (URL parameter) {String} bs The BSs to configure, see <a
+   * href="#api-SliceConfiguration-ApplySliceConfigurationBatch">ApplySliceConfigurationBatch</a>.
+   *
+   * @apiDescription Like <a
+   * href="#api-CellConfigurationPolicy-CellReconfiguration">CellReconfiguration</a>,
+   * but for many BSs at once, with results per BS.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -X POST http://127.0.0.1:9999/conf/batch/all --data-binary "@file"
+   *
+   * @apiError BadRequest Mal-formed request, or no BS selected, reported as
+   * JSON.
+   */
+  rrm_calls.route(desc.post("/conf/batch/:bs"),
+                  "Change the cell configuration of many eNodeBs")
+           .bind(&flexran::north_api::rrm_calls::cell_reconfiguration_batch, this);
+
+  /**
+   * @api {post} /label/:label/enb/:id Add a label to a BS
+   * @apiName AddLabel
+   * @apiGroup BSLabels
+   *
+   * @apiParam (URL parameter) {String} label The label, which must not
+   * contain `,` or `=`.
+   * @apiParam (URL parameter) {Number} id The ID of the BS: -1 (last added
+   * agent), the eNB ID (in hex or decimal) or the agent ID.
+   *
+   * @apiDescription Labels group BSs for batch operations, e.g., <a
+   * href="#api-SliceConfiguration-ApplySliceConfigurationBatch">ApplySliceConfigurationBatch</a>
+   * with `label=<label>`. A BS can have many labels. Labels are kept if the BS
+   * disconnects and apply again when it reconnects, but not across controller
+   * restarts.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -X POST http://127.0.0.1:9999/label/campus/enb/0xe000
+   *
+   * @apiSuccessExample Success-Response:
+   *    HTTP/1.1 200 OK
+   *
+   * @apiError BadRequest The BS does not exist or the label is invalid.
+   */
+  rrm_calls.route(desc.post("/label/:label/enb/:id"),
+                  "Add a label to a BS")
+           .bind(&flexran::north_api::rrm_calls::add_label, this);
+
+  /**
+   * @api {delete} /label/:label/enb/:id Remove a label of a BS
+   * @apiName RemoveLabel
+   * @apiGroup BSLabels
+   *
+   * @apiParam (URL parameter) {String} label The label to remove.
+   * @apiParam (URL parameter) {Number} id The ID of the BS, see <a
+   * href="#api-BSLabels-AddLabel">AddLabel</a>.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *    curl -X DELETE http://127.0.0.1:9999/label/campus/enb/0xe000
+   *
+   * @apiSuccessExample Success-Response:
+   *    HTTP/1.1 200 OK
+   *
+   * @apiError BadRequest The BS does not have this label.
+   */
+  rrm_calls.route(desc.del("/label/:label/enb/:id"),
+                  "Remove a label of a BS")
+           .bind(&flexran::north_api::rrm_calls::remove_label, this);
+
   /**
    * @api {post} /yaml/:id? Send arbitrary YAML to the agent
    * @apiName YamlCompat
@@ -621,7 +761,7 @@ void flexran::north_api::rrm_calls::apply_slice_config(
   }
 
   try {
-    rrm_app->apply_slice_config_policy(bs, policy);
+    in_rt([&] { rrm_app->apply_slice_config_policy(bs, policy); });
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -647,7 +787,7 @@ void flexran::north_api::rrm_calls::remove_slice_config(
   }
 
   try {
-    rrm_app->remove_slice(bs, policy);
+    in_rt([&] { rrm_app->remove_slice(bs, policy); });
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -673,7 +813,7 @@ void flexran::north_api::rrm_calls::change_ue_slice_assoc(
   }
 
   try {
-    rrm_app->change_ue_slice_association(bs, policy);
+    in_rt([&] { rrm_app->change_ue_slice_association(bs, policy); });
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -689,9 +829,11 @@ void flexran::north_api::rrm_calls::yaml_compat(
     const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response)
 {
-  uint64_t bs_id = request.hasParam(":id") ?
-      rrm_app->parse_enb_agent_id(request.param(":id").as<std::string>()) :
-      rrm_app->get_last_bs();
+  const std::string id = request.hasParam(":id")
+      ? request.param(":id").as<std::string>() : "";
+  const uint64_t bs_id = in_rt([&] {
+    return id.empty() ? rrm_app->get_last_bs() : rrm_app->parse_enb_agent_id(id);
+  });
   if (bs_id == 0) {
     response.send(Pistache::Http::Code::Not_Found, "Policy not set (no such BS)\n");
     return;
@@ -703,7 +845,7 @@ void flexran::north_api::rrm_calls::yaml_compat(
 
   LOG4CXX_INFO(flog::app, "sending YAML request to BS " << bs_id
       << " (compat):\n" << request.body());
-  rrm_app->reconfigure_agent_string(bs_id, request.body());
+  in_rt([&] { rrm_app->reconfigure_agent_string(bs_id, request.body()); });
   response.send(Pistache::Http::Code::Ok,
                 "Set the policy to BS " + std::to_string(bs_id) + "\n");
 }
@@ -712,9 +854,11 @@ void flexran::north_api::rrm_calls::cell_reconfiguration(
     const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response)
 {
-  uint64_t bs_id = request.hasParam(":id") ?
-      rrm_app->parse_enb_agent_id(request.param(":id").as<std::string>()) :
-      rrm_app->get_last_bs();
+  const std::string id = request.hasParam(":id")
+      ? request.param(":id").as<std::string>() : "";
+  const uint64_t bs_id = in_rt([&] {
+    return id.empty() ? rrm_app->get_last_bs() : rrm_app->parse_enb_agent_id(id);
+  });
   if (bs_id == 0) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"can not find BS\" }", MIME(Application, Json));
@@ -729,10 +873,93 @@ void flexran::north_api::rrm_calls::cell_reconfiguration(
   }
 
   std::string error_reason;
-  if (!rrm_app->apply_cell_config_policy(bs_id, policy, error_reason)) {
+  if (!in_rt([&] { return rrm_app->apply_cell_config_policy(bs_id, policy, error_reason); })) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }", MIME(Application, Json));
     return;
   }
   response.send(Pistache::Http::Code::Ok, "");
 }
+
+void flexran::north_api::rrm_calls::apply_slice_config_batch(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  std::string policy = request.body();
+  if (policy.length() == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"empty request body\" }\n", MIME(Application, Json));
+    return;
+  }
+
+  run_batch(request, response, *rrm_app,
+      [&] (const std::vector<uint64_t>& bs_ids, flexran::app::batch_results& results) {
+        rrm_app->apply_slice_config_policy(bs_ids, policy, results);
+      });
+}
+
+void flexran::north_api::rrm_calls::remove_slice_config_batch(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  std::string policy = request.body();
+  if (policy.length() == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"empty request body\" }\n", MIME(Application, Json));
+    return;
+  }
+
+  run_batch(request, response, *rrm_app,
+      [&] (const std::vector<uint64_t>& bs_ids, flexran::app::batch_results& results) {
+        rrm_app->remove_slice(bs_ids, policy, results);
+      });
+}
+
+void flexran::north_api::rrm_calls::cell_reconfiguration_batch(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  std::string policy = request.body();
+  if (policy.length() == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"empty request body\" }\n", MIME(Application, Json));
+    return;
+  }
+
+  run_batch(request, response, *rrm_app,
+      [&] (const std::vector<uint64_t>& bs_ids, flexran::app::batch_results& results) {
+        std::string error_reason;
+        if (!rrm_app->apply_cell_config_policy(bs_ids, policy, results, error_reason))
+          throw std::invalid_argument(error_reason);
+      });
+}
+
+void flexran::north_api::rrm_calls::add_label(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  const std::string label = request.param(":label").as<std::string>();
+  const std::string bs = request.param(":id").as<std::string>();
+  std::string error_reason;
+  if (!in_rt([&] { return rrm_app->label_bs(bs, label, true, error_reason); })) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
+    return;
+  }
+  response.send(Pistache::Http::Code::Ok, "");
+}
+
+void flexran::north_api::rrm_calls::remove_label(
+    const Pistache::Rest::Request& request,
+    Pistache::Http::ResponseWriter response)
+{
+  const std::string label = request.param(":label").as<std::string>();
+  const std::string bs = request.param(":id").as<std::string>();
+  std::string error_reason;
+  if (!in_rt([&] { return rrm_app->label_bs(bs, label, false, error_reason); })) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
+    return;
+  }
+  response.send(Pistache::Http::Code::Ok, "");
+}
@@ -56,6 +56,16 @@ namespace flexran {
 
       void cell_reconfiguration(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
 
+      void apply_slice_config_batch(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+
+      void remove_slice_config_batch(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+
+      void cell_reconfiguration_batch(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+
+      void add_label(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+
+      void remove_label(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+
     private:
 
       std::shared_ptr<flexran::app::management::rrm_management> rrm_app;
@@ -22,10 +22,43 @@
  *  \email   x.foukas@sms.ed.ac.uk, robert.schmidt@eurecom.fr
  */
 
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <sstream>
+
 #include <pistache/http.h>
 #include <pistache/http_header.h>
+#include <pistache/peer.h>
+#include <pistache/stream.h>
 
 #include "stats_manager_calls.h"
+#include "admission.h"
+#include "flexran_log.h"
+
+namespace {
+  /* REST reads may lag behind the RIB by this much; bounds the time the
+   * task manager spends on taking snapshots */
+  const std::chrono::milliseconds snapshot_max_age(20);
+  /* from this number of UEs on, responses are not rendered as a whole but
+   * sent in chunks of stream_chunk_size while serializing */
+  const size_t stream_min_ues = 500;
+  const size_t stream_chunk_size = 64 * 1024;
+  /* bounds the response cache, e.g., against many field selections */
+  const size_t max_cache_entries = 1024;
+  /* chunks a stream may have handed to the network before it waits for the
+   * client, and how long it waits until it gives up */
+  const size_t stream_max_in_flight = 2;
+  const std::chrono::seconds stream_write_timeout(10);
+
+  const char *protobuf_mime = "application/x-protobuf";
+
+  /* the protobuf representation needs its own entity tag */
+  std::string protobuf_etag(const std::string& etag)
+  {
+    return etag.substr(0, etag.size() - 1) + "-pb\"";
+  }
+}
 
 void flexran::north_api::stats_manager_calls::register_calls(Pistache::Rest::Description& desc)
 {
@@ -73,16 +106,63 @@ void flexran::north_api::stats_manager_calls::register_calls(Pistache::Rest::Des
    * * `enb_config`: static configuration (for eNB, UE, and LC)
    * * `mac_stats`:  statistics about various eNB layers (PDCP, RLC, MAC)
    * * `all`:        both of the above
+   * @apiParam {String} [fields] Comma-separated list of fields of the UE
+   * statistics reports (`mac_stats`) to return, using the names of the
+   * output (e.g., `dlCqiReport`) or of the protobuf definition (e.g.,
+   * `dl_cqi_report`). Top-level fields can also be given by a short name:
+   * `dl_cqi`, `ul_cqi`, `rlc`, `rrc`, `pdcp`, `mac`, `gtp`, and `s1ap` stand
+   * for `dl_cqi_report`, `ul_cqi_report`, `rlc_report`, `rrc_measurements`,
+   * `pdcp_stats`, `mac_stats`, `gtp_stats`, and `s1ap_stats`. Sub-fields are
+   * separated by a dot, e.g., `mac_stats.total_bytes_sdus_dl` or
+   * `macStats.totalBytesSdusDl`. `harq` selects the HARQ information.
+   * Without, all fields are returned.
+   * @apiParam {String} [bs] Comma-separated list of BS IDs or agent IDs to
+   * return. Without, all BSs are returned.
+   * @apiParam {String} [ue] Comma-separated list of RNTIs or IMSIs of the UEs
+   * to return. Applies to the UE statistics and UE/LC configurations.
+   * @apiParam {Number} [slice] Only return UEs in this DL slice.
+   * @apiParam {Number{1-}} [limit] Return at most this many UEs. If more
+   * UEs are selected, the response contains a `next_cursor`.
+   * @apiParam {String} [cursor] Return the page of UEs following the one
+   * that returned this `next_cursor`. The other parameters should be the
+   * same as in the previous request.
    *
    * @apiDescription This API gets the RAN config and status for the current
    * TTI for all eNBs connected to this controller. The output is in JSON
    * format. For human-readable output, see <a
    * href="#api-Stats-GetStatsHumanReadable">Stats:GetStatsHumanReadable</a>.
    *
+   * The response carries an `ETag` header that changes only if the RAN
+   * config or statistics change. If it is sent back in an `If-None-Match`
+   * header, the controller answers with `304 Not Modified` and no body. This
+   * holds for all JSON statistics of BSs and UEs, including the HARQ
+   * information of UEs. Responses compressed as requested
+   * through `Accept-Encoding` carry a tag of their own.
+   *
+   * The selection through `fields`, `bs`, `ue`, `slice`, and `limit` is
+   * applied while writing the output, so that a selective request is also
+   * cheaper for the controller.
+   *
+   * Large UE listings can be paged through `limit` and `cursor`: UEs are
+   * ordered by BS ID and RNTI, and as long as there are more UEs, the
+   * response contains a `next_cursor` to pass in the next request. A BS
+   * whose UEs are split across pages is contained in each of them. Large
+   * responses without `limit` are sent with chunked transfer encoding.
+   *
+   * With `Accept: application/x-protobuf`, the same selection is returned as
+   * a sequence of length-delimited `protocol.flex_nb_bs` messages (see
+   * `northbound.proto`), one per BS, named in the `X-Protobuf-Message`
+   * header. The next cursor is then returned in the `X-Next-Cursor` header.
+   * The HARQ information is not part of the protobuf output.
+   *
    * @apiVersion v0.1.0
    * @apiPermission None
    * @apiExample Example usage:
    *     curl -X GET http://127.0.0.1:9999/stats/
+   * @apiExample Example usage:
+   *     curl -X GET 'http://127.0.0.1:9999/stats/mac_stats?slice=1&fields=dlCqiReport,bsr,macStats.totalBytesSdusDl'
+   * @apiExample Example usage:
+   *     curl -X GET 'http://127.0.0.1:9999/stats/mac_stats?limit=100&cursor=234881037-1234'
    * @apiSuccessExample L2-simulator, 1 UE
    *     HTTP/1.1 200 OK
    *     {
@@ -3186,11 +3266,15 @@ void flexran::north_api::stats_manager_calls::register_calls(Pistache::Rest::Des
    *       ]
    *     }
    *
-   * @apiError BadRequest The given stats type is invalid.
+   * @apiError BadRequest The given stats type or selection is invalid.
    *
    * @apiErrorExample Error-Response:
    *     HTTP/1.1 400 BadRequest
    *     { "error": "invalid statistics type" }
+   *
+   * @apiErrorExample Error-Response:
+   *     HTTP/1.1 400 BadRequest
+   *     { "error": "unknown field dl_cqi" }
    */
   stats.route(desc.get("/:type?"),
               "Get JSON RAN config for type")
@@ -3209,10 +3293,19 @@ void flexran::north_api::stats_manager_calls::register_calls(Pistache::Rest::Des
    * * `enb_config`: static configuration (for eNB, UE, and LC)
    * * `mac_stats`:  statistics about various eNB layers (PDCP, RLC, MAC)
    * * `all`:        both of the above
+   * @apiParam {String} [fields] The fields of the UE statistics to return,
+   * see <a href="#api-Stats-GetStats">Stats:GetStats</a>.
+   * @apiParam {String} [ue] Comma-separated list of RNTIs or IMSIs of the UEs
+   * to return.
+   * @apiParam {Number} [slice] Only return UEs in this DL slice.
+   * @apiParam {Number{1-}} [limit] Return at most this many UEs.
+   * @apiParam {String} [cursor] Return the next page of UEs, see
+   * <a href="#api-Stats-GetStats">Stats:GetStats</a>.
    *
    * @apiDescription This API gets the RAN config and status for the current
-   * TTI for a given eNB. The output is in JSON format. No human-readable
-   * format exists corresponding to this endpoint.
+   * TTI for a given eNB. The output is in JSON format, or in protobuf as
+   * described in <a href="#api-Stats-GetStats">Stats:GetStats</a>. No
+   * human-readable format exists corresponding to this endpoint.
    *
    * @apiVersion v0.1.0
    * @apiPermission None
@@ -3248,10 +3341,13 @@ void flexran::north_api::stats_manager_calls::register_calls(Pistache::Rest::Des
    * * `enb_config`: static configuration (for eNB, UE, and LC)
    * * `mac_stats`:  statistics about various eNB layers (PDCP, RLC, MAC)
    * * `all`:        both of the above
+   * @apiParam {String} [fields] The fields of the UE statistics to return,
+   * see <a href="#api-Stats-GetStats">Stats:GetStats</a>.
    *
    * @apiDescription This API gets the UE statistics (`mac_stats`) for one UE
-   * registered at any eNB managed by the controller. No
-   * human-readable format exists corresponding to this endpoint.
+   * registered at any eNB managed by the controller. With `Accept:
+   * application/x-protobuf`, a single `protocol.flex_ue_stats_report` is
+   * returned. No human-readable format exists corresponding to this endpoint.
    *
    * @apiVersion v0.1.0
    * @apiPermission None
@@ -3278,6 +3374,8 @@ void flexran::north_api::stats_manager_calls::register_calls(Pistache::Rest::Des
    * @apiParam {number} id_ue The ID of the UE in the form of either an RNTI or
    * the IMSI. Everything shorter than 6 digits will be treated as the RNTI,
    * the rest as the IMSI.
+   * @apiParam {String} [fields] The fields of the UE statistics to return,
+   * see <a href="#api-Stats-GetStats">Stats:GetStats</a>.
    *
    * @apiDescription This API gets the UE statistics ("mac_stats") for one UE.
    * The search is restrained to a given eNB registered at the controller. No
@@ -3404,6 +3502,7 @@ void flexran::north_api::stats_manager_calls::obtain_stats(const Pistache::Rest:
   const std::string type = request.hasParam(":type") ?
       request.param(":type").as<std::string>() : REQ_TYPE::ALL_STATS;
 
+  refresh_snapshot();
   std::string resp;
   if (type == REQ_TYPE::ALL_STATS) {
     resp = stats_app->all_stats_to_string();
@@ -3423,24 +3522,44 @@ void flexran::north_api::stats_manager_calls::obtain_json_stats(const Pistache::
 {
   const std::string type = request.hasParam(":type") ?
       request.param(":type").as<std::string>() : REQ_TYPE::ALL_STATS;
-  std::string resp;
+  flexran::rib::stats_filter filter;
+  std::function<std::string()> render;
   if (type == REQ_TYPE::ALL_STATS) {
-    resp = stats_app->all_stats_to_json_string();
+    render = [this, &filter] () { return stats_app->all_stats_to_json_string(filter); };
   } else if (type == REQ_TYPE::ENB_CONFIG) {
-    resp = stats_app->all_enb_configs_to_json_string();
+    render = [this, &filter] () { return stats_app->all_enb_configs_to_json_string(filter); };
   } else if (type == REQ_TYPE::MAC_STATS) {
-    resp = stats_app->all_mac_configs_to_json_string();
+    render = [this, &filter] () { return stats_app->all_mac_configs_to_json_string(filter); };
   } else {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"invalid statistics type\"}", MIME(Application, Json));
     return;
   }
-  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
-  response.send(Pistache::Http::Code::Ok, resp, MIME(Application, Json));
+  refresh_snapshot();
+  std::string error_reason;
+  bool filtered = false;
+  if (!parse_filter(request, true, true, filter, filtered, error_reason)) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"" + error_reason + "\" }", MIME(Application, Json));
+    return;
+  }
+  if (accepts_protobuf(request)) {
+    send_protobuf_stats(request, response, type, 0, filter, filtered);
+    return;
+  }
+  if (!filter.paged() && stats_app->num_ues() >= stream_min_ues) {
+    send_stream(request, response, stats_app->stats_etag(type),
+        [this, type, filter] (const flexran::rib::json_writer& out)
+        { stats_app->write_json_stats(type, 0, out, filter); });
+    return;
+  }
+  send_cached(request, response, filtered ? "" : "stats/" + type, 0, -1,
+      stats_app->stats_etag(type), render);
 }
 
 void flexran::north_api::stats_manager_calls::obtain_json_stats_enb(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
+  refresh_snapshot();
   uint64_t bs_id = stats_app->parse_bs_agent_id(request.param(":id").as<std::string>());
   if (bs_id == 0) {
     response.send(Pistache::Http::Code::Bad_Request,
@@ -3451,25 +3570,49 @@ void flexran::north_api::stats_manager_calls::obtain_json_stats_enb(const Pistac
   const std::string type = request.hasParam(":type") ?
       request.param(":type").as<std::string>() : REQ_TYPE::ALL_STATS;
 
-  std::string resp;
+  flexran::rib::stats_filter filter;
+  std::function<bool(uint64_t, std::string&)> dump;
   if (type == REQ_TYPE::ALL_STATS) {
-    stats_app->stats_by_bs_id_to_json_string(bs_id, resp);
+    dump = [this, &filter] (uint64_t id, std::string& out)
+        { return stats_app->stats_by_bs_id_to_json_string(id, out, filter); };
   } else if (type == REQ_TYPE::ENB_CONFIG) {
-    stats_app->enb_configs_by_bs_id_to_json_string(bs_id, resp);
+    dump = [this, &filter] (uint64_t id, std::string& out)
+        { return stats_app->enb_configs_by_bs_id_to_json_string(id, out, filter); };
   } else if (type == REQ_TYPE::MAC_STATS) {
-    stats_app->mac_configs_by_bs_id_to_json_string(bs_id, resp);
+    dump = [this, &filter] (uint64_t id, std::string& out)
+        { return stats_app->mac_configs_by_bs_id_to_json_string(id, out, filter); };
   } else {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"invalid statistics type\" }", MIME(Application, Json));
     return;
   }
 
-  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
-  response.send(Pistache::Http::Code::Ok, resp, MIME(Application, Json));
+  std::string error_reason;
+  bool filtered = false;
+  if (!parse_filter(request, false, true, filter, filtered, error_reason)) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"" + error_reason + "\" }", MIME(Application, Json));
+    return;
+  }
+
+  if (accepts_protobuf(request)) {
+    send_protobuf_stats(request, response, type, bs_id, filter, filtered);
+    return;
+  }
+  if (!filter.paged() && stats_app->num_ues(bs_id) >= stream_min_ues) {
+    send_stream(request, response, stats_app->stats_etag(type, bs_id),
+        [this, type, bs_id, filter] (const flexran::rib::json_writer& out)
+        { stats_app->write_json_stats(type, bs_id, out, filter); });
+    return;
+  }
+  send_cached(request, response, filtered ? "" : "stats/" + type, bs_id, -1,
+      stats_app->stats_etag(type, bs_id),
+      [bs_id, &dump] () { std::string resp; dump(bs_id, resp); return resp; });
 }
 
 void flexran::north_api::stats_manager_calls::obtain_json_stats_ue(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
+  refresh_snapshot();
   uint64_t bs_id = 0;
   const bool check_enb = request.hasParam(":id_enb");
   if (check_enb) {
@@ -3492,11 +3635,354 @@ void flexran::north_api::stats_manager_calls::obtain_json_stats_ue(const Pistach
     return;
   }
 
-  /* at this point, both the correct bs_id and RNTI will be known */
-  std::string resp;
-  stats_app->ue_stats_by_rnti_by_bs_id_to_json_string(rnti, resp, bs_id);
+  flexran::rib::stats_filter filter;
+  std::string error_reason;
+  bool filtered = false;
+  if (!parse_filter(request, false, false, filter, filtered, error_reason)) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"" + error_reason + "\" }", MIME(Application, Json));
+    return;
+  }
+
+  /* at this point, both the correct bs_id and RNTI will be known. Only
+   * fields can be selected, so the selection is part of the cache key */
+  auto fields = request.query().get("fields");
+  const std::string selection = fields.isEmpty() ? "" : "?fields=" + fields.get();
+  if (accepts_protobuf(request)) {
+    response.headers().addRaw(Pistache::Http::Header::Raw("X-Protobuf-Message",
+          "protocol.flex_ue_stats_report"));
+    send_cached(request, response, "pb/stats/ue" + selection, bs_id, rnti,
+        protobuf_etag(stats_app->ue_stats_etag(rnti, bs_id)),
+        [this, rnti, bs_id, &filter] () {
+          std::string resp;
+          stats_app->ue_stats_by_rnti_by_bs_id_to_protobuf(rnti, resp, bs_id, filter);
+          return resp;
+        },
+        Pistache::Http::Mime::MediaType::fromString(protobuf_mime));
+    return;
+  }
+  send_cached(request, response, "stats/ue" + selection, bs_id, rnti,
+      stats_app->ue_stats_etag(rnti, bs_id),
+      [this, rnti, bs_id, &filter] () {
+        std::string resp;
+        stats_app->ue_stats_by_rnti_by_bs_id_to_json_string(rnti, resp, bs_id, filter);
+        return resp;
+      });
+}
+
+bool flexran::north_api::stats_manager_calls::parse_filter(
+    const Pistache::Rest::Request& request, bool bs_sel, bool ue_sel,
+    flexran::rib::stats_filter& filter, bool& filtered, std::string& error_reason)
+{
+  auto get = [&request] (const std::string& name) {
+    auto o = request.query().get(name);
+    return o.isEmpty() ? std::string() : o.get();
+  };
+  filtered = false;
+
+  const std::string fields = get("fields");
+  if (!fields.empty()) {
+    if (!filter.set_fields(fields, error_reason))
+      return false;
+    filtered = true;
+  }
+  if (!bs_sel && !ue_sel)
+    return true;
+
+  const std::string bs = get("bs");
+  if (bs_sel && !bs.empty()) {
+    std::set<uint64_t> bss;
+    std::istringstream bsss(bs);
+    std::string b;
+    while (std::getline(bsss, b, ',')) {
+      if (b.empty()) continue;
+      const uint64_t bs_id = stats_app->parse_bs_agent_id(b);
+      if (bs_id == 0) {
+        error_reason = "can not find BS " + b;
+        return false;
+      }
+      bss.insert(bs_id);
+    }
+    filter.set_bs(bss);
+    filtered = true;
+  }
+
+  const std::string ue = get("ue");
+  if (!ue.empty()) {
+    filter.set_ues(ue);
+    filtered = true;
+  }
+
+  const std::string slice = get("slice");
+  if (!slice.empty()) {
+    try {
+      filter.set_dl_slice(std::stoul(slice));
+    } catch (const std::exception& e) {
+      error_reason = "slice must be a number";
+      return false;
+    }
+    filtered = true;
+  }
+
+  const std::string cursor = get("cursor");
+  if (!cursor.empty()) {
+    if (!filter.set_cursor(cursor, error_reason))
+      return false;
+    filtered = true;
+  }
+
+  const std::string limit = get("limit");
+  if (!limit.empty()) {
+    unsigned long l = 0;
+    try {
+      l = std::stoul(limit);
+    } catch (const std::exception& e) {
+    }
+    if (l < 1) {
+      error_reason = "limit must be a number larger than 0";
+      return false;
+    }
+    filter.set_limit(l);
+    filtered = true;
+  }
+  return true;
+}
+
+void flexran::north_api::stats_manager_calls::refresh_snapshot()
+{
+  /* only the structure is copied in the task manager, the contents here */
+  stats_app->refresh_snapshot(snapshot_max_age,
+      [this] { return in_rt([this] { return stats_app->prepare_snapshot(); },
+                            flexran::core::command_queue::priority::bulk); });
+  prune_cache();
+}
+
+void flexran::north_api::stats_manager_calls::prune_cache()
+{
+  const auto snapshot = stats_app->current_snapshot();
+  std::lock_guard<std::mutex> lg(cache_mutex_);
+  if (!snapshot || snapshot.get() == pruned_for_)
+    return;
+  pruned_for_ = snapshot.get();
+  for (auto it = cache_.begin(); it != cache_.end(); ) {
+    const uint64_t bs_id = std::get<1>(it->first);
+    const int32_t rnti = std::get<2>(it->first);
+    const auto bs = bs_id != 0 ? snapshot->get_bs(bs_id) : nullptr;
+    const bool removed = bs_id != 0
+        && (!bs || (rnti >= 0 && !bs->get_ue_mac_info(rnti)));
+    it = removed ? cache_.erase(it) : std::next(it);
+  }
+}
+
+void flexran::north_api::stats_manager_calls::send_cached(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter& response,
+    const std::string& endpoint, uint64_t bs_id, int32_t rnti,
+    const std::string& etag, const std::function<std::string()>& render,
+    const Pistache::Http::Mime::MediaType& mime)
+{
+  namespace cmp = flexran::core::compression;
   response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
-  response.send(Pistache::Http::Code::Ok, resp, MIME(Application, Json));
+  /* the client has either the identity or the compressed body, depending
+   * on its size, but both are up to date */
+  for (const std::string& tag : {etag,
+                                 encoded_etag(etag, response_encoding(request, SIZE_MAX))}) {
+    if (etag_matches(request, tag)) {
+      response.headers().addRaw(Pistache::Http::Header::Raw("ETag", tag));
+      add_encoding_headers(response, cmp::encoding::identity);
+      response.send(Pistache::Http::Code::Not_Modified);
+      return;
+    }
+  }
+
+  const cache_key key(endpoint, bs_id, rnti);
+  std::shared_ptr<const std::string> body;
+  std::shared_ptr<const std::string> gzip;
+  std::shared_ptr<const std::string> deflate;
+  if (!endpoint.empty()) {
+    std::lock_guard<std::mutex> lg(cache_mutex_);
+    auto it = cache_.find(key);
+    if (it != cache_.end() && it->second.etag == etag) {
+      body = it->second.body;
+      gzip = it->second.gzip;
+      deflate = it->second.deflate;
+    }
+  }
+  if (!body) {
+    /* the snapshot might be replaced while rendering, so the body can be
+     * newer than etag; a client will then simply get the same body again
+     * later */
+    body = std::make_shared<const std::string>(render());
+    if (!endpoint.empty()) {
+      std::lock_guard<std::mutex> lg(cache_mutex_);
+      if (cache_.size() < max_cache_entries || cache_.count(key) > 0)
+        cache_[key] = cached_body{etag, body, nullptr, nullptr};
+    }
+  }
+
+  const cmp::encoding e = response_encoding(request, body->size());
+  response.headers().addRaw(Pistache::Http::Header::Raw("ETag", encoded_etag(etag, e)));
+  add_encoding_headers(response, e);
+  if (e == cmp::encoding::identity) {
+    response.send(Pistache::Http::Code::Ok, *body, mime);
+    return;
+  }
+  std::shared_ptr<const std::string>& compressed =
+      e == cmp::encoding::gzip ? gzip : deflate;
+  if (!compressed) {
+    compressed = std::make_shared<const std::string>(
+        cmp::compress(e, compression_options()->level, *body));
+    if (!endpoint.empty()) {
+      std::lock_guard<std::mutex> lg(cache_mutex_);
+      auto it = cache_.find(key);
+      if (it != cache_.end() && it->second.body == body)
+        (e == cmp::encoding::gzip ? it->second.gzip : it->second.deflate) = compressed;
+    }
+  }
+  response.send(Pistache::Http::Code::Ok, *compressed, mime);
+}
+
+void flexran::north_api::stats_manager_calls::send_stream(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter& response,
+    const std::string& etag,
+    std::function<void(const flexran::rib::json_writer&)> render,
+    const Pistache::Http::Mime::MediaType& mime)
+{
+  /* streamed bodies are large, so the minimum size does not matter */
+  namespace cmp = flexran::core::compression;
+  const cmp::encoding e = response_encoding(request, SIZE_MAX);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.headers().addRaw(Pistache::Http::Header::Raw("ETag", encoded_etag(etag, e)));
+  add_encoding_headers(response, e);
+  if (etag_matches(request, encoded_etag(etag, e))) {
+    response.send(Pistache::Http::Code::Not_Modified);
+    return;
+  }
+  response.setMime(mime);
+
+  /* the handler runs in the thread that does the network I/O: waiting for
+   * the client here would block the writes we wait for */
+  auto writer = std::make_shared<Pistache::Http::ResponseWriter>(std::move(response));
+  const int level = compression_options()->level;
+  /* a heavy request keeps its admission slot until it is streamed */
+  flexran::core::admission::ticket ticket = flexran::core::admission::current_ticket();
+  auto job = [writer, e, level, render, ticket] () {
+    std::unique_ptr<cmp::compressor> comp;
+    if (e != cmp::encoding::identity)
+      comp.reset(new cmp::compressor(e, level));
+    std::shared_ptr<Pistache::Tcp::Peer> peer = writer->peer();
+    if (!peer) return;
+    Pistache::Http::ResponseStream stream = writer->stream(Pistache::Http::Code::Ok);
+    stream.flush();
+
+    /* the chunks are written with the chunked transfer encoding of
+     * ResponseStream, but through the peer to learn when they are sent */
+    std::deque<std::future<bool>> in_flight;
+    auto wait_oldest = [&in_flight] () {
+      std::future<bool> f = std::move(in_flight.front());
+      in_flight.pop_front();
+      if (f.wait_for(stream_write_timeout) != std::future_status::ready || !f.get())
+        throw std::runtime_error("client does not take the data");
+    };
+    auto write = [&peer, &in_flight, &wait_oldest] (const std::string& s) {
+      if (in_flight.size() >= stream_max_in_flight)
+        wait_oldest();
+      auto done = std::make_shared<std::promise<bool>>();
+      in_flight.push_back(done->get_future());
+      peer->send(Pistache::Buffer(s.data(), s.size())).then(
+          [done] (ssize_t) { done->set_value(true); },
+          [done] (std::exception_ptr&) { done->set_value(false); });
+    };
+
+    std::string buf;
+    std::string out;
+    std::string chunk;
+    buf.reserve(stream_chunk_size);
+    auto send = [&buf, &out, &chunk, &comp, &write] (bool last) {
+      const std::string *data = &buf;
+      if (comp) {
+        out.clear();
+        comp->write(buf, out);
+        if (last) comp->finish(out);
+        data = &out;
+      }
+      std::ostringstream ss;
+      if (!data->empty())
+        ss << std::hex << data->size() << "\r\n";
+      chunk = ss.str();
+      chunk += *data;
+      if (!data->empty())
+        chunk += "\r\n";
+      if (last)
+        chunk += "0\r\n\r\n";
+      buf.clear();
+      if (!chunk.empty())
+        write(chunk);
+    };
+    try {
+      render([&buf, &send] (const std::string& s) {
+        buf += s;
+        if (buf.size() >= stream_chunk_size) send(false);
+      });
+      send(true);
+      while (!in_flight.empty())
+        wait_oldest();
+    } catch (const std::exception& e) {
+      LOG4CXX_WARN(flog::app, "error while streaming statistics: " << e.what());
+    }
+  };
+  if (!stream_executor_.submit(job))
+    writer->send(Pistache::Http::Code::Service_Unavailable,
+        "{ \"error\": \"too many concurrent large responses\" }",
+        MIME(Application, Json));
+}
+
+bool flexran::north_api::stats_manager_calls::accepts_protobuf(
+    const Pistache::Rest::Request& request)
+{
+  auto accept = request.headers().tryGetRaw("Accept");
+  if (accept.isEmpty())
+    return false;
+  const std::string& a = accept.get().value();
+  return a.find("application/x-protobuf") != std::string::npos
+      || a.find("application/protobuf") != std::string::npos
+      || a.find("application/vnd.google.protobuf") != std::string::npos;
+}
+
+void flexran::north_api::stats_manager_calls::send_protobuf_stats(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter& response,
+    const std::string& type, uint64_t bs_id, const flexran::rib::stats_filter& filter,
+    bool filtered)
+{
+  const std::string etag = protobuf_etag(stats_app->stats_etag(type, bs_id));
+  const Pistache::Http::Mime::MediaType mime =
+      Pistache::Http::Mime::MediaType::fromString(protobuf_mime);
+  response.headers().addRaw(Pistache::Http::Header::Raw("X-Protobuf-Message",
+        "protocol.flex_nb_bs; delimited=true"));
+
+  if (filter.paged()) {
+    /* the cursor goes into a header, so render before sending */
+    std::string body, cursor;
+    stats_app->write_protobuf_stats(type, bs_id,
+        [&body] (const std::string& s) { body += s; }, filter, cursor);
+    if (!cursor.empty())
+      response.headers().addRaw(Pistache::Http::Header::Raw("X-Next-Cursor", cursor));
+    send_cached(request, response, "", bs_id, -1, etag,
+        [&body] () { return std::move(body); }, mime);
+    return;
+  }
+  /* unpaged, so there is no cursor */
+  auto render = [this, type, bs_id, filter] (const flexran::rib::json_writer& out)
+      { std::string cursor; stats_app->write_protobuf_stats(type, bs_id, out, filter, cursor); };
+  if (stats_app->num_ues(bs_id) >= stream_min_ues) {
+    send_stream(request, response, etag, render, mime);
+    return;
+  }
+  send_cached(request, response, filtered ? "" : "pb/stats/" + type, bs_id, -1, etag,
+      [&render] () {
+        std::string body;
+        render([&body] (const std::string& s) { body += s; });
+        return body;
+      }, mime);
 }
 
 void flexran::north_api::stats_manager_calls::get_stats_req(
@@ -3506,7 +3992,7 @@ void flexran::north_api::stats_manager_calls::get_stats_req(
   if (request.hasParam(":id")) bs = request.param(":id").as<std::string>();
 
   std::string resp;
-  if (!stats_app->get_stats_requests(bs, resp)) {
+  if (!in_rt([&] { return stats_app->get_stats_requests(bs, resp); })) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + resp +"\" }", MIME(Application, Json));
     return;
@@ -3530,7 +4016,7 @@ void flexran::north_api::stats_manager_calls::set_stats_req(
   }
 
   std::string error_reason;
-  if (!stats_app->set_stats_requests(bs, policy, error_reason)) {
+  if (!in_rt([&] { return stats_app->set_stats_requests(bs, policy, error_reason); })) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
     return;
@@ -26,11 +26,16 @@
 #define STATS_MANAGER_CALLS_H_
 
 #include <string>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <tuple>
 #include <pistache/http.h>
 #include <pistache/description.h>
 
 #include "app_calls.h"
 #include "stats_manager.h"
+#include "background_executor.h"
 
 namespace flexran {
 
@@ -55,8 +60,70 @@ namespace flexran {
       void set_stats_req(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
 
     private:
+      /* makes sure the stats app's RIB snapshot is recent enough */
+      void refresh_snapshot();
+
+      /* reads the selection of the query (fields, and bs, ue, slice, limit,
+       * cursor if allowed) into filter. filtered is set if anything was selected */
+      bool parse_filter(const Pistache::Rest::Request& request, bool bs_sel,
+          bool ue_sel, flexran::rib::stats_filter& filter, bool& filtered,
+          std::string& error_reason);
+
+      /* answers 304 Not Modified if the client has the version given by
+       * etag, otherwise sends the cached body for (endpoint, bs_id, rnti) if
+       * it has the same version, or renders a new one. rnti is -1 if the
+       * response is not about a single UE. An empty endpoint is not cached,
+       * e.g., for filtered responses */
+      void send_cached(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter& response, const std::string& endpoint,
+          uint64_t bs_id, int32_t rnti, const std::string& etag,
+          const std::function<std::string()>& render,
+          const Pistache::Http::Mime::MediaType& mime = MIME(Application, Json));
+
+      /* like send_cached(), but sends the output of render in chunks
+       * while it is produced, without caching. If compressed, the chunks are
+       * compressed on the fly. Rendering happens in stream_executor_ and
+       * waits for the client to take the data, so render may not refer to
+       * the caller's stack. The job keeps the admission ticket of the
+       * request (see core::admission::current_ticket()) until it ends */
+      void send_stream(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter& response, const std::string& etag,
+          std::function<void(const flexran::rib::json_writer&)> render,
+          const Pistache::Http::Mime::MediaType& mime = MIME(Application, Json));
+
+      /* true if the client asks for protobuf instead of JSON */
+      static bool accepts_protobuf(const Pistache::Rest::Request& request);
+      /* sends the statistics of the given type as length-delimited
+       * flex_nb_bs messages */
+      void send_protobuf_stats(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter& response, const std::string& type,
+          uint64_t bs_id, const flexran::rib::stats_filter& filter, bool filtered);
+
       std::shared_ptr<flexran::app::stats::stats_manager> stats_app;
 
+      /* a body together with its compressed versions, which are created
+       * when a client first asks for them */
+      struct cached_body {
+        std::string etag;
+        std::shared_ptr<const std::string> body;
+        std::shared_ptr<const std::string> gzip;
+        std::shared_ptr<const std::string> deflate;
+      };
+      /* endpoint (including a field selection), BS (0 for all BSs) and
+       * RNTI (-1 if not for a single UE) */
+      typedef std::tuple<std::string, uint64_t, int32_t> cache_key;
+      std::mutex cache_mutex_;
+      std::map<cache_key, cached_body> cache_;
+      /* the snapshot for which removed BSs and UEs were last dropped from
+       * the cache, only compared, never dereferenced */
+      const flexran::rib::Rib *pruned_for_ = nullptr;
+      /* drops the entries of BSs and UEs not in the current snapshot */
+      void prune_cache();
+
+      /* streamed responses, which block until the client read a chunk;
+       * bounds the number of concurrent streams */
+      flexran::core::background_executor stream_executor_{2, 4};
+
     };
   }
 }
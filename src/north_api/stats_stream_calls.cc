@@ -0,0 +1,207 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    stats_stream_calls.cc
+ *  \brief   NB API for pushing statistics as Server-Sent Events
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <pthread.h>
+
+#include <pistache/http.h>
+#include <pistache/http_header.h>
+
+#include "stats_stream_calls.h"
+#include "rt_wrapper.h"
+#include "flexran_log.h"
+
+flexran::north_api::stats_stream_calls::stats_stream_calls(
+    std::shared_ptr<flexran::app::stats::stats_stream> stream)
+  : stream_app(stream),
+    stop_(false)
+{
+  pump_thread_ = std::thread(&flexran::north_api::stats_stream_calls::pump, this);
+}
+
+flexran::north_api::stats_stream_calls::~stats_stream_calls()
+{
+  stop_ = true;
+  if (pump_thread_.joinable())
+    pump_thread_.join();
+}
+
+void flexran::north_api::stats_stream_calls::register_calls(Pistache::Rest::Description& desc)
+{
+  /**
+   * @api {get} /stats_stream Subscribe to a stream of RAN statistics
+   * @apiName GetStatsStream
+   * @apiGroup Stats
+   * @apiParam {String} [bs] Comma-separated list of BS IDs or agent IDs.
+   * Without, all BSs are streamed, including the ones connecting later.
+   * @apiParam {String} [ue] Comma-separated list of RNTIs or IMSIs. Without,
+   * all UEs are streamed.
+   * @apiParam {string=enb_config,mac_stats,all} [kpi=all] The type of
+   * statistics to be streamed, as in <a href="#api-Stats-GetStats">Stats:GetStats</a>.
+   * @apiParam {Number{1-}} [period=1000] Interval in milliseconds in which
+   * changes are sent.
+   *
+   * @apiDescription This API opens a stream of Server-Sent Events
+   * (text/event-stream). The first event is a `snapshot` with the same
+   * content as <a href="#api-Stats-GetStats">Stats:GetStats</a> for the
+   * selection. Afterwards, every period only changed parts are sent: an
+   * `enb_config` event contains the complete configuration of one BS, a
+   * `mac_stats` event the statistics of all UEs of one BS that changed since
+   * the last period, and `ue_remove`/`bs_remove` events signal UEs or BSs
+   * that disappeared. If a client does not read fast enough, pending events
+   * are dropped and a new `snapshot` is sent.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -N http://127.0.0.1:9999/stats_stream?kpi=mac_stats&period=100
+   * @apiSuccessExample Example stream:
+   *     HTTP/1.1 200 OK
+   *     Content-Type: text/event-stream
+   *
+   *     id: 1
+   *     event: snapshot
+   *     data: {"date_time":"2020-07-01T13:00:22.218","mac_stats":[...]}
+   *
+   *     id: 2
+   *     event: mac_stats
+   *     data: {"bs_id":10000,"ue_mac_stats":[{"rnti":28274,...}]}
+   *
+   * @apiError BadRequest The BS, statistics type, or period is invalid, or
+   * the maximum number of streams (16) is open.
+   *
+   * @apiErrorExample Error-Response:
+   *    HTTP/1.1 400 BadRequest
+   *    { "error": "can not find BS 4" }
+   */
+  desc.route(desc.get("/stats_stream"), "Stream RAN statistics as Server-Sent Events")
+      .bind(&flexran::north_api::stats_stream_calls::open_stream, this);
+}
+
+void flexran::north_api::stats_stream_calls::open_stream(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  auto get = [&request] (const std::string& name) {
+    auto o = request.query().get(name);
+    return o.isEmpty() ? std::string() : o.get();
+  };
+  const std::string bs = get("bs");
+  const std::string ue = get("ue");
+  const std::string kpi = get("kpi");
+  const std::string period_s = get("period");
+
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+
+  uint64_t period = 1000;
+  if (!period_s.empty()) {
+    try {
+      period = std::stoull(period_s);
+    } catch (const std::exception& e) {
+      response.send(Pistache::Http::Code::Bad_Request,
+          "{\"error\":\"period must be a number\"}", MIME(Application, Json));
+      return;
+    }
+  }
+
+  uint64_t id;
+  std::string error_reason;
+  if (!stream_app->add_client(bs, ue, kpi, period, id, error_reason)) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{\"error\":\"" + error_reason + "\"}", MIME(Application, Json));
+    return;
+  }
+
+  response.headers().addRaw(Pistache::Http::Header::Raw("Cache-Control", "no-cache"));
+  response.setMime(Pistache::Http::Mime::MediaType::fromString("text/event-stream"));
+  std::weak_ptr<Pistache::Tcp::Peer> peer = response.peer();
+  Pistache::Http::ResponseStream stream = response.stream(Pistache::Http::Code::Ok);
+  /* send the headers immediately, the snapshot follows with the next tick */
+  const std::string hello = ": stream " + std::to_string(id) + "\n\n";
+  stream.write(hello.data(), hello.size());
+  stream.flush();
+
+  std::lock_guard<std::mutex> lg(clients_mutex_);
+  clients_.emplace_back(id, peer, std::move(stream));
+}
+
+std::string flexran::north_api::stats_stream_calls::format_event(
+    const flexran::app::stats::stream_event& e)
+{
+  std::string s = "id: " + std::to_string(e.id) + "\nevent: " + e.type + "\n";
+  size_t pos = 0;
+  do {
+    const size_t end = e.data.find('\n', pos);
+    s += "data: ";
+    s += e.data.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    s += "\n";
+    pos = end == std::string::npos ? end : end + 1;
+  } while (pos != std::string::npos);
+  s += "\n";
+  return s;
+}
+
+void flexran::north_api::stats_stream_calls::pump()
+{
+  pthread_setname_np(pthread_self(), "stats_stream");
+  flexran::core::rt::become_background_thread();
+
+  uint64_t seen = 0;
+  std::vector<flexran::app::stats::stream_event> events;
+  while (!stop_) {
+    stream_app->wait_events(seen, std::chrono::milliseconds(200));
+
+    std::lock_guard<std::mutex> lg(clients_mutex_);
+    for (auto it = clients_.begin(); it != clients_.end(); ) {
+      events.clear();
+      /* a closed connection releases the peer */
+      if (it->peer.expired() || !stream_app->pop_events(it->id, events)) {
+        stream_app->remove_client(it->id);
+        it = clients_.erase(it);
+        continue;
+      }
+      try {
+        for (const auto& e : events) {
+          const std::string s = format_event(e);
+          it->stream.write(s.data(), s.size());
+        }
+        if (!events.empty())
+          it->stream.flush();
+      } catch (const std::exception& e) {
+        LOG4CXX_INFO(flog::app, "stats_stream: closing stream " << it->id
+            << ": " << e.what());
+        stream_app->remove_client(it->id);
+        it = clients_.erase(it);
+        continue;
+      }
+      ++it;
+    }
+  }
+
+  std::lock_guard<std::mutex> lg(clients_mutex_);
+  for (auto& c : clients_) {
+    if (!c.peer.expired())
+      c.stream.ends();
+    stream_app->remove_client(c.id);
+  }
+  clients_.clear();
+}
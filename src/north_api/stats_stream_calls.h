@@ -0,0 +1,86 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    stats_stream_calls.h
+ *  \brief   NB API for pushing statistics as Server-Sent Events
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef STATS_STREAM_CALLS_H_
+#define STATS_STREAM_CALLS_H_
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include <pistache/http.h>
+#include <pistache/description.h>
+
+#include "app_calls.h"
+#include "stats_stream.h"
+
+namespace flexran {
+
+  namespace north_api {
+
+    class stats_stream_calls : public app_calls {
+
+    public:
+
+      stats_stream_calls(std::shared_ptr<flexran::app::stats::stats_stream> stream);
+      ~stats_stream_calls();
+
+      void register_calls(Pistache::Rest::Description& desc);
+
+      void open_stream(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      //! format an event according to the text/event-stream format
+      static std::string format_event(const flexran::app::stats::stream_event& e);
+
+    private:
+
+      struct sse_client {
+        sse_client(uint64_t id, std::weak_ptr<Pistache::Tcp::Peer> peer,
+            Pistache::Http::ResponseStream stream)
+          : id(id), peer(peer), stream(std::move(stream))
+        {}
+        uint64_t id;
+        std::weak_ptr<Pistache::Tcp::Peer> peer;
+        Pistache::Http::ResponseStream stream;
+      };
+
+      /* writes queued events of all clients to their streams; runs in its own
+       * thread so that Pistache threads are not blocked by open streams */
+      void pump();
+
+      std::shared_ptr<flexran::app::stats::stats_stream> stream_app;
+
+      std::mutex clients_mutex_;
+      std::list<sse_client> clients_;
+
+      std::atomic<bool> stop_;
+      std::thread pump_thread_;
+
+    };
+  }
+}
+
+#endif /* STATS_STREAM_CALLS_H_ */
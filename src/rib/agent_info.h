@@ -78,7 +78,9 @@ namespace flexran {
           splits(spl),
           port_ip(port_ip),
           rx_packets(0),
-          rx_bytes(0)
+          rx_bytes(0),
+          tx_packets(0),
+          tx_bytes(0)
       { }
       std::string to_json() const;
       std::string to_string() const;
@@ -88,8 +90,12 @@ namespace flexran {
       const agent_capabilities capabilities;
       const agent_splits splits;
       const std::string port_ip;
+      /* counters of messages from/to the agent since it connected, written
+       * in the task manager thread */
       std::atomic<uint64_t> rx_packets;
       std::atomic<uint64_t> rx_bytes;
+      std::atomic<uint64_t> tx_packets;
+      std::atomic<uint64_t> tx_bytes;
     };
   }
 }
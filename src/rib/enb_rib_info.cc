@@ -31,7 +31,28 @@
 #include <google/protobuf/reflection.h>
 
 #include "enb_rib_info.h"
+#include "northbound.pb.h"
 #include "flexran_log.h"
+#include "async_log.h"
+
+namespace {
+  void append_varint(std::string& out, uint64_t v)
+  {
+    while (v >= 0x80) {
+      out += static_cast<char>(v | 0x80);
+      v >>= 7;
+    }
+    out += static_cast<char>(v);
+  }
+
+  /* appends bytes as the length-delimited field number of a message */
+  void append_field(std::string& out, int number, const std::string& bytes)
+  {
+    append_varint(out, (static_cast<uint64_t>(number) << 3) | 2);
+    append_varint(out, bytes.size());
+    out += bytes;
+  }
+}
 
 
 
@@ -40,7 +61,7 @@ flexran::rib::enb_rib_info::enb_rib_info(uint64_t bs_id,
   : bs_id_(bs_id),
     agents_(agents)
 {
-  last_checked = st_clock::now();
+  last_checked = clock_now();
   for (auto a: agents) {
     if (a->bs_id != bs_id_)
       throw std::runtime_error("invalid bs_id " + std::to_string(a->bs_id)
@@ -81,6 +102,7 @@ void flexran::rib::enb_rib_info::update_eNB_config(
     eNB_config_.mutable_s1ap()->CopyFrom(enb_config_update.s1ap());
   }
   eNB_config_mutex_.unlock();
+  config_version_ = next_rib_version();
   update_liveness();
 }
 
@@ -117,6 +139,7 @@ void flexran::rib::enb_rib_info::update_UE_config(
     dst->MergeFrom(src);
   }
   ue_config_mutex_.unlock();
+  config_version_ = next_rib_version();
 
   update_liveness();
 }
@@ -169,7 +192,9 @@ void flexran::rib::enb_rib_info::update_UE_config(
   default:
     LOG4CXX_WARN(flog::rib, "unhandled ue_state_change type " << ue_state_change.type()
         << " in " << __func__);
+    return;
   }
+  config_version_ = next_rib_version();
 }
 
 void flexran::rib::enb_rib_info::update_LC_config(const protocol::flex_lc_config_reply& lc_config_update) {
@@ -179,13 +204,17 @@ void flexran::rib::enb_rib_info::update_LC_config(const protocol::flex_lc_config
   lc_config_mutex_.lock();
   lc_config_.CopyFrom(lc_config_update);
   lc_config_mutex_.unlock();
+  config_version_ = next_rib_version();
 }
 
-void flexran::rib::enb_rib_info::update_subframe(const protocol::flex_sf_trigger& sf_trigger) {
+void flexran::rib::enb_rib_info::update_subframe(
+    const protocol::flex_sf_trigger& sf_trigger, st_clock::time_point arrival)
+{
   rnti_t rnti;
   uint16_t sfn_sf = sf_trigger.sfn_sf();
   current_frame_ = get_frame(sfn_sf);
   current_subframe_ = get_subframe(sfn_sf);
+  update_sf_timing(sfn_sf, arrival);
 
   // Update dl_sf_info
   for (int i = 0; i < sf_trigger.dl_info_size(); i++) {
@@ -194,7 +223,7 @@ void flexran::rib::enb_rib_info::update_subframe(const protocol::flex_sf_trigger
     if (it == ue_mac_info_.end()) {
       /* TODO: For some reason we have no such entry. This shouldn't happen */
     } else {
-      LOG4CXX_DEBUG(flog::rib, "update DL subframe info for RNTI " << rnti);
+      FLOG_DEBUG(flog::rib, "update DL subframe info for RNTI {}", rnti);
       it->second->update_dl_sf_info(sf_trigger.dl_info(i));
     }
   }
@@ -206,7 +235,7 @@ void flexran::rib::enb_rib_info::update_subframe(const protocol::flex_sf_trigger
     if (it == ue_mac_info_.end()) {
       /* TODO: For some reason we have no such entry. This shouldn't happen */
     } else {
-      LOG4CXX_DEBUG(flog::rib, "update UL subframe info for RNTI " << rnti);
+      FLOG_DEBUG(flog::rib, "update UL subframe info for RNTI {}", rnti);
       it->second->update_ul_sf_info(sf_trigger.ul_info(i));
     }
   }
@@ -226,13 +255,85 @@ void flexran::rib::enb_rib_info::update_mac_stats(const protocol::flex_stats_rep
       //							    std::shared_ptr<ue_mac_rib_info>(new ue_mac_rib_info(rnti))));
     } else {
       it->second->update_mac_stats_report(mac_stats.ue_report(i));
-      LOG4CXX_DEBUG(flog::rib, "Update MAC stats for RNTI " << rnti);
+      FLOG_DEBUG(flog::rib, "Update MAC stats for RNTI {}", rnti);
     }
   }
   // Then work on the Cell updates
+  cell_mac_info_mutex_.lock();
   for (int i = 0; i < mac_stats.cell_report_size(); i++) {
     cell_mac_info_[i].update_cell_stats_report(mac_stats.cell_report(i));
   }
+  cell_mac_info_mutex_.unlock();
+  stats_version_ = next_rib_version();
+}
+
+std::shared_ptr<flexran::rib::enb_rib_info> flexran::rib::enb_rib_info::prepare_clone(
+    const std::shared_ptr<const enb_rib_info>& bs,
+    const std::shared_ptr<enb_rib_info>& previous)
+{
+  if (previous && previous->config_version_ == bs->config_version_
+      && previous->stats_version_ == bs->stats_version_
+      && previous->sf_version_ == bs->sf_version_
+      && previous->ue_mac_info_.size() == bs->ue_mac_info_.size()
+      && std::equal(bs->ue_mac_info_.begin(), bs->ue_mac_info_.end(),
+                    previous->ue_mac_info_.begin(),
+                    [] (const std::pair<const rnti_t, std::shared_ptr<ue_mac_rib_info>>& a,
+                        const std::pair<const rnti_t, std::shared_ptr<ue_mac_rib_info>>& b) {
+                      return a.first == b.first
+                          && a.second->get_stats_version() == b.second->get_stats_version()
+                          && a.second->get_sf_version() == b.second->get_sf_version();
+                    }))
+    return previous;
+
+  auto c = std::make_shared<enb_rib_info>(bs->bs_id_, bs->agents_);
+  c->last_checked = bs->last_checked;
+  c->current_frame_ = bs->current_frame_;
+  c->current_subframe_ = bs->current_subframe_;
+  c->sf_synced_ = bs->sf_synced_;
+  c->sf_anchor_ = bs->sf_anchor_;
+  c->sf_anchor_sfn_sf_ = bs->sf_anchor_sfn_sf_;
+  c->sf_drift_ = bs->sf_drift_;
+  c->sf_jitter_ = bs->sf_jitter_;
+  c->config_version_ = bs->config_version_.load();
+  c->stats_version_ = bs->stats_version_.load();
+  c->sf_version_ = bs->sf_version_.load();
+  /* the subframe information of the UEs is only consistent here */
+  for (const auto& ue : bs->ue_mac_info_)
+    c->ue_mac_info_.emplace(ue.first, ue_mac_rib_info::prepare_clone(ue.second,
+          previous ? previous->get_ue_mac_info(ue.first) : nullptr));
+  c->clone_source_ = bs;
+  return c;
+}
+
+void flexran::rib::enb_rib_info::complete_clone()
+{
+  if (!clone_source_) return;
+  const enb_rib_info& src = *clone_source_;
+
+  /* the configurations might be newer than config_version_; the next
+   * snapshot will then copy them again */
+  {
+    std::lock_guard<std::mutex> lg(src.eNB_config_mutex_);
+    eNB_config_.CopyFrom(src.eNB_config_);
+  }
+  {
+    std::lock_guard<std::mutex> lg(src.ue_config_mutex_);
+    ue_config_.CopyFrom(src.ue_config_);
+  }
+  {
+    std::lock_guard<std::mutex> lg(src.lc_config_mutex_);
+    lc_config_.CopyFrom(src.lc_config_);
+  }
+  {
+    std::lock_guard<std::mutex> lg(src.cell_mac_info_mutex_);
+    for (int i = 0; i < MAX_NUM_CC; ++i)
+      cell_mac_info_[i] = src.cell_mac_info_[i];
+  }
+  /* UEs shared with the previous copy are complete already */
+  for (auto& ue : ue_mac_info_)
+    ue.second->complete_clone();
+
+  clone_source_.reset();
 }
 
 std::shared_ptr<flexran::rib::ue_mac_rib_info> flexran::rib::enb_rib_info::get_ue_mac_info(rnti_t rnti) const
@@ -244,13 +345,69 @@ std::shared_ptr<flexran::rib::ue_mac_rib_info> flexran::rib::enb_rib_info::get_u
   return std::shared_ptr<ue_mac_rib_info>(nullptr);
 }
 
+std::set<flexran::rib::rnti_t> flexran::rib::enb_rib_info::get_rntis() const
+{
+  std::set<rnti_t> rntis;
+  for (const auto& ue : ue_mac_info_)
+    rntis.insert(ue.first);
+  return rntis;
+}
+
+void flexran::rib::enb_rib_info::update_sf_timing(uint16_t sfn_sf,
+    st_clock::time_point arrival)
+{
+  /* the sfn_sf wraps around after 1024 frames of 10 subframes */
+  const int abs_sf = current_frame_ * 10 + current_subframe_;
+  const int anchor_sf = get_frame(sf_anchor_sfn_sf_) * 10
+      + get_subframe(sf_anchor_sfn_sf_);
+  const int elapsed = (abs_sf - anchor_sf + 10240) % 10240;
+  const st_clock::time_point predicted = sf_anchor_ + std::chrono::milliseconds(elapsed);
+  const std::chrono::nanoseconds err = arrival - predicted;
+
+  /* duplicate trigger for the same subframe, e.g., from several agents */
+  if (sf_synced_ && elapsed == 0)
+    return;
+
+  sf_anchor_sfn_sf_ = sfn_sf;
+  if (!sf_synced_
+      || err > sf_resync_threshold || -err > sf_resync_threshold) {
+    if (sf_synced_)
+      LOG4CXX_INFO(flog::rib, "BS " << bs_id_ << ": lost subframe timing "
+          << "(error " << err.count() << " ns), resynchronizing");
+    sf_anchor_ = arrival;
+    sf_drift_ = std::chrono::nanoseconds(0);
+    sf_jitter_ = std::chrono::nanoseconds(0);
+    sf_synced_ = true;
+    return;
+  }
+
+  /* alpha-filter the anchor towards the observed arrival: a single late
+   * trigger (network jitter) only shifts the estimate by 1/8 */
+  sf_anchor_ = predicted + err / 8;
+  sf_drift_ += (err - sf_drift_) / 8;
+  const std::chrono::nanoseconds abs_err = err.count() < 0 ? -err : err;
+  sf_jitter_ += (abs_err - sf_jitter_) / 8;
+}
+
+st_clock::time_point flexran::rib::enb_rib_info::next_subframe_start(
+    st_clock::time_point t) const
+{
+  if (!sf_synced_)
+    return t + std::chrono::milliseconds(1);
+  if (t < sf_anchor_)
+    return sf_anchor_;
+  const auto passed = std::chrono::duration_cast<std::chrono::milliseconds>(t - sf_anchor_);
+  return sf_anchor_ + passed + std::chrono::milliseconds(1);
+}
+
 bool flexran::rib::enb_rib_info::need_to_query() {
-  st_clock::duration dur = st_clock::now() - last_checked;
+  st_clock::duration dur = clock_now() - last_checked;
   return (dur > time_to_query);
 }
 
 void flexran::rib::enb_rib_info::update_liveness() {
-  last_checked = st_clock::now();
+  last_checked = clock_now();
+  sf_version_ = next_rib_version();
 }
 
 void flexran::rib::enb_rib_info::dump_mac_stats() const {
@@ -276,14 +433,39 @@ std::string flexran::rib::enb_rib_info::dump_mac_stats_to_string() const {
 
 std::string flexran::rib::enb_rib_info::dump_mac_stats_to_json_string() const
 {
-  std::vector<std::string> ue_mac_stats;
-  ue_mac_stats.reserve(ue_mac_info_.size());
-  std::transform(ue_mac_info_.begin(), ue_mac_info_.end(), std::back_inserter(ue_mac_stats),
-      [] (const std::pair<rnti_t, std::shared_ptr<ue_mac_rib_info>>& ue_stats)
-      { return ue_stats.second->dump_stats_to_json_string(); }
-  );
+  return dump_mac_stats_to_json_string(stats_filter::all(), nullptr);
+}
+
+std::string flexran::rib::enb_rib_info::dump_mac_stats_to_json_string(
+    const stats_filter& filter, const std::vector<rnti_t> *rntis) const
+{
+  std::string str;
+  dump_mac_stats_to_json([&str] (const std::string& s) { str += s; }, filter, rntis);
+  return str;
+}
 
-  return format_mac_stats_to_json(bs_id_, ue_mac_stats);
+void flexran::rib::enb_rib_info::dump_mac_stats_to_json(const json_writer& out,
+    const stats_filter& filter, const std::vector<rnti_t> *rntis) const
+{
+  /* same output as format_mac_stats_to_json() */
+  out("\"bs_id\":" + std::to_string(bs_id_) + ",\"ue_mac_stats\":[");
+  bool first = true;
+  auto write_ue = [&out, &filter, &first] (const ue_mac_rib_info& ue) {
+    out(first ? ue.dump_stats_to_json_string(filter)
+              : "," + ue.dump_stats_to_json_string(filter));
+    first = false;
+  };
+  if (!rntis) {
+    for (const auto& ue : ue_mac_info_)
+      write_ue(*ue.second);
+  } else {
+    for (rnti_t rnti : *rntis) {
+      auto it = ue_mac_info_.find(rnti);
+      if (it != ue_mac_info_.end())
+        write_ue(*it->second);
+    }
+  }
+  out("]");
 }
 
 std::string flexran::rib::enb_rib_info::format_mac_stats_to_json(
@@ -339,6 +521,12 @@ std::string flexran::rib::enb_rib_info::dump_configs_to_string() const {
 }
 
 std::string flexran::rib::enb_rib_info::dump_configs_to_json_string() const
+{
+  return dump_configs_to_json_string(nullptr);
+}
+
+std::string flexran::rib::enb_rib_info::dump_configs_to_json_string(
+    const std::vector<rnti_t> *rntis) const
 {
   std::string agent_info, enb_config, ue_config, lc_config;
 
@@ -353,17 +541,100 @@ std::string flexran::rib::enb_rib_info::dump_configs_to_json_string() const
   google::protobuf::util::MessageToJsonString(eNB_config_, &enb_config, google::protobuf::util::JsonPrintOptions());
   eNB_config_mutex_.unlock();
 
-  ue_config_mutex_.lock();
-  google::protobuf::util::MessageToJsonString(ue_config_, &ue_config, google::protobuf::util::JsonPrintOptions());
-  ue_config_mutex_.unlock();
+  if (!rntis) {
+    ue_config_mutex_.lock();
+    google::protobuf::util::MessageToJsonString(ue_config_, &ue_config, google::protobuf::util::JsonPrintOptions());
+    ue_config_mutex_.unlock();
 
-  lc_config_mutex_.lock();
-  google::protobuf::util::MessageToJsonString(lc_config_, &lc_config, google::protobuf::util::JsonPrintOptions());
-  lc_config_mutex_.unlock();
+    lc_config_mutex_.lock();
+    google::protobuf::util::MessageToJsonString(lc_config_, &lc_config, google::protobuf::util::JsonPrintOptions());
+    lc_config_mutex_.unlock();
+  } else {
+    /* copy only the selected UEs, both lists are small compared to the
+     * configurations of all UEs */
+    const std::set<rnti_t> selected(rntis->begin(), rntis->end());
+    protocol::flex_ue_config_reply ue_sel;
+    ue_config_mutex_.lock();
+    for (const auto& c : ue_config_.ue_config())
+      if (selected.count(c.rnti()) > 0)
+        ue_sel.add_ue_config()->CopyFrom(c);
+    ue_config_mutex_.unlock();
+    google::protobuf::util::MessageToJsonString(ue_sel, &ue_config, google::protobuf::util::JsonPrintOptions());
+
+    protocol::flex_lc_config_reply lc_sel;
+    lc_config_mutex_.lock();
+    for (const auto& c : lc_config_.lc_ue_config())
+      if (selected.count(c.rnti()) > 0)
+        lc_sel.add_lc_ue_config()->CopyFrom(c);
+    lc_config_mutex_.unlock();
+    google::protobuf::util::MessageToJsonString(lc_sel, &lc_config, google::protobuf::util::JsonPrintOptions());
+  }
 
   return format_configs_to_json(bs_id_, agent_info, enb_config, ue_config, lc_config);
 }
 
+std::string flexran::rib::enb_rib_info::dump_to_protobuf(bool configs,
+    bool stats, const stats_filter& filter, const std::vector<rnti_t> *rntis) const
+{
+  typedef protocol::flex_nb_bs nb;
+  std::string bs;
+  append_varint(bs, (nb::kBsIdFieldNumber << 3) | 0);
+  append_varint(bs, bs_id_);
+
+  std::string m;
+  if (configs) {
+    eNB_config_mutex_.lock();
+    eNB_config_.SerializeToString(&m);
+    eNB_config_mutex_.unlock();
+    append_field(bs, nb::kEnbConfigFieldNumber, m);
+
+    /* the selected UEs' configurations form the repeated fields of the
+     * replies */
+    std::set<rnti_t> selected;
+    if (rntis) selected.insert(rntis->begin(), rntis->end());
+    std::string reply;
+    ue_config_mutex_.lock();
+    for (const auto& c : ue_config_.ue_config()) {
+      if (rntis && selected.count(c.rnti()) == 0) continue;
+      c.SerializeToString(&m);
+      append_field(reply, protocol::flex_ue_config_reply::kUeConfigFieldNumber, m);
+    }
+    ue_config_mutex_.unlock();
+    append_field(bs, nb::kUeConfigFieldNumber, reply);
+
+    reply.clear();
+    lc_config_mutex_.lock();
+    for (const auto& c : lc_config_.lc_ue_config()) {
+      if (rntis && selected.count(c.rnti()) == 0) continue;
+      c.SerializeToString(&m);
+      append_field(reply, protocol::flex_lc_config_reply::kLcUeConfigFieldNumber, m);
+    }
+    lc_config_mutex_.unlock();
+    append_field(bs, nb::kLcConfigFieldNumber, reply);
+  }
+
+  if (stats) {
+    auto write_ue = [&bs, &filter] (const ue_mac_rib_info& ue) {
+      append_field(bs, nb::kUeReportFieldNumber, ue.dump_stats_to_protobuf(filter));
+    };
+    if (!rntis) {
+      for (const auto& ue : ue_mac_info_)
+        write_ue(*ue.second);
+    } else {
+      for (rnti_t rnti : *rntis) {
+        auto it = ue_mac_info_.find(rnti);
+        if (it != ue_mac_info_.end())
+          write_ue(*it->second);
+      }
+    }
+  }
+
+  std::string out;
+  append_varint(out, bs.size());
+  out += bs;
+  return out;
+}
+
 std::string flexran::rib::enb_rib_info::format_configs_to_json(
     uint64_t bs_id,
     const std::string& agent_info_json,
@@ -385,15 +656,42 @@ std::string flexran::rib::enb_rib_info::format_configs_to_json(
   return str;
 }
 
-bool flexran::rib::enb_rib_info::dump_ue_spec_stats_by_rnti_to_json_string(rnti_t rnti, std::string& out) const
+bool flexran::rib::enb_rib_info::dump_ue_spec_stats_by_rnti_to_json_string(rnti_t rnti,
+    std::string& out, const stats_filter& filter) const
 {
   auto it = ue_mac_info_.find(rnti);
   if (it == ue_mac_info_.end()) return false;
 
-  out = it->second->dump_stats_to_json_string();
+  out = it->second->dump_stats_to_json_string(filter);
   return true;
 }
 
+std::vector<flexran::rib::rnti_t> flexran::rib::enb_rib_info::select_ues(
+    const stats_filter& filter) const
+{
+  std::set<rnti_t> selected;
+  if (filter.get_ues().empty()) {
+    selected = get_rntis();
+  } else {
+    for (const std::string& u : filter.get_ues()) {
+      rnti_t rnti;
+      if (parse_rnti_imsi(u, rnti))
+        selected.insert(rnti);
+    }
+  }
+
+  if (filter.has_dl_slice()) {
+    std::lock_guard<std::mutex> lg(ue_config_mutex_);
+    std::set<rnti_t> in_slice;
+    for (const auto& c : ue_config_.ue_config())
+      if (c.dl_slice_id() == filter.get_dl_slice() && selected.count(c.rnti()) > 0)
+        in_slice.insert(c.rnti());
+    selected.swap(in_slice);
+  }
+
+  return std::vector<rnti_t>(selected.begin(), selected.end());
+}
+
 bool flexran::rib::enb_rib_info::parse_rnti_imsi(const std::string& rnti_imsi_s,
     rnti_t& rnti) const
 {
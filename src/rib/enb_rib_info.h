@@ -29,11 +29,14 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <atomic>
 #include <chrono>
+#include <vector>
 using st_clock = std::chrono::steady_clock;
 
 #include "flexran.pb.h"
 #include "rib_common.h"
+#include "stats_filter.h"
 #include "ue_mac_rib_info.h"
 #include "cell_mac_rib_info.h"
 #include "agent_info.h"
@@ -56,7 +59,8 @@ namespace flexran {
 
       void update_liveness();
 
-      void update_subframe(const protocol::flex_sf_trigger& sf_trigger);
+      void update_subframe(const protocol::flex_sf_trigger& sf_trigger,
+          st_clock::time_point arrival = clock_now());
 
       void update_mac_stats(const protocol::flex_stats_reply& mac_stats);
   
@@ -68,6 +72,14 @@ namespace flexran {
 
       std::string dump_mac_stats_to_json_string() const;
 
+      /*! MAC stats of the given UEs only (all if rntis is nullptr), with the
+       * fields selected by filter */
+      std::string dump_mac_stats_to_json_string(const stats_filter& filter,
+          const std::vector<rnti_t> *rntis) const;
+      //! as above, but writes UE by UE
+      void dump_mac_stats_to_json(const json_writer& out,
+          const stats_filter& filter, const std::vector<rnti_t> *rntis) const;
+
       static std::string format_mac_stats_to_json(uint64_t bs_id,
           const std::vector<std::string>& ue_mac_stats_json);
 
@@ -77,18 +89,46 @@ namespace flexran {
 
       std::string dump_configs_to_json_string() const;
 
+      //! configurations with the UE and LC configurations of the given UEs only
+      std::string dump_configs_to_json_string(const std::vector<rnti_t> *rntis) const;
+
+      /*! this BS as a length-delimited protobuf flex_nb_bs (see
+       * northbound.proto) with the configurations (if configs) and the
+       * statistics (if stats) of the given UEs only (all if rntis is
+       * nullptr), with the fields selected by filter. The messages are
+       * serialized directly, without copying them into a flex_nb_bs */
+      std::string dump_to_protobuf(bool configs, bool stats,
+          const stats_filter& filter, const std::vector<rnti_t> *rntis) const;
+      /*! RNTIs of the UEs matching the UE and slice selection of filter, in
+       * ascending order */
+      std::vector<rnti_t> select_ues(const stats_filter& filter) const;
+
       static std::string format_configs_to_json(uint64_t bs_id,
                                                 const std::string& agent_info_json,
                                                 const std::string& eNB_config_json,
                                                 const std::string& ue_config_json,
                                                 const std::string& lc_config_json);
 
-      bool dump_ue_spec_stats_by_rnti_to_json_string(rnti_t rnti, std::string& out) const;
+      bool dump_ue_spec_stats_by_rnti_to_json_string(rnti_t rnti, std::string& out,
+          const stats_filter& filter = stats_filter::all()) const;
 
       frame_t get_current_frame() const { return current_frame_; }
 
       subframe_t get_current_subframe() const { return current_subframe_; }
 
+      //! true once enough subframe triggers arrived to predict the BS timing
+      bool is_sf_synced() const { return sf_synced_; }
+
+      /*! estimated start of the first BS subframe strictly after t, derived
+       * from the smoothed subframe trigger arrival times */
+      st_clock::time_point next_subframe_start(st_clock::time_point t) const;
+
+      //! smoothed deviation of trigger arrivals from the 1ms subframe grid
+      std::chrono::nanoseconds get_sf_drift() const { return sf_drift_; }
+
+      //! jitter (mean absolute deviation) of subframe trigger arrivals
+      std::chrono::nanoseconds get_sf_jitter() const { return sf_jitter_; }
+
       //! Access is only safe when the RIB is not active, i.e. within apps
       const protocol::flex_enb_config_reply& get_enb_config() const {return eNB_config_;}
 
@@ -102,6 +142,34 @@ namespace flexran {
 
       std::shared_ptr<ue_mac_rib_info> get_ue_mac_info(rnti_t rnti) const;
 
+      //! RNTIs of all UEs for which MAC information is kept
+      std::set<rnti_t> get_rntis() const;
+
+      /*! version of the eNB/UE/LC configurations, changes on every
+       * configuration update or UE state change */
+      uint64_t get_config_version() const { return config_version_; }
+
+      //! version of the statistics, changes on every stats reply
+      uint64_t get_stats_version() const { return stats_version_; }
+
+      /*! version of the timing and liveness, changes on every subframe
+       * trigger or other message of the BS */
+      uint64_t get_sf_version() const { return sf_version_; }
+
+      /*! first step of copying bs for a RIB snapshot, see
+       * Rib::prepare_snapshot(). Returns previous if it is a copy with the
+       * same versions (including all UEs), otherwise a copy of the structure
+       * of bs (UEs, timing, subframe information) whose contents are copied
+       * by complete_clone(). Must be called while the RIB is not active */
+      static std::shared_ptr<enb_rib_info> prepare_clone(
+          const std::shared_ptr<const enb_rib_info>& bs,
+          const std::shared_ptr<enb_rib_info>& previous);
+
+      /*! second step: copies configurations and statistics into a BS returned
+       * by prepare_clone(). Can be called from any thread; UEs with unchanged
+       * statistics and subframe information are shared with the previous copy */
+      void complete_clone();
+
       cell_mac_rib_info& get_cell_mac_rib_info(uint16_t cell_id) {
 	return cell_mac_info_[cell_id];
       }
@@ -120,6 +188,8 @@ namespace flexran {
 
       void clear_repeated_if_present(google::protobuf::Message *dst,
           const google::protobuf::Message& src);
+
+      void update_sf_timing(uint16_t sfn_sf, st_clock::time_point arrival);
       
     private:
       uint64_t bs_id_;
@@ -132,6 +202,23 @@ namespace flexran {
 
       frame_t current_frame_;
       subframe_t current_subframe_;
+
+      /* estimated arrival time of the last subframe trigger of this BS, on
+       * the 1ms grid; used to align the task manager to the BS timing */
+      bool sf_synced_ = false;
+      st_clock::time_point sf_anchor_;
+      uint16_t sf_anchor_sfn_sf_ = 0;
+      std::chrono::nanoseconds sf_drift_{0};
+      std::chrono::nanoseconds sf_jitter_{0};
+      /* if a trigger is off by more than this, the BS timing was lost (e.g.,
+       * agent stalled) and we re-anchor instead of smoothing */
+      const std::chrono::nanoseconds sf_resync_threshold = std::chrono::milliseconds(2);
+
+      /* change tracking: readers (e.g., the stats stream) compare against a
+       * previously seen value to find out whether something changed */
+      std::atomic<uint64_t> config_version_{next_rib_version()};
+      std::atomic<uint64_t> stats_version_{next_rib_version()};
+      std::atomic<uint64_t> sf_version_{next_rib_version()};
       
       // eNB config structure
       protocol::flex_enb_config_reply eNB_config_;
@@ -146,6 +233,11 @@ namespace flexran {
       std::map<rnti_t, std::shared_ptr<ue_mac_rib_info>> ue_mac_info_;
 
       cell_mac_rib_info cell_mac_info_[MAX_NUM_CC];
+      /* only protects the updates/copies of cell_mac_info_ for snapshots */
+      mutable std::mutex cell_mac_info_mutex_;
+
+      /* between prepare_clone() and complete_clone(): the BS to copy from */
+      std::shared_ptr<const enb_rib_info> clone_source_;
       static constexpr const size_t RNTI_ID_LENGTH_LIMIT = 6;
     };
 
@@ -187,6 +187,32 @@ flexran::rib::Rib::get_agent(int agent_id) const
   return it->second;
 }
 
+std::shared_ptr<flexran::rib::Rib> flexran::rib::Rib::prepare_snapshot(
+    const std::shared_ptr<const Rib>& previous) const
+{
+  auto s = std::make_shared<Rib>();
+  s->agent_configs_ = agent_configs_;
+  s->pending_agents_ = pending_agents_;
+  for (const auto& bs : eNB_configs_)
+    s->eNB_configs_.emplace(bs.first, enb_rib_info::prepare_clone(bs.second,
+          previous ? previous->get_bs(bs.first) : nullptr));
+  return s;
+}
+
+void flexran::rib::Rib::complete_snapshot()
+{
+  for (auto& bs : eNB_configs_)
+    bs.second->complete_clone();
+}
+
+std::shared_ptr<const flexran::rib::Rib> flexran::rib::Rib::snapshot(
+    const std::shared_ptr<const Rib>& previous) const
+{
+  std::shared_ptr<Rib> s = prepare_snapshot(previous);
+  s->complete_snapshot();
+  return s;
+}
+
 void flexran::rib::Rib::dump_mac_stats() const {
   for (auto enb_config : eNB_configs_) {
     enb_config.second->dump_mac_stats();
@@ -205,28 +231,94 @@ std::string flexran::rib::Rib::dump_all_mac_stats_to_string() const {
   return str;
 }
 
-std::string flexran::rib::Rib::dump_all_mac_stats_to_json_string() const
+std::vector<flexran::rib::Rib::page_entry> flexran::rib::Rib::select_page(
+    const stats_filter& filter, uint64_t bs_id, bool& more) const
 {
-  std::vector<std::string> mac_stats;
-  mac_stats.reserve(eNB_configs_.size());
-  std::transform(eNB_configs_.begin(), eNB_configs_.end(), std::back_inserter(mac_stats),
-      [] (const std::pair<int, std::shared_ptr<enb_rib_info>>& enb_config)
-      { return enb_config.second->dump_mac_stats_to_json_string(); }
-  );
+  std::vector<page_entry> page;
+  more = false;
+  auto bsit = bs_id != 0 ? eNB_configs_.find(bs_id) : eNB_configs_.begin();
+  auto bsend = bs_id != 0 && bsit != eNB_configs_.end() ? std::next(bsit) : eNB_configs_.end();
+  if (filter.has_cursor() && bs_id == 0)
+    bsit = eNB_configs_.lower_bound(filter.get_cursor_bs());
+
+  size_t remaining = filter.get_limit();
+  for (; bsit != bsend; ++bsit) {
+    if (bs_id == 0 && !filter.selects_bs(bsit->first)) continue;
+    if (filter.all_ues() && !filter.paged()) {
+      page.push_back(page_entry{bsit->second, nullptr});
+      continue;
+    }
 
-  return format_mac_stats_to_json(mac_stats);
+    std::vector<rnti_t> rntis = bsit->second->select_ues(filter);
+    if (filter.has_cursor() && bsit->first == filter.get_cursor_bs()) {
+      /* the previous page ended within this BS */
+      rntis.erase(rntis.begin(), std::upper_bound(rntis.begin(), rntis.end(),
+            filter.get_cursor_rnti()));
+      if (rntis.empty()) continue;
+    }
+    if (filter.get_limit() > 0) {
+      if (remaining == 0) {
+        more = true;
+        break;
+      }
+      if (rntis.size() > remaining) {
+        rntis.resize(remaining);
+        more = true;
+      }
+      remaining -= rntis.size();
+    }
+    page.push_back(page_entry{bsit->second,
+        std::unique_ptr<std::vector<rnti_t>>(new std::vector<rnti_t>(std::move(rntis)))});
+    if (more) break;
+  }
+  return page;
+}
+
+std::string flexran::rib::Rib::next_cursor(const stats_filter& filter, uint64_t bs_id) const
+{
+  bool more = false;
+  const std::vector<page_entry> page = select_page(filter, bs_id, more);
+  if (!more) return "";
+  /* the last UE on the page; a page ends only after a UE */
+  for (auto it = page.rbegin(); it != page.rend(); ++it)
+    if (it->rntis && !it->rntis->empty())
+      return stats_filter::format_cursor(it->bs->get_id(), it->rntis->back());
+  return "";
+}
+
+std::string flexran::rib::Rib::dump_all_mac_stats_to_json_string(
+    const stats_filter& filter) const
+{
+  std::string str;
+  dump_mac_stats_to_json([&str] (const std::string& s) { str += s; }, filter);
+  return str;
 }
 
 bool flexran::rib::Rib::dump_mac_stats_by_bs_id_to_json_string(uint64_t bs_id,
-    std::string& out) const
+    std::string& out, const stats_filter& filter) const
 {
-  auto it = eNB_configs_.find(bs_id);
-  if (it == eNB_configs_.end()) return false;
+  if (eNB_configs_.find(bs_id) == eNB_configs_.end()) return false;
 
-  out = format_mac_stats_to_json(std::vector<std::string>{it->second->dump_mac_stats_to_json_string()});
+  out.clear();
+  dump_mac_stats_to_json([&out] (const std::string& s) { out += s; }, filter, bs_id);
   return true;
 }
 
+void flexran::rib::Rib::dump_mac_stats_to_json(const json_writer& out,
+    const stats_filter& filter, uint64_t bs_id) const
+{
+  /* same output as format_mac_stats_to_json() */
+  bool more;
+  const std::vector<page_entry> page = select_page(filter, bs_id, more);
+  out("[");
+  for (auto it = page.begin(); it != page.end(); ++it) {
+    out(it != page.begin() ? ",{" : "{");
+    it->bs->dump_mac_stats_to_json(out, filter, it->rntis.get());
+    out("}");
+  }
+  out("]");
+}
+
 std::string flexran::rib::Rib::format_mac_stats_to_json(
     const std::vector<std::string>& mac_stats_json)
 {
@@ -259,28 +351,48 @@ std::string flexran::rib::Rib::dump_all_enb_configurations_to_string() const {
   return str;
 }
 
-std::string flexran::rib::Rib::dump_all_enb_configurations_to_json_string() const
+std::string flexran::rib::Rib::dump_all_enb_configurations_to_json_string(
+    const stats_filter& filter) const
 {
-  std::vector<std::string> enb_configurations;
-  enb_configurations.reserve(eNB_configs_.size());
-  std::transform(eNB_configs_.begin(), eNB_configs_.end(), std::back_inserter(enb_configurations),
-      [] (const std::pair<int, std::shared_ptr<enb_rib_info>>& enb_config)
-      { return enb_config.second->dump_configs_to_json_string(); }
-  );
-
-  return format_enb_configurations_to_json(enb_configurations);
+  std::string str;
+  dump_enb_configurations_to_json([&str] (const std::string& s) { str += s; }, filter);
+  return str;
 }
 
 bool flexran::rib::Rib::dump_enb_configurations_by_bs_id_to_json_string(
-    uint64_t bs_id, std::string& out) const
+    uint64_t bs_id, std::string& out, const stats_filter& filter) const
 {
-  auto it = eNB_configs_.find(bs_id);
-  if (it == eNB_configs_.end()) return false;
+  if (eNB_configs_.find(bs_id) == eNB_configs_.end()) return false;
 
-  out = format_enb_configurations_to_json(std::vector<std::string>{it->second->dump_configs_to_json_string()});
+  out.clear();
+  dump_enb_configurations_to_json([&out] (const std::string& s) { out += s; }, filter, bs_id);
   return true;
 }
 
+void flexran::rib::Rib::dump_enb_configurations_to_json(const json_writer& out,
+    const stats_filter& filter, uint64_t bs_id) const
+{
+  /* same output as format_enb_configurations_to_json() */
+  bool more;
+  const std::vector<page_entry> page = select_page(filter, bs_id, more);
+  out("[");
+  for (auto it = page.begin(); it != page.end(); ++it) {
+    out(it != page.begin() ? ",{" : "{");
+    out(it->bs->dump_configs_to_json_string(it->rntis.get()));
+    out("}");
+  }
+  out("]");
+}
+
+void flexran::rib::Rib::dump_to_protobuf(const json_writer& out, bool configs,
+    bool stats, const stats_filter& filter, uint64_t bs_id) const
+{
+  bool more;
+  const std::vector<page_entry> page = select_page(filter, bs_id, more);
+  for (const page_entry& e : page)
+    out(e.bs->dump_to_protobuf(configs, stats, filter, e.rntis.get()));
+}
+
 std::string flexran::rib::Rib::format_enb_configurations_to_json(
     const std::vector<std::string>& enb_configurations_json)
 {
@@ -324,11 +436,11 @@ std::string flexran::rib::Rib::format_date_time(std::chrono::time_point<std::chr
 }
 
 bool flexran::rib::Rib::dump_ue_by_rnti_by_bs_id_to_json_string(
-    rnti_t rnti, std::string& out, uint64_t bs_id) const
+    rnti_t rnti, std::string& out, uint64_t bs_id, const stats_filter& filter) const
 {
   auto it = eNB_configs_.find(bs_id);
   if (it == eNB_configs_.end()) return false;
-  return it->second->dump_ue_spec_stats_by_rnti_to_json_string(rnti, out);
+  return it->second->dump_ue_spec_stats_by_rnti_to_json_string(rnti, out, filter);
 }
 
 uint64_t flexran::rib::Rib::get_bs_id(int agent_id) const
@@ -382,3 +494,55 @@ uint64_t flexran::rib::Rib::parse_bs_id(const std::string& bs_id_s) const
   if (!get_bs(enb_id)) return 0;
   return enb_id;
 }
+
+bool flexran::rib::Rib::select_bs(const std::string& selector,
+    std::vector<uint64_t>& bs_ids, std::string& error_reason) const
+{
+  bs_ids.clear();
+  if (selector == "all") {
+    for (const auto& e : eNB_configs_)
+      bs_ids.push_back(e.first);
+  } else if (selector.compare(0, 6, "label=") == 0) {
+    for (uint64_t bs_id : get_labelled_bs(selector.substr(6)))
+      if (get_bs(bs_id)) bs_ids.push_back(bs_id);
+  } else {
+    std::istringstream ss(selector);
+    std::string s;
+    while (std::getline(ss, s, ',')) {
+      if (s.empty()) continue;
+      const uint64_t bs_id = parse_enb_agent_id(s);
+      if (bs_id == 0) {
+        error_reason = "can not find BS " + s;
+        return false;
+      }
+      if (std::find(bs_ids.begin(), bs_ids.end(), bs_id) == bs_ids.end())
+        bs_ids.push_back(bs_id);
+    }
+  }
+  if (bs_ids.empty()) {
+    error_reason = "no BS selected by " + selector;
+    return false;
+  }
+  return true;
+}
+
+void flexran::rib::Rib::add_bs_label(uint64_t bs_id, const std::string& label)
+{
+  bs_labels_[label].insert(bs_id);
+}
+
+bool flexran::rib::Rib::remove_bs_label(uint64_t bs_id, const std::string& label)
+{
+  auto it = bs_labels_.find(label);
+  if (it == bs_labels_.end() || it->second.erase(bs_id) == 0)
+    return false;
+  if (it->second.empty())
+    bs_labels_.erase(it);
+  return true;
+}
+
+std::set<uint64_t> flexran::rib::Rib::get_labelled_bs(const std::string& label) const
+{
+  auto it = bs_labels_.find(label);
+  return it == bs_labels_.end() ? std::set<uint64_t>() : it->second;
+}
@@ -60,37 +60,101 @@ namespace flexran {
       std::shared_ptr<enb_rib_info> get_bs(uint64_t bs_id) const;
       std::shared_ptr<enb_rib_info> get_bs_from_agent(int agent_id) const;
       std::shared_ptr<agent_info>   get_agent(int agent_id) const;
+
+      /*! A snapshot is a deep copy of the RIB which other threads can read
+       * without synchronization. It is taken in two steps:
+       * prepare_snapshot() must be called while the RIB is not active, i.e.,
+       * in the task manager thread, but only copies which BSs and UEs exist.
+       * BSs that did not change since previous are shared with it.
+       * complete_snapshot() then copies the contents, which are protected by
+       * their own mutexes, and can run in any other thread */
+      std::shared_ptr<Rib> prepare_snapshot(
+          const std::shared_ptr<const Rib>& previous = nullptr) const;
+      void complete_snapshot();
+      //! both steps in one
+      std::shared_ptr<const Rib> snapshot(
+          const std::shared_ptr<const Rib>& previous = nullptr) const;
       
       void dump_mac_stats() const;
       
       void dump_enb_configurations() const;
 
       std::string dump_all_mac_stats_to_string() const;
-      std::string dump_all_mac_stats_to_json_string() const;
-      bool dump_mac_stats_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const;
+      /* The JSON dumps only write what is selected by filter. For a single
+       * BS, the BS selection of the filter is ignored */
+      std::string dump_all_mac_stats_to_json_string(
+          const stats_filter& filter = stats_filter::all()) const;
+      bool dump_mac_stats_by_bs_id_to_json_string(uint64_t bs_id, std::string& out,
+          const stats_filter& filter = stats_filter::all()) const;
+      /*! writes the MAC stats of all BSs (or bs_id if non-zero) UE by UE to
+       * out, with bounded memory */
+      void dump_mac_stats_to_json(const json_writer& out,
+          const stats_filter& filter, uint64_t bs_id = 0) const;
 
       static std::string format_mac_stats_to_json(const std::vector<std::string>& mac_stats_json);
       
       std::string dump_all_enb_configurations_to_string() const;
-      std::string dump_all_enb_configurations_to_json_string() const;
-      bool dump_enb_configurations_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const;
+      std::string dump_all_enb_configurations_to_json_string(
+          const stats_filter& filter = stats_filter::all()) const;
+      bool dump_enb_configurations_by_bs_id_to_json_string(uint64_t bs_id, std::string& out,
+          const stats_filter& filter = stats_filter::all()) const;
+      //! writes the configurations of all BSs (or bs_id) BS by BS to out
+      void dump_enb_configurations_to_json(const json_writer& out,
+          const stats_filter& filter, uint64_t bs_id = 0) const;
+
+      /*! writes all BSs (or bs_id) BS by BS to out as a sequence of
+       * length-delimited protobuf flex_nb_bs (see northbound.proto) with
+       * the configurations (if configs) and the MAC stats (if stats) */
+      void dump_to_protobuf(const json_writer& out, bool configs, bool stats,
+          const stats_filter& filter, uint64_t bs_id = 0) const;
+
+      /*! if filter is paged (has a limit), returns the cursor for the next
+       * page after the one the dumps above write, or an empty string if it
+       * is the last one */
+      std::string next_cursor(const stats_filter& filter, uint64_t bs_id = 0) const;
 
       static std::string format_enb_configurations_to_json(const std::vector<std::string>& enb_configurations_json);
 
-      bool dump_ue_by_rnti_by_bs_id_to_json_string(rnti_t rnti, std::string& out, uint64_t bs_id) const;
+      bool dump_ue_by_rnti_by_bs_id_to_json_string(rnti_t rnti, std::string& out, uint64_t bs_id,
+          const stats_filter& filter = stats_filter::all()) const;
 
       uint64_t get_bs_id(int agent_id) const;
       uint64_t parse_enb_agent_id(const std::string& enb_agent_id_s) const;
       uint64_t parse_bs_id(const std::string& bs_id_s) const;
+
+      /*! resolves the BSs of a batch operation. selector is "all", a
+       * comma-separated list of BSs (as for parse_enb_agent_id()), or
+       * "label=<label>" for all connected BSs with that label. Returns false
+       * if a listed BS does not exist or no BS is selected */
+      bool select_bs(const std::string& selector, std::vector<uint64_t>& bs_ids,
+          std::string& error_reason) const;
+      /*! labels can be given to any BS ID and are kept when the BS
+       * disconnects, so that it is selected again after a reconnect */
+      void add_bs_label(uint64_t bs_id, const std::string& label);
+      bool remove_bs_label(uint64_t bs_id, const std::string& label);
+      std::set<uint64_t> get_labelled_bs(const std::string& label) const;
       static std::string format_statistics_to_json(
           std::chrono::time_point<std::chrono::system_clock> t,
           const std::string& configurations, const std::string& mac_stats);
       static std::string format_date_time(std::chrono::time_point<std::chrono::system_clock> t);
       
     private:
+      /* a BS in a JSON dump, with its UEs (nullptr: all) */
+      struct page_entry {
+        std::shared_ptr<enb_rib_info> bs;
+        std::unique_ptr<std::vector<rnti_t>> rntis;
+      };
+      /* the BSs (all or bs_id) and UEs selected by filter that are on the
+       * page given by its cursor and limit. more is set if there is a next
+       * page */
+      std::vector<page_entry> select_page(const stats_filter& filter,
+          uint64_t bs_id, bool& more) const;
+
       std::map<uint64_t, std::shared_ptr<enb_rib_info>> eNB_configs_;
       std::map<int, std::shared_ptr<agent_info>> agent_configs_;
       std::set<std::shared_ptr<agent_info>> pending_agents_;
+      /* label -> BS IDs, not part of snapshots */
+      std::map<std::string, std::set<uint64_t>> bs_labels_;
 
       static constexpr const size_t AGENT_ID_LENGTH_LIMIT = 4;
       
@@ -22,6 +22,9 @@
  *  \email   x.foukas@sms.ed.ac.uk
  */
 
+#include <atomic>
+#include <chrono>
+
 #include "rib_common.h"
 
 const int flexran::rib::cqi_to_mcs[16] = {0, 0, 1, 2, 4, 6, 8, 11, 13, 16, 18, 20, 23, 25, 27, 28};
@@ -102,3 +105,31 @@ uint16_t flexran::rib::get_sfn_sf(frame_t frame, subframe_t subframe) {
   
   return sfn_sf;
 }
+
+uint64_t flexran::rib::next_rib_version()
+{
+  static std::atomic<uint64_t> version{static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count())};
+  return ++version;
+}
+
+namespace {
+  std::atomic<bool> virtual_clock{false};
+  std::atomic<uint64_t> virtual_tick{0};
+}
+
+std::chrono::steady_clock::time_point flexran::rib::clock_now()
+{
+  if (!virtual_clock.load(std::memory_order_relaxed))
+    return std::chrono::steady_clock::now();
+  /* the same in every run */
+  return std::chrono::steady_clock::time_point(std::chrono::hours(24))
+      + std::chrono::milliseconds(virtual_tick.load(std::memory_order_relaxed));
+}
+
+void flexran::rib::set_virtual_clock(uint64_t tick)
+{
+  virtual_tick.store(tick, std::memory_order_relaxed);
+  virtual_clock.store(true, std::memory_order_relaxed);
+}
@@ -25,7 +25,10 @@
 #ifndef RIB_COMMON_H_
 #define RIB_COMMON_H_
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <string>
 #include <utility>
 
 namespace flexran {
@@ -36,6 +39,10 @@ namespace flexran {
     typedef uint16_t subframe_t;
 
     typedef uint32_t rnti_t;
+
+    /* receives the pieces of JSON output, e.g., to send them while
+     * serializing large dumps */
+    typedef std::function<void(const std::string&)> json_writer;
     
     static int const MAX_NUM_HARQ = 8;
     static int const MAX_NUM_TB = 2;
@@ -69,6 +76,20 @@ namespace flexran {
     
     std::pair<frame_t, subframe_t> get_frame_subframe(uint32_t sfn_sf);
 
+    /*! returns a new version number for change tracking in the RIB. Versions
+     * are unique across all RIB objects and runs of the controller (they
+     * start at the wall clock time in us), so equal versions imply equal
+     * content */
+    uint64_t next_rib_version();
+
+    /*! the time of the RIB, e.g., for the liveness of BSs: the steady
+     * clock, or in virtual time the time of the current tick, so that a
+     * replay does not depend on the wall clock */
+    std::chrono::steady_clock::time_point clock_now();
+    /*! switches clock_now() to virtual time, tick ms after a fixed epoch.
+     * Called by the task manager in every tick of a replay */
+    void set_virtual_clock(uint64_t tick);
+
   }
   
 }
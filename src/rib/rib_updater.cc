@@ -32,15 +32,17 @@
 #include "rt_controller_common.h"
 
 #include "flexran_log.h"
+#include "async_log.h"
 
 #ifdef PROFILE
 #include <iostream>
 extern std::atomic_bool g_doprof;
 #endif
 
-unsigned int flexran::rib::rib_updater::run()
+unsigned int flexran::rib::rib_updater::run(uint64_t tick)
 {
-  return update_rib();
+  req_manager_.transactions().expire(tick);
+  return update_rib(tick);
 }
 
 #ifdef PROFILE
@@ -50,33 +52,51 @@ void flexran::rib::rib_updater::print_prof_results(std::chrono::duration<double>
   std::cout << "*** Agent throughput profiling results during "
       << us << "us ***\n";
   for (auto a : rib_.get_agents()) {
+    /* the counters are not reset, only what arrived while profiling */
+    const auto base = prof_base_[a.first];
+    const uint64_t packets = a.second->rx_packets - base.first;
+    const uint64_t bytes = a.second->rx_bytes - base.second;
     std::cout << "agent " << a.second->agent_id << " BS " << a.second->bs_id
-        << " rx packets " << a.second->rx_packets
-        << " rx_bytes " << a.second->rx_bytes
-        << " ~Mbps " << static_cast<double>(a.second->rx_bytes) / us << std::endl;
-    a.second->rx_bytes = 0;
-    a.second->rx_packets = 0;
+        << " rx packets " << packets
+        << " rx_bytes " << bytes
+        << " ~Mbps " << static_cast<double>(bytes) / us << std::endl;
   }
+  prof_base_.clear();
+  prof_running_ = false;
 }
 #endif
 
-unsigned int flexran::rib::rib_updater::update_rib()
+unsigned int flexran::rib::rib_updater::update_rib(uint64_t tick)
 {
   unsigned int processed = 0;
   int rem_msgs = messages_to_check_;
   std::shared_ptr<flexran::network::tagged_message> tm;
 
-  while(net_xface_.get_msg_from_network(tm) && (rem_msgs > 0)) {
+  while((rem_msgs > 0) && net_xface_.get_msg_from_network(tm)) {
+    if (trace_ && !trace_stopped_ && !trace_->write(tick, tm)) {
+      /* the trace would be incomplete; it is closed on shutdown, since
+       * closing waits for the writer */
+      LOG4CXX_ERROR(flog::rib, "could not write message trace (writer behind "
+          << "or disk error), stop tracing");
+      trace_stopped_ = true;
+    }
     if (tm->getSize() == 0) { // New connection. update the pending eNBs list
       handle_new_connection(tm->getTag());
     } else {
 #ifdef PROFILE
-      if (g_doprof) {
-        std::shared_ptr<agent_info> a = rib_.get_agent(tm->getTag());
-        a->rx_packets++;
-        a->rx_bytes += tm->getSize();
+      if (g_doprof && !prof_running_) {
+        for (auto a : rib_.get_agents())
+          prof_base_[a.first] = std::make_pair(a.second->rx_packets.load(),
+                                               a.second->rx_bytes.load());
+        prof_running_ = true;
       }
 #endif
+      /* unknown before the hello message has been handled */
+      std::shared_ptr<agent_info> a = rib_.get_agent(tm->getTag());
+      if (a) {
+        a->rx_packets.fetch_add(1, std::memory_order_relaxed);
+        a->rx_bytes.fetch_add(tm->getSize(), std::memory_order_relaxed);
+      }
       dispatch_message(tm);
     }
     rem_msgs--;
@@ -109,6 +129,9 @@ void flexran::rib::rib_updater::dispatch_message(std::shared_ptr<flexran::networ
 
   // Deserialize the message
   in_message.ParseFromArray(tm->getMessageContents(), tm->getSize());
+  // Match replies to their requests (only timing and callbacks, the RIB is
+  // updated below as for any other message)
+  req_manager_.transactions().complete(tm->getTag(), in_message);
   // Update the RIB based on the message type
   switch (in_message.msg_case()) {
   case protocol::flexran_message::kHelloMsg:
@@ -124,7 +147,7 @@ void flexran::rib::rib_updater::dispatch_message(std::shared_ptr<flexran::networ
     handle_stats_reply(tm->getTag(), in_message.stats_reply_msg());
     break;
   case protocol::flexran_message::kSfTriggerMsg:
-    handle_sf_trigger(tm->getTag(), in_message.sf_trigger_msg());
+    handle_sf_trigger(tm->getTag(), in_message.sf_trigger_msg(), tm->getArrival());
     break;
   case protocol::flexran_message::kUlSrInfoMsg:
     LOG4CXX_WARN(flog::rib, "NOT IMPLEMENTED Agent " << tm->getTag()
@@ -216,7 +239,7 @@ void flexran::rib::rib_updater::handle_hello(int agent_id,
 void flexran::rib::rib_updater::handle_echo_request(int agent_id,
     const protocol::flex_echo_request& echo_request_msg)
 {
-  LOG4CXX_INFO(flog::rib, "Agent " << agent_id << ": received echo request msg");
+  FLOG_INFO(flog::rib, "Agent {}: received echo request msg", agent_id);
   // Need to send an echo reply
   protocol::flex_header *header(new protocol::flex_header);
   header->set_type(protocol::FLPT_ECHO_REPLY);
@@ -242,12 +265,13 @@ void flexran::rib::rib_updater::handle_echo_reply(int agent_id,
     return;
   }
 
-  LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << ": received echo reply msg");
+  FLOG_DEBUG(flog::rib, "Agent {}: received echo reply msg", agent_id);
   if (bs) bs->update_liveness();
 }
 
 void flexran::rib::rib_updater::handle_sf_trigger(int agent_id,
-    const protocol::flex_sf_trigger& sf_trigger_msg)
+    const protocol::flex_sf_trigger& sf_trigger_msg,
+    std::chrono::steady_clock::time_point arrival)
 {
   auto bs = rib_.get_bs_from_agent(agent_id);
   if (!bs) {
@@ -255,9 +279,11 @@ void flexran::rib::rib_updater::handle_sf_trigger(int agent_id,
     return;
   }
 
-  LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << "/BS "
-      << bs->get_id() << " received a subframe trigger msg");
-  bs->update_subframe(sf_trigger_msg);
+  FLOG_DEBUG(flog::rib, "Agent {}/BS {} received a subframe trigger msg",
+      agent_id, bs->get_id());
+  /* the drift is estimated from the time the trigger came from the socket,
+   * not when the task manager took it */
+  bs->update_subframe(sf_trigger_msg, arrival);
 }
 
 void flexran::rib::rib_updater::handle_enb_config_reply(int agent_id,
@@ -269,7 +295,7 @@ void flexran::rib::rib_updater::handle_enb_config_reply(int agent_id,
     return;
   }
 
-  LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << " received an eNB config reply msg");
+  FLOG_DEBUG(flog::rib, "Agent {} received an eNB config reply msg", agent_id);
   bs->update_eNB_config(enb_config_reply_msg);
 }
 
@@ -282,7 +308,7 @@ void flexran::rib::rib_updater::handle_ue_config_reply(int agent_id,
     return;
   }
 
-  LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << " received a UE config reply msg");
+  FLOG_DEBUG(flog::rib, "Agent {} received a UE config reply msg", agent_id);
   bs->update_UE_config(ue_config_reply_msg);
 }
 
@@ -296,7 +322,7 @@ void flexran::rib::rib_updater::handle_lc_config_reply(int agent_id,
     return;
   }
 
-  LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << ": received an LC config reply msg");
+  FLOG_DEBUG(flog::rib, "Agent {}: received an LC config reply msg", agent_id);
   bs->update_LC_config(lc_config_reply_msg);
 }
 
@@ -323,7 +349,7 @@ void flexran::rib::rib_updater::handle_stats_reply(int agent_id,
     return;
   }
 
-  LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << ": received stats reply msg");
+  FLOG_DEBUG(flog::rib, "Agent {}: received stats reply msg", agent_id);
   bs->update_mac_stats(mac_stats_reply);
 }
 
@@ -357,6 +383,7 @@ void flexran::rib::rib_updater::handle_disconnect(int agent_id,
     const protocol::flex_disconnect& disconnect_msg)
 {
   _unused(disconnect_msg);
+  req_manager_.transactions().remove_agent(agent_id);
   uint64_t bs_id = rib_.get_bs_id(agent_id);
   if (bs_id > 0) { // existing base station
     LOG4CXX_INFO(flog::rib, "Agent " << agent_id << " of BS " << bs_id << " disconnected");
@@ -380,37 +407,34 @@ void flexran::rib::rib_updater::trigger_bs_config(uint64_t bs_id)
   protocol::flex_header *header1(new protocol::flex_header);
   header1->set_type(protocol::FLPT_GET_ENB_CONFIG_REQUEST);
   header1->set_version(0);
-  header1->set_xid(0);
   protocol::flex_enb_config_request *enb_config_request_msg(new protocol::flex_enb_config_request);
   enb_config_request_msg->set_allocated_header(header1);
   protocol::flexran_message out_message1;
   out_message1.set_msg_dir(protocol::INITIATING_MESSAGE);
   out_message1.set_allocated_enb_config_request_msg(enb_config_request_msg);
-  req_manager_.send_message(bs_id, out_message1);
+  req_manager_.send_request(bs_id, out_message1);
 
   // UE config second
   protocol::flex_header *header2(new protocol::flex_header);
   header2->set_type(protocol::FLPT_GET_UE_CONFIG_REQUEST);
   header2->set_version(0);
-  header2->set_xid(1);
   protocol::flex_ue_config_request *ue_config_request_msg(new protocol::flex_ue_config_request);
   ue_config_request_msg->set_allocated_header(header2);
   protocol::flexran_message out_message2;
   out_message2.set_msg_dir(protocol::INITIATING_MESSAGE);
   out_message2.set_allocated_ue_config_request_msg(ue_config_request_msg);
-  req_manager_.send_message(bs_id, out_message2);
+  req_manager_.send_request(bs_id, out_message2);
 
   // LC config third
   protocol::flex_header *header3(new protocol::flex_header);
   header3->set_type(protocol::FLPT_GET_LC_CONFIG_REQUEST);
   header2->set_version(0);
-  header3->set_xid(2);
   protocol::flex_lc_config_request *lc_config_request_msg(new protocol::flex_lc_config_request);
   lc_config_request_msg->set_allocated_header(header3);
   protocol::flexran_message out_message3;
   out_message3.set_msg_dir(protocol::INITIATING_MESSAGE);
   out_message3.set_allocated_lc_config_request_msg(lc_config_request_msg);
-  req_manager_.send_message(bs_id, out_message3);
+  req_manager_.send_request(bs_id, out_message3);
 }
 
 void flexran::rib::rib_updater::warn_unknown_agent_bs(const std::string& function, int agent_id)
@@ -31,6 +31,7 @@
 #include "flexran.pb.h"
 #include "rt_task.h"
 #include "subscription.h"
+#include "message_trace.h"
 #include <chrono>
 
 namespace flexran {
@@ -46,15 +47,26 @@ namespace flexran {
       : rib_(storage), net_xface_(xface), req_manager_(netman),
         event_sub_(ev), messages_to_check_(n_msg_check) {}
       
-      unsigned int run();
+      unsigned int run(uint64_t tick);
       
-      unsigned int update_rib();
+      unsigned int update_rib(uint64_t tick);
+
+      /*! record every received message into the given trace, to be replayed
+       * later in virtual time */
+      void set_message_trace(std::shared_ptr<flexran::network::message_trace_writer> trace)
+      { trace_ = trace; trace_stopped_ = false; }
 
 #ifdef PROFILE
       void print_prof_results(std::chrono::duration<double> d);
 #endif
 
     private:
+
+#ifdef PROFILE
+      /* rx counters of all agents when profiling started */
+      std::map<int, std::pair<uint64_t, uint64_t>> prof_base_;
+      bool prof_running_ = false;
+#endif
       
       // Incoming message handlers
       void handle_new_connection(int agent_id);
@@ -71,7 +83,8 @@ namespace flexran {
           const protocol::flex_echo_reply& echo_reply_msg);
 
       void handle_sf_trigger(int agent_id,
-          const protocol::flex_sf_trigger& sf_trigger_msg);
+          const protocol::flex_sf_trigger& sf_trigger_msg,
+          std::chrono::steady_clock::time_point arrival);
 
       void handle_enb_config_reply(int agent_id,
           const protocol::flex_enb_config_reply& enb_config_reply_msg);
@@ -105,6 +118,9 @@ namespace flexran {
       
       // Max number of messages to check during a single update period
       std::atomic<int> messages_to_check_;
+
+      std::shared_ptr<flexran::network::message_trace_writer> trace_;
+      bool trace_stopped_ = false;
       static constexpr const uint64_t BS_ID_OFFSET = 10000;
       
     };
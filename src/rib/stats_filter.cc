@@ -0,0 +1,148 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    stats_filter.cc
+ *  \brief   selection of BSs, UEs and fields when serializing statistics
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <google/protobuf/util/field_mask_util.h>
+
+#include "stats_filter.h"
+
+namespace {
+  /* short names of fields of flex_ue_stats_report, e.g., dl_cqi */
+  const char *field_alias(const std::string& name)
+  {
+    static const std::map<std::string, const char *> aliases = {
+      {"dl_cqi", "dl_cqi_report"},
+      {"ul_cqi", "ul_cqi_report"},
+      {"rlc", "rlc_report"},
+      {"rrc", "rrc_measurements"},
+      {"pdcp", "pdcp_stats"},
+      {"mac", "mac_stats"},
+      {"gtp", "gtp_stats"},
+      {"s1ap", "s1ap_stats"},
+    };
+    auto it = aliases.find(name);
+    return it != aliases.end() ? it->second : nullptr;
+  }
+}
+
+bool flexran::rib::stats_filter::set_fields(const std::string& fields,
+    std::string& error_reason)
+{
+  google::protobuf::FieldMask mask;
+  bool harq = false;
+  std::istringstream fss(fields);
+  std::string f;
+  while (std::getline(fss, f, ',')) {
+    if (f.empty()) continue;
+    if (f == "harq") {
+      harq = true;
+      continue;
+    }
+    /* resolve every component, so that JSON names can be used as well */
+    const google::protobuf::Descriptor *d = protocol::flex_ue_stats_report::descriptor();
+    std::string path;
+    std::istringstream pss(f);
+    std::string c;
+    while (std::getline(pss, c, '.')) {
+      if (!d) {
+        error_reason = "field " + f + " can not be selected, only its parent";
+        return false;
+      }
+      const google::protobuf::FieldDescriptor *fd = d->FindFieldByName(c);
+      if (!fd) fd = d->FindFieldByCamelcaseName(c);
+      if (!fd && path.empty() && field_alias(c))
+        fd = d->FindFieldByName(field_alias(c));
+      if (!fd) {
+        error_reason = "unknown field " + f;
+        return false;
+      }
+      if (!path.empty()) path += ".";
+      path += fd->name();
+      /* the field mask can not select inside of repeated fields */
+      d = fd->is_repeated() ? nullptr : fd->message_type();
+    }
+    if (path.empty()) {
+      error_reason = "unknown field " + f;
+      return false;
+    }
+    mask.add_paths(path);
+  }
+
+  fields_.Swap(&mask);
+  all_fields_ = fields_.paths_size() == 0 && !harq;
+  harq_ = all_fields_ || harq;
+  return true;
+}
+
+void flexran::rib::stats_filter::set_ues(const std::string& ues)
+{
+  ues_.clear();
+  std::istringstream uss(ues);
+  std::string s;
+  while (std::getline(uss, s, ','))
+    if (!s.empty()) ues_.push_back(s);
+}
+
+bool flexran::rib::stats_filter::set_cursor(const std::string& cursor,
+    std::string& error_reason)
+{
+  const size_t sep = cursor.find('-');
+  try {
+    size_t pos = 0;
+    if (sep == std::string::npos)
+      throw std::invalid_argument("no separator");
+    cursor_bs_ = std::stoull(cursor.substr(0, sep), &pos);
+    if (pos != sep)
+      throw std::invalid_argument("trailing characters");
+    cursor_rnti_ = std::stoul(cursor.substr(sep + 1), &pos);
+    if (pos != cursor.size() - sep - 1)
+      throw std::invalid_argument("trailing characters");
+  } catch (const std::exception& e) {
+    error_reason = "invalid cursor " + cursor;
+    return false;
+  }
+  has_cursor_ = true;
+  return true;
+}
+
+std::string flexran::rib::stats_filter::format_cursor(uint64_t bs_id, rnti_t rnti)
+{
+  return std::to_string(bs_id) + "-" + std::to_string(rnti);
+}
+
+void flexran::rib::stats_filter::project(const protocol::flex_ue_stats_report& src,
+    protocol::flex_ue_stats_report& dst) const
+{
+  google::protobuf::util::FieldMaskUtil::MergeMessageTo(src, fields_,
+      google::protobuf::util::FieldMaskUtil::MergeOptions(), &dst);
+}
+
+const flexran::rib::stats_filter& flexran::rib::stats_filter::all()
+{
+  static const stats_filter f;
+  return f;
+}
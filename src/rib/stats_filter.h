@@ -0,0 +1,113 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    stats_filter.h
+ *  \brief   selection of BSs, UEs and fields when serializing statistics
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef STATS_FILTER_H_
+#define STATS_FILTER_H_
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/field_mask.pb.h>
+
+#include "rib_common.h"
+#include "flexran.pb.h"
+
+namespace flexran {
+
+  namespace rib {
+
+    /* Describes which parts of the statistics a client wants. The RIB
+     * evaluates it while serializing, i.e., unselected BSs and UEs are
+     * skipped and only selected fields of UE statistics reports are copied
+     * and written. A default-constructed filter selects everything. */
+    class stats_filter {
+    public:
+      /*! parses a comma-separated list of fields of the UE statistics report
+       * (flex_ue_stats_report) to output, e.g., "bsr,mac_stats.tbs_dl".
+       * Fields can be given with their protobuf or JSON names, or the
+       * top-level ones with a short name (e.g., "dl_cqi" for
+       * "dl_cqi_report"); the special field "harq" selects the HARQ
+       * information. Returns false if a field does not exist */
+      bool set_fields(const std::string& fields, std::string& error_reason);
+      /// only output these BSs (by BS ID)
+      void set_bs(const std::set<uint64_t>& bs) { bs_ = bs; }
+      /// only output UEs given as a comma-separated list of RNTIs/IMSIs
+      void set_ues(const std::string& ues);
+      /// only output UEs in this DL slice
+      void set_dl_slice(uint32_t slice_id) { has_slice_ = true; slice_id_ = slice_id; }
+      /// output at most limit UEs in total, 0 means no limit
+      void set_limit(size_t limit) { limit_ = limit; }
+      /*! only output UEs after the given cursor, i.e., the next page of a
+       * previous request (see Rib::next_cursor()). Returns false if the
+       * cursor is malformed */
+      bool set_cursor(const std::string& cursor, std::string& error_reason);
+
+      bool selects_bs(uint64_t bs_id) const { return bs_.empty() || bs_.count(bs_id) > 0; }
+      /// true if all UEs of a BS are selected, i.e., no UE filter is active
+      bool all_ues() const { return ues_.empty() && !has_slice_; }
+      const std::vector<std::string>& get_ues() const { return ues_; }
+      bool has_dl_slice() const { return has_slice_; }
+      uint32_t get_dl_slice() const { return slice_id_; }
+      size_t get_limit() const { return limit_; }
+      bool has_cursor() const { return has_cursor_; }
+      uint64_t get_cursor_bs() const { return cursor_bs_; }
+      rnti_t get_cursor_rnti() const { return cursor_rnti_; }
+      /// true if UEs are restricted to a page of all UEs
+      bool paged() const { return limit_ > 0 || has_cursor_; }
+      //! cursor pointing after the UE rnti of BS bs_id
+      static std::string format_cursor(uint64_t bs_id, rnti_t rnti);
+
+      /// true if the full UE statistics report should be output
+      bool all_fields() const { return all_fields_; }
+      bool harq() const { return harq_; }
+      /*! copies the selected fields of src into dst, which should be empty.
+       * Must only be called if all_fields() is false */
+      void project(const protocol::flex_ue_stats_report& src,
+          protocol::flex_ue_stats_report& dst) const;
+
+      /// a filter that selects everything
+      static const stats_filter& all();
+
+    private:
+      std::set<uint64_t> bs_;
+      std::vector<std::string> ues_;
+      bool has_slice_ = false;
+      uint32_t slice_id_ = 0;
+      size_t limit_ = 0;
+      bool has_cursor_ = false;
+      uint64_t cursor_bs_ = 0;
+      rnti_t cursor_rnti_ = 0;
+
+      bool all_fields_ = true;
+      google::protobuf::FieldMask fields_;
+      bool harq_ = true;
+    };
+
+  }
+
+}
+
+#endif /* STATS_FILTER_H_ */
@@ -31,18 +31,19 @@
 
 #include "ue_mac_rib_info.h"
 #include "flexran_log.h"
+#include "async_log.h"
 
 void flexran::rib::ue_mac_rib_info::update_dl_sf_info(const protocol::flex_dl_info& dl_info) {
   uint8_t CC_id = dl_info.serv_cell_index();
   uint8_t harq_id = dl_info.harq_process_id();
   
   for (int i = 0; i < dl_info.harq_status_size(); i++) {
-    LOG4CXX_DEBUG(flog::rib, "HARQ ID " << static_cast<uint16_t>(harq_id)
-        << ", HARQ status " << dl_info.harq_status(i) << ", CC "
-        << static_cast<uint16_t>(CC_id));
+    FLOG_DEBUG(flog::rib, "HARQ ID {}, HARQ status {}, CC {}",
+        harq_id, dl_info.harq_status(i), CC_id);
     harq_stats_[CC_id][harq_id][i] = dl_info.harq_status(i);
     active_harq_[CC_id][harq_id][i] = true;
   }
+  sf_version_ = next_rib_version();
 }
 
 void flexran::rib::ue_mac_rib_info::update_ul_sf_info(const protocol::flex_ul_info& ul_info) {
@@ -52,6 +53,7 @@ void flexran::rib::ue_mac_rib_info::update_ul_sf_info(const protocol::flex_ul_in
   for (int i = 0; i < ul_info.ul_reception_size(); i++) {
     ul_reception_data_[CC_id][i] = ul_info.ul_reception(i);
   }
+  sf_version_ = next_rib_version();
 }
 
 void flexran::rib::ue_mac_rib_info::update_mac_stats_report(const protocol::flex_ue_stats_report& stats_report) {
@@ -116,6 +118,40 @@ void flexran::rib::ue_mac_rib_info::update_mac_stats_report(const protocol::flex
 
   if (protocol::FLUST_S1AP_STATS & flags)
     mac_stats_report_.mutable_s1ap_stats()->CopyFrom(stats_report.s1ap_stats());
+
+  stats_version_ = next_rib_version();
+}
+
+std::shared_ptr<flexran::rib::ue_mac_rib_info> flexran::rib::ue_mac_rib_info::prepare_clone(
+    const std::shared_ptr<const ue_mac_rib_info>& ue,
+    const std::shared_ptr<ue_mac_rib_info>& previous)
+{
+  if (previous && previous->stats_version_ == ue->stats_version_
+      && previous->sf_version_ == ue->sf_version_)
+    return previous;
+
+  auto c = std::make_shared<ue_mac_rib_info>(ue->rnti_);
+  c->harq_stats_ = ue->harq_stats_;
+  c->active_harq_ = ue->active_harq_;
+  c->uplink_reception_stats_ = ue->uplink_reception_stats_;
+  c->ul_reception_data_ = ue->ul_reception_data_;
+  c->tpc_ = ue->tpc_;
+  c->sf_version_ = ue->sf_version_.load();
+  /* the report might change until complete_clone(), which sets the version */
+  c->stats_version_ = 0;
+  c->clone_source_ = ue;
+  return c;
+}
+
+void flexran::rib::ue_mac_rib_info::complete_clone()
+{
+  if (!clone_source_) return;
+  {
+    std::lock_guard<std::mutex> guard(clone_source_->mac_stats_report_mutex_);
+    mac_stats_report_.CopyFrom(clone_source_->mac_stats_report_);
+    stats_version_ = clone_source_->stats_version_.load();
+  }
+  clone_source_.reset();
 }
 
 void flexran::rib::ue_mac_rib_info::dump_stats() const {
@@ -179,12 +215,50 @@ std::string flexran::rib::ue_mac_rib_info::dump_stats_to_string() const {
 
 }
 
-std::string flexran::rib::ue_mac_rib_info::dump_stats_to_json_string() const
+std::string flexran::rib::ue_mac_rib_info::dump_stats_to_protobuf(
+    const stats_filter& filter) const
 {
-  std::string mac_stats;
+  std::string out;
+  if (filter.all_fields()) {
+    std::lock_guard<std::mutex> guard(mac_stats_report_mutex_);
+    mac_stats_report_.SerializeToString(&out);
+    return out;
+  }
+  protocol::flex_ue_stats_report projected;
   mac_stats_report_mutex_.lock();
-  google::protobuf::util::MessageToJsonString(mac_stats_report_, &mac_stats, google::protobuf::util::JsonPrintOptions());
+  filter.project(mac_stats_report_, projected);
   mac_stats_report_mutex_.unlock();
+  /* the RNTI identifies the report, even if it was not selected */
+  projected.set_rnti(rnti_);
+  projected.SerializeToString(&out);
+  return out;
+}
+
+std::string flexran::rib::ue_mac_rib_info::dump_stats_to_json_string() const
+{
+  return dump_stats_to_json_string(stats_filter::all());
+}
+
+std::string flexran::rib::ue_mac_rib_info::dump_stats_to_json_string(
+    const stats_filter& filter) const
+{
+  std::string mac_stats;
+  if (filter.all_fields()) {
+    mac_stats_report_mutex_.lock();
+    google::protobuf::util::MessageToJsonString(mac_stats_report_, &mac_stats, google::protobuf::util::JsonPrintOptions());
+    mac_stats_report_mutex_.unlock();
+  } else {
+    /* copy only what is selected, and serialize outside of the lock */
+    protocol::flex_ue_stats_report projected;
+    mac_stats_report_mutex_.lock();
+    filter.project(mac_stats_report_, projected);
+    mac_stats_report_mutex_.unlock();
+    google::protobuf::util::MessageToJsonString(projected, &mac_stats, google::protobuf::util::JsonPrintOptions());
+  }
+
+  if (!filter.harq())
+    return "{\"rnti\": " + std::to_string(rnti_) + ",\"mac_stats\":" + mac_stats + "}";
+
   std::array<std::string, 8> harq;
 
   for (int i = 0; i < 8; i++) {
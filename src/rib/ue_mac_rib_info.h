@@ -29,8 +29,11 @@
 
 #include <cstdint>
 #include <mutex>
+#include <atomic>
+#include <memory>
 
 #include "rib_common.h"
+#include "stats_filter.h"
 #include "flexran.pb.h"
 
 template <class T, size_t rows, size_t cols>
@@ -72,13 +75,38 @@ namespace flexran {
 
      std::string dump_stats_to_json_string() const;
 
+     //! only writes the fields selected by filter
+     std::string dump_stats_to_json_string(const stats_filter& filter) const;
+
+     //! the stats report with the fields selected by filter, serialized as
+     //! protobuf (flex_ue_stats_report); HARQ information is not included
+     std::string dump_stats_to_protobuf(const stats_filter& filter = stats_filter::all()) const;
      static std::string format_stats_to_json(rnti_t rnti,
                                              const std::string& mac_stats,
                                              const std::array<std::string, 8>& harq);
 
      //! Access is only safe when the RIB is not active, i.e. within apps
      const protocol::flex_ue_stats_report& get_mac_stats_report() const { return mac_stats_report_; }
-     
+
+     //! version of the MAC stats report (excluding HARQ information)
+     uint64_t get_stats_version() const { return stats_version_; }
+
+     /*! version of the subframe information (HARQ, UL reception), changes
+      * on every subframe trigger of the UE or scheduled HARQ process */
+     uint64_t get_sf_version() const { return sf_version_; }
+
+     /*! first step of copying ue, e.g., for RIB snapshots. Returns previous
+      * if it has the same versions, otherwise a copy with the subframe
+      * information, whose stats report is copied by complete_clone(). Must
+      * be called while the RIB is not active, as the subframe information is
+      * not protected */
+     static std::shared_ptr<ue_mac_rib_info> prepare_clone(
+         const std::shared_ptr<const ue_mac_rib_info>& ue,
+         const std::shared_ptr<ue_mac_rib_info>& previous);
+
+     //! second step: copies the stats report. Can be called from any thread
+     void complete_clone();
+
      uint8_t get_harq_stats(uint16_t cell_id, int harq_pid) const {
        return harq_stats_[cell_id][harq_pid][0];
      }
@@ -109,6 +137,7 @@ namespace flexran {
      void harq_scheduled(uint16_t cell_id, uint8_t harq_pid) {
        active_harq_[cell_id][harq_pid][0] = false;
        active_harq_[cell_id][harq_pid][1] = false;
+       sf_version_ = next_rib_version();
      }
      
     private:
@@ -117,6 +146,7 @@ namespace flexran {
      
      protocol::flex_ue_stats_report mac_stats_report_;
      mutable std::mutex mac_stats_report_mutex_;
+     std::atomic<uint64_t> stats_version_{next_rib_version()};
 
      // TODO this could/should be protected with mutexes, too
      // SF info
@@ -125,6 +155,10 @@ namespace flexran {
      std::array<uint8_t, MAX_NUM_CC> uplink_reception_stats_;
      array2d<uint8_t, MAX_NUM_CC, MAX_NUM_LC> ul_reception_data_;
      uint8_t tpc_;
+     std::atomic<uint64_t> sf_version_{next_rib_version()};
+
+     /* between prepare_clone() and complete_clone(): the UE to copy from */
+     std::shared_ptr<const ue_mac_rib_info> clone_source_;
     };
 
   }
@@ -0,0 +1,118 @@
+#include <chrono>
+#include <future>
+#include <memory>
+
+#include "catch.hpp"
+#include "admission.h"
+#include "background_executor.h"
+
+TEST_CASE("test northbound admission control", "[admission]")
+{
+  namespace adm = flexran::core::admission;
+  const adm::clock::time_point t0 = adm::clock::now();
+  adm::request_class c;
+
+  SECTION("requests are classified by method and path") {
+    REQUIRE (adm::controller::classify("POST", "/slice/enb/-1") == adm::request_class::control);
+    REQUIRE (adm::controller::classify("DELETE", "/mme/enb/-1") == adm::request_class::control);
+    REQUIRE (adm::controller::classify("GET", "/stats") == adm::request_class::heavy);
+    REQUIRE (adm::controller::classify("GET", "/stats/mac_stats") == adm::request_class::heavy);
+    REQUIRE (adm::controller::classify("GET", "/stats/enb/-1/all") == adm::request_class::heavy);
+    REQUIRE (adm::controller::classify("GET", "/stats_manager/all") == adm::request_class::heavy);
+    REQUIRE (adm::controller::classify("GET", "/stats/ue/-1") == adm::request_class::read);
+    REQUIRE (adm::controller::classify("GET", "/stats/enb/-1/ue/-1") == adm::request_class::read);
+    REQUIRE (adm::controller::classify("GET", "/stats/conf/enb/-1") == adm::request_class::read);
+    REQUIRE (adm::controller::classify("GET", "/stats_stream") == adm::request_class::read);
+    REQUIRE (adm::controller::classify("GET", "/capabilities") == adm::request_class::read);
+    REQUIRE (adm::controller::endpoint("GET", "/stats/enb/-1") == "GET /stats");
+  }
+
+  SECTION("token buckets allow a burst and refill at the rate") {
+    adm::token_bucket b(10, 2, t0);
+    REQUIRE (b.take(t0));
+    REQUIRE (b.take(t0));
+    REQUIRE_FALSE (b.take(t0));
+    REQUIRE_FALSE (b.idle(t0));
+    REQUIRE (b.take(t0 + std::chrono::milliseconds(100)));
+    REQUIRE_FALSE (b.take(t0 + std::chrono::milliseconds(150)));
+    REQUIRE (b.idle(t0 + std::chrono::seconds(1)));
+  }
+
+  SECTION("clients are limited independently, control separately from reads") {
+    adm::options o;
+    o.client_rate = 1;
+    o.client_burst = 2;
+    adm::controller ac(o);
+    const uint64_t limited = adm::get_counters().client_limited[1];
+    REQUIRE (ac.admit("10.0.0.1", "GET", "/capabilities", c, t0) == adm::verdict::admitted);
+    REQUIRE (ac.admit("10.0.0.1", "GET", "/capabilities", c, t0) == adm::verdict::admitted);
+    REQUIRE (ac.admit("10.0.0.1", "GET", "/capabilities", c, t0) == adm::verdict::client_limit);
+    REQUIRE (c == adm::request_class::read);
+    REQUIRE (adm::get_counters().client_limited[1] == limited + 1);
+    REQUIRE (ac.admit("10.0.0.1", "POST", "/rrc/enb/-1", c, t0) == adm::verdict::admitted);
+    REQUIRE (ac.admit("10.0.0.2", "GET", "/capabilities", c, t0) == adm::verdict::admitted);
+    REQUIRE (ac.admit("10.0.0.1", "GET", "/capabilities", c,
+                      t0 + std::chrono::seconds(1)) == adm::verdict::admitted);
+    REQUIRE (ac.num_buckets() == 3);
+  }
+
+  SECTION("endpoints are limited over all clients") {
+    adm::options o;
+    o.endpoint_rate = 1;
+    o.endpoint_burst = 1;
+    adm::controller ac(o);
+    REQUIRE (ac.admit("10.0.0.1", "GET", "/stats/ue/1", c, t0) == adm::verdict::admitted);
+    REQUIRE (ac.admit("10.0.0.2", "GET", "/stats/enb/-1", c, t0) == adm::verdict::endpoint_limit);
+    REQUIRE (ac.admit("10.0.0.2", "GET", "/capabilities", c, t0) == adm::verdict::admitted);
+  }
+
+  SECTION("concurrent heavy requests are capped") {
+    adm::options o;
+    o.max_heavy = 1;
+    adm::controller ac(o);
+    adm::request_class c1, c2;
+    REQUIRE (ac.admit("10.0.0.1", "GET", "/stats", c1, t0) == adm::verdict::admitted);
+    REQUIRE (ac.num_heavy() == 1);
+    REQUIRE (ac.admit("10.0.0.2", "GET", "/stats", c2, t0) == adm::verdict::heavy_limit);
+    REQUIRE (ac.admit("10.0.0.2", "GET", "/stats/ue/1", c2, t0) == adm::verdict::admitted);
+    ac.finish(c2);
+    ac.finish(c1);
+    REQUIRE (ac.num_heavy() == 0);
+    REQUIRE (ac.admit("10.0.0.2", "GET", "/stats", c2, t0) == adm::verdict::admitted);
+  }
+
+  SECTION("a streamed heavy request holds its slot until the job ends") {
+    adm::options o;
+    o.max_heavy = 1;
+    auto ac = std::make_shared<adm::controller>(o);
+    flexran::core::background_executor executor(1, 2);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<void> ended;
+    REQUIRE (ac->admit("10.0.0.1", "GET", "/stats", c, t0) == adm::verdict::admitted);
+    {
+      /* like the REST handler: the ticket is current while the request is
+       * handled, and the streaming job keeps a copy */
+      adm::current_ticket() = adm::controller::make_ticket(ac, c);
+      adm::ticket t = adm::current_ticket();
+      REQUIRE (executor.submit([t, released] () { released.wait(); }, nullptr));
+      adm::current_ticket().reset();
+    }
+    REQUIRE (ac->num_heavy() == 1);
+    REQUIRE (ac->admit("10.0.0.2", "GET", "/stats", c, t0) == adm::verdict::heavy_limit);
+    REQUIRE (executor.submit([&ended] () { ended.set_value(); }, nullptr));
+    release.set_value();
+    ended.get_future().wait();
+    REQUIRE (ac->num_heavy() == 0);
+    REQUIRE (ac->admit("10.0.0.2", "GET", "/stats", c, t0) == adm::verdict::admitted);
+    ac->finish(c);
+  }
+
+  SECTION("requests that are not heavy get no ticket") {
+    adm::options o;
+    o.max_heavy = 1;
+    auto ac = std::make_shared<adm::controller>(o);
+    REQUIRE (ac->admit("10.0.0.1", "GET", "/stats/ue/1", c, t0) == adm::verdict::admitted);
+    REQUIRE_FALSE (adm::controller::make_ticket(ac, c));
+  }
+}
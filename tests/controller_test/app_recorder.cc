@@ -9,12 +9,28 @@ using Me = google::protobuf::Message;
 using Re = google::protobuf::Reflection;
 using Fd = google::protobuf::FieldDescriptor;
 
+#include <fstream>
+#include <future>
+#include <sstream>
+
 #include "catch.hpp"
 #include "recorder.h"
+#include "recording_writer.h"
+#include "recording_delta.h"
+#include "recording_file.h"
+#include "flight_recorder.h"
+#include "recording_replay.h"
+#include "enb_rib_info.h"
+#include "async_xface.h"
 namespace alog = flexran::app::log;
 
 void fill_message(Me &m, std::mt19937_64& mt);
 
+/* defined in rib.cc */
+std::shared_ptr<flexran::rib::agent_info> make_agent(
+    int agent_id, uint64_t bs_id, const std::vector<protocol::flex_bs_capability>& cs,
+    const std::vector<protocol::flex_bs_split>& sp);
+
 TEST_CASE("test binary serialization and deserialization", "[recorder]")
 {
   /* I don't want to "invent" all those numbers (and cannot for all), hence the
@@ -65,6 +81,469 @@ TEST_CASE("test binary serialization and deserialization", "[recorder]")
   std::vector<std::map<uint64_t, alog::bs_dump>> vr = alog::recorder::read_binary(info.filename);
   REQUIRE(v.size() == vr.size());
   REQUIRE(v == vr);
+
+  SECTION("streamed files are the same as written at once") {
+    auto slurp = [] (const std::string& fn) {
+      std::ifstream f(fn, std::ios::binary);
+      std::stringstream ss;
+      ss << f.rdbuf();
+      return ss.str();
+    };
+    for (alog::job_type t : {alog::job_type::all, alog::job_type::bin}) {
+      alog::job_info ji{ms_start, ms_start + n, f, t};
+      if (t == alog::job_type::bin)
+        alog::recorder::write_binary(ji, v);
+      else
+        alog::recorder::write_json(ji, v);
+      const std::string expected = slurp(f);
+
+      std::promise<uint64_t> written;
+      alog::recording_writer w(
+          [&written] (const alog::job_info&, uint64_t n) { written.set_value(n); }, 4);
+      ji.filename = f + ".stream";
+      REQUIRE(w.begin(ji));
+      for (auto c : v) {
+        /* the queue is small: wait for the writer instead of dropping */
+        while (!w.push(std::map<uint64_t, alog::bs_dump>(c)))
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      w.end();
+      REQUIRE(written.get_future().get() == v.size());
+      REQUIRE(slurp(ji.filename) == expected);
+    }
+  }
+
+  SECTION("JSON rendered in parallel is the same") {
+    /* enough chunks for several ranges, but only a few UEs per chunk to
+     * keep the rendered JSON small */
+    std::vector<std::map<uint64_t, alog::bs_dump>> many;
+    while (many.size() < 1000)
+      many.insert(many.end(), v.begin(), v.end());
+    for (auto& chunk : many) {
+      for (auto& bs : chunk) {
+        auto& ues = bs.second.ue_mac_harq_infos;
+        if (ues.size() > 2)
+          ues.resize(2);
+      }
+    }
+    std::ostringstream serial, parallel;
+    alog::recorder::write_json_chunks(serial, alog::job_type::all, many, nullptr);
+    flexran::core::background_executor executor(4, 2);
+    std::atomic<uint64_t> progress{0};
+    alog::recorder::write_json_chunks(parallel, alog::job_type::all, many,
+        &executor, &progress);
+    REQUIRE(parallel.str() == serial.str());
+    REQUIRE(progress == many.size());
+  }
+}
+
+TEST_CASE("delta recordings reconstruct the full chunks", "[recorder]")
+{
+  std::random_device rd;
+  const unsigned int seed = rd();
+  std::cout << "test app recorder.cc: delta seed is " << seed << ", please note if test fails\n";
+  std::mt19937_64 mt(seed);
+
+  /* configurations change rarely, statistics of a UE every few chunks, and
+   * UEs come and go: build the full chunks and the deltas a capture would
+   * produce */
+  const uint64_t bs_id = 12;
+  auto enb = std::make_shared<protocol::flex_enb_config_reply>();
+  auto ue = std::make_shared<protocol::flex_ue_config_reply>();
+  auto lc = std::make_shared<protocol::flex_lc_config_reply>();
+  fill_message(*enb, mt);
+  fill_message(*ue, mt);
+  fill_message(*lc, mt);
+  std::map<flexran::rib::rnti_t, std::shared_ptr<protocol::flex_ue_stats_report>> reports;
+  for (flexran::rib::rnti_t r : {100, 101, 102}) {
+    reports[r] = std::make_shared<protocol::flex_ue_stats_report>();
+    fill_message(*reports[r], mt);
+  }
+
+  const unsigned n = 50;
+  std::vector<std::map<uint64_t, alog::bs_dump>> v;
+  std::vector<alog::delta_chunk> d;
+  std::map<flexran::rib::rnti_t, std::array<bool, 8>> last_harq;
+  for (unsigned i = 0; i < n; ++i) {
+    alog::bs_delta bd;
+    if (i == 0 || i % 20 == 0) {
+      /* the configuration version moves, but only the eNB config changed */
+      if (i > 0) {
+        enb = std::make_shared<protocol::flex_enb_config_reply>();
+        fill_message(*enb, mt);
+      }
+      bd.enb_config = enb;
+      bd.ue_config = ue;
+      bd.lc_config = lc;
+    }
+    if (i == 30) {
+      reports.erase(101);
+      bd.removed.push_back(101);
+    }
+    if (i == 31) reports[103] = std::make_shared<protocol::flex_ue_stats_report>();
+    std::vector<mac_harq_info_t> harq;
+    for (auto& r : reports) {
+      alog::bs_delta::ue u;
+      u.rnti = r.first;
+      for (unsigned k = 0; k < 8; ++k) u.harq[k] = (i / 4 + k + r.first) % 3 == 0;
+      if (i == 0 || (i + r.first) % 7 == 0 || (i == 31 && r.first == 103)) {
+        if (i > 0) {
+          r.second = std::make_shared<protocol::flex_ue_stats_report>();
+          fill_message(*r.second, mt);
+        }
+        u.stats = r.second;
+      }
+      harq.push_back(std::make_pair(*r.second, u.harq));
+      /* only UEs that changed are part of a delta */
+      auto lh = last_harq.find(r.first);
+      if (u.stats || lh == last_harq.end() || lh->second != u.harq)
+        bd.ues.push_back(u);
+      last_harq[r.first] = u.harq;
+    }
+    v.push_back({{bs_id, alog::bs_dump{*enb, *ue, *lc, harq}}});
+    d.push_back({{bs_id, bd}});
+  }
+
+  const std::string f = "/tmp/flexran.test.app_recorder.delta";
+  {
+    std::ofstream file(f, std::ios::binary);
+    alog::delta_encoder enc(10);
+    enc.write_header(file);
+    for (unsigned i = 0; i < n; ++i)
+      REQUIRE(enc.write(file, 1000 + i, d[i]));
+    REQUIRE(enc.num_chunks() == n);
+  }
+  /* read_binary() detects delta recordings */
+  std::vector<std::map<uint64_t, alog::bs_dump>> vr = alog::recorder::read_binary(f);
+  REQUIRE(vr.size() == v.size());
+  REQUIRE(vr == v);
+
+  SECTION("delta recordings are smaller") {
+    alog::recorder::write_binary(alog::job_info{0, n, f + ".bin", alog::job_type::bin}, v);
+    std::ifstream full(f + ".bin", std::ios::binary | std::ios::ate);
+    std::ifstream delta(f, std::ios::binary | std::ios::ate);
+    REQUIRE(delta.tellg() * 3 < full.tellg());
+  }
+
+  SECTION("reading can start at a keyframe") {
+    alog::delta_encoder enc(10);
+    std::stringstream ss;
+    enc.write_header(ss);
+    std::vector<std::streampos> pos;
+    for (unsigned i = 0; i < n; ++i) {
+      pos.push_back(ss.tellp());
+      REQUIRE(enc.write(ss, 1000 + i, d[i]));
+    }
+    alog::delta_decoder dec;
+    ss.seekg(pos[20]);
+    uint64_t tick;
+    std::map<uint64_t, alog::bs_dump> chunk;
+    for (unsigned i = 20; i < n; ++i) {
+      REQUIRE(dec.next(ss, tick, chunk));
+      REQUIRE(tick == 1000 + i);
+      REQUIRE(chunk == v[i]);
+    }
+    REQUIRE_FALSE(dec.next(ss, tick, chunk));
+  }
+
+  SECTION("recording files are read by time slice and BS") {
+    /* a second BS with the same data */
+    const uint64_t bs2 = 13;
+    {
+      std::ofstream file(f + ".rec", std::ios::binary);
+      alog::recording_file_writer w(file, 10);
+      w.write_header();
+      for (unsigned i = 0; i < n; ++i) {
+        alog::delta_chunk c = d[i];
+        c.emplace(bs2, d[i].at(bs_id));
+        REQUIRE(w.write(1000 + i, c));
+      }
+      w.finish();
+    }
+    alog::recording_file_reader r;
+    REQUIRE(r.open(f + ".rec"));
+    REQUIRE(r.index().size() == 2 * n / 10);
+    REQUIRE(r.base_stations() == std::set<uint64_t>{bs_id, bs2});
+    uint64_t first, last;
+    REQUIRE(r.tick_range(first, last));
+    REQUIRE(first == 1000);
+    REQUIRE(last == 1000 + n - 1);
+
+    std::map<uint64_t, alog::bs_dump> slice;
+    REQUIRE(r.read(bs2, 1015, 1032, slice));
+    REQUIRE(slice.size() == 18);
+    for (const auto& c : slice)
+      REQUIRE(c.second == v[c.first - 1000].at(bs_id));
+
+    std::map<uint64_t, std::map<uint64_t, alog::bs_dump>> all;
+    REQUIRE(r.read(1049, UINT64_MAX, all));
+    REQUIRE(all.size() == 1);
+    REQUIRE(all.at(1049).size() == 2);
+
+    /* read_binary() reads recording files as well */
+    std::vector<std::map<uint64_t, alog::bs_dump>> vr = alog::recorder::read_binary(f + ".rec");
+    REQUIRE(vr.size() == n);
+    for (unsigned i = 0; i < n; ++i) {
+      REQUIRE(vr[i].size() == 2);
+      REQUIRE(vr[i].at(bs2) == v[i].at(bs_id));
+    }
+  }
+
+  SECTION("compressed blocks are read the same") {
+    for (int level : {0, 6}) {
+      std::ofstream file(f + ".rec" + std::to_string(level), std::ios::binary);
+      alog::recording_file_writer w(file, 10, level);
+      w.write_header();
+      for (unsigned i = 0; i < n; ++i)
+        REQUIRE(w.write(1000 + i, d[i]));
+      w.finish();
+    }
+    alog::recording_file_reader plain, compressed;
+    REQUIRE(plain.open(f + ".rec0"));
+    REQUIRE(compressed.open(f + ".rec6"));
+    REQUIRE(compressed.index().size() == plain.index().size());
+    for (size_t i = 0; i < plain.index().size(); ++i) {
+      REQUIRE(plain.index()[i].flags == 0);
+      REQUIRE(compressed.index()[i].flags == alog::index_entry::deflate);
+      REQUIRE(compressed.index()[i].size < plain.index()[i].size);
+    }
+    std::map<uint64_t, alog::bs_dump> a, b;
+    REQUIRE(plain.read(bs_id, 1005, 1044, a));
+    REQUIRE(compressed.read(bs_id, 1005, 1044, b));
+    REQUIRE(a.size() == 40);
+    REQUIRE(a == b);
+  }
+
+  SECTION("deltas folded into a base state start a new recording") {
+    /* as the flight recorder does when deltas leave its ring */
+    alog::delta_chunk base;
+    for (unsigned i = 0; i < 30; ++i)
+      alog::flight_recorder::apply(base, d[i]);
+    alog::delta_encoder enc(1000);
+    std::stringstream ss;
+    enc.write_header(ss);
+    REQUIRE(enc.write(ss, 1029, base));
+    for (unsigned i = 30; i < n; ++i)
+      REQUIRE(enc.write(ss, 1000 + i, d[i]));
+    alog::delta_decoder dec;
+    REQUIRE(dec.read_header(ss));
+    uint64_t tick;
+    std::map<uint64_t, alog::bs_dump> chunk;
+    for (unsigned i = 29; i < n; ++i) {
+      REQUIRE(dec.next(ss, tick, chunk));
+      REQUIRE(tick == 1000 + i);
+      REQUIRE(chunk == v[i]);
+    }
+  }
+
+  SECTION("chunks referring to unknown sections are rejected") {
+    alog::delta_encoder enc;
+    std::stringstream ss;
+    REQUIRE_FALSE(enc.write(ss, 0, d[1]));
+    REQUIRE(ss.str().empty());
+    REQUIRE(enc.write(ss, 0, d[0]));
+  }
+}
+
+TEST_CASE("delta captures contain only changed UEs", "[recorder]")
+{
+  using cap = protocol::flex_bs_capability;
+  flexran::rib::Rib rib;
+  const uint64_t bs = 0xe0000;
+  REQUIRE(rib.add_pending_agent(make_agent(0, bs, {cap::LOPHY, cap::HIPHY,
+      cap::LOMAC, cap::HIMAC, cap::RLC, cap::RRC, cap::SDAP, cap::PDCP,
+      cap::S1AP}, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs) == true);
+  auto ue_state = [&rib, bs] (flexran::rib::rnti_t rnti, protocol::flex_ue_state_change_type t) {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(t);
+    sc.mutable_config()->set_rnti(rnti);
+    rib.get_bs(bs)->update_UE_config(sc);
+  };
+  ue_state(100, protocol::FLUESC_ACTIVATED);
+  ue_state(101, protocol::FLUESC_ACTIVATED);
+
+  alog::delta_capture capture;
+  alog::delta_chunk c = capture.capture(rib);
+  REQUIRE(c.size() == 1);
+  REQUIRE(c.at(bs).enb_config);
+  REQUIRE(c.at(bs).ues.size() == 2);
+  REQUIRE(c.at(bs).ues[0].stats);
+
+  /* nothing changed */
+  c = capture.capture(rib);
+  REQUIRE(c.size() == 1);
+  REQUIRE_FALSE(c.at(bs).enb_config);
+  REQUIRE(c.at(bs).ues.empty());
+
+  protocol::flex_stats_reply s;
+  s.add_ue_report()->set_rnti(101);
+  s.mutable_ue_report(0)->set_flags(protocol::FLUST_PHR);
+  s.mutable_ue_report(0)->set_phr(10);
+  rib.get_bs(bs)->update_mac_stats(s);
+  c = capture.capture(rib);
+  REQUIRE(c.at(bs).ues.size() == 1);
+  REQUIRE(c.at(bs).ues[0].rnti == 101);
+  REQUIRE(c.at(bs).ues[0].stats->phr() == 10);
+
+  /* HARQ changes come without statistics */
+  protocol::flex_sf_trigger t;
+  auto *dl = t.add_dl_info();
+  dl->set_rnti(100);
+  dl->set_serv_cell_index(0);
+  dl->set_harq_process_id(2);
+  dl->add_harq_status(protocol::FLHS_NACK);
+  rib.get_bs(bs)->update_subframe(t);
+  c = capture.capture(rib);
+  REQUIRE(c.at(bs).ues.size() == 1);
+  REQUIRE(c.at(bs).ues[0].rnti == 100);
+  REQUIRE_FALSE(c.at(bs).ues[0].stats);
+  REQUIRE_FALSE(c.at(bs).ues[0].harq[2]);
+  REQUIRE(c.at(bs).ues[0].harq[1]);
+
+  ue_state(101, protocol::FLUESC_DEACTIVATED);
+  c = capture.capture(rib);
+  REQUIRE(c.at(bs).ue_config);
+  REQUIRE(c.at(bs).ues.empty());
+  REQUIRE(c.at(bs).removed == std::vector<flexran::rib::rnti_t>{101});
+
+  REQUIRE(rib.remove_eNB_config_entry(0) == true);
+  REQUIRE(capture.capture(rib).empty());
+}
+
+TEST_CASE("the flight recorder ring is bounded by time and memory", "[recorder]")
+{
+  using cap = protocol::flex_bs_capability;
+  flexran::rib::Rib rib;
+  flexran::network::async_xface net_xface(0);
+  flexran::core::requests_manager rm(rib, net_xface);
+  flexran::event::subscription ev;
+  flexran::core::background_executor executor(1, 4);
+  const uint64_t bs = 0xe0000;
+  REQUIRE(rib.add_pending_agent(make_agent(0, bs, {cap::LOPHY, cap::HIPHY,
+      cap::LOMAC, cap::HIMAC, cap::RLC, cap::RRC, cap::SDAP, cap::PDCP,
+      cap::S1AP}, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs) == true);
+  protocol::flex_ue_state_change sc;
+  sc.set_type(protocol::FLUESC_ACTIVATED);
+  sc.mutable_config()->set_rnti(100);
+  rib.get_bs(bs)->update_UE_config(sc);
+
+  /* new statistics in every tick */
+  auto run = [&rib, bs] (alog::flight_recorder& fr, uint64_t n) {
+    protocol::flex_stats_reply s;
+    s.add_ue_report()->set_rnti(100);
+    s.mutable_ue_report(0)->set_flags(protocol::FLUST_PHR);
+    for (uint64_t i = 1; i <= n; ++i) {
+      s.mutable_ue_report(0)->set_phr(i % 50);
+      rib.get_bs(bs)->update_mac_stats(s);
+      fr.tick(i);
+    }
+  };
+
+  SECTION("deltas older than pre_ms + post_ms leave the ring") {
+    alog::flight_recorder fr(rib, rm, ev, executor, 100, 10, 0, 1 << 20);
+    run(fr, 500);
+    REQUIRE(fr.ring_ms() == 111);
+  }
+
+  SECTION("the ring keeps less time if it exceeds its memory") {
+    alog::flight_recorder fr(rib, rm, ev, executor, 100, 10, 0, 2000);
+    run(fr, 500);
+    REQUIRE(fr.ring_ms() > 1);
+    REQUIRE(fr.ring_ms() < 111);
+    REQUIRE(fr.ring_bytes() <= 2000);
+  }
+}
+
+TEST_CASE("recordings are replayed into the RIB", "[recorder]")
+{
+  /* BS 12 with UEs 100 and 101 (leaving at 1020) over 50 ticks, BS 13
+   * disconnects at 1030 */
+  auto make_bs = [] (unsigned i, bool ue101) {
+    alog::bs_delta bd;
+    auto enb = std::make_shared<protocol::flex_enb_config_reply>();
+    enb->add_cell_config()->set_phy_cell_id(i < 25 ? 1 : 2);
+    auto ue = std::make_shared<protocol::flex_ue_config_reply>();
+    ue->add_ue_config()->set_rnti(100);
+    if (ue101) ue->add_ue_config()->set_rnti(101);
+    bd.enb_config = enb;
+    bd.ue_config = ue;
+    bd.lc_config = std::make_shared<protocol::flex_lc_config_reply>();
+    if (!ue101 && i == 20) bd.removed.push_back(101);
+    for (flexran::rib::rnti_t rnti : {100, 101}) {
+      if (rnti == 101 && !ue101) continue;
+      alog::bs_delta::ue u;
+      u.rnti = rnti;
+      for (unsigned k = 0; k < 8; ++k) u.harq[k] = (i + k) % 2 == 0;
+      auto report = std::make_shared<protocol::flex_ue_stats_report>();
+      report->set_rnti(rnti);
+      report->set_flags(protocol::FLUST_PHR);
+      report->set_phr(i / 5);
+      u.stats = report;
+      bd.ues.push_back(u);
+    }
+    return bd;
+  };
+  const std::string f = "/tmp/flexran.test.app_recorder.replay";
+  {
+    std::ofstream file(f, std::ios::binary);
+    alog::recording_file_writer w(file, 10);
+    w.write_header();
+    for (unsigned i = 0; i < 50; ++i) {
+      alog::delta_chunk c{{12, make_bs(i, i < 20)}};
+      if (i < 30) c.emplace(13, make_bs(i, true));
+      REQUIRE(w.write(1000 + i, c));
+    }
+    w.finish();
+  }
+
+  flexran::rib::Rib rib;
+  flexran::event::subscription ev;
+  std::vector<uint64_t> added, removed;
+  std::vector<flexran::rib::rnti_t> connected, disconnected;
+  ev.subscribe_bs_add([&added] (uint64_t bs_id) { added.push_back(bs_id); });
+  ev.subscribe_bs_remove([&removed] (uint64_t bs_id) { removed.push_back(bs_id); });
+  ev.subscribe_ue_connect([&connected] (uint64_t, flexran::rib::rnti_t r) { connected.push_back(r); });
+  ev.subscribe_ue_disconnect([&disconnected] (uint64_t, flexran::rib::rnti_t r) { disconnected.push_back(r); });
+
+  /* small windows, so that the replay reads across blocks */
+  alog::recording_replay replay(rib, ev, 7);
+  std::string error_reason;
+  REQUIRE_FALSE(replay.open(f + ".missing", error_reason));
+  REQUIRE(replay.open(f, error_reason));
+
+  REQUIRE(replay.feed(0));
+  REQUIRE(added == std::vector<uint64_t>{12, 13});
+  REQUIRE(connected.size() == 4);
+  auto bs = rib.get_bs(12);
+  REQUIRE(bs);
+  REQUIRE(bs->get_enb_config().cell_config(0).phy_cell_id() == 1);
+  REQUIRE(bs->get_ue_configs().ue_config_size() == 2);
+  REQUIRE(bs->get_ue_mac_info(101)->get_mac_stats_report().phr() == 0);
+  REQUIRE(bs->get_ue_mac_info(100)->get_harq_stats(0, 0) == protocol::FLHS_ACK);
+  REQUIRE(bs->get_ue_mac_info(100)->get_harq_stats(0, 1) == protocol::FLHS_NACK);
+
+  /* unchanged configurations keep their version */
+  const uint64_t config_version = bs->get_config_version();
+  REQUIRE(replay.feed(3));
+  REQUIRE(bs->get_config_version() == config_version);
+  REQUIRE(bs->get_ue_mac_info(100)->get_harq_stats(0, 0) == protocol::FLHS_NACK);
+
+  REQUIRE(replay.feed(26));
+  REQUIRE(disconnected == std::vector<flexran::rib::rnti_t>{101});
+  REQUIRE(bs->get_ue_configs().ue_config_size() == 1);
+  REQUIRE(bs->get_enb_config().cell_config(0).phy_cell_id() == 2);
+  REQUIRE(bs->get_ue_mac_info(100)->get_mac_stats_report().phr() == 5);
+  REQUIRE(removed.empty());
+
+  REQUIRE(replay.feed(30));
+  REQUIRE(removed == std::vector<uint64_t>{13});
+  REQUIRE(rib.get_available_base_stations() == std::set<uint64_t>{12});
+
+  REQUIRE(replay.feed(48));
+  REQUIRE_FALSE(replay.feed(49));
+  REQUIRE(replay.num_chunks() == 50);
 }
 
 void fill_by_type_repeated(Me &m, const Fd *fd, std::mt19937_64& mt)
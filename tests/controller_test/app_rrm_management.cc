@@ -1,9 +1,17 @@
 #include "catch.hpp"
 #include "rrm_management.h"
+#include "async_xface.h"
 #include <vector>
 #include <iostream>
 
 using rrm = flexran::app::management::rrm_management;
+using cap = protocol::flex_bs_capability;
+using spl = protocol::flex_bs_split;
+
+/* defined in rib.cc */
+std::shared_ptr<flexran::rib::agent_info> make_agent(
+    int agent_id, uint64_t bs_id, const std::vector<cap>& cs,
+    const std::vector<spl>& sp);
 
 TEST_CASE("test correct parsing of IMSIs", "[rrm_management]")
 {
@@ -56,3 +64,73 @@ TEST_CASE("test correct parsing of IMSIs", "[rrm_management]")
   REQUIRE(ret == false);
   REQUIRE(imsis.size() == 0);
 }
+
+TEST_CASE("batch operations on many BSs", "[rrm_management]")
+{
+  flexran::rib::Rib rib;
+  flexran::network::async_xface net_xface(0);
+  flexran::core::requests_manager rm(rib, net_xface);
+  flexran::event::subscription ev;
+  rrm r(rib, rm, ev);
+
+  const std::vector<cap> all_caps = {cap::LOPHY, cap::HIPHY, cap::LOMAC,
+      cap::HIMAC, cap::RLC, cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP};
+  const std::vector<uint64_t> bs = {0xe0000, 0xe0001, 0xe0002};
+  for (int i = 0; i < 3; ++i) {
+    REQUIRE(rib.add_pending_agent(make_agent(i, bs[i], all_caps, {})) == true);
+    REQUIRE(rib.new_eNB_config_entry(bs[i]) == true);
+    protocol::flex_enb_config_reply ec;
+    auto *sc = ec.add_cell_config()->mutable_slice_config();
+    /* the last BS uses another slice algorithm */
+    sc->mutable_dl()->set_algorithm(i == 2 ? protocol::NVS : protocol::None);
+    sc->mutable_ul()->set_algorithm(protocol::None);
+    rib.get_bs(bs[i])->update_eNB_config(ec);
+  }
+
+  std::vector<uint64_t> selected;
+  std::string error_reason;
+
+  SECTION("BSs are selected by list, label, or all") {
+    REQUIRE(r.select_bs("all", selected, error_reason) == true);
+    REQUIRE(selected == bs);
+    REQUIRE(r.select_bs("0xe0001,2,917505", selected, error_reason) == true);
+    REQUIRE(selected == std::vector<uint64_t>({bs[1], bs[2]}));
+    REQUIRE(r.select_bs("0xe0001,0xf0000", selected, error_reason) == false);
+
+    REQUIRE(r.select_bs("label=north", selected, error_reason) == false);
+    REQUIRE(r.label_bs("0xe0000", "north", true, error_reason) == true);
+    REQUIRE(r.label_bs("2", "north", true, error_reason) == true);
+    REQUIRE(r.label_bs("0xe0000", "a,b", true, error_reason) == false);
+    REQUIRE(r.select_bs("label=north", selected, error_reason) == true);
+    REQUIRE(selected == std::vector<uint64_t>({bs[0], bs[2]}));
+    REQUIRE(r.label_bs("2", "north", false, error_reason) == true);
+    REQUIRE(r.label_bs("2", "north", false, error_reason) == false);
+    REQUIRE(r.select_bs("label=north", selected, error_reason) == true);
+    REQUIRE(selected == std::vector<uint64_t>({bs[0]}));
+  }
+
+  SECTION("a slice configuration is validated once and sent to all BSs") {
+    flexran::app::batch_results results;
+    REQUIRE_THROWS_AS(r.apply_slice_config_policy(bs, "{\"dl\": 3", results),
+        std::invalid_argument);
+    REQUIRE(results.empty());
+    REQUIRE(net_xface.out_queue_depth() == 0);
+
+    r.apply_slice_config_policy(bs, "{\"dl\":{\"scheduler\":\"pf\"}}", results);
+    REQUIRE(results.size() == 3);
+    for (int i = 0; i < 3; ++i) {
+      REQUIRE(results[i].bs_id == bs[i]);
+      REQUIRE(results[i].error.empty());
+    }
+    REQUIRE(net_xface.out_queue_depth() == 3);
+
+    /* not valid with the current algorithm of the first two BSs */
+    results.clear();
+    r.apply_slice_config_policy(bs, "{\"dl\":{\"slices\":[{\"id\":1}]}}", results);
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[0].error == "no slice algorithm, but slices present");
+    REQUIRE(results[1].error == "no slice algorithm, but slices present");
+    REQUIRE(results[2].error.empty());
+    REQUIRE(net_xface.out_queue_depth() == 4);
+  }
+}
@@ -0,0 +1,54 @@
+#include "catch.hpp"
+#include "stats_manager.h"
+#include "async_xface.h"
+#include "enb_rib_info.h"
+
+using cap = protocol::flex_bs_capability;
+using spl = protocol::flex_bs_split;
+
+/* defined in rib.cc */
+std::shared_ptr<flexran::rib::agent_info> make_agent(
+    int agent_id, uint64_t bs_id, const std::vector<cap>& cs,
+    const std::vector<spl>& sp);
+
+TEST_CASE("statistics entity tags follow the RIB versions", "[stats_manager]")
+{
+  flexran::rib::Rib rib;
+  flexran::network::async_xface net_xface(0);
+  flexran::core::requests_manager rm(rib, net_xface);
+  flexran::event::subscription ev;
+  flexran::app::stats::stats_manager stats(rib, rm, ev);
+
+  const uint64_t bs = 0xe0000;
+  const flexran::rib::rnti_t rnti = 0x1234;
+  const std::vector<cap> all_caps = {cap::LOPHY, cap::HIPHY, cap::LOMAC,
+      cap::HIMAC, cap::RLC, cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP};
+  REQUIRE(rib.add_pending_agent(make_agent(1, bs, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs) == true);
+  protocol::flex_ue_state_change sc;
+  sc.set_type(protocol::FLUESC_ACTIVATED);
+  sc.mutable_config()->set_rnti(rnti);
+  rib.get_bs(bs)->update_UE_config(sc);
+
+  const std::string all = stats.stats_etag("all", bs);
+  const std::string mac = stats.stats_etag("mac_stats", bs);
+  const std::string conf = stats.stats_etag("enb_config", bs);
+  const std::string ue = stats.ue_stats_etag(rnti, bs);
+  REQUIRE(stats.stats_etag("all", bs) == all);
+  REQUIRE(stats.ue_stats_etag(rnti, bs) == ue);
+
+  /* the JSON statistics contain the HARQ states */
+  protocol::flex_sf_trigger t;
+  t.set_sfn_sf((17 << 4) | 3);
+  auto *dl = t.add_dl_info();
+  dl->set_rnti(rnti);
+  dl->set_serv_cell_index(0);
+  dl->set_harq_process_id(5);
+  dl->add_harq_status(protocol::FLHS_NACK);
+  rib.get_bs(bs)->update_subframe(t);
+  REQUIRE(stats.stats_etag("all", bs) != all);
+  REQUIRE(stats.stats_etag("all") != stats.stats_etag("enb_config"));
+  REQUIRE(stats.stats_etag("mac_stats", bs) != mac);
+  REQUIRE(stats.stats_etag("enb_config", bs) == conf);
+  REQUIRE(stats.ue_stats_etag(rnti, bs) != ue);
+}
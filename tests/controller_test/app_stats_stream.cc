@@ -0,0 +1,67 @@
+#include "catch.hpp"
+#include "stats_stream.h"
+#include "async_xface.h"
+#include "enb_rib_info.h"
+
+using cap = protocol::flex_bs_capability;
+using spl = protocol::flex_bs_split;
+
+/* defined in rib.cc */
+std::shared_ptr<flexran::rib::agent_info> make_agent(
+    int agent_id, uint64_t bs_id, const std::vector<cap>& cs,
+    const std::vector<spl>& sp);
+
+TEST_CASE("stats stream renders only changes outside the tick", "[stats_stream]")
+{
+  flexran::rib::Rib rib;
+  flexran::network::async_xface net_xface(0);
+  flexran::core::requests_manager rm(rib, net_xface);
+  flexran::event::subscription ev;
+  flexran::app::stats::stats_stream stream(rib, rm, ev, 256, 2);
+
+  const uint64_t bs = 0xe0000;
+  const std::vector<cap> all_caps = {cap::LOPHY, cap::HIPHY, cap::LOMAC,
+      cap::HIMAC, cap::RLC, cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP};
+  REQUIRE(rib.add_pending_agent(make_agent(1, bs, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs) == true);
+
+  uint64_t id;
+  std::string error_reason;
+  REQUIRE(stream.add_client("", "", "enb_config", 10, id, error_reason) == true);
+
+  uint64_t seen = 0;
+  std::vector<flexran::app::stats::stream_event> events;
+  stream.tick(0);
+  REQUIRE(stream.wait_events(seen, std::chrono::seconds(5)) == true);
+  REQUIRE(stream.pop_events(id, events) == true);
+  REQUIRE(events.size() == 1);
+  REQUIRE(events[0].type == "snapshot");
+
+  /* nothing changed: no render job, hence no events */
+  events.clear();
+  stream.tick(10);
+  REQUIRE(stream.wait_events(seen, std::chrono::milliseconds(50)) == false);
+  REQUIRE(stream.pop_events(id, events) == true);
+  REQUIRE(events.empty());
+
+  protocol::flex_enb_config_reply ec;
+  ec.add_cell_config()->set_phy_cell_id(3);
+  rib.get_bs(bs)->update_eNB_config(ec);
+  stream.tick(15);
+  REQUIRE(stream.wait_events(seen, std::chrono::milliseconds(50)) == false);
+  stream.tick(20);
+  REQUIRE(stream.wait_events(seen, std::chrono::seconds(5)) == true);
+  REQUIRE(stream.pop_events(id, events) == true);
+  REQUIRE(events.size() == 1);
+  REQUIRE(events[0].type == "enb_config");
+  REQUIRE(events[0].data.find("\"phyCellId\":3") != std::string::npos);
+
+  SECTION("the number of clients is limited") {
+    uint64_t id2;
+    REQUIRE(stream.add_client("", "", "all", 10, id2, error_reason) == true);
+    REQUIRE(stream.add_client("", "", "all", 10, id2, error_reason) == false);
+    REQUIRE(stream.num_clients() == 2);
+    stream.remove_client(id);
+    REQUIRE(stream.add_client("", "", "all", 10, id2, error_reason) == true);
+  }
+}
@@ -0,0 +1,51 @@
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "async_log.h"
+namespace alog = flexran::core::async_log;
+
+TEST_CASE("test async log formatting", "[async_log]")
+{
+  alog::record r{&*flog::core, alog::level::info, 4,
+    "BS {}: UE {} has CQI {} ({})", __FILE__, __func__, __LINE__,
+    {alog::make_arg(uint64_t(1234)), alog::make_arg(-5), alog::make_arg(7.5),
+     alog::make_arg("ok")}};
+  REQUIRE (alog::format(r) == "BS 1234: UE -5 has CQI 7.5 (ok)");
+
+  r.nargs = 1;
+  REQUIRE (alog::format(r) == "BS 1234: UE {} has CQI {} ({})");
+}
+
+TEST_CASE("test async log from several threads", "[async_log]")
+{
+  const uint64_t before = alog::written() + alog::dropped();
+  alog::start(64);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([t] () {
+      for (int i = 0; i < 1000; ++i)
+        FLOG_DEBUG(flog::core, "thread {} message {}", t, i);
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+  alog::stop();
+  if (flog::core->isDebugEnabled())
+    REQUIRE (alog::written() + alog::dropped() - before == 4000);
+}
+
+TEST_CASE("test async log removes rings of exited threads", "[async_log]")
+{
+  alog::start(64);
+  const size_t rings = alog::num_rings();
+  for (int round = 0; round < 10; ++round) {
+    std::thread t([] () { FLOG_ERROR(flog::core, "short-lived thread {}", 1); });
+    t.join();
+  }
+  /* the writer drains and removes them */
+  for (int i = 0; i < 1000 && alog::num_rings() > rings; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  REQUIRE (alog::num_rings() == rings);
+  alog::stop();
+}
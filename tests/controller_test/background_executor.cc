@@ -0,0 +1,64 @@
+#include <atomic>
+#include <thread>
+
+#include "catch.hpp"
+#include "background_executor.h"
+
+TEST_CASE("test background executor", "[background_executor]")
+{
+  flexran::core::background_executor ex(2, 4);
+
+  SECTION("completions run in the thread calling run_completions()") {
+    std::atomic<int> sum{0};
+    int done = 0;
+    const auto me = std::this_thread::get_id();
+    std::thread::id done_thread;
+    REQUIRE (ex.submit([&sum] () { sum += 3; },
+                       [&done, &done_thread] () { done++; done_thread = std::this_thread::get_id(); }));
+    while (ex.num_completed() < 1)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    REQUIRE (sum == 3);
+    REQUIRE (done == 0);
+    ex.run_completions();
+    REQUIRE (done == 1);
+    REQUIRE (done_thread == me);
+  }
+
+  SECTION("futures deliver results and errors") {
+    auto f = ex.submit_future([] () { return 42; });
+    REQUIRE (f.get() == 42);
+    auto g = ex.submit_future([] () -> int { throw std::logic_error("fail"); });
+    REQUIRE_THROWS_AS (g.get(), std::logic_error);
+  }
+
+  SECTION("the queue is bounded and drained on shutdown") {
+    std::atomic<bool> go{false};
+    std::atomic<int> n{0};
+    auto block = [&go, &n] () { while (!go) std::this_thread::yield(); n++; };
+    int accepted = 0;
+    for (int i = 0; i < 10; ++i)
+      accepted += ex.submit(block);
+    /* 2 running, 4 queued, rest rejected */
+    REQUIRE (accepted <= 6);
+    REQUIRE (ex.num_rejected() == static_cast<uint64_t>(10 - accepted));
+    auto r = ex.submit_future([] () { return 1; });
+    REQUIRE_THROWS_AS (r.get(), std::runtime_error);
+    go = true;
+    ex.shutdown();
+    REQUIRE (n == accepted);
+    REQUIRE (ex.submit([] () {}) == false);
+  }
+
+  SECTION("post never blocks and shutdown runs pending completions") {
+    int done = 0;
+    int posted = 0;
+    for (int i = 0; i < 2000; ++i)
+      posted += ex.post([&done] () { done++; });
+    REQUIRE (posted < 2000);
+    REQUIRE (ex.num_dropped_completions() == static_cast<uint64_t>(2000 - posted));
+    ex.shutdown();
+    REQUIRE (done == posted);
+    REQUIRE (ex.post([&done] () { done++; }) == false);
+    REQUIRE (done == posted);
+  }
+}
@@ -0,0 +1,58 @@
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "catch.hpp"
+#include "command_queue.h"
+
+TEST_CASE("test command queue", "[command_queue]")
+{
+  flexran::core::command_queue q(4);
+  std::atomic<bool> stop{false};
+
+  SECTION("commands run in the thread calling run_pending()") {
+    std::thread::id rt_thread;
+    std::thread rt([&q, &stop, &rt_thread] () {
+      rt_thread = std::this_thread::get_id();
+      while (!stop) {
+        q.run_pending();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    });
+    std::thread::id ran_in;
+    REQUIRE (q.run([&ran_in] () { ran_in = std::this_thread::get_id(); return 42; }) == 42);
+    REQUIRE (ran_in == rt_thread);
+    REQUIRE_THROWS_AS (q.run([] () -> int { throw std::logic_error("fail"); }),
+                       std::logic_error);
+    q.run([] () {});
+    REQUIRE (q.num_executed() == 3);
+    stop = true;
+    rt.join();
+  }
+
+  SECTION("commands not run in time are cancelled") {
+    bool ran = false;
+    REQUIRE_THROWS_AS (q.run([&ran] () { ran = true; }, std::chrono::milliseconds(10)),
+                       std::runtime_error);
+    REQUIRE (q.num_timeouts() == 1);
+    REQUIRE (q.queue_depth() == 1);
+    REQUIRE (q.run_pending() == 0);
+    REQUIRE (q.queue_depth() == 0);
+    REQUIRE (ran == false);
+  }
+
+  SECTION("control commands run before bulk commands") {
+    std::string order;
+    typedef flexran::core::command_queue::priority prio;
+    std::thread bulk([&q, &order] () { q.run([&order] () { order += "b"; }, prio::bulk); });
+    while (q.queue_depth() < 1)
+      std::this_thread::yield();
+    std::thread control([&q, &order] () { q.run([&order] () { order += "c"; }); });
+    while (q.queue_depth() < 2)
+      std::this_thread::yield();
+    REQUIRE (q.run_pending() == 2);
+    bulk.join();
+    control.join();
+    REQUIRE (order == "cb");
+  }
+}
@@ -0,0 +1,71 @@
+#include <zlib.h>
+
+#include <string>
+
+#include "catch.hpp"
+#include "compression.h"
+
+namespace {
+  std::string inflate_all(const std::string& in, int window_bits)
+  {
+    z_stream z = {};
+    REQUIRE (inflateInit2(&z, window_bits) == Z_OK);
+    z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    z.avail_in = in.size();
+    std::string out;
+    int ret;
+    do {
+      char buf[4096];
+      z.next_out = reinterpret_cast<Bytef *>(buf);
+      z.avail_out = sizeof(buf);
+      ret = inflate(&z, Z_NO_FLUSH);
+      out.append(buf, sizeof(buf) - z.avail_out);
+    } while (ret == Z_OK);
+    inflateEnd(&z);
+    REQUIRE (ret == Z_STREAM_END);
+    return out;
+  }
+}
+
+TEST_CASE("test response compression", "[compression]")
+{
+  namespace cmp = flexran::core::compression;
+
+  SECTION("the encoding is negotiated from Accept-Encoding") {
+    REQUIRE (cmp::negotiate("") == cmp::encoding::identity);
+    REQUIRE (cmp::negotiate("gzip") == cmp::encoding::gzip);
+    REQUIRE (cmp::negotiate("deflate, gzip") == cmp::encoding::gzip);
+    REQUIRE (cmp::negotiate("gzip;q=0.5, deflate") == cmp::encoding::deflate);
+    REQUIRE (cmp::negotiate("gzip;q=0, deflate;q=0") == cmp::encoding::identity);
+    REQUIRE (cmp::negotiate("br, *") == cmp::encoding::gzip);
+    REQUIRE (cmp::negotiate("*;q=0.1, gzip;q=0") == cmp::encoding::deflate);
+    REQUIRE (cmp::negotiate("br") == cmp::encoding::identity);
+  }
+
+  std::string body = "{\"eNB_config\":[";
+  for (int i = 0; i < 1000; ++i)
+    body += "{\"rnti\":" + std::to_string(i) + ",\"dlCqi\":15},";
+  body += "]}";
+
+  SECTION("gzip and deflate bodies can be decompressed") {
+    const std::string gz = cmp::compress(cmp::encoding::gzip, 6, body);
+    REQUIRE (gz.size() < body.size() / 4);
+    REQUIRE (inflate_all(gz, 15 + 16) == body);
+    const std::string df = cmp::compress(cmp::encoding::deflate, 1, body);
+    REQUIRE (inflate_all(df, 15) == body);
+  }
+
+  SECTION("streams can be compressed in pieces") {
+    const uint64_t responses = cmp::get_counters().responses;
+    const uint64_t bytes_in = cmp::get_counters().bytes_in;
+    cmp::compressor c(cmp::encoding::gzip, 6);
+    std::string out;
+    for (size_t pos = 0; pos < body.size(); pos += 100)
+      c.write(body.substr(pos, 100), out);
+    c.finish(out);
+    REQUIRE (inflate_all(out, 15 + 16) == body);
+    REQUIRE (cmp::get_counters().responses == responses + 1);
+    REQUIRE (cmp::get_counters().bytes_in == bytes_in + body.size());
+    REQUIRE_THROWS_AS (c.write(body, out), std::logic_error);
+  }
+}
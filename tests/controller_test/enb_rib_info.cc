@@ -298,3 +298,79 @@ TEST_CASE("test update_LC_config correct merging", "[enb_rib_info]")
   REQUIRE (rib_info.get_lc_configs().lc_ue_config(0).lc_config_size() == 1);
   REQUIRE (rib_info.get_lc_configs().lc_ue_config(0).lc_config(0).lcid() == lcid2);
 }
+
+TEST_CASE("test subframe timing", "[enb_rib_info]")
+{
+  flexran::rib::enb_rib_info rib_info(1, {});
+  REQUIRE (rib_info.is_sf_synced() == false);
+
+  const auto t0 = st_clock::now();
+  protocol::flex_sf_trigger sf;
+  sf.set_sfn_sf(flexran::rib::get_sfn_sf(1023, 8));
+  rib_info.update_subframe(sf, t0);
+  REQUIRE (rib_info.is_sf_synced() == true);
+  REQUIRE (rib_info.next_subframe_start(t0) == t0 + std::chrono::milliseconds(1));
+
+  // two subframes later, crossing the SFN wrap-around, 80us late
+  sf.set_sfn_sf(flexran::rib::get_sfn_sf(0, 0));
+  rib_info.update_subframe(sf, t0 + std::chrono::microseconds(2080));
+  REQUIRE (rib_info.get_sf_drift() == std::chrono::microseconds(10));
+  REQUIRE (rib_info.next_subframe_start(t0 + std::chrono::microseconds(2500))
+           == t0 + std::chrono::microseconds(3010));
+
+  SECTION("large deviations re-anchor the timing") {
+    sf.set_sfn_sf(flexran::rib::get_sfn_sf(0, 1));
+    rib_info.update_subframe(sf, t0 + std::chrono::milliseconds(10));
+    REQUIRE (rib_info.get_sf_drift() == std::chrono::nanoseconds(0));
+    REQUIRE (rib_info.next_subframe_start(t0 + std::chrono::milliseconds(10))
+             == t0 + std::chrono::milliseconds(11));
+  }
+}
+
+TEST_CASE("test change tracking of configurations and statistics", "[enb_rib_info]")
+{
+  flexran::rib::enb_rib_info rib_info(1, {});
+  flexran::rib::enb_rib_info other(1, {});
+  const flexran::rib::rnti_t rnti = 0x1234;
+  /* versions are unique, even for a BS with the same ID */
+  REQUIRE (rib_info.get_config_version() != other.get_config_version());
+  REQUIRE (rib_info.get_stats_version() != other.get_stats_version());
+
+  protocol::flex_enb_config_reply c;
+  c.add_cell_config()->set_phy_cell_id(1);
+  const uint64_t v0 = rib_info.get_config_version();
+  rib_info.update_eNB_config(c);
+  const uint64_t v1 = rib_info.get_config_version();
+  REQUIRE (v1 != v0);
+
+  protocol::flex_ue_state_change sc;
+  sc.set_type(protocol::FLUESC_ACTIVATED);
+  sc.mutable_config()->set_rnti(rnti);
+  rib_info.update_UE_config(sc);
+  const uint64_t v2 = rib_info.get_config_version();
+  REQUIRE (v2 != v1);
+  REQUIRE (rib_info.get_rntis() == std::set<flexran::rib::rnti_t>{rnti});
+  const uint64_t ue0 = rib_info.get_ue_mac_info(rnti)->get_stats_version();
+
+  protocol::flex_stats_reply s;
+  s.add_ue_report()->set_rnti(rnti);
+  const uint64_t s0 = rib_info.get_stats_version();
+  rib_info.update_mac_stats(s);
+  REQUIRE (rib_info.get_config_version() == v2);
+  const uint64_t s1 = rib_info.get_stats_version();
+  REQUIRE (s1 != s0);
+  const uint64_t ue1 = rib_info.get_ue_mac_info(rnti)->get_stats_version();
+  REQUIRE (ue1 != ue0);
+
+  /* stats for unknown UEs only change the BS statistics */
+  protocol::flex_stats_reply s2;
+  s2.add_ue_report()->set_rnti(rnti + 1);
+  rib_info.update_mac_stats(s2);
+  REQUIRE (rib_info.get_stats_version() != s1);
+  REQUIRE (rib_info.get_ue_mac_info(rnti)->get_stats_version() == ue1);
+
+  sc.set_type(protocol::FLUESC_DEACTIVATED);
+  rib_info.update_UE_config(sc);
+  REQUIRE (rib_info.get_config_version() != v2);
+  REQUIRE (rib_info.get_rntis().empty());
+}
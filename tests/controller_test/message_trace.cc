@@ -0,0 +1,69 @@
+#include <string>
+#include <cstring>
+
+#include "catch.hpp"
+#include "message_trace.h"
+#include "flexran.pb.h"
+namespace fnet = flexran::network;
+
+TEST_CASE("test message trace writing and reading", "[message_trace]")
+{
+  const std::string f = "/tmp/flexran.test.message_trace.dat";
+  std::string err;
+  char big[4000];
+  for (size_t i = 0; i < sizeof(big); ++i)
+    big[i] = i % 251;
+
+  fnet::message_trace_writer w;
+  REQUIRE (w.open(f, err));
+  REQUIRE (w.write(17, fnet::tagged_message(0, 3))); // new connection
+  REQUIRE (w.write(17, fnet::tagged_message(const_cast<char *>("hello"), 5, 3)));
+  REQUIRE (w.write(20, fnet::tagged_message(big, sizeof(big), 4)));
+  REQUIRE (w.num_written() == 3);
+  w.close();
+
+  fnet::message_trace_reader r;
+  REQUIRE (r.open(f, err));
+  uint64_t tick;
+  std::unique_ptr<fnet::tagged_message> m;
+  REQUIRE (r.read(tick, m));
+  REQUIRE (tick == 17);
+  REQUIRE (m->getTag() == 3);
+  REQUIRE (m->getSize() == 0);
+  REQUIRE (r.read(tick, m));
+  REQUIRE (tick == 17);
+  REQUIRE (m->getSize() == 5);
+  REQUIRE (std::memcmp(m->getMessageContents(), "hello", 5) == 0);
+  REQUIRE (r.read(tick, m));
+  REQUIRE (tick == 20);
+  REQUIRE (m->getTag() == 4);
+  REQUIRE (m->getSize() == sizeof(big));
+  REQUIRE (std::memcmp(m->getMessageContents(), big, sizeof(big)) == 0);
+  REQUIRE (r.read(tick, m) == false);
+
+  SECTION("other files are rejected") {
+    fnet::message_trace_reader r2;
+    REQUIRE (r2.open("/dev/null", err) == false);
+  }
+}
+
+TEST_CASE("subframe triggers are recognized without parsing", "[message_trace]")
+{
+  auto tag = [] (const protocol::flexran_message& msg) {
+    const std::string s = msg.SerializeAsString();
+    return fnet::tagged_message(const_cast<char *>(s.data()), s.size(), 1);
+  };
+
+  protocol::flexran_message m;
+  m.set_msg_dir(protocol::INITIATING_MESSAGE);
+  m.mutable_sf_trigger_msg()->set_sfn_sf(1234);
+  m.mutable_sf_trigger_msg()->add_dl_info()->set_rnti(100);
+  REQUIRE (tag(m).isSfTrigger());
+
+  protocol::flexran_message r;
+  r.set_msg_dir(protocol::SUCCESSFUL_OUTCOME);
+  r.mutable_stats_reply_msg()->add_ue_report()->set_rnti(100);
+  REQUIRE_FALSE (tag(r).isSfTrigger());
+
+  REQUIRE_FALSE (fnet::tagged_message(0, 3).isSfTrigger());
+}
@@ -0,0 +1,129 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "flexran.pb.h"
+#include "rib.h"
+#include "metrics.h"
+#include "ran_metrics.h"
+
+using cap = protocol::flex_bs_capability;
+using spl = protocol::flex_bs_split;
+
+/* defined in rib.cc */
+std::shared_ptr<flexran::rib::agent_info> make_agent(
+    int agent_id, uint64_t bs_id, const std::vector<cap>& cs,
+    const std::vector<spl>& sp);
+
+TEST_CASE("test metrics exposition", "[metrics]")
+{
+  using flexran::core::metrics::histogram;
+  using flexran::core::metrics::writer;
+
+  SECTION("histograms count into the first bucket fitting a value") {
+    histogram h({10, 100});
+    for (uint64_t v : {1, 10, 11, 100, 1000})
+      h.observe(v);
+    REQUIRE (h.bucket(0) == 2);
+    REQUIRE (h.bucket(1) == 2);
+    REQUIRE (h.bucket(2) == 1);
+    REQUIRE (h.sum() == 1122);
+
+    writer w;
+    w.family("x_seconds", "histogram", "help", "seconds");
+    w.write("x_seconds", writer::labels({{"a", "b"}}), h, 1e-3);
+    REQUIRE (w.finish() ==
+        "# TYPE x_seconds histogram\n"
+        "# HELP x_seconds help\n"
+        "# UNIT x_seconds seconds\n"
+        "x_seconds_bucket{a=\"b\",le=\"0.01\"} 2\n"
+        "x_seconds_bucket{a=\"b\",le=\"0.1\"} 4\n"
+        "x_seconds_bucket{a=\"b\",le=\"+Inf\"} 5\n"
+        "x_seconds_count{a=\"b\"} 5\n"
+        "x_seconds_sum{a=\"b\"} 1.122\n"
+        "# EOF\n");
+  }
+
+  SECTION("counters follow the requested format") {
+    writer om(writer::format::openmetrics);
+    om.family("msgs", "counter", "Messages");
+    om.counter("msgs", "", 3);
+    REQUIRE (om.finish() == "# TYPE msgs counter\n# HELP msgs Messages\nmsgs_total 3\n# EOF\n");
+    writer prom(writer::format::prometheus);
+    prom.family("msgs", "counter", "Messages", "bytes");
+    prom.counter("msgs", "", 3);
+    REQUIRE (prom.finish() == "# TYPE msgs_total counter\n# HELP msgs_total Messages\nmsgs_total 3\n");
+    REQUIRE (writer::accepts_openmetrics("application/openmetrics-text;version=1.0.0,text/plain;q=0.5"));
+    REQUIRE (!writer::accepts_openmetrics("text/plain"));
+  }
+
+  SECTION("label values are escaped") {
+    REQUIRE (writer::labels({}) == "");
+    REQUIRE (writer::labels({{"a", "x\"y\\z\n"}, {"b", "1"}}) == "{a=\"x\\\"y\\\\z\\n\",b=\"1\"}");
+  }
+}
+
+TEST_CASE("RAN metrics are written from the RIB", "[metrics]")
+{
+  flexran::rib::Rib rib;
+  const std::vector<cap> all_caps =
+      {cap::LOPHY, cap::HIPHY, cap::LOMAC, cap::HIMAC,
+       cap::RLC, cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP};
+  const uint64_t bs = 0xe0000;
+  auto agent = make_agent(1, bs, all_caps, {});
+  REQUIRE (rib.add_pending_agent(agent) == true);
+  REQUIRE (rib.new_eNB_config_entry(bs) == true);
+  agent->rx_bytes = 1000;
+
+  protocol::flex_stats_reply s;
+  for (flexran::rib::rnti_t rnti : {0x100, 0x101}) {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->set_rnti(rnti);
+    sc.mutable_config()->set_imsi(208950000000000 + rnti);
+    sc.mutable_config()->set_dl_slice_id(rnti == 0x100 ? 0 : 1);
+    rib.get_bs(bs)->update_UE_config(sc);
+    protocol::flex_ue_stats_report *r = s.add_ue_report();
+    r->set_rnti(rnti);
+    r->set_flags(protocol::FLUST_DL_CQI | protocol::FLUST_MAC_STATS);
+    r->mutable_dl_cqi_report()->add_csi_report()->mutable_p10csi()->set_wb_cqi(12);
+    r->mutable_mac_stats()->set_total_bytes_sdus_dl(5000);
+  }
+  rib.get_bs(bs)->update_mac_stats(s);
+
+  flexran::app::stats::ran_metrics m;
+  flexran::core::metrics::writer w;
+  m.write(rib, w);
+  const std::string out = w.finish();
+  REQUIRE (out.find("flexran_agent_rx_bytes_total{agent_id=\"1\",bs_id=\"917504\"} 1000\n") != std::string::npos);
+  REQUIRE (out.find("flexran_cell_ues{bs_id=\"917504\",cell_id=\"0\"} 2\n") != std::string::npos);
+  REQUIRE (out.find("flexran_slice_ues{bs_id=\"917504\",slice_id=\"1\"} 1\n") != std::string::npos);
+  REQUIRE (out.find("flexran_ue_dl_cqi{bs_id=\"917504\",cell_id=\"0\",slice_id=\"0\","
+                    "rnti=\"256\",imsi=\"208950000000256\"} 12\n") != std::string::npos);
+  REQUIRE (out.find("flexran_ue_dl_bytes_total{bs_id=\"917504\",cell_id=\"0\",slice_id=\"1\","
+                    "rnti=\"257\",imsi=\"208950000000257\"} 5000\n") != std::string::npos);
+  REQUIRE (m.num_cached_ues() == 2);
+
+  SECTION("labels of removed UEs are dropped") {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_DEACTIVATED);
+    sc.mutable_config()->set_rnti(0x100);
+    rib.get_bs(bs)->update_UE_config(sc);
+    flexran::core::metrics::writer w2;
+    m.write(rib, w2);
+    REQUIRE (w2.finish().find("rnti=\"256\"") == std::string::npos);
+    REQUIRE (m.num_cached_ues() == 1);
+  }
+
+  SECTION("labels follow slice changes") {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_UPDATED);
+    sc.mutable_config()->set_rnti(0x100);
+    sc.mutable_config()->set_imsi(208950000000256);
+    sc.mutable_config()->set_dl_slice_id(3);
+    rib.get_bs(bs)->update_UE_config(sc);
+    flexran::core::metrics::writer w2;
+    m.write(rib, w2);
+    REQUIRE (w2.finish().find("slice_id=\"3\",rnti=\"256\"") != std::string::npos);
+  }
+}
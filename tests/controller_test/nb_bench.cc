@@ -0,0 +1,269 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    nb_bench.cc
+ *  \brief   throughput of concurrent northbound statistics reads against RIB
+ *           snapshots while the task manager keeps updating the RIB
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rib.h"
+#include "async_xface.h"
+#include "requests_manager.h"
+#include "subscription.h"
+#include "stats_manager.h"
+#include "command_queue.h"
+
+using namespace std::chrono;
+
+namespace {
+
+  const int num_bs = 100;
+  const int num_ue = 200;
+  /* same as the REST API */
+  const milliseconds snapshot_max_age(20);
+
+  uint64_t bs_id_of(int i) { return 0xe0000 + i; }
+  flexran::rib::rnti_t rnti_of(int j) { return 0x1000 + j; }
+
+  void populate(flexran::rib::Rib& rib)
+  {
+    using cap = protocol::flex_bs_capability;
+    protocol::flex_hello h;
+    for (cap c : {cap::LOPHY, cap::HIPHY, cap::LOMAC, cap::HIMAC, cap::RLC,
+                  cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP})
+      h.add_capabilities(c);
+    for (int i = 0; i < num_bs; ++i) {
+      rib.add_pending_agent(std::make_shared<flexran::rib::agent_info>(i,
+            bs_id_of(i), flexran::rib::agent_capabilities(h.capabilities()),
+            flexran::rib::agent_splits(h.splits()), "127.0.0.1:2210"));
+      rib.new_eNB_config_entry(bs_id_of(i));
+      auto bs = rib.get_bs(bs_id_of(i));
+
+      protocol::flex_enb_config_reply ec;
+      protocol::flex_cell_config *cc = ec.add_cell_config();
+      cc->set_phy_cell_id(i);
+      cc->set_dl_bandwidth(50);
+      cc->set_ul_bandwidth(50);
+      bs->update_eNB_config(ec);
+
+      for (int j = 0; j < num_ue; ++j) {
+        protocol::flex_ue_state_change sc;
+        sc.set_type(protocol::FLUESC_ACTIVATED);
+        sc.mutable_config()->set_rnti(rnti_of(j));
+        sc.mutable_config()->set_imsi(208950000000000 + i * num_ue + j);
+        sc.mutable_config()->set_dl_slice_id(0);
+        bs->update_UE_config(sc);
+      }
+    }
+  }
+
+  void update_stats(flexran::rib::Rib& rib, int i, uint32_t round)
+  {
+    protocol::flex_stats_reply s;
+    for (int j = 0; j < num_ue; ++j) {
+      protocol::flex_ue_stats_report *r = s.add_ue_report();
+      r->set_rnti(rnti_of(j));
+      r->set_flags(protocol::FLUST_PHR | protocol::FLUST_BSR
+          | protocol::FLUST_RLC_BS | protocol::FLUST_DL_CQI
+          | protocol::FLUST_MAC_STATS | protocol::FLUST_PDCP_STATS);
+      r->set_phr(round % 40);
+      for (int k = 0; k < 4; ++k)
+        r->add_bsr(round + k);
+      protocol::flex_rlc_bsr *rlc = r->add_rlc_report();
+      rlc->set_lc_id(3);
+      rlc->set_tx_queue_size(round * 100);
+      r->mutable_dl_cqi_report()->set_sfn_sn(round % 10240);
+      r->mutable_dl_cqi_report()->add_csi_report()->set_ri(1);
+      r->mutable_mac_stats()->set_tbs_dl(round * 7);
+      r->mutable_mac_stats()->set_prb_dl(round % 50);
+      r->mutable_mac_stats()->set_mcs1_dl(round % 28);
+      r->mutable_pdcp_stats()->set_pkt_tx(round);
+      r->mutable_pdcp_stats()->set_pkt_rx(round);
+    }
+    rib.get_bs(bs_id_of(i))->update_mac_stats(s);
+  }
+
+  enum class workload { bs, ue, all };
+
+  const char *workload_name(workload w)
+  {
+    switch (w) {
+      case workload::bs:  return "GET /stats/enb/:id";
+      case workload::ue:  return "GET /stats/ue/:id";
+      case workload::all: return "GET /stats";
+    }
+    return "";
+  }
+
+  struct bench {
+    flexran::rib::Rib& rib;
+    flexran::app::stats::stats_manager& stats;
+    flexran::core::command_queue& commands;
+    std::mutex snapshot_mutex;
+
+    /* emulates the task manager: every ms, a tenth of the BSs send
+     * statistics, afterwards the northbound commands run */
+    void task_manager(std::atomic<bool>& stop, nanoseconds& max_cmd, uint64_t& ticks)
+    {
+      uint32_t round = 0;
+      auto next = steady_clock::now();
+      while (!stop) {
+        for (int i = round % 10; i < num_bs; i += 10)
+          update_stats(rib, i, round);
+        const auto t0 = steady_clock::now();
+        commands.run_pending();
+        max_cmd = std::max(max_cmd, duration_cast<nanoseconds>(steady_clock::now() - t0));
+        round++;
+        ticks++;
+        next += milliseconds(1);
+        std::this_thread::sleep_until(next);
+      }
+    }
+
+    /* what a REST handler does, see stats_manager_calls */
+    size_t request(workload w, unsigned& seed)
+    {
+      if (stats.snapshot_outdated(snapshot_max_age)) {
+        std::unique_lock<std::mutex> lk(snapshot_mutex);
+        if (stats.snapshot_outdated(snapshot_max_age)) {
+          auto s = commands.run([this] { return stats.prepare_snapshot(); });
+          stats.publish_snapshot(std::move(s));
+        }
+      }
+      const int i = rand_r(&seed) % num_bs;
+      std::string out;
+      switch (w) {
+        case workload::bs:
+          stats.stats_etag("all", bs_id_of(i));
+          stats.stats_by_bs_id_to_json_string(bs_id_of(i), out);
+          break;
+        case workload::ue: {
+          const flexran::rib::rnti_t rnti = rnti_of(rand_r(&seed) % num_ue);
+          stats.ue_stats_etag(rnti, bs_id_of(i));
+          stats.ue_stats_by_rnti_by_bs_id_to_json_string(rnti, out, bs_id_of(i));
+          break;
+        }
+        case workload::all:
+          stats.stats_etag("all");
+          out = stats.all_stats_to_json_string();
+          break;
+      }
+      return out.size();
+    }
+
+    void run(workload w, int threads, seconds run_time)
+    {
+      std::atomic<bool> stop_tm{false};
+      nanoseconds max_cmd{0};
+      uint64_t ticks = 0;
+      std::thread tm(&bench::task_manager, this, std::ref(stop_tm),
+          std::ref(max_cmd), std::ref(ticks));
+
+      std::atomic<bool> stop{false};
+      std::vector<uint64_t> ops(threads, 0);
+      std::vector<uint64_t> bytes(threads, 0);
+      std::vector<std::thread> readers;
+      const auto start = steady_clock::now();
+      for (int t = 0; t < threads; ++t)
+        readers.emplace_back([this, w, t, &stop, &ops, &bytes] () {
+          unsigned seed = t + 1;
+          uint64_t n = 0, b = 0;
+          while (!stop) {
+            b += request(w, seed);
+            n++;
+          }
+          ops[t] = n;
+          bytes[t] = b;
+        });
+      std::this_thread::sleep_for(run_time);
+      stop = true;
+      for (auto& r : readers)
+        r.join();
+      const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+      stop_tm = true;
+      tm.join();
+
+      uint64_t total = 0, total_bytes = 0;
+      for (int t = 0; t < threads; ++t) {
+        total += ops[t];
+        total_bytes += bytes[t];
+      }
+      printf("%-20s %3d threads: %10.0f req/s %8.1f MiB/s, max command time on"
+             " task manager %6.2f ms (%lu ticks)\n",
+             workload_name(w), threads, total / secs,
+             total_bytes / secs / (1 << 20), max_cmd.count() / 1e6,
+             static_cast<unsigned long>(ticks));
+    }
+  };
+
+}
+
+int main(int argc, char *argv[])
+{
+  const seconds run_time(argc > 1 ? atoi(argv[1]) : 2);
+  const int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+
+  flexran::rib::Rib rib;
+  flexran::network::async_xface net_xface(0);
+  flexran::core::requests_manager rm(rib, net_xface);
+  flexran::event::subscription ev;
+  flexran::app::stats::stats_manager stats(rib, rm, ev);
+  flexran::core::command_queue commands;
+
+  printf("populating RIB with %d BSs x %d UEs\n", num_bs, num_ue);
+  populate(rib);
+  for (int i = 0; i < num_bs; ++i)
+    update_stats(rib, i, 0);
+
+  auto ms_since = [] (steady_clock::time_point t) {
+    return duration_cast<duration<double, std::milli>>(steady_clock::now() - t).count();
+  };
+  auto t0 = steady_clock::now();
+  std::shared_ptr<flexran::rib::Rib> s = rib.prepare_snapshot();
+  const double prep = ms_since(t0);
+  t0 = steady_clock::now();
+  s->complete_snapshot();
+  printf("full snapshot: %.2f ms in task manager, %.2f ms in REST thread\n",
+      prep, ms_since(t0));
+  for (int i = 0; i < num_bs; ++i)
+    update_stats(rib, i, 1);
+  t0 = steady_clock::now();
+  std::shared_ptr<flexran::rib::Rib> s2 = rib.prepare_snapshot(s);
+  const double prep2 = ms_since(t0);
+  t0 = steady_clock::now();
+  s2->complete_snapshot();
+  printf("snapshot after all stats changed: %.2f ms in task manager, %.2f ms "
+      "in REST thread\n", prep2, ms_since(t0));
+
+  bench b{rib, stats, commands, {}};
+  for (workload w : {workload::bs, workload::ue, workload::all})
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+      b.run(w, threads, run_time);
+  return 0;
+}
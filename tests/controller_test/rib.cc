@@ -1,9 +1,13 @@
 #include "catch.hpp"
 #include "flexran.pb.h"
+#include "northbound.pb.h"
 #include "rib.h"
 #include "agent_info.h"
 #include <vector>
 
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/delimited_message_util.h>
+
 using cap = protocol::flex_bs_capability;
 using spl = protocol::flex_bs_split;
 
@@ -225,3 +229,253 @@ TEST_CASE("Refuse BS with the same ID")
   REQUIRE(rib.add_pending_agent(a2) == true);
   REQUIRE(rib.new_eNB_config_entry(bs1) == false);
 }
+
+TEST_CASE("RIB snapshots are independent of the RIB", "[rib]")
+{
+  flexran::rib::Rib rib;
+  const std::vector<protocol::flex_bs_capability> all_caps =
+      {cap::LOPHY, cap::HIPHY, cap::LOMAC, cap::HIMAC,
+       cap::RLC, cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP};
+  const uint64_t bs1 = 0xe0000;
+  const uint64_t bs2 = 0xf0000;
+  const flexran::rib::rnti_t rnti = 0x1234;
+  REQUIRE(rib.add_pending_agent(make_agent(0, bs1, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs1) == true);
+  REQUIRE(rib.add_pending_agent(make_agent(2, bs2, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs2) == true);
+
+  protocol::flex_ue_state_change sc;
+  sc.set_type(protocol::FLUESC_ACTIVATED);
+  sc.mutable_config()->set_rnti(rnti);
+  rib.get_bs(bs1)->update_UE_config(sc);
+  protocol::flex_stats_reply s;
+  s.add_ue_report()->set_rnti(rnti);
+  s.mutable_ue_report(0)->set_flags(protocol::FLUST_PHR);
+  s.mutable_ue_report(0)->set_phr(10);
+  rib.get_bs(bs1)->update_mac_stats(s);
+
+  const auto snap = rib.snapshot();
+  REQUIRE(snap->get_available_base_stations() == rib.get_available_base_stations());
+  REQUIRE(snap->get_bs(bs1) != rib.get_bs(bs1));
+  REQUIRE(snap->get_bs(bs1)->get_stats_version() == rib.get_bs(bs1)->get_stats_version());
+  REQUIRE(snap->get_bs(bs1)->get_ue_mac_info(rnti)->get_mac_stats_report().phr() == 10);
+
+  /* changes of the RIB do not show up in the snapshot */
+  s.mutable_ue_report(0)->set_phr(20);
+  rib.get_bs(bs1)->update_mac_stats(s);
+  REQUIRE(snap->get_bs(bs1)->get_ue_mac_info(rnti)->get_mac_stats_report().phr() == 10);
+
+  /* a new snapshot shares what did not change */
+  const auto snap2 = rib.snapshot(snap);
+  REQUIRE(snap2->get_bs(bs2) == snap->get_bs(bs2));
+  REQUIRE(snap2->get_bs(bs1) != snap->get_bs(bs1));
+  REQUIRE(snap2->get_bs(bs1)->get_ue_mac_info(rnti)->get_mac_stats_report().phr() == 20);
+
+  /* timing and HARQ information are refreshed without a stats update */
+  protocol::flex_sf_trigger t;
+  t.set_sfn_sf((17 << 4) | 3);
+  auto *dl = t.add_dl_info();
+  dl->set_rnti(rnti);
+  dl->set_serv_cell_index(0);
+  dl->set_harq_process_id(5);
+  dl->add_harq_status(protocol::FLHS_NACK);
+  rib.get_bs(bs1)->update_subframe(t);
+  const auto snap3 = rib.snapshot(snap2);
+  REQUIRE(snap3->get_bs(bs1) != snap2->get_bs(bs1));
+  REQUIRE(snap3->get_bs(bs1)->get_current_frame() == 17);
+  REQUIRE(snap3->get_bs(bs1)->get_current_subframe() == 3);
+  REQUIRE(snap3->get_bs(bs1)->get_ue_mac_info(rnti)->get_harq_stats(0, 5) == protocol::FLHS_NACK);
+  REQUIRE(snap2->get_bs(bs1)->get_ue_mac_info(rnti)->get_harq_stats(0, 5) == protocol::FLHS_ACK);
+  REQUIRE(snap3->get_bs(bs1)->get_ue_mac_info(rnti)->get_mac_stats_report().phr() == 20);
+  REQUIRE(rib.snapshot(snap3)->get_bs(bs1) == snap3->get_bs(bs1));
+
+  /* removed BSs stay in the snapshot */
+  REQUIRE(rib.remove_eNB_config_entry(2) == true);
+  REQUIRE(rib.get_bs(bs2) == nullptr);
+  REQUIRE(snap2->get_bs(bs2) != nullptr);
+  REQUIRE(rib.snapshot(snap2)->get_bs(bs2) == nullptr);
+}
+
+TEST_CASE("JSON statistics are filtered while serializing", "[rib]")
+{
+  flexran::rib::Rib rib;
+  const std::vector<protocol::flex_bs_capability> all_caps =
+      {cap::LOPHY, cap::HIPHY, cap::LOMAC, cap::HIMAC,
+       cap::RLC, cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP};
+  const uint64_t bs1 = 0xe0000;
+  const uint64_t bs2 = 0xf0000;
+  REQUIRE(rib.add_pending_agent(make_agent(0, bs1, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs1) == true);
+  REQUIRE(rib.add_pending_agent(make_agent(2, bs2, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs2) == true);
+
+  /* UEs 0x100 (slice 0), 0x101 (slice 1, IMSI 208950000000001), 0x102
+   * (slice 1) at BS 1 */
+  protocol::flex_stats_reply s;
+  for (flexran::rib::rnti_t rnti : {0x100, 0x101, 0x102}) {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->set_rnti(rnti);
+    sc.mutable_config()->set_dl_slice_id(rnti == 0x100 ? 0 : 1);
+    if (rnti == 0x101)
+      sc.mutable_config()->set_imsi(208950000000001);
+    rib.get_bs(bs1)->update_UE_config(sc);
+    protocol::flex_ue_stats_report *r = s.add_ue_report();
+    r->set_rnti(rnti);
+    r->set_flags(protocol::FLUST_PHR | protocol::FLUST_BSR | protocol::FLUST_MAC_STATS);
+    r->set_phr(10);
+    r->add_bsr(5);
+    r->mutable_mac_stats()->set_tbs_dl(1000);
+    r->mutable_mac_stats()->set_prb_dl(7);
+  }
+  rib.get_bs(bs1)->update_mac_stats(s);
+
+  flexran::rib::stats_filter filter;
+  std::string error_reason;
+
+  SECTION("default filter writes everything") {
+    REQUIRE(rib.dump_all_mac_stats_to_json_string(filter)
+        == rib.dump_all_mac_stats_to_json_string());
+    REQUIRE(rib.dump_all_enb_configurations_to_json_string(filter)
+        == rib.dump_all_enb_configurations_to_json_string());
+  }
+
+  SECTION("unknown fields are refused") {
+    REQUIRE(filter.set_fields("dl_cqi_rep", error_reason) == false);
+    REQUIRE(filter.set_fields("mac_stats.dl_cqi", error_reason) == false);
+    REQUIRE(filter.set_fields("bsr.foo", error_reason) == false);
+    REQUIRE(filter.set_fields("macStats.foo", error_reason) == false);
+  }
+
+  SECTION("fields are projected, with protobuf or JSON names") {
+    REQUIRE(filter.set_fields("bsr,macStats.tbsDl", error_reason) == true);
+    std::string out;
+    REQUIRE(rib.dump_ue_by_rnti_by_bs_id_to_json_string(0x100, out, bs1, filter) == true);
+    REQUIRE(out == "{\"rnti\": 256,\"mac_stats\":{\"bsr\":[5],\"macStats\":{\"tbsDl\":1000}}}");
+
+    REQUIRE(filter.set_fields("phr,harq", error_reason) == true);
+    REQUIRE(rib.dump_ue_by_rnti_by_bs_id_to_json_string(0x100, out, bs1, filter) == true);
+    REQUIRE(out.find("\"phr\":10") != std::string::npos);
+    REQUIRE(out.find("\"harq\"") != std::string::npos);
+    REQUIRE(out.find("bsr") == std::string::npos);
+  }
+
+  SECTION("top-level fields have short names") {
+    REQUIRE(filter.set_fields("dl_cqi,bsr,mac.tbs_dl", error_reason) == true);
+    std::string out;
+    REQUIRE(rib.dump_ue_by_rnti_by_bs_id_to_json_string(0x100, out, bs1, filter) == true);
+    REQUIRE(out == "{\"rnti\": 256,\"mac_stats\":{\"bsr\":[5],\"macStats\":{\"tbsDl\":1000}}}");
+  }
+
+  SECTION("BSs and UEs are selected") {
+    filter.set_bs({bs1});
+    filter.set_dl_slice(1);
+    const std::string stats = rib.dump_all_mac_stats_to_json_string(filter);
+    REQUIRE(stats.find("\"bs_id\":983040") == std::string::npos);
+    REQUIRE(stats.find("\"rnti\": 256") == std::string::npos);
+    REQUIRE(stats.find("\"rnti\": 257") != std::string::npos);
+    REQUIRE(stats.find("\"rnti\": 258") != std::string::npos);
+    const std::string configs = rib.dump_all_enb_configurations_to_json_string(filter);
+    REQUIRE(configs.find("\"rnti\":256") == std::string::npos);
+    REQUIRE(configs.find("\"rnti\":257") != std::string::npos);
+
+    filter.set_ues("208950000000001,256");
+    const std::string by_imsi = rib.dump_all_mac_stats_to_json_string(filter);
+    REQUIRE(by_imsi.find("\"rnti\": 256") == std::string::npos);
+    REQUIRE(by_imsi.find("\"rnti\": 257") != std::string::npos);
+    REQUIRE(by_imsi.find("\"rnti\": 258") == std::string::npos);
+  }
+
+  SECTION("the number of UEs is limited") {
+    filter.set_limit(2);
+    const std::string stats = rib.dump_all_mac_stats_to_json_string(filter);
+    REQUIRE(stats.find("\"rnti\": 256") != std::string::npos);
+    REQUIRE(stats.find("\"rnti\": 257") != std::string::npos);
+    REQUIRE(stats.find("\"rnti\": 258") == std::string::npos);
+  }
+
+  SECTION("UEs are paged with cursors") {
+    /* one more UE at BS 2 */
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->set_rnti(0x200);
+    rib.get_bs(bs2)->update_UE_config(sc);
+
+    filter.set_limit(2);
+    std::string cursor = rib.next_cursor(filter);
+    REQUIRE(cursor == flexran::rib::stats_filter::format_cursor(bs1, 0x101));
+    REQUIRE(rib.dump_all_mac_stats_to_json_string(filter).find("983040") == std::string::npos);
+
+    REQUIRE(filter.set_cursor(cursor, error_reason) == true);
+    const std::string page2 = rib.dump_all_mac_stats_to_json_string(filter);
+    REQUIRE(page2.find("\"rnti\": 257") == std::string::npos);
+    REQUIRE(page2.find("\"rnti\": 258") != std::string::npos);
+    REQUIRE(page2.find("\"rnti\": 512") != std::string::npos);
+    REQUIRE(rib.next_cursor(filter) == "");
+
+    /* the BS where the last page ended is not repeated without UEs */
+    filter.set_limit(1);
+    REQUIRE(filter.set_cursor(flexran::rib::stats_filter::format_cursor(bs1, 0x102),
+          error_reason) == true);
+    const std::string page3 = rib.dump_all_mac_stats_to_json_string(filter);
+    REQUIRE(page3.find("\"bs_id\":917504") == std::string::npos);
+    REQUIRE(page3.find("\"rnti\": 512") != std::string::npos);
+
+    REQUIRE(filter.set_cursor("917504", error_reason) == false);
+    REQUIRE(filter.set_cursor("917504-x", error_reason) == false);
+  }
+
+  SECTION("dumps are written in pieces") {
+    std::vector<std::string> pieces;
+    rib.dump_mac_stats_to_json([&pieces] (const std::string& p) { pieces.push_back(p); },
+        filter);
+    REQUIRE(pieces.size() > 3);
+    std::string all;
+    for (const auto& p : pieces)
+      all += p;
+    REQUIRE(all == flexran::rib::Rib::format_mac_stats_to_json({
+          rib.get_bs(bs1)->dump_mac_stats_to_json_string(),
+          rib.get_bs(bs2)->dump_mac_stats_to_json_string()}));
+  }
+
+  SECTION("protobuf output is filtered the same way") {
+    auto parse = [] (const std::string& out) {
+      std::vector<protocol::flex_nb_bs> v;
+      google::protobuf::io::ArrayInputStream in(out.data(), out.size());
+      bool clean_eof = false;
+      protocol::flex_nb_bs m;
+      while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&m, &in, &clean_eof)) {
+        v.push_back(m);
+        m.Clear();
+      }
+      REQUIRE(clean_eof);
+      return v;
+    };
+    std::string out;
+    auto append = [&out] (const std::string& p) { out += p; };
+
+    rib.dump_to_protobuf(append, true, true, filter);
+    std::vector<protocol::flex_nb_bs> all = parse(out);
+    REQUIRE(all.size() == 2);
+    REQUIRE(all[0].bs_id() == bs1);
+    REQUIRE(all[0].ue_report_size() == 3);
+    REQUIRE(all[0].ue_report(1).mac_stats().tbs_dl() == 1000);
+    REQUIRE(all[0].ue_config().ue_config_size() == 3);
+    REQUIRE(all[1].bs_id() == bs2);
+    REQUIRE(all[1].ue_report_size() == 0);
+
+    out.clear();
+    filter.set_bs({bs1});
+    filter.set_dl_slice(1);
+    REQUIRE(filter.set_fields("phr", error_reason) == true);
+    rib.dump_to_protobuf(append, false, true, filter);
+    std::vector<protocol::flex_nb_bs> sel = parse(out);
+    REQUIRE(sel.size() == 1);
+    REQUIRE(sel[0].has_enb_config() == false);
+    REQUIRE(sel[0].ue_report_size() == 2);
+    REQUIRE(sel[0].ue_report(0).rnti() == 0x101);
+    REQUIRE(sel[0].ue_report(0).phr() == 10);
+    REQUIRE(sel[0].ue_report(0).bsr_size() == 0);
+    REQUIRE(sel[0].ue_report(1).rnti() == 0x102);
+  }
+}
@@ -0,0 +1,34 @@
+#include "catch.hpp"
+#include "rt_wrapper.h"
+namespace rt = flexran::core::rt;
+
+TEST_CASE("test CPU list parsing", "[rt_wrapper]")
+{
+  std::vector<int> cpus;
+  std::string err;
+  REQUIRE (rt::parse_cpu_list("3", cpus, err));
+  REQUIRE (cpus == std::vector<int>({3}));
+  REQUIRE (rt::parse_cpu_list("0,2-4,7", cpus, err));
+  REQUIRE (cpus == std::vector<int>({0, 2, 3, 4, 7}));
+
+  REQUIRE (rt::parse_cpu_list("", cpus, err) == false);
+  REQUIRE (rt::parse_cpu_list("4-2", cpus, err) == false);
+  REQUIRE (rt::parse_cpu_list("1,a", cpus, err) == false);
+  REQUIRE (rt::parse_cpu_list("1-2x", cpus, err) == false);
+  REQUIRE (rt::parse_cpu_list("-1", cpus, err) == false);
+}
+
+TEST_CASE("test placement of the calling thread", "[rt_wrapper]")
+{
+  std::vector<int> cpus;
+  REQUIRE (rt::get_cpu_affinity(cpus));
+  REQUIRE (cpus.size() > 0);
+
+  std::string err;
+  REQUIRE (rt::set_cpu_affinity({cpus[0]}, err));
+  std::vector<int> pinned;
+  REQUIRE (rt::get_cpu_affinity(pinned));
+  REQUIRE (pinned == std::vector<int>({cpus[0]}));
+  REQUIRE (rt::describe_placement().find("CPUs " + std::to_string(cpus[0])) == 0);
+  REQUIRE (rt::set_cpu_affinity(cpus, err));
+}
@@ -0,0 +1,167 @@
+#include <vector>
+
+#include "catch.hpp"
+#include "transaction_table.h"
+#include "requests_manager.h"
+#include "async_xface.h"
+#include "rib.h"
+
+using cap = protocol::flex_bs_capability;
+using spl = protocol::flex_bs_split;
+
+/* defined in rib.cc */
+std::shared_ptr<flexran::rib::agent_info> make_agent(
+    int agent_id, uint64_t bs_id, const std::vector<cap>& cs,
+    const std::vector<spl>& sp);
+
+namespace {
+  protocol::flexran_message enb_config_request()
+  {
+    protocol::flexran_message m;
+    m.set_msg_dir(protocol::INITIATING_MESSAGE);
+    m.mutable_enb_config_request_msg()->mutable_header()->set_type(
+        protocol::FLPT_GET_ENB_CONFIG_REQUEST);
+    return m;
+  }
+
+  protocol::flexran_message enb_config_reply(uint32_t xid)
+  {
+    protocol::flexran_message m;
+    m.set_msg_dir(protocol::SUCCESSFUL_OUTCOME);
+    m.mutable_enb_config_reply_msg()->mutable_header()->set_xid(xid);
+    return m;
+  }
+}
+
+TEST_CASE("test transaction table", "[transaction_table]")
+{
+  typedef flexran::core::transaction_table tt;
+  tt t(100);
+  std::vector<tt::result> results;
+  const tt::callback cb = [&results] (tt::result r, const protocol::flexran_message *reply) {
+    REQUIRE ((reply != nullptr) == (r == tt::result::reply));
+    results.push_back(r);
+  };
+
+  SECTION("xids are unique and leave the lower ones to the apps") {
+    const uint32_t x1 = t.next_xid();
+    const uint32_t x2 = t.next_xid();
+    REQUIRE (x1 >= tt::first_xid);
+    REQUIRE (x2 != x1);
+  }
+
+  SECTION("replies are matched by agent, xid and message type") {
+    protocol::flexran_message req = enb_config_request();
+    const uint32_t xid = t.next_xid();
+    tt::mutable_header(req)->set_xid(xid);
+    t.add(1, req, cb);
+    t.add(2, req, cb);
+    REQUIRE (t.num_outstanding() == 2);
+    REQUIRE (t.num_outstanding(1) == 1);
+
+    /* wrong agent, wrong xid, wrong type */
+    REQUIRE_FALSE (t.complete(3, enb_config_reply(xid)));
+    REQUIRE_FALSE (t.complete(1, enb_config_reply(xid + 1)));
+    protocol::flexran_message ue_reply;
+    ue_reply.mutable_ue_config_reply_msg()->mutable_header()->set_xid(xid);
+    REQUIRE_FALSE (t.complete(1, ue_reply));
+    /* messages that do not answer a request are skipped by their type */
+    protocol::flexran_message sc;
+    sc.mutable_ue_state_change_msg()->mutable_header()->set_xid(xid);
+    REQUIRE_FALSE (t.complete(1, sc));
+
+    REQUIRE (t.complete(1, enb_config_reply(xid)));
+    REQUIRE_FALSE (t.complete(1, enb_config_reply(xid)));
+    REQUIRE (results == std::vector<tt::result>({tt::result::reply}));
+    REQUIRE (t.num_outstanding(1) == 0);
+    REQUIRE (t.num_replies() == 1);
+
+    flexran::core::metrics::writer w;
+    t.write_metrics(w);
+    const std::string out = w.finish();
+    REQUIRE (out.find("flexran_agent_request_latency_seconds_count{type=\"enb_config_request_msg\"} 1")
+             != std::string::npos);
+  }
+
+  SECTION("requests time out in the timer wheel") {
+    protocol::flexran_message req = enb_config_request();
+    tt::mutable_header(req)->set_xid(t.next_xid());
+    t.add(1, req, cb);
+    t.expire(99);
+    REQUIRE (t.num_outstanding() == 1);
+    t.expire(100);
+    REQUIRE (t.num_outstanding() == 0);
+    REQUIRE (results == std::vector<tt::result>({tt::result::timeout}));
+
+    /* added at tick 100, a long pause visits every slot */
+    tt::mutable_header(req)->set_xid(t.next_xid());
+    t.add(1, req, cb);
+    tt::mutable_header(req)->set_xid(t.next_xid());
+    t.add(2, req, cb);
+    t.expire(150);
+    REQUIRE (t.num_outstanding() == 2);
+    t.expire(5000);
+    REQUIRE (t.num_outstanding() == 0);
+    REQUIRE (t.num_timeouts() == 3);
+  }
+
+  SECTION("requests of disconnected agents are completed") {
+    protocol::flexran_message req = enb_config_request();
+    tt::mutable_header(req)->set_xid(t.next_xid());
+    t.add(1, req, cb);
+    t.add(2, req, cb);
+    t.remove_agent(1);
+    REQUIRE (results == std::vector<tt::result>({tt::result::disconnect}));
+    REQUIRE (t.num_outstanding() == 1);
+  }
+
+  SECTION("only requests that are answered are tracked") {
+    protocol::flexran_message m;
+    m.mutable_stats_request_msg()->mutable_header();
+    m.mutable_stats_request_msg()->mutable_complete_stats_request()
+        ->set_report_frequency(protocol::FLSRF_PERIODICAL);
+    t.add(1, m, cb);
+    m.mutable_agent_reconfiguration_msg()->mutable_header();
+    t.add(1, m, cb);
+    REQUIRE (t.num_outstanding() == 0);
+    m.mutable_stats_request_msg()->mutable_header();
+    m.mutable_stats_request_msg()->mutable_complete_stats_request()
+        ->set_report_frequency(protocol::FLSRF_ONCE);
+    t.add(1, m, cb);
+    REQUIRE (t.num_outstanding() == 1);
+  }
+}
+
+TEST_CASE("requests are tracked per agent of a BS", "[transaction_table]")
+{
+  flexran::rib::Rib rib;
+  flexran::network::async_xface net_xface(0);
+  flexran::core::requests_manager rm(rib, net_xface);
+  const uint64_t bs = 0xe0000;
+  REQUIRE (rib.add_pending_agent(make_agent(0, bs, {cap::LOPHY, cap::HIPHY, cap::LOMAC}, {})));
+  REQUIRE (rib.add_pending_agent(make_agent(1, bs, {cap::HIMAC, cap::RLC, cap::PDCP,
+      cap::SDAP, cap::RRC, cap::S1AP}, {})));
+  REQUIRE (rib.new_eNB_config_entry(bs));
+
+  int replies = 0;
+  protocol::flexran_message req = enb_config_request();
+  const uint32_t xid = rm.send_request(bs, req,
+      [&replies] (flexran::core::transaction_table::result, const protocol::flexran_message *) { replies++; });
+  REQUIRE (req.enb_config_request_msg().header().xid() == xid);
+  REQUIRE (net_xface.out_queue_depth() == 2);
+  REQUIRE (rm.transactions().num_outstanding() == 2);
+  REQUIRE (rm.transactions().complete(0, enb_config_reply(xid)));
+  REQUIRE (rm.transactions().complete(1, enb_config_reply(xid)));
+  REQUIRE (replies == 2);
+  REQUIRE (rm.send_request(bs, req) != xid);
+  REQUIRE (rm.transactions().num_outstanding() == 2);
+
+  /* requests that can not be sent are not tracked */
+  while (net_xface.send_msg(req, 0)) {}
+  rm.send_request(bs, req,
+      [&replies] (flexran::core::transaction_table::result, const protocol::flexran_message *) { replies++; });
+  REQUIRE (rm.transactions().num_outstanding() == 2);
+  rm.transactions().expire(5000);
+  REQUIRE (rm.transactions().num_timeouts() == 2);
+  REQUIRE (replies == 2);
+}